@@ -5,6 +5,7 @@
 #include "model/MobiusConfig.h"
 #include "model/UIAction.h"
 #include "model/FunctionDefinition.h"
+#include "model/UIParameter.h"
 #include "model/Binding.h"
 
 #include "KeyTracker.h"
@@ -15,19 +16,26 @@
 Binderator::Binderator(Supervisor * super)
 {
     supervisor = super;
+    midiAction = new UIAction();
 }
 
 Binderator::~Binderator()
 {
     KeyTracker::removeListener(this);
     supervisor->getMidiManager()->removeListener(this);
+    delete midiAction;
 }
 
+/**
+ * Note bindings are handled on the MIDI thread when they can be,
+ * the rest still come in through midiMessage.
+ */
 void Binderator::start()
 {
     if (!started) {
         KeyTracker::addListener(this);
         supervisor->getMidiManager()->addListener(this);
+        supervisor->getMidiManager()->setRealtimeListener(this);
         started = true;
     }
 }
@@ -43,30 +51,37 @@ void Binderator::stop()
 
 void Binderator::configure(MobiusConfig* config)
 {
+    juce::ScopedLock lock (midiLock);
+    
     // if we're reconfiguring, initialize the binding array
     keyActions.clear();
-    noteActions.clear();
+    midiActions.clear();
     // juce::Array is fucking annoying, even if you call ensureStorageAllocated
     // you can't just index into sparse arrays without setting something
     // there first, even if it is nullptr, if not it appends
     // if we do this then don't really need to call clear()
     for (int i = 0 ; i < 256 ; i++) {
         keyActions.set(i, nullptr);
-        noteActions.set(i, nullptr);
     }
+
+    // the MIDI table is allocated once and cleared on each configure
+    if (midiSlots == nullptr)
+      midiSlots.allocate(BinderatorMidiSlots, true);
+    else
+      midiSlots.clear(BinderatorMidiSlots);
     
     // only pay attention to the base set for now
     BindingSet* baseBindings = config->getBindingSets();
     if (baseBindings != nullptr) {
         Binding* bindings = baseBindings->getBindings();
         while (bindings != nullptr) {
-            installAction(bindings);
+            installAction(bindings, config);
             bindings = bindings->getNext();
         }
     }
 }
 
-void Binderator::installAction(Binding* b)
+void Binderator::installAction(Binding* b, MobiusConfig* config)
 {
     Trigger* trigger = b->trigger;
 
@@ -108,40 +123,164 @@ void Binderator::installAction(Binding* b)
             }
         }
     }
+    else if (trigger == TriggerNote || trigger == TriggerControl || trigger == TriggerProgram) {
+        installMidi(b, config);
+    }
+    else if (trigger == TriggerPitch) {
+        Trace(1, "Binderator: Ignoring pitch bend Binding %s\n", name);
+    }
+}
+
+/**
+ * Compile a MIDI binding into the table.
+ *
+ * Notes get a down action in the note on slot and an up action in the
+ * note off slot with the same trigger id so sustainable functions and
+ * long presses work.  Controllers bound to functions are momentary with
+ * zero being up.  Controllers bound to parameters scale their value
+ * into the parameter range.  Program changes bound to parameters use
+ * the program number as the value unless the binding has arguments.
+ */
+void Binderator::installMidi(Binding* b, MobiusConfig* config)
+{
+    const char* name = b->getActionName();
+    Trigger* trigger = b->trigger;
+    int number = b->triggerValue;
+    int channel = b->midiChannel;
+    ActionType* type = b->action;
+    
+    if (number < 0 || number > 127) {
+        Trace(1, "Binderator: Invalid MIDI value for %s %ld\n", name, (long)number);
+    }
+    else if (channel < 0 || channel > 15) {
+        Trace(1, "Binderator: Invalid MIDI channel for %s %ld\n", name, (long)channel);
+    }
+    else if (type == nullptr) {
+        Trace(1, "Binderator: Ignoring Binding with no action type %s\n", name);
+    }
+    else if (type != ActionFunction && type != ActionParameter) {
+        // only support Functions and Parameters for awhile
+        Trace(1, "Binderator: Ignoring Binding for action %s\n", name);
+    }
     else if (trigger == TriggerNote) {
-        // todo: channels, do we really need 16 arrays for all this or should
-        // we pile them into one and have a list?
-        int note = b->triggerValue;
-        if (note < 0 || note > 0xFF) {
-            Trace(1, "Binderator: Invalid MIDI note %d\n", note);
+        UIAction* down = newMidiAction(b, 0x90, true);
+        if (down != nullptr) {
+            setMidiSlot(BinderatorNoteOn, channel, number, down, 0, 0);
+            if (type == ActionFunction) {
+                UIAction* up = newMidiAction(b, 0x90, false);
+                setMidiSlot(BinderatorNoteOff, channel, number, up, 0, 0);
+            }
         }
-        else {
-            ActionType* type = b->action;
-            if (type == nullptr) {
-                Trace(1, "Binderator: Ignoring Binding with no action type %s\n", name);
+    }
+    else if (trigger == TriggerControl) {
+        UIAction* action = newMidiAction(b, 0xB0, true);
+        if (action != nullptr) {
+            int high = 0;
+            if (type == ActionParameter) {
+                action->triggerMode = TriggerModeContinuous;
+                high = getParameterHigh(action->implementation.parameter, config);
             }
-            else if (type != ActionFunction) {
-                // only support Functions for awhile
-                Trace(1, "Binderator: Ignoring Binding for non-function action %s\n", name);
+            else {
+                action->triggerMode = TriggerModeMomentary;
+            }
+            int low = (type == ActionParameter) ? action->implementation.parameter->low : 0;
+            setMidiSlot(BinderatorControl, channel, number, action, low, high);
+        }
+    }
+    else if (trigger == TriggerProgram) {
+        UIAction* action = newMidiAction(b, 0xC0, true);
+        if (action != nullptr) {
+            action->triggerMode = TriggerModeOnce;
+            int high = 0;
+            if (type == ActionParameter && action->arg.isNull())
+              high = getParameterHigh(action->implementation.parameter, config);
+            setMidiSlot(BinderatorProgram, channel, number, action, 0, high);
+        }
+    }
+}
+
+/**
+ * Build one of the actions referenced by the table.
+ */
+UIAction* Binderator::newMidiAction(Binding* b, int status, bool down)
+{
+    UIAction* action = new UIAction();
+    action->init(b);
+    action->resolve();
+    if (action->implementation.object == nullptr) {
+        Trace(1, "Binderator: Ignoring Binding for invalid action %s\n", b->getActionName());
+        delete action;
+        action = nullptr;
+    }
+    else {
+        // ((status | channel) << 8) | key, see UIAction::getMidiStatus
+        action->triggerId = ((status | b->midiChannel) << 8) | b->triggerValue;
+        action->triggerMode = TriggerModeMomentary;
+        action->down = down;
+        midiActions.add(action);
+    }
+    return action;
+}
+
+/**
+ * Bindings used to match messages on any channel and the channel
+ * defaults to zero, so channel zero bindings still do.  They are also
+ * put in the slots of the other channels unless a binding for that
+ * channel is already there, and a binding for a specific channel
+ * replaces them.  The cost is that a binding can't be restricted to
+ * channel 1 alone.
+ */
+void Binderator::setMidiSlot(int type, int channel, int number, UIAction* action,
+                             int low, int high)
+{
+    for (int i = 0 ; i < 16 ; i++) {
+        if (i == channel || channel == 0) {
+            MidiSlot* slot = &(midiSlots[(((type << 4) | i) << 7) | number]);
+            bool copy = (i != channel);
+            if (copy && slot->action != nullptr && !slot->anyChannel) {
+                // a binding for this channel wins
             }
             else {
-                FunctionDefinition* func = FunctionDefinition::find(name);
-                if (func == nullptr) {
-                    Trace(1, "Binderator: Ignoring Binding for invalid function %s\n", name);
-                }
-                else {
-                    UIAction* action = new UIAction();
-                    action->trigger = trigger;
-                    action->type = type;
-                    action->implementation.function = func;
-                    // todo: scope and args
-                    noteActions.set(note, action);
-                }
+                if (!copy && slot->action != nullptr && !slot->anyChannel)
+                  Trace(2, "Binderator: Replacing MIDI binding %s with %s\n",
+                        slot->action->actionName, action->actionName);
+                slot->action = action;
+                slot->low = low;
+                slot->high = high;
+                slot->anyChannel = copy;
             }
         }
     }
 }
 
+/**
+ * The highest ordinal a MIDI value can be scaled to.
+ * Strings can't be scaled and are left at zero.
+ */
+int Binderator::getParameterHigh(UIParameter* p, MobiusConfig* config)
+{
+    int high = 0;
+    if (p->type == TypeBool) {
+        high = 1;
+    }
+    else if (p->type == TypeEnum) {
+        if (p->values != nullptr) {
+            while (p->values[high + 1] != nullptr)
+              high++;
+        }
+    }
+    else if (p->type == TypeStructure || p->dynamic) {
+        // this is a count rather than an ordinal
+        high = p->getDynamicHigh(config) - 1;
+        if (high < 0)
+          high = 0;
+    }
+    else if (p->type == TypeInt) {
+        high = p->high;
+    }
+    return high;
+}
+
 void Binderator::keyTrackerDown(int code, int modifiers)
 {
     if (started) {
@@ -159,15 +298,96 @@ void Binderator::keyTrackerUp(int code, int modifiers)
 {
 }
 
+/**
+ * Find the table slot for a message.
+ * The value is the velocity, controller value, or program number.
+ * A note on with zero velocity is a note off.
+ */
+Binderator::MidiSlot* Binderator::findMidiSlot(const juce::MidiMessage& message,
+                                               int& type, int& value)
+{
+    MidiSlot* slot = nullptr;
+    if (midiSlots != nullptr && message.getRawDataSize() >= 2) {
+        const juce::uint8* data = message.getRawData();
+        int status = data[0] & 0xF0;
+        int channel = data[0] & 0x0F;
+        int number = data[1] & 0x7F;
+        value = (message.getRawDataSize() > 2) ? (data[2] & 0x7F) : 0;
+        type = -1;
+        switch (status) {
+            case 0x90: type = (value > 0) ? BinderatorNoteOn : BinderatorNoteOff; break;
+            case 0x80: type = BinderatorNoteOff; break;
+            case 0xB0: type = BinderatorControl; break;
+            case 0xC0: type = BinderatorProgram; value = number; break;
+        }
+        if (type >= 0) {
+            slot = &(midiSlots[(((type << 4) | channel) << 7) | number]);
+            if (slot->action == nullptr)
+              slot = nullptr;
+        }
+    }
+    return slot;
+}
+
+/**
+ * Put the message value into the action.
+ */
+void Binderator::applyMidiValue(MidiSlot* slot, int type, int value, UIAction* action)
+{
+    action->triggerValue = value;
+    if (action->type == ActionParameter) {
+        if (slot->high > slot->low) {
+            int range = slot->high - slot->low;
+            if (type == BinderatorControl)
+              action->arg.setInt(slot->low + ((value * range) + 63) / 127);
+            else
+              action->arg.setInt((value > range) ? slot->high : slot->low + value);
+        }
+    }
+    else if (type == BinderatorControl) {
+        action->down = (value > 0);
+    }
+}
+
 void Binderator::midiMessage(const juce::MidiMessage& message, juce::String& source)
 {
     if (started) {
-        if (message.isNoteOn()) {
-            int index = message.getNoteNumber();
-            UIAction* action = noteActions[index];
-            if (action != nullptr) {
-                supervisor->doAction(action);
+        bool found = false;
+        {
+            juce::ScopedLock lock (midiLock);
+            int type = 0;
+            int value = 0;
+            MidiSlot* slot = findMidiSlot(message, type, value);
+            if (slot != nullptr) {
+                midiAction->copy(slot->action);
+                applyMidiValue(slot, type, value, midiAction);
+                found = true;
             }
         }
+        if (found)
+          supervisor->doAction(midiAction);
+    }
+}
+
+/**
+ * Called on the MIDI thread.  The lock is only held by configure
+ * and briefly by midiMessage so this won't normally wait.
+ * The action in the table is modified and sent directly, doTrigger
+ * copies it.  The message timestamp is in seconds on the same clock
+ * as getMillisecondCounterHiRes.
+ */
+bool Binderator::midiRealtime(const juce::MidiMessage& message)
+{
+    bool handled = false;
+    if (started) {
+        juce::ScopedLock lock (midiLock);
+        int type = 0;
+        int value = 0;
+        MidiSlot* slot = findMidiSlot(message, type, value);
+        if (slot != nullptr) {
+            applyMidiValue(slot, type, value, slot->action);
+            handled = supervisor->doTrigger(slot->action, message.getTimeStamp() * 1000.0);
+        }
     }
+    return handled;
 }
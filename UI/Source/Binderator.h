@@ -1,6 +1,12 @@
 /**
  * Class that manages the mapping between external events
  * and actions sent to the Mobius engine.
+ *
+ * MIDI bindings are compiled into a dense table with a slot for every
+ * message type, channel, and note/controller/program number so finding
+ * the action for a message is a single index.  The UIActions are built
+ * once in configure() and reused, CC values are scaled into the
+ * parameter range in place, so nothing is allocated per message.
  */
 
 #pragma once
@@ -10,6 +16,22 @@
 #include "KeyTracker.h"
 #include "MidiManager.h"
 
+/**
+ * The MIDI message types that can be bound.  Note on and off
+ * have their own slots so up transitions don't need a search.
+ */
+const int BinderatorNoteOn = 0;
+const int BinderatorNoteOff = 1;
+const int BinderatorControl = 2;
+const int BinderatorProgram = 3;
+const int BinderatorMidiTypes = 4;
+
+/**
+ * Slot index is ((type * 16) + channel) * 128 + number.
+ * Bindings on channel zero are copied to every channel, see setMidiSlot.
+ */
+const int BinderatorMidiSlots = BinderatorMidiTypes * 16 * 128;
+
 class Binderator : public KeyTracker::Listener, public MidiManager::Listener
 {
   public:
@@ -25,16 +47,47 @@ class Binderator : public KeyTracker::Listener, public MidiManager::Listener
     void keyTrackerUp(int code, int modifiers);
 
     void midiMessage(const class juce::MidiMessage& message, juce::String& source);
+    bool midiRealtime(const class juce::MidiMessage& message) override;
 
   private:
 
+    /**
+     * One entry in the MIDI table.  For parameter actions the
+     * message value is scaled from 0-127 to low-high.
+     */
+    class MidiSlot
+    {
+      public:
+        class UIAction* action;
+        int low;
+        int high;
+        // copied from a channel zero binding
+        bool anyChannel;
+    };
+
     class Supervisor* supervisor = nullptr;
     bool started = false;
 
     juce::OwnedArray<class UIAction> keyActions;
-    juce::OwnedArray<class UIAction> noteActions;
 
-    void installAction(class Binding* b);
+    // owns the actions referenced by the MIDI table
+    juce::OwnedArray<class UIAction> midiActions;
+    juce::HeapBlock<MidiSlot> midiSlots;
+
+    // the MIDI thread reads the table
+    juce::CriticalSection midiLock;
+
+    // where the UI thread copies table actions before sending them
+    class UIAction* midiAction = nullptr;
+
+    void installAction(class Binding* b, class MobiusConfig* config);
+    void installMidi(class Binding* b, class MobiusConfig* config);
+    class UIAction* newMidiAction(class Binding* b, int status, bool down);
+    void setMidiSlot(int type, int channel, int number, class UIAction* action,
+                     int low, int high);
+    int getParameterHigh(class UIParameter* p, class MobiusConfig* config);
+    MidiSlot* findMidiSlot(const juce::MidiMessage& message, int& type, int& value);
+    void applyMidiValue(MidiSlot* slot, int type, int value, class UIAction* action);
 
     
 };
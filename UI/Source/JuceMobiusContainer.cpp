@@ -1,16 +1,15 @@
 /**
  * An implementation of MobiusContainer that bridge Juce to the old world.
  *
- * As interrupts come in, we need to convert the Juce buffer structure
- * with separate channel arrays into an interleavad array and save them.
- * Then call the listener, which will immediately calls us back and ask for those
- * buffers.  The "ports" concept was to support more than 2 channels.  Say the hardware
- * had 8 channels.  These would be presented as 4 ports with 2 channels each, left and right.
- * In theory you could have more than 2 channels per port for surround but that was
- * never implemented.
+ * As interrupts come in, we call the listener, which will immediately call us back
+ * and ask for interleaved buffers.  The "ports" concept was to support more than 2 channels.
+ * Say the hardware had 8 channels.  These are presented as 4 ports with 2 channels each,
+ * left and right.  In theory you could have more than 2 channels per port for surround
+ * but that was never implemented.
  *
- * For the initial integration, we'll assume 2 stereo channels per port and only one port.
- * This is all the RME seems to allow anyway.  Leave multiple ports for another day.
+ * The ports are found once in prepareToPlay.  Each port has its own interleaved
+ * buffer which is only converted from the Juce channel arrays when something asks
+ * for it, so ports no track is using cost nothing.
  *
  * Besides buffers, the stream is expected to provide the the sample rate for synchronization.
  * We save that at startup in the Juce prepareToPay call, it can presumably change
@@ -30,6 +29,13 @@
 JuceMobiusContainer::JuceMobiusContainer(Supervisor* s)
 {
     supervisor = s;
+
+    inputBuffers.allocate(JuceAudioMaxPorts * JuceAudioMaxSamplesPerBuffer, true);
+    outputBuffers.allocate(JuceAudioMaxPorts * JuceAudioMaxSamplesPerBuffer, true);
+    for (int i = 0 ; i < JuceAudioMaxPorts ; i++) {
+        inputReady[i] = false;
+        outputUsed[i] = false;
+    }
 }
 
 JuceMobiusContainer::~JuceMobiusContainer()
@@ -76,14 +82,18 @@ void JuceMobiusContainer::sleep(int millis)
     juce::Time::waitForMillisecondCounter(juce::Time::getMillisecondCounter() + millis);
 }
 
+/**
+ * Ports are pairs of active device channels, see capturePorts.
+ * There is always at least one so the engine has somewhere to go.
+ */
 int JuceMobiusContainer::getInputPorts()
 {
-    return 1;
+    return (inputPorts > 0) ? inputPorts : 1;
 }
 
 int JuceMobiusContainer::getOutputPorts()
 {
-    return 1;
+    return (outputPorts > 0) ? outputPorts : 1;
 }
 
 int JuceMobiusContainer::getSampleRate()
@@ -133,22 +143,56 @@ long JuceMobiusContainer::getInterruptFrames()
 }
 
 /**
- * Return the inputBuffer containing interleaved samples from
- * getNextAudioBlock and let the handler fill the interleaved
- * output buffer.  The output buffer will have been cleared
- * so it doesn't have to do anything if it doesn't want to.
+ * Return the interleaved input buffer for one port and let the
+ * handler fill the interleaved output buffer for another.
+ * The output buffer will have been cleared so it doesn't have to
+ * do anything if it doesn't want to.
  *
  * Note that when the noExternalInput test parameter is on,
  * this will be called with nullptr for the output buffer
  * since it is not needed.  But check both to be safe.
- *
- * todo: ignoring port numbers, need to fix that
  */
 void JuceMobiusContainer::getInterruptBuffers(int inport, float** input, 
                                              int outport, float** output)
 {
-    if (input != nullptr) *input = inputBuffer;
-    if (output != nullptr) *output = outputBuffer;
+    if (input != nullptr) *input = getInputBuffer(inport);
+    if (output != nullptr) *output = getOutputBuffer(outport);
+}
+
+/**
+ * The first time a port is asked for in a block, convert
+ * the device channels into its interleaved buffer.  Ports
+ * we don't have fall back to the first one, the Setup may have
+ * been made for a different device.
+ */
+float* JuceMobiusContainer::getInputBuffer(int port)
+{
+    if (port < 0 || port >= inputPorts)
+      port = 0;
+
+    float* buffer = inputBuffers + (port * JuceAudioMaxSamplesPerBuffer);
+    if (!inputReady[port]) {
+        interleaveInputBuffer(port, buffer);
+        inputReady[port] = true;
+    }
+    return buffer;
+}
+
+/**
+ * The first time a port is asked for in a block, clear it
+ * and remember to send it to the device when the handler returns.
+ */
+float* JuceMobiusContainer::getOutputBuffer(int port)
+{
+    if (port < 0 || port >= outputPorts)
+      port = 0;
+
+    float* buffer = outputBuffers + (port * JuceAudioMaxSamplesPerBuffer);
+    if (!outputUsed[port]) {
+        clearInterleavedBuffer(nextBlockSamples, buffer);
+        outputUsed[port] = true;
+    }
+    return buffer;
 }
 	
 //////////////////////////////////////////////////////////////////////
@@ -170,6 +214,65 @@ void JuceMobiusContainer::prepareToPlay (int samplesPerBlockExpected, double flo
     // not sure under what conditions this would actually be a fractional value
     sampleRate = (int)floatSampleRate;
     expectedSamplesPerBlock = samplesPerBlockExpected;
+
+    // the active channels only change when the device is reconfigured
+    // and that comes with another prepareToPlay, so find the ports here
+    // rather than asking the device on every block
+    inputPorts = 0;
+    outputPorts = 0;
+    extraOutputChannels.clear();
+    juce::AudioDeviceManager& deviceManager = Supervisor::Instance->getAudioDeviceManager();
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device != nullptr) {
+        capturePorts(device->getActiveInputChannels(), inputChannels, inputPorts, nullptr);
+        capturePorts(device->getActiveOutputChannels(), outputChannels, outputPorts,
+                     &extraOutputChannels);
+    }
+    Trace(2, "JuceMobiusContainer: %d input ports, %d output ports\n",
+          inputPorts, outputPorts);
+}
+
+/**
+ * Pair up the active channels into stereo ports.  This is option 2
+ * described in interleaveInputBuffer extended to more than one port.
+ * The lowest two active channels are the first port, the next two the
+ * second and so on.  An odd channel left at the end is a port with only
+ * a left side.
+ *
+ * What we remember is the position of the channel within the active
+ * channels, not the device channel number.  The AudioSampleBuffer we're
+ * given only has the active channels, in order.
+ */
+void JuceMobiusContainer::capturePorts(const juce::BigInteger& active,
+                                       int channels[][JuceAudioMaxChannels],
+                                       int& ports, juce::Array<int>* extra)
+{
+    int maxChannels = active.getHighestBit() + 1;
+    int position = 0;
+    int side = 0;
+    ports = 0;
+    for (int channel = 0 ; channel < maxChannels ; channel++) {
+        if (active[channel]) {
+            if (ports < JuceAudioMaxPorts) {
+                channels[ports][side] = position;
+                side++;
+                if (side >= JuceAudioMaxChannels) {
+                    ports++;
+                    side = 0;
+                }
+            }
+            else if (extra != nullptr) {
+                extra->add(position);
+            }
+            position++;
+        }
+    }
+
+    if (side > 0) {
+        for ( ; side < JuceAudioMaxChannels ; side++)
+          channels[ports][side] = -1;
+        ports++;
+    }
 }
 
 /**
@@ -187,7 +290,8 @@ void JuceMobiusContainer::releaseResources()
  * Unfortunately we don't call the stream handler directly, we just tell it something
  * arrived and it has to call back to getInterruptBuffers above so we can't just pass
  * these along, but it doesn't really matter since the format conversion requires
- * an intermediate model anyway.
+ * an intermediate model anyway.  The conversion happens in getInterruptBuffers
+ * for the ports that are used.
  */
 void JuceMobiusContainer::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
 {
@@ -205,13 +309,12 @@ void JuceMobiusContainer::getNextAudioBlock (const juce::AudioSourceChannelInfo&
     // to process, this might be how they handle plugins that don't like variable block
     // sizes from the host, receive a large buffer from the host, then send it down
     // in smaller fixed size chunks, I've only seen startSample be zero, but support it
-    int startSample = bufferToFill.startSample;
-
-    // leave the result in our inputBuffer array
-    interleaveInputBuffers(bufferToFill, inputBuffer);
-    
-    // clear the interleaved output buffer just in case the handler is bad
-    clearInterleavedBuffer(nextBlockSamples, outputBuffer);
+    // this is remembered along with the buffer until the handler is done
+    currentBlock = &bufferToFill;
+    for (int i = 0 ; i < JuceAudioMaxPorts ; i++) {
+        inputReady[i] = false;
+        outputUsed[i] = false;
+    }
 
     // call the handler which will immediately call back to 
     // getInterruptFrames and getInterruptBuffers
@@ -223,11 +326,10 @@ void JuceMobiusContainer::getNextAudioBlock (const juce::AudioSourceChannelInfo&
         test(bufferToFill.numSamples);
     }
     
-    // copy what was left in the in the interleaved output buffer back to
-    // the Juce buffer, if we don't have a handler we'll copy the
-    // empty output buffer left by clearInterleavedBuffer and clear
-    // the channel buffers we didn't use
-    deinterleaveOutputBuffers(bufferToFill, outputBuffer);
+    // copy what was left in the interleaved output buffers back to
+    // the Juce buffer and clear the channel buffers we didn't use
+    deinterleaveOutputBuffers();
+    currentBlock = nullptr;
 
     // pray
 }
@@ -250,9 +352,8 @@ void JuceMobiusContainer::clearInterleavedBuffer(int numSamples, float* buffer)
 }
 
 /**
- * Convert a set of non-interleaved input buffers into an interleaved buffer.
- * Here we expect two channel buffers.  In theory there could be more but we'll ignore
- * them.  If there is only one, clear those samples so the engine doesn't
+ * Convert the non-interleaved channel buffers for one port into an interleaved buffer.
+ * If the port only has one channel, clear the other side so the engine doesn't
  * have to deal with it.
  *
  * The tutorial is kind of insane about how buffers are organized, so I'm capturing some
@@ -360,93 +461,73 @@ void JuceMobiusContainer::clearInterleavedBuffer(int numSamples, float* buffer)
  * or I guess it may be double*.  The compiler complains if you try to assign it to a float*
  * with "C2440	'=': cannot convert from 'const Type *' to 'float *"
  * This means you can't easily iterate over them and save the pointers for later.
- * Instead we'll iterate and remember just the channel numbers, then call getReadPointer
- * in the next loop where we need to access the samples
+ * Instead we'll remember just the channel numbers in prepareToPlay, then call
+ * getReadPointer here where we need to access the samples
  */
-void JuceMobiusContainer::interleaveInputBuffers(const juce::AudioSourceChannelInfo& bufferToFill,
-                                                float* resultBuffer)
+void JuceMobiusContainer::interleaveInputBuffer(int port, float* resultBuffer)
 {
-    // to do the active channel folderol, we need to get to the AudioDeviceManager
-    juce::AudioDeviceManager& deviceManager = Supervisor::Instance->getAudioDeviceManager();
-    auto* device = deviceManager.getCurrentAudioDevice();
-    auto activeInputChannels = device->getActiveInputChannels();
-    auto activeOutputChannels = device->getActiveOutputChannels();
-    auto maxInputChannels = activeInputChannels.getHighestBit() + 1;
-    auto maxOutputChannels = activeOutputChannels.getHighestBit() + 1;
-
-    // because we can't be sure we'll find 2 or any active channels, zero
-    // out the result buffer so we don't have to clean up the mess after
-    // the next loop
-    clearInterleavedBuffer(bufferToFill.numSamples, resultBuffer);
-    
-    // look for the two lowest numbered active channels to serve as the source
-    // for our stereo frames, when we find one, copy them as soon as we find them
-    // so we can use the fucking auto
-    int interleavedChannel = 0;
-    for (auto channel = 0 ; channel < maxInputChannels ; channel++) {
-            // this is a misnomer, it isn't the channels that are active
-        // it's a bit vector of channels that could be active
-        if (activeInputChannels[channel]) {
-            // okay, here's one
+    if (currentBlock == nullptr || port >= inputPorts) {
+        // asked for outside a block, or there is no device
+        clearInterleavedBuffer(nextBlockSamples, resultBuffer);
+        return;
+    }
+
+    const juce::AudioSourceChannelInfo& bufferToFill = *currentBlock;
+    int numChannels = bufferToFill.buffer->getNumChannels();
+    for (int side = 0 ; side < JuceAudioMaxChannels ; side++) {
+        int channel = inputChannels[port][side];
+        if (channel >= 0 && channel < numChannels) {
             auto* buffer = bufferToFill.buffer->getReadPointer(channel, bufferToFill.startSample);
             for (int i = 0 ; i < bufferToFill.numSamples ; i++) {
-                int frameOffset = i * 2;
-                resultBuffer[frameOffset + interleavedChannel] = buffer[i];
+                int frameOffset = i * JuceAudioMaxChannels;
+                resultBuffer[frameOffset + side] = buffer[i];
             }
-            interleavedChannel++;
-            if (interleavedChannel >= 2)
-              break;
+        }
+        else {
+            for (int i = 0 ; i < bufferToFill.numSamples ; i++)
+              resultBuffer[(i * JuceAudioMaxChannels) + side] = 0.0f;
         }
     }
-
-    // our job was just to get the input samples, output comes later
-    // after our handler is called
 }
 
 /**
- * Take the interleaved Mobius output buffer and spray that into active
- * Juce output channel buffers.
+ * Take the interleaved Mobius output buffers and spray them into the
+ * Juce output channel buffers for each port.
  *
- * Similar issues with output channels that represent stereo pairs.
- * In practice these will almost always be the first two but if not pick
- * the lowest two we can find.
- *
- * For any active output channels that we decide not to use, fill them
- * with zeros.  I think that is required because they're not cleared
- * by default.  Or we could put a jaunty tune in there.
+ * For any active output channels that belong to ports nobody used,
+ * or didn't fit in a port, fill them with zeros.  I think that is required
+ * because they're not cleared by default.  Or we could put a jaunty tune in there.
  */
-void JuceMobiusContainer::deinterleaveOutputBuffers(const juce::AudioSourceChannelInfo& bufferToFill,
-                                                   float* sourceBuffer)
+void JuceMobiusContainer::deinterleaveOutputBuffers()
 {
-    // to do the active channel folderol, we need to get to the AudioDeviceManager
-    // once this is working, can save some of this so we don't have to do it all again
-    // but it should be fast enough
-    juce::AudioDeviceManager& deviceManager = Supervisor::Instance->getAudioDeviceManager();
-    auto* device = deviceManager.getCurrentAudioDevice();
-    auto activeInputChannels = device->getActiveInputChannels();
-    auto activeOutputChannels = device->getActiveOutputChannels();
-    auto maxInputChannels = activeInputChannels.getHighestBit() + 1;
-    auto maxOutputChannels = activeOutputChannels.getHighestBit() + 1;
-    
-    // first locate the two lowest numbered active channels to serve as the
-    // destination for our stereo frames
-    int interleavedChannel = 0;
-    for (int channel = 0 ; channel < maxOutputChannels ; channel++) {
-        if (activeOutputChannels[channel]) {
-            auto* buffer = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
-            if (interleavedChannel < 2) {
-                for (int i = 0 ; i < bufferToFill.numSamples ; i++) {
-                    int frameOffset = i * 2;
-                    buffer[i] = sourceBuffer[frameOffset + interleavedChannel];
+    if (currentBlock == nullptr)
+      return;
+
+    const juce::AudioSourceChannelInfo& bufferToFill = *currentBlock;
+    int numChannels = bufferToFill.buffer->getNumChannels();
+    for (int port = 0 ; port < outputPorts ; port++) {
+        float* sourceBuffer = outputBuffers + (port * JuceAudioMaxSamplesPerBuffer);
+        for (int side = 0 ; side < JuceAudioMaxChannels ; side++) {
+            int channel = outputChannels[port][side];
+            if (channel >= 0 && channel < numChannels) {
+                auto* buffer = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
+                if (outputUsed[port]) {
+                    for (int i = 0 ; i < bufferToFill.numSamples ; i++) {
+                        int frameOffset = i * JuceAudioMaxChannels;
+                        buffer[i] = sourceBuffer[frameOffset + side];
+                    }
                 }
-            }
-            else {
-                // an extra one, clear it
-                for (int i = 0 ; i < bufferToFill.numSamples ; i++) {
-                    buffer[i] = 0.0f;
+                else {
+                    juce::FloatVectorOperations::clear(buffer, bufferToFill.numSamples);
                 }
             }
-            interleavedChannel++;
+        }
+    }
+
+    for (auto channel : extraOutputChannels) {
+        if (channel < numChannels) {
+            auto* buffer = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
+            juce::FloatVectorOperations::clear(buffer, bufferToFill.numSamples);
         }
     }
     
@@ -468,7 +549,9 @@ void JuceMobiusContainer::deinterleaveOutputBuffers(const juce::AudioSourceChann
  */
 void JuceMobiusContainer::test(int numSamples)
 {
-    // input buffer has been filled, copy them to the output buffer buffer
+    float* inputBuffer = nullptr;
+    float* outputBuffer = nullptr;
+    getInterruptBuffers(0, &inputBuffer, 0, &outputBuffer);
 
     int frameSamples = numSamples * 2;
     for (int i = 0 ; i < frameSamples ; i++) {
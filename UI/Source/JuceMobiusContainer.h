@@ -44,6 +44,12 @@ const int JuceAudioMaxChannels = 2;
  */
 const int JuceAudioMaxSamplesPerBuffer = JuceAudioMaxFramesPerBuffer * JuceAudioMaxChannels;
 
+/**
+ * Maximum number of stereo ports we'll make from the active device
+ * channels.  This is the same as AUDIO_MAX_PORTS in the engine.
+ */
+const int JuceAudioMaxPorts = 16;
+
 
 class JuceMobiusContainer : public MobiusContainer
 {
@@ -92,18 +98,35 @@ class JuceMobiusContainer : public MobiusContainer
     // the number of samples we actually received
     int nextBlockSamples = 0;
 
-    // interleaved sample buffers large enough to hold whatever comes
-    // in from Juce.  Old code had a pair of these for each "port", we'll
-    // start by assuming just one port.
-    // todo: it looks like the expectation is that buffer allocation
-    // be done in prepareToPlay, though since we will never not be allocating
-    // buffers and involved in audio streams, it matters less
-    float inputBuffer[JuceAudioMaxSamplesPerBuffer];
-    float outputBuffer[JuceAudioMaxSamplesPerBuffer];
-    
+    // the block being processed, only set during getNextAudioBlock
+    const juce::AudioSourceChannelInfo* currentBlock = nullptr;
+
+    // the device channels for the left and right side of each port,
+    // captured in prepareToPlay, -1 when the port has only one side
+    int inputChannels[JuceAudioMaxPorts][JuceAudioMaxChannels];
+    int outputChannels[JuceAudioMaxPorts][JuceAudioMaxChannels];
+    int inputPorts = 0;
+    int outputPorts = 0;
+
+    // active output channels that didn't fit in a port
+    juce::Array<int> extraOutputChannels;
+
+    // interleaved sample buffers for each port, large enough to hold
+    // whatever comes in from Juce, allocated once in the constructor
+    juce::HeapBlock<float> inputBuffers;
+    juce::HeapBlock<float> outputBuffers;
+
+    // ports converted or handed out during this block
+    bool inputReady[JuceAudioMaxPorts];
+    bool outputUsed[JuceAudioMaxPorts];
+
+    void capturePorts(const juce::BigInteger& active, int channels[][JuceAudioMaxChannels],
+                      int& ports, juce::Array<int>* extra);
+    float* getInputBuffer(int port);
+    float* getOutputBuffer(int port);
     void clearInterleavedBuffer(int numSamples, float* buffer);
-    void interleaveInputBuffers(const juce::AudioSourceChannelInfo& bufferToFill, float* resultBuffer);
-    void deinterleaveOutputBuffers(const juce::AudioSourceChannelInfo& bufferToFill, float* sourceBuffer);
+    void interleaveInputBuffer(int port, float* resultBuffer);
+    void deinterleaveOutputBuffers();
 
     void test(int samples);
 
@@ -15,6 +15,8 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "RootLocator.h"
+#include "mobius/Benchmark.h"
 
 //==============================================================================
 class UIApplication  : public juce::JUCEApplication
@@ -32,6 +34,21 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        // jsl - headless engine benchmark for automated runs, no window
+        // -benchmark [directory], defaults to the benchmark folder under the root
+        if (commandLine.contains ("-benchmark"))
+        {
+            RootLocator locator;
+            juce::File root = locator.getRoot();
+            juce::String path = commandLine.fromFirstOccurrenceOf ("-benchmark", false, false).trim().unquoted();
+            juce::File dir = (path.length() > 0) ? juce::File::getCurrentWorkingDirectory().getChildFile (path)
+                                                 : root.getChildFile ("benchmark");
+            Benchmark benchmark;
+            setApplicationReturnValue (benchmark.run (root, dir) ? 0 : 1);
+            quit();
+            return;
+        }
+
         mainWindow.reset (new MainWindow (getApplicationName()));
     }
 
@@ -62,8 +62,9 @@ void MainThread::run()
     // set this only if you want to start buffering Trace
     // leave it null during testing period where you don't want
     // trace buffering for some reason
-    
-    //GlobalTraceListener = this;
+    // when set, Trace calls in the audio thread just save the arguments
+    // and the formatting happens here
+    GlobalTraceListener = this;
 
     // threadShouldExit returns true when the stopThread method is called
     while (!threadShouldExit()) {
@@ -92,7 +93,7 @@ void MainThread::run()
         if (!mml.lockWasGained()) {
             // if something is trying to kill this job the lock will fail
             // in which case we better return
-            return;
+            break;
         }
 
         // thread is locked, we can mess with components
@@ -100,6 +101,12 @@ void MainThread::run()
         // notify Supervisor
         supervisor->advance();
     }
+
+    // anything traced during shutdown goes out immediately
+    if (GlobalTraceListener == this) {
+        GlobalTraceListener = nullptr;
+        FlushTrace();
+    }
 }
 
 /**
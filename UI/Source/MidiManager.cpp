@@ -94,6 +94,8 @@ void MidiManager::addListener(Listener* l)
 void MidiManager::removeListener(Listener* l)
 {
     listeners.removeAllInstancesOf(l);
+    if (realtimeListener == l)
+      realtimeListener = nullptr;
 }
 
 void MidiManager::logMessage(juce::String msg)
@@ -285,8 +287,15 @@ juce::String MidiManager::findInputDeviceId(juce::String name)
 void MidiManager::handleIncomingMidiMessage (juce::MidiInput* source,
                                              const juce::MidiMessage& message)
 {
+    // give the realtime listener the first look, before anything
+    // is allocated for the UI thread
+    bool handled = false;
+    Listener* rt = realtimeListener.load();
+    if (rt != nullptr)
+      handled = rt->midiRealtime(message);
+    
     postLogMessage(message, source->getName());
-    postListenerMessage(message, source->getName());
+    postListenerMessage(message, source->getName(), handled);
 }
 
 /**
@@ -380,8 +389,9 @@ void MidiManager::postLogMessage (const juce::MidiMessage& message, const juce::
 class ListenerMessageCallback : public juce::CallbackMessage
 {
   public:
-    ListenerMessageCallback (MidiManager* o, const juce::MidiMessage& m, const juce::String& s)
-        : owner (o), message (m), source (s)
+    ListenerMessageCallback (MidiManager* o, const juce::MidiMessage& m, const juce::String& s,
+                             bool h)
+        : owner (o), message (m), source (s), handled (h)
     {}
 
     // this appears to be what Juce will call when it handles this
@@ -390,33 +400,48 @@ class ListenerMessageCallback : public juce::CallbackMessage
     {
         if (owner != nullptr) {
             // and we can call any method on the owner
-            owner->notifyListener(message, source);
+            owner->notifyListener(message, source, handled);
         }
     }
     
     MidiManager* owner;
     juce::MidiMessage message;
     juce::String source;
+    bool handled;
 };
 
-void MidiManager::postListenerMessage(const juce::MidiMessage& message, const juce::String& source)
+void MidiManager::postListenerMessage(const juce::MidiMessage& message, const juce::String& source,
+                                      bool handled)
 {
     // don't bother if we don't have a listener
     if (listeners.size() > 0) {
-        (new ListenerMessageCallback (this, message, source))->post();
+        (new ListenerMessageCallback (this, message, source, handled))->post();
     }
 }
 
 /**
  * We're back from beyond and on the main event thread
+ * If the realtime listener already handled it, the others still see it.
  */
-void MidiManager::notifyListener(const juce::MidiMessage& message, juce::String& source)
+void MidiManager::notifyListener(const juce::MidiMessage& message, juce::String& source,
+                                 bool handled)
 {
+    Listener* rt = realtimeListener.load();
     for (int i = 0 ; i < listeners.size() ; i++) {
-        listeners[i]->midiMessage(message, source);
+        Listener* l = listeners[i];
+        if (!handled || l != rt)
+          l->midiMessage(message, source);
     }
 }
 
+/**
+ * There can only be one of these, it is called on the MIDI thread.
+ */
+void MidiManager::setRealtimeListener(Listener* l)
+{
+    realtimeListener = l;
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // Logging
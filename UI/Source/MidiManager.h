@@ -10,6 +10,7 @@
  */
 
 #pragma once
+#include <atomic>
 #include <JuceHeader.h>
 
 class MidiManager : public juce::MidiInputCallback
@@ -23,6 +24,16 @@ class MidiManager : public juce::MidiInputCallback
     class Listener {
       public:
         virtual void midiMessage(const juce::MidiMessage& message, juce::String& source) = 0;
+
+        /**
+         * Called on the MIDI input thread before the message is
+         * posted to the UI thread.  This must not block or allocate.
+         * Return true if it was handled, midiMessage is then not called.
+         */
+        virtual bool midiRealtime(const juce::MidiMessage& message) {
+            (void)message;
+            return false;
+        }
     };
 
     MidiManager();
@@ -31,6 +42,10 @@ class MidiManager : public juce::MidiInputCallback
     void addListener(Listener* l);
     void removeListener(Listener* l);
 
+    // the one listener that may see messages on the MIDI thread
+    // it must also be added with addListener
+    void setRealtimeListener(Listener* l);
+
     // read device configuration from MobiusConfig
     void configure(class MobiusConfig* config);
     void shutdown();
@@ -68,11 +83,13 @@ class MidiManager : public juce::MidiInputCallback
     // needs to be public so it can be called from a CallbackMessage
     void logMidiMessage(const juce::MidiMessage& message, juce::String& source);
 
-    void notifyListener(const juce::MidiMessage& message, juce::String& source);
+    void notifyListener(const juce::MidiMessage& message, juce::String& source,
+                        bool handled = false);
 
   private:
 
     class juce::Array<Listener*> listeners;
+    std::atomic<Listener*> realtimeListener {nullptr};
     
     // see notes on this in the .cpp
     //juce::AudioDeviceManager deviceManager;
@@ -92,7 +109,8 @@ class MidiManager : public juce::MidiInputCallback
     juce::String findInputDeviceId(juce::String name);
 
     void postLogMessage (const juce::MidiMessage& message, const juce::String& source);
-    void postListenerMessage (const juce::MidiMessage& message, const juce::String& source);
+    void postListenerMessage (const juce::MidiMessage& message, const juce::String& source,
+                              bool handled);
 
     // static in the demo but I don't think it needs to be
     static juce::String getMidiMessageDescription (const class juce::MidiMessage& m);
@@ -91,6 +91,11 @@ void Supervisor::start()
     // call FlushTrace
     TraceDebugLevel = 2;
 
+    // level 2 can be busy in the audio thread, make the ring large
+    // enough to cover a few MainThread cycles of it
+    // this must be done before anything uses Trace
+    SetTraceCapacity(8192);
+
     // normally would enable this now, but deferring that
     // till the first Echo script statement for testing
     // if you enable network trace, you'd better be sure
@@ -140,14 +145,15 @@ void Supervisor::start()
     // tell the ones that care whata we're starting with
     notifyDynamicConfigListeners();
 
-    // let the maintenance thread go
-    uiThread.start();
-
-    // initial display update
+    // initial display update, before the maintenance thread starts
+    // since getState only supports one reader
     if (mobius != nullptr) {
         MobiusState* state = mobius->getState();
         displayManager->update(state);
     }
+
+    // let the maintenance thread go
+    uiThread.start();
     
     // wait till everything is initialized before pumping events
     binderator.configure(config);
@@ -787,11 +793,30 @@ void Supervisor::addActionListener(ActionListener* l)
 {
     if (!actionListeners.contains(l))
       actionListeners.add(l);
+    updateTriggerInterception();
 }
 
 void Supervisor::removeActionListener(ActionListener* l)
 {
     actionListeners.removeFirstMatchingValue(l);
+    updateTriggerInterception();
+}
+
+/**
+ * Called on the UI thread when listeners are added or removed, or
+ * one of them changes what it wants to see.  doTrigger runs on the
+ * MIDI thread and only looks at the flag.
+ */
+void Supervisor::updateTriggerInterception()
+{
+    bool intercepted = false;
+    for (int i = 0 ; i < actionListeners.size() ; i++) {
+        if (actionListeners[i]->isInterceptingTriggers()) {
+            intercepted = true;
+            break;
+        }
+    }
+    triggersIntercepted = intercepted;
 }
 
 /**
@@ -827,6 +852,22 @@ void Supervisor::doAction(UIAction* action)
     }
 }
 
+/**
+ * Called by Binderator on the MIDI input thread.
+ * The action must already be resolved.  If an action listener
+ * is intercepting triggers it needs to see it so it has to go
+ * through doAction on the UI thread.
+ */
+bool Supervisor::doTrigger(UIAction* action, double timestamp)
+{
+    bool sent = false;
+    if (mobius != nullptr && !triggersIntercepted &&
+        action->implementation.object != nullptr) {
+        sent = mobius->doTrigger(action, timestamp);
+    }
+    return sent;
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // Audio Thread
@@ -35,6 +35,11 @@ class Supervisor : public MobiusListener
       public:
         virtual ~ActionListener() {};
         virtual bool doAction(UIAction* action) = 0;
+
+        // true if this currently needs to see actions bound to MIDI,
+        // when none do they are sent from the MIDI thread directly
+        // call updateTriggerInterception when this changes
+        virtual bool isInterceptingTriggers() { return true; }
     };
 
     /**
@@ -94,9 +99,14 @@ class Supervisor : public MobiusListener
     // propagate an action to either MobiusInterface or DisplayManager
     void doAction(class UIAction*);
 
+    // send an action directly from the MIDI thread, false if it
+    // has to go through doAction
+    bool doTrigger(class UIAction* action, double timestamp);
+
     // register UI component action handlers
     void addActionListener(ActionListener* l);
     void removeActionListener(ActionListener* l);
+    void updateTriggerInterception();
 
     void addDynamicConfigListener(DynamicConfigListener* l);
     void removeDynamicConfigListener(DynamicConfigListener* l);
@@ -148,6 +158,8 @@ class Supervisor : public MobiusListener
     MainThread uiThread {this};
 
     juce::Array<ActionListener*> actionListeners;
+    // maintained by the UI thread so doTrigger doesn't read actionListeners
+    std::atomic<bool> triggersIntercepted {false};
     juce::Array<DynamicConfigListener*> dynamicConfigListeners;
     juce::Array<AlertListener*> alertListeners;
 
@@ -132,7 +132,11 @@ void Audio::init()
 
 	mVersion = 0;
 	mBuffers = NULL;
+	mClasses = NULL;
+	mGains = NULL;
+	mShared = NULL;
 	mBufferCount = 0;
+	mAllocatedSlots = 0;
 	mStartFrame = 0;
 	mFrames = 0;
 
@@ -144,7 +148,10 @@ void Audio::init()
 Audio::~Audio() 
 {
 	freeBuffers();
-	delete mBuffers;
+	delete[] mBuffers;
+	delete[] mClasses;
+	delete[] mGains;
+	delete[] mShared;
 	delete mPlay;
 	delete mRecord;
 }
@@ -221,10 +228,7 @@ void Audio::reset()
  */
 void Audio::zero() 
 {
-	for (int i = 0 ; i < mBufferCount ; i++) {
-		freeBuffer(mBuffers[i]);
-		mBuffers[i] = NULL;
-	}
+	releaseBuffers(0, mBufferCount - 1);
 	mVersion++;
 
 	// we could set mStartFrame back to zero now??
@@ -249,7 +253,7 @@ void Audio::locateStart(int* buffer, int* offset)
 
 /**
  * Initialize the buffer index array.
- * At 64K frames per buffer, there is about 1.4 seconds per buffer.
+ * At 4K frames per slot, there is about a tenth of a second per slot.
  * To prevent excessive growth, allocate an index big enough for
  * about a minute of audio then grow it in chunks.
  */
@@ -257,11 +261,21 @@ void Audio::initIndex()
 {
 	if (mBuffers == NULL) {
 
-		mBufferCount = 60;			// configurable?
+		mBufferCount = AUDIO_INDEX_SLOTS;
 		mBuffers = new float*[mBufferCount];
         MemTrack(mBuffers, "Audio::initIndex", mBufferCount * sizeof(float*));
-		for (int i = 0 ; i < mBufferCount ; i++)
-		  mBuffers[i] = NULL;
+		mClasses = new unsigned char[mBufferCount];
+        MemTrack(mClasses, "Audio::initIndex", mBufferCount);
+		mGains = new float[mBufferCount];
+        MemTrack(mGains, "Audio::initIndex", mBufferCount * sizeof(float));
+		mShared = new unsigned char[mBufferCount];
+        MemTrack(mShared, "Audio::initIndex", mBufferCount);
+		for (int i = 0 ; i < mBufferCount ; i++) {
+			mBuffers[i] = NULL;
+			mClasses[i] = AudioBlockSmall;
+			mGains[i] = 1.0f;
+			mShared[i] = 0;
+		}
 
 		// We'll normally record forward but if we reverse then
 		// we can start pushing new buffers on the front.  Though 
@@ -270,7 +284,7 @@ void Audio::initIndex()
 		// the index and test the other calculations.
 
 		long framesPerBuffer = mBufferSize / mChannels;
-		mStartFrame = framesPerBuffer * 10;
+		mStartFrame = framesPerBuffer * AUDIO_INDEX_GROWTH;
 		mVersion++;
 	}
 }
@@ -282,12 +296,8 @@ void Audio::initIndex()
  */
 void Audio::freeBuffers() 
 {
-	if (mBuffers != NULL) {
-		for (int i = 0 ; i < mBufferCount ; i++) {
-			freeBuffer(mBuffers[i]);
-			mBuffers[i] = NULL;
-		}
-	}
+	if (mBuffers != NULL)
+	  releaseBuffers(0, mBufferCount - 1);
 	mStartFrame = 0;
     mFrames = 0;
 	mVersion++;
@@ -297,35 +307,57 @@ void Audio::freeBuffers()
  * Increase the size of the the index in the given direction.
  * Here "up" means to extend the index on the "left" (in reverse)
  * and "down" is a normal forward extension.
+ *
+ * When growing up the count is rounded so the existing buffers stay
+ * aligned on a multiple of their slot count.
  */
 void Audio::growIndex(int count, bool up)
 {
 	if (count > 0) {
 		float **buffers;
+		unsigned char* classes;
+		float* gains;
+		unsigned char* shared;
 		int i, newcount;
 
+		if (up) {
+			int align = AudioBlockSlots(AudioBlockLarge);
+			count = ((count + align - 1) / align) * align;
+		}
+
 		newcount = mBufferCount + count;
 		buffers  = new float*[newcount];
         MemTrack(buffers, "Audio:growIndex", newcount * sizeof(float*));
+		classes = new unsigned char[newcount];
+        MemTrack(classes, "Audio:growIndex", newcount);
+		gains = new float[newcount];
+        MemTrack(gains, "Audio:growIndex", newcount * sizeof(float));
+		shared = new unsigned char[newcount];
+        MemTrack(shared, "Audio:growIndex", newcount);
         
-		if (up) {
-			for (i = 0 ; i < mBufferCount ; i++)
-			  buffers[i+count] = mBuffers[i];
-	
-			for (i = 0 ; i < count ; i++)
-			  buffers[i] = NULL;
+		int shift = (up) ? count : 0;
+		for (i = 0 ; i < newcount ; i++) {
+			buffers[i] = NULL;
+			classes[i] = AudioBlockSmall;
+			gains[i] = 1.0f;
+			shared[i] = 0;
 		}
-		else {
-			for (i = 0 ; i < mBufferCount ; i++)
-			  buffers[i] = mBuffers[i];
-	
-			for (i = mBufferCount ; i < newcount ; i++)
-			  buffers[i] = NULL;
+		for (i = 0 ; i < mBufferCount ; i++) {
+			buffers[i + shift] = mBuffers[i];
+			classes[i + shift] = mClasses[i];
+			gains[i + shift] = mGains[i];
+			shared[i + shift] = mShared[i];
 		}
 
 		mBufferCount = newcount;
-		delete mBuffers;
+		delete[] mBuffers;
+		delete[] mClasses;
+		delete[] mGains;
+		delete[] mShared;
 		mBuffers = buffers;
+		mClasses = classes;
+		mGains = gains;
+		mShared = shared;
 
 		// when growing up, the current content range must also be adjusted
 		if (up)
@@ -343,7 +375,7 @@ void Audio::prepareIndex(int index)
 {
 	if (index >= mBufferCount) {
 		// always add a few extra
-		int count = (index - mBufferCount + 1) + 10;
+		int count = (index - mBufferCount + 1) + AUDIO_INDEX_GROWTH;
 		growIndex(count, false);
 	}
 }
@@ -373,65 +405,238 @@ float* Audio::getBuffer(int i)
 
 /**
  * Return the buffer at a given index, allocating one if necessary.
+ * 
+ * The size of a new buffer depends on how much we already have.
+ * Content tends to grow from wherever it started, so the first
+ * few slots get small buffers and once there are a few of those
+ * we move up to the larger ones.  Short overdubs and fade tails stay
+ * small, long recordings don't go back to the pool every tenth
+ * of a second.
  */
-float *Audio::allocBuffer(int index) 
+float* Audio::prepareBuffer(int index) 
 {
-	float* buffer;
-
 	prepareIndex(index);
-	buffer = mBuffers[index];
+	float* buffer = mBuffers[index];
 	if (buffer == NULL) {
-		buffer = allocBuffer();
-		mBuffers[index] = buffer;
-		mVersion++;
+		int cls = AudioBlockSmall;
+		if (mAllocatedSlots >= AudioBlockSlots(AudioBlockLarge))
+		  cls = AudioBlockLarge;
+		else if (mAllocatedSlots >= AudioBlockSlots(AudioBlockMedium))
+		  cls = AudioBlockMedium;
+
+		buffer = allocBuffer(index, fitClass(index, cls));
 	}
 
 	return buffer;
 }
 
 /**
- * Add a buffer at the specified index. 
- * Used only in the implementation of file reading.
+ * Reduce a buffer class until a buffer of that class can be placed
+ * over the given slot.  The aligned group of slots it would cover
+ * must all be empty.
  */
-void Audio::addBuffer(float* buffer, int index)
+int Audio::fitClass(int index, int cls)
 {
-	prepareIndex(index);
-	float* existing = mBuffers[index];
-	if (existing != NULL) {
-		// ordinarily not supposed to be replacing buffers, but allow it
-		Trace(1, "Audio::addBuffer replacing existing buffer!\n");
-        freeBuffer(existing);
+	while (cls > AudioBlockSmall) {
+		int span = AudioBlockSlots(cls);
+		int first = index - (index % span);
+		prepareIndex(first + span - 1);
+
+		bool empty = true;
+		for (int i = first ; i < first + span && empty ; i++)
+		  empty = (mBuffers[i] == NULL);
+
+		if (empty)
+		  break;
+		cls--;
 	}
-	mBuffers[index] = buffer;
+	return cls;
+}
+
+/**
+ * Allocate a buffer of the given class and place it over the slot,
+ * returning the part of the buffer for that slot.
+ * The caller must have checked it with fitClass.
+ *
+ * If the pool is exhausted in the interrupt we get its silent block.
+ * That is returned so the caller has somewhere to write, but it is
+ * not put in the index, the slot stays empty and we'll try the pool
+ * again on the next write.
+ */
+float* Audio::allocBuffer(int index, int cls)
+{
+	int span = AudioBlockSlots(cls);
+	int first = index - (index % span);
+	prepareIndex(first + span - 1);
+
+	float* buffer = allocBuffer(cls);
+	if (mPool != NULL && mPool->isSilentBlock(buffer))
+	  return buffer + ((index - first) * mBufferSize);
+
+	for (int i = 0 ; i < span ; i++) {
+		mBuffers[first + i] = buffer + (i * mBufferSize);
+		mClasses[first + i] = (unsigned char)cls;
+		mGains[first + i] = 1.0f;
+		mShared[first + i] = 0;
+	}
+	mAllocatedSlots += span;
 	mVersion++;
+
+	return mBuffers[index];
 }
 
 /**
  * Allocate one buffer.
  */
-float* Audio::allocBuffer() 
+float* Audio::allocBuffer(int cls) 
 {
     float* buffer = NULL;
 
     if (mPool != NULL) {
-        // Sincwe Audio and AudioPool share the same buffer size
-        // we dont' have to pass it down.
-        buffer = mPool->newBuffer();
+        buffer = mPool->newBuffer(cls);
     }
     else {
         // In theory we could just allocate them on the fly
         // but I want these to always be used with a pool.  Convenient
         // for a handful of debug traces so allow with a warning.
         Trace(1, "Audio::allocBuffer no pool!\n");
-        int bytesize = (BUFFER_SIZE * sizeof(float));
+        int samples = BUFFER_SIZE * AudioBlockSlots(cls);
+        int bytesize = (samples * sizeof(float));
         buffer = (float*)new char[bytesize];
         MemTrack(buffer, "Audio::allocBuffer", bytesize);
-		memset(buffer, 0, BUFFER_SIZE * sizeof(float));
+		memset(buffer, 0, bytesize);
     }
 
 	return buffer;
 }
 
+/**
+ * Release the buffers covering a range of slots.
+ * A larger buffer that is only partly in the range can't be returned,
+ * the slots we wanted to release are zeroed instead so they read
+ * as silence, and it goes back to the pool when the rest of it does.
+ * If the buffer is shared, releasing it just drops our reference.
+ */
+void Audio::releaseBuffers(int first, int last)
+{
+	if (first < 0)
+	  first = 0;
+	if (last >= mBufferCount)
+	  last = mBufferCount - 1;
+
+	for (int i = first ; i <= last ; i++) {
+		if (mBuffers[i] != NULL) {
+			int span = AudioBlockSlots(mClasses[i]);
+			int start = i - (i % span);
+			if (start >= first && start + span - 1 <= last) {
+				freeBuffer(mBuffers[start]);
+				for (int j = start ; j < start + span ; j++) {
+					mBuffers[j] = NULL;
+					mGains[j] = 1.0f;
+					mShared[j] = 0;
+				}
+				mAllocatedSlots -= span;
+				mVersion++;
+				// skip the rest of it
+				i = start + span - 1;
+			}
+			else {
+				memset(prepareWrite(i), 0, mBufferSize * sizeof(float));
+			}
+		}
+	}
+}
+
+/**
+ * Make the buffer covering a slot private before it is modified.
+ *
+ * If another Audio still has the buffer we copy it, applying the
+ * pending gain as we go, and drop our reference to the original.
+ * If we're the only one left we just apply the gain in place.
+ * Either way the slots covered by the buffer are no longer shared.
+ *
+ * This can happen in the audio thread on the first write after
+ * a copy, it costs one pool buffer and one pass over it.  If the pool
+ * is exhausted the slot stays shared and the write goes into the
+ * pool's silent block, see allocBuffer.
+ */
+float* Audio::unshare(int index)
+{
+	int cls = mClasses[index];
+	int span = AudioBlockSlots(cls);
+	int first = index - (index % span);
+	float* buffer = mBuffers[first];
+
+	if (mPool != NULL && mPool->isShared(buffer)) {
+		float* copy = allocBuffer(cls);
+		if (mPool->isSilentBlock(copy))
+		  return copy + ((index - first) * mBufferSize);
+
+		for (int i = 0 ; i < span ; i++) {
+			float* src = mBuffers[first + i];
+			float* dest = copy + (i * mBufferSize);
+			float gain = mGains[first + i];
+			if (gain == 1.0f)
+			  juce::FloatVectorOperations::copy(dest, src, mBufferSize);
+			else
+			  juce::FloatVectorOperations::copyWithMultiply(dest, src, gain, mBufferSize);
+			mBuffers[first + i] = dest;
+		}
+		freeBuffer(buffer);
+		mVersion++;
+	}
+	else {
+		for (int i = first ; i < first + span ; i++) {
+			if (mGains[i] != 1.0f)
+			  juce::FloatVectorOperations::multiply(mBuffers[i], mGains[i], mBufferSize);
+		}
+	}
+
+	for (int i = first ; i < first + span ; i++) {
+		mGains[i] = 1.0f;
+		mShared[i] = 0;
+	}
+
+	return mBuffers[index];
+}
+
+/**
+ * Make every slot private, for the few things that go around AudioCursor.
+ */
+void Audio::unshareAll()
+{
+	for (int i = 0 ; i < mBufferCount ; i++) {
+		if (mBuffers[i] != NULL && mShared[i])
+		  unshare(i);
+	}
+}
+
+/**
+ * Share the buffer containing a slot in another Audio.
+ * Both Audios must use the same pool.  The buffer is marked shared
+ * on both sides so whichever one writes to it first makes a copy.
+ * The gain is combined with any gain the source already had
+ * pending for the slot.
+ */
+void Audio::share(Audio* src, int index, float gain)
+{
+	int cls = src->mClasses[index];
+	int span = AudioBlockSlots(cls);
+	int first = index - (index % span);
+	prepareIndex(first + span - 1);
+
+	mPool->shareBuffer(src->mBuffers[first]);
+	for (int i = first ; i < first + span ; i++) {
+		mBuffers[i] = src->mBuffers[i];
+		mClasses[i] = (unsigned char)cls;
+		mGains[i] = src->mGains[i] * gain;
+		mShared[i] = 1;
+		src->mShared[i] = 1;
+	}
+	mAllocatedSlots += span;
+	mVersion++;
+}
+
 /**
  * Release one buffer.
  */
@@ -515,6 +720,7 @@ void Audio::setFrames(long frames)
 				// partially clear the new last buffer
 				float* buffer = mBuffers[index];
 				if (buffer != NULL) {
+					buffer = prepareWrite(index);
 					// may be more than we need if we're in the same
 					// buffer as the current last frame, but this shouldn't
 					// happen very often
@@ -527,14 +733,7 @@ void Audio::setFrames(long frames)
 				// boundary conditions
 				int lastIndex;
 				locate(mFrames, &lastIndex, &offset);
-				if (lastIndex >= mBufferCount)
-				  lastIndex = mBufferCount - 1;
-
-				for (int i = index + 1 ; i <= lastIndex ; i++) {
-					freeBuffer(mBuffers[i]);
-					mBuffers[i] = NULL;
-					mVersion++;
-				}
+				releaseBuffers(index + 1, lastIndex);
 			}
 		}
 
@@ -618,6 +817,7 @@ void Audio::setStartFrame(long frame)
 				// partially clear the new first buffer
 				float* buffer = mBuffers[index];
 				if (buffer != NULL) {
+					buffer = prepareWrite(index);
 					// may be more than we need if we're in the same
 					// buffer as the current start frame, but this shouldn't
 					// happen often enough to be worth optimizing?
@@ -629,15 +829,7 @@ void Audio::setStartFrame(long frame)
 				int firstIndex;
 				locate(0, &firstIndex, &offset);
 
-				int lastIndex = index - 1;
-				if (lastIndex >= mBufferCount)
-				  lastIndex = mBufferCount - 1;
-
-				for (int i = firstIndex ; i <= lastIndex ; i++) {
-					freeBuffer(mBuffers[i]);
-					mBuffers[i] = NULL;
-					mVersion++;
-				}
+				releaseBuffers(firstIndex, index - 1);
 			}
 			
 			mStartFrame = frame;
@@ -661,7 +853,7 @@ void Audio::setStartFrame(long frame)
 
 		// since it looks like we're in reverse, add a few extra so we
 		// don't have to grow one buffer at a time
-		needBuffers += 10;
+		needBuffers += AUDIO_INDEX_GROWTH;
 
 		// extend the index up by this amount
 		// this will increase mStartFrame by the corresponding amount
@@ -705,7 +897,7 @@ long Audio::prepareFrame(long frame, int* retIndex,
 		// normal forward positioning
 
 		locate(frame, &index, &offset);
-		buffer = allocBuffer(index);
+		buffer = prepareBuffer(index);
 
 		// extend if this is beyond the current end frame
 		if (frame >= mFrames)
@@ -719,7 +911,7 @@ long Audio::prepareFrame(long frame, int* retIndex,
 		frame = 0;
 
 		locate(frame, &index, &offset);
-		buffer = allocBuffer(index);
+		buffer = prepareBuffer(index);
 	}
 
 	*retIndex = index;
@@ -911,6 +1103,11 @@ int Audio::write(const char *name, int format)
  * Copy the contents of one Audio into another.
  * Note that this assumes the buffer doesn't have a lot of wasted
  * space at the front or back, could check that and compress.
+ *
+ * If both Audios use the same pool the buffers are not copied,
+ * they are shared and the feedback becomes a gain that is applied
+ * when the slot is read.  The first one to write to a shared buffer
+ * gets a private copy, see unshare.
  */
 void Audio::copy(Audio* src)
 {
@@ -925,16 +1122,26 @@ void Audio::copy(Audio* src, int feedback)
 		if (src->mBufferSize != mBufferSize)
 		  Trace(1, "Mismatched Audio buffer size!\n");
 		else {
+			float gain = getFeedbackGain(feedback);
+			bool sharing = (mPool != NULL && mPool == src->mPool);
 			int srcmax = src->mBufferCount;
 			for (int i = 0 ; i < srcmax ; i++) {
 				float* srcb = src->getBuffer(i);
 				if (srcb != NULL) {
-					// !! todo: if the buffer is empty don't bother allocating
-
-					float* destb = allocBuffer(i);
-
-					memcpy(destb, srcb, mBufferSize * sizeof(float));
-					applyFeedback(destb, feedback);
+					if (sharing) {
+						// we're empty so it will land on the same slots
+						share(src, i, gain);
+						int span = AudioBlockSlots(src->mClasses[i]);
+						i += span - (i % span) - 1;
+					}
+					else {
+						// keep the same buffer sizes as the source
+						float* destb = getBuffer(i);
+						if (destb == NULL)
+						  destb = allocBuffer(i, fitClass(i, src->mClasses[i]));
+
+						juce::FloatVectorOperations::copyWithMultiply(destb, srcb, gain * src->mGains[i], mBufferSize);
+					}
 				}
 			}
 		}
@@ -944,18 +1151,22 @@ void Audio::copy(Audio* src, int feedback)
 	}
 }
 
-void Audio::applyFeedback(float* buffer, int feedback)
+/**
+ * Convert a feedback level to the gain applied to copied buffers.
+ * This used to multiply the buffer immediately, now it's applied
+ * when the slot is read or made private.
+ */
+float Audio::getFeedbackGain(int feedback)
 {
+	float modifier = 1.0f;
 	if (feedback < 127 && feedback >= 0) {
 		// old way, linear
 		// float modifier = (float)feedback / 127.0f;
 		// new way, pseudo-log
 		float* ramp = AudioFade::getRamp128();
-		float modifier = ramp[feedback];
-
-		for (int i = 0 ; i < mBufferSize ; i++)
-		  buffer[i] = buffer[i] * modifier;
+		modifier = ramp[feedback];
 	}
+	return modifier;
 }
 
 /****************************************************************************
@@ -970,16 +1181,23 @@ void Audio::dump()
 	trace("Sample rate %d, Channels %d, Frames %ld StartFrame %ld\n",
 		   mSampleRate, mChannels, mFrames, mStartFrame);
 
-	int allocated = 0;
+	int blocks[AudioBlockClasses];
+	for (int i = 0 ; i < AudioBlockClasses ; i++)
+	  blocks[i] = 0;
+
 	if (mBuffers != NULL) {
 		for (int i = 0 ; i < mBufferCount ; i++) {
-			if (mBuffers[i] != NULL)
-			  allocated++;
+			int span = AudioBlockSlots(mClasses[i]);
+			if (mBuffers[i] != NULL && (i % span) == 0)
+			  blocks[mClasses[i]]++;
 		}
 	}
 
-	trace("Buffer size %d, Buffers reserved %d Buffers allocated %d\n",
-		   mBufferSize, mBufferCount, allocated);
+	trace("Slot size %d, Slots reserved %d Slots allocated %d\n",
+		   mBufferSize, mBufferCount, mAllocatedSlots);
+	trace("Buffers small %d medium %d large %d\n",
+		   blocks[AudioBlockSmall], blocks[AudioBlockMedium],
+		   blocks[AudioBlockLarge]);
 
 	fflush(stdout);
 }
@@ -1194,6 +1412,9 @@ void Audio::insert(Audio* audio, long insertFrame)
             append(audio);
         }
         else {
+            // this goes directly at the buffers
+            unshareAll();
+
             // first shift everything down
             long lastFrame = mFrames - 1;
             long newFrames = audio->getFrames();
@@ -1215,7 +1436,7 @@ void Audio::insert(Audio* audio, long insertFrame)
 
             // todo: could try to be smart about sparse copying
             // a buffer that happens to be empty but it's hard
-            float* dest = allocBuffer(destBuffer);
+            float* dest = prepareBuffer(destBuffer);
 
             for (int i = 0 ; i < shiftSamples ; i++) {
                 // allow copying from a sparse buffer
@@ -1227,7 +1448,7 @@ void Audio::insert(Audio* audio, long insertFrame)
                 if (destSample < 0) {
                     destBuffer--;
                     // don't assume this exists
-                    dest = allocBuffer(destBuffer);
+                    dest = prepareBuffer(destBuffer);
                     destSample = mBufferSize - 1;
                 }
                 srcSample--;
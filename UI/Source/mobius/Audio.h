@@ -66,13 +66,17 @@
 #define AUDIO_DEFAULT_FADE_FRAMES 128
 
 /**
- * The number of Audio frames per buffer.
- * Actual size of the buffer will depend on the number of channels,
+ * The number of Audio frames in one slot of the buffer index.
+ * Actual size of the slot will depend on the number of channels,
  * which will usually be 2.
- * Probably will want to make this variable and tune it to reduce
- * fragmentation.
+ *
+ * This used to be a fixed 64K frame buffer, which meant every short
+ * overdub and every fade tail pinned half a megabyte.  Buffers now
+ * come from the AudioPool in several size classes, the index is kept
+ * at the granularity of the smallest and a larger buffer fills several
+ * consecutive slots.  See AudioBlockClass.
  */
-#define FRAMES_PER_BUFFER  1024 * 64
+#define FRAMES_PER_BUFFER  1024 * 4
 
 /**
  * Number of channels in a buffer.
@@ -80,12 +84,45 @@
 #define BUFFER_CHANNELS 2
 
 /**
- * The size of one buffer.  In theory the AudioPool should
+ * The size of one index slot.  In theory the AudioPool should
  * be able to decide this but let's keep it simple and assume
  * a size with stereo channels;
  */
 #define BUFFER_SIZE (FRAMES_PER_BUFFER * BUFFER_CHANNELS)
 
+/**
+ * Initial number of slots in the buffer index, about a minute
+ * at 44.1K.
+ */
+#define AUDIO_INDEX_SLOTS 960
+
+/**
+ * Number of slots added when the index has to grow beyond what
+ * was asked for.  Also the number of slots we leave in front of the
+ * start frame so a short reverse recording doesn't grow the index.
+ */
+#define AUDIO_INDEX_GROWTH 160
+
+/**
+ * Buffer size classes.  A buffer of each class covers 1, 4, or 16
+ * index slots, or 4K, 16K, and 64K frames.  A buffer always starts
+ * on a slot that is a multiple of its slot count so the buffer
+ * containing any slot can be found from the slot number.
+ */
+typedef enum {
+
+    AudioBlockSmall,
+    AudioBlockMedium,
+    AudioBlockLarge,
+    AudioBlockClasses
+
+} AudioBlockClass;
+
+inline int AudioBlockSlots(int cls)
+{
+    return 1 << (cls * 2);
+}
+
 /****************************************************************************
  *                                                                          *
  *   							  UTILITIES                                 *
@@ -327,7 +364,12 @@ class AudioCursor {
 	void prepareFrame();
 	void locateFrame();
 	void incFrame();
+	void advance(long frames);
+	long getSpanFrames(int channels, long max);
 	void get(AudioBuffer* buf, float* dest, float modifier);
+	void getSpan(float* dest, long frames, float level);
+	void putFrame(float* src, int channels, AudioOp op);
+	void putSpan(float* src, long frames, AudioOp op);
 
 	char* mName;
 	class Audio* mAudio;
@@ -473,12 +515,24 @@ class Audio {
 	void prepareIndex(int index);
 	void prepareIndexFrame(long frame);
 	void growIndex(int count, bool up);
-	void addBuffer(float* buffer, int index);
-	float* allocBuffer();
-	float* allocBuffer(int index);
+	float* allocBuffer(int cls);
+	float* allocBuffer(int index, int cls);
+	float* prepareBuffer(int index);
+	int fitClass(int index, int cls);
+	void releaseBuffers(int first, int last);
+	float* unshare(int index);
+	void unshareAll();
+	void share(Audio* src, int index, float gain);
 	bool isEmpty(float* buffer);
 	void setStartFrame(long frame);
-	void applyFeedback(float* buffer, int feedback);
+	float getFeedbackGain(int feedback);
+
+	/**
+	 * Called by AudioCursor before writing to a slot.
+	 */
+	inline float* prepareWrite(int index) {
+		return (mShared[index] ? unshare(index) : mBuffers[index]);
+	}
 
 	// allow these to be directly accessible by AudioCursor
 
@@ -507,7 +561,7 @@ class Audio {
 	int mChannels;
 
 	/**
-	 * Number of samples per buffer.  To get frames per buffer
+	 * Number of samples per index slot.  To get frames per slot
 	 * divide this by mChannels;
 	 */
 	int mBufferSize;
@@ -516,15 +570,42 @@ class Audio {
 	 * The buffer index array.  This may be a sparse array, meaning that
 	 * there may be a NULL pointer in any given element.  On playback
 	 * this is to be treated as silence.  On record, buffers are normally
-	 * allocated incrementally.
+	 * allocated incrementally.  Each element points to one slot, a
+	 * buffer larger than a slot fills several elements that point
+	 * into the same buffer.
 	 */
 	float **mBuffers;
 
+	/**
+	 * The AudioBlockClass of the buffer covering each slot in mBuffers,
+	 * only meaningful where mBuffers is non-null.
+	 */
+	unsigned char* mClasses;
+
+	/**
+	 * Gain to apply to each slot when it is read.  This is how feedback
+	 * is applied to a shared buffer without copying it, normally 1.0.
+	 */
+	float* mGains;
+
+	/**
+	 * Non-zero for each slot whose buffer may be shared with another
+	 * Audio or has a gain other than 1.0.  The slot must be made
+	 * private with unshare before it can be modified.
+	 */
+	unsigned char* mShared;
+
 	/**
 	 * Total number of elements in the mBuffers array.
 	 */
 	int mBufferCount;
 
+	/**
+	 * Number of elements in mBuffers that have a buffer.
+	 * Used to pick the size of the next one.
+	 */
+	int mAllocatedSlots;
+
 	/**
 	 * A counter that increments any time the the buffer array changes.
 	 * This must be monitored by AudioCursor to detect structural changes
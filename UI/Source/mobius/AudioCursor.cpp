@@ -751,6 +751,61 @@ void AudioCursor::incFrame()
 	mFade.inc(mFrame, mReverse);
 }
 
+/**
+ * Move over a span of frames calculated by getSpanFrames.
+ * This has the same result as calling incFrame once for each frame.
+ * Since the span can only cross a buffer or Audio edge on the last
+ * frame, we only need to check the edge once.  There is no fade
+ * to increment, getSpanFrames won't return spans while fading.
+ */
+void AudioCursor::advance(long frames)
+{
+	int channels = mAudio->mChannels;
+
+	if (mReverse) {
+
+		mFrame -= frames;
+
+        if (mFrame < 0 && !mAutoExtend) {
+			decache();
+		}
+		else {
+            mBufferOffset -= (frames * channels);
+            if (mBufferOffset < 0) {
+                mBufferIndex--;
+                mBufferOffset = mAudio->mBufferSize - channels;
+                int bufferCount = mAudio->mBufferCount;
+                if (mBufferIndex >= 0 && mBufferIndex < bufferCount &&
+                    bufferCount > 0) {
+                    mBuffer = mAudio->mBuffers[mBufferIndex];
+                }
+                else {
+					decache();
+                }
+            }
+		}
+	}
+	else {
+
+		mFrame += frames;
+
+        if (mFrame >= mAudio->mFrames && !mAutoExtend) {
+			decache();
+        }
+        else {
+            mBufferOffset += (frames * channels);
+            if (mBufferOffset >= mAudio->mBufferSize) {
+                mBufferIndex++;
+                mBufferOffset = 0;
+                if (mBufferIndex < mAudio->mBufferCount)
+                    mBuffer = mAudio->mBuffers[mBufferIndex];
+                else
+                    decache();
+            }
+		}
+	}
+}
+
 /****************************************************************************
  *                                                                          *
  *   								 GET                                    *
@@ -775,10 +830,21 @@ void AudioCursor::get(AudioBuffer* buf, float level)
 
 	locateFrame();
 
-	for (int i = 0 ; i < length ; i++) {
-		get(buf, dest, level);
+	// move whole spans up to the end of the current block, dropping
+	// back to single frames for fades and edge conditions
+	long remaining = length;
+	while (remaining > 0) {
+		long span = getSpanFrames(channels, remaining);
+		if (span > 0) {
+			getSpan(dest, span, level);
+		}
+		else {
+			get(buf, dest, level);
+			span = 1;
+		}
 		if (dest != NULL)
-		  dest += channels;
+		  dest += (span * channels);
+		remaining -= span;
 	}
 }
 
@@ -813,13 +879,20 @@ void AudioCursor::get(AudioBuffer* buf, float* dest, float level)
 	bool replace = false;
 	bool doLevel = (level != 1.0f);
 
+	// a shared slot may have a pending gain
+	float slotLevel = level;
+	if (mBuffer != NULL && mAudio->mShared[mBufferIndex]) {
+		slotLevel *= mAudio->mGains[mBufferIndex];
+		doLevel = (slotLevel != 1.0f);
+	}
+
 	for (int i = 0 ; i < buf->channels ; i++) {
 		float sample = 0.0f;
 		if (mBuffer != NULL)
 		  sample = mBuffer[mBufferOffset + i];
             
 		if (doLevel)
-		  sample *= level;
+		  sample *= slotLevel;
 
 		sample = mFade.fade(sample);
 
@@ -834,6 +907,87 @@ void AudioCursor::get(AudioBuffer* buf, float* dest, float level)
 	incFrame();
 }
 
+/**
+ * Calculate the number of frames that may be transferred as one
+ * contiguous span from the current location.  A span ends at the
+ * edge of the current buffer or the edge of the Audio, whichever
+ * comes first, which are the only places incFrame does anything
+ * other than bump the offset.  Returns zero if the next frame must go
+ * through the single frame path, which is the case whenever a fade
+ * is pending or the caller's channel count doesn't match.
+ */
+long AudioCursor::getSpanFrames(int channels, long max)
+{
+	long span = 0;
+
+	if (!mFade.enabled && !mFade.active && channels == mAudio->mChannels) {
+		if (mReverse) {
+			if (mFrame >= 0) {
+				span = (mBufferOffset / channels) + 1;
+				// we may land on -1 but no further
+				if (span > mFrame + 1)
+				  span = mFrame + 1;
+			}
+		}
+		else {
+			span = (mAudio->mBufferSize - mBufferOffset) / channels;
+			if (!mAutoExtend) {
+				// we may land on mFrames but no further
+				long available = mAudio->mFrames - mFrame;
+				if (available < span)
+				  span = available;
+			}
+		}
+	}
+
+	if (span > max)
+	  span = max;
+	else if (span < 0)
+	  span = 0;
+
+	return span;
+}
+
+/**
+ * Copy a span of frames verified by getSpanFrames into a buffer,
+ * adding to what is already there like the single frame get.
+ * If the current buffer is missing it is a sparse gap and we just
+ * move past it.
+ */
+void AudioCursor::getSpan(float* dest, long frames, float level)
+{
+	if (mBuffer != NULL && dest != NULL) {
+		int channels = mAudio->mChannels;
+		float* src = &mBuffer[mBufferOffset];
+
+		if (mAudio->mShared[mBufferIndex])
+		  level *= mAudio->mGains[mBufferIndex];
+
+		if (!mReverse) {
+			int samples = (int)(frames * channels);
+			if (level == 1.0f)
+			  juce::FloatVectorOperations::add(dest, src, samples);
+			else
+			  juce::FloatVectorOperations::addWithMultiply(dest, src, level, samples);
+		}
+		else {
+			bool doLevel = (level != 1.0f);
+			for (long i = 0 ; i < frames ; i++) {
+				for (int j = 0 ; j < channels ; j++) {
+					float sample = src[j];
+					if (doLevel)
+					  sample *= level;
+					dest[j] += sample;
+				}
+				src -= channels;
+				dest += channels;
+			}
+		}
+	}
+
+	advance(frames);
+}
+
 /****************************************************************************
  *                                                                          *
  *   								 PUT                                    *
@@ -850,29 +1004,109 @@ void AudioCursor::put(AudioBuffer* buf, AudioOp op)
 	if (mVersion != mAudio->mVersion)
 	  decache();
 
-	for (int i = 0 ; i < frames ; i++) {
+	long remaining = frames;
+	while (remaining > 0) {
+		// spans are only possible once the current block exists,
+		// prepareFrame handles allocation and start frame adjustments
+		long span = 0;
+		if (mBuffer != NULL && mFrame >= 0)
+		  span = getSpanFrames(channels, remaining);
 
-		// since we're recording, have to flesh out the buffers as we go
-		prepareFrame();
+		if (span > 0) {
+			putSpan(src, span, op);
+		}
+		else {
+			putFrame(src, channels, op);
+			span = 1;
+		}
 
-		for (int j = 0 ; j < channels ; j++) {
-			float sample = (src != NULL) ? src[j] : 0.0f;
+		if (src != NULL)
+		  src += (span * channels);
+		remaining -= span;
+	}
+}
 
-			sample = mFade.fade(sample);
+/**
+ * Store one frame and increment the frame position.
+ */
+void AudioCursor::putFrame(float* src, int channels, AudioOp op)
+{
+	// since we're recording, have to flesh out the buffers as we go
+	prepareFrame();
 
-			if (op == OpReplace)
-			  mBuffer[mBufferOffset + j] = sample;
-			else if (op == OpRemove)
-			  mBuffer[mBufferOffset + j] -= sample;
-			else
-			  mBuffer[mBufferOffset + j] += sample;
-		}
+	// and make sure we're not writing on a buffer someone else has
+	if (mBuffer != NULL)
+	  mBuffer = mAudio->prepareWrite(mBufferIndex);
+
+	for (int j = 0 ; j < channels ; j++) {
+		float sample = (src != NULL) ? src[j] : 0.0f;
+
+		sample = mFade.fade(sample);
+
+		if (op == OpReplace)
+		  mBuffer[mBufferOffset + j] = sample;
+		else if (op == OpRemove)
+		  mBuffer[mBufferOffset + j] -= sample;
+		else
+		  mBuffer[mBufferOffset + j] += sample;
+	}
 		
-		incFrame();
+	incFrame();
+}
 
-		if (src != NULL)
-		  src += channels;
+/**
+ * Store a span of frames that has already been verified by
+ * getSpanFrames to lie entirely within the current buffer.
+ * This is the block equivalent of calling putFrame for each frame
+ * when there is no fade in progress.
+ */
+void AudioCursor::putSpan(float* src, long frames, AudioOp op)
+{
+	int channels = mAudio->mChannels;
+	mBuffer = mAudio->prepareWrite(mBufferIndex);
+	float* dest = &mBuffer[mBufferOffset];
+
+	if (!mReverse) {
+		int samples = (int)(frames * channels);
+		if (op == OpReplace) {
+			if (src != NULL)
+			  juce::FloatVectorOperations::copy(dest, src, samples);
+			else
+			  juce::FloatVectorOperations::clear(dest, samples);
+		}
+		else if (src != NULL) {
+			if (op == OpRemove)
+			  juce::FloatVectorOperations::subtract(dest, src, samples);
+			else
+			  juce::FloatVectorOperations::add(dest, src, samples);
+		}
+	}
+	else {
+		// frames are stored forward but we iterate backward,
+		// can't just reverse the samples or the channels swap
+		for (long i = 0 ; i < frames ; i++) {
+			for (int j = 0 ; j < channels ; j++) {
+				float sample = (src != NULL) ? src[j] : 0.0f;
+				if (op == OpReplace)
+				  dest[j] = sample;
+				else if (op == OpRemove)
+				  dest[j] -= sample;
+				else
+				  dest[j] += sample;
+			}
+			dest -= channels;
+			if (src != NULL)
+			  src += channels;
+		}
 	}
+
+	// what prepareFrame would have done for each frame, the
+	// highest frame touched is the first one when in reverse
+	long highest = (mReverse) ? mFrame : mFrame + frames - 1;
+	if (highest >= mAudio->mFrames)
+	  mAudio->mFrames = highest + 1;
+
+	advance(frames);
 }
 
 void AudioCursor::put(AudioBuffer* buf, AudioOp op, long frame)
@@ -961,9 +1195,10 @@ void AudioCursor::fade(int offset, int frames, bool up, float baseLevel)
 		int channels = mAudio->mChannels;
 
 		for (int i = 0 ; i < frames ; i++) {
-			for (int j = 0 ; j < channels ; j++) {
-				// if mBuffer goes null, we fell off the end
-				if (mBuffer != NULL) {
+			// if mBuffer goes null, we fell off the end
+			if (mBuffer != NULL) {
+				mBuffer = mAudio->prepareWrite(mBufferIndex);
+				for (int j = 0 ; j < channels ; j++) {
 					float* loc = &(mBuffer[mBufferOffset + j]);
 					*loc = mFade.fade(*loc);
 				}
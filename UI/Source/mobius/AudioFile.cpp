@@ -23,19 +23,24 @@
 /**
  * Write an audio file using the old tool.
  * This is an adaptation of what used to be in Audio::write()
- * which no longer exists, but still sucks because it does this
- * a sample at a time rather than blocking.  Okay for initial testing
- * but you can do better.
+ * which no longer exists.
+ *
+ * This used to pull a frame at a time out of the Audio and write
+ * each sample with its own fwrite, which took seconds for a long loop.
+ * Now it reads chunks with Audio::get, which moves whole spans out of
+ * the Audio buffers, and WaveFile writes each chunk in one call.
  */
-void AudioFile::write(juce::File file, Audio* a)
+juce::String AudioFile::write(juce::File file, Audio* a, std::atomic<int>* progress)
 {
+    juce::String errorMessage;
+    
     // Old code gave the illusion that it supported something other than 2
     // channels but this was never tested.  Ensuing that this all stays
     // in sync and something forgot to set the channels is tedius, just
     // force it to 2 no matter what Audio says
     //int channels = a->getChannels();
     int channels = 2;
-    int frames = a->getFrames();
+    long frames = a->getFrames();
     
 	WaveFile* wav = new WaveFile();
 	wav->setChannels(channels);
@@ -44,43 +49,69 @@ void AudioFile::write(juce::File file, Audio* a)
     // other format is PCM, but I don't think the old writer supported that?
 	wav->setFormat(WAV_FORMAT_IEEE);
     // this was how we conveyed the file path
-    const char* path = file.getFullPathName().toUTF8();
+    juce::String jpath = file.getFullPathName();
+    const char* path = jpath.toUTF8();
 	wav->setFile(path);
 
     // the old tool will not auto-create parent directories, let's
     // use Juce to handle that now
     file.create();
+
+    if (progress != nullptr)
+      *progress = 0;
     
 	int error = wav->writeStart();
 	if (error) {
 		Trace(1, "Error writing file %s: %s\n", path, 
 			  wav->getErrorMessage(error));
+        errorMessage = wav->getErrorMessage(error);
 	}
 	else {
-		// write one frame at a time not terribly effecient but messing
-		// with blocking at this level isn't going to save much
-		AudioBuffer b;
-        // not sure where this constant went but we don't support more than 2 anyway
-		//float buffer[AUDIO_MAX_CHANNELS];
-		float buffer[MaxAudioChannels];
-		b.buffer = buffer;
-		b.frames = 1;
-		b.channels = channels;
-
-		for (long i = 0 ; i < frames ; i++) {
-			memset(buffer, 0, sizeof(buffer));
-			a->get(&b, i);
-			wav->write(buffer, 1);
+        // Audio::get adds to what is in the buffer so it has to be
+        // cleared for each chunk
+        int samples = AudioFileChunkFrames * channels;
+        float* buffer = new float[samples];
+
+        long frame = 0;
+		while (frame < frames && !error) {
+            long chunk = frames - frame;
+            if (chunk > AudioFileChunkFrames)
+              chunk = AudioFileChunkFrames;
+
+			memset(buffer, 0, samples * sizeof(float));
+			a->get(buffer, chunk, frame);
+			error = wav->write(buffer, chunk);
+
+            frame += chunk;
+            if (progress != nullptr)
+              *progress = (int)((frame * 100) / frames);
 		}
 
-		error = wav->writeFinish();
-		if (error) {
-			Trace(1, "Error finishing file %s: %s\n", path, 
+        delete[] buffer;
+
+        if (error) {
+			Trace(1, "Error writing file %s: %s\n", path, 
 				  wav->getErrorMessage(error));
-		}
+            errorMessage = wav->getErrorMessage(error);
+            // still try to close it
+            wav->writeFinish();
+        }
+        else {
+            error = wav->writeFinish();
+            if (error) {
+                Trace(1, "Error finishing file %s: %s\n", path, 
+                      wav->getErrorMessage(error));
+                errorMessage = wav->getErrorMessage(error);
+            }
+        }
     }
 
+    if (progress != nullptr)
+      *progress = 100;
+
     delete wav;
+
+    return errorMessage;
 }
 
 /**
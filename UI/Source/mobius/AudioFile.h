@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <JuceHeader.h>
 
 /**
@@ -15,11 +16,23 @@
  */
 const int MaxAudioChannels = 4;
 
+/**
+ * Number of frames read from the Audio and written to the file
+ * at a time.
+ */
+const int AudioFileChunkFrames = 16384;
+
 class AudioFile
 {
   public:
 
-    static void write(juce::File, class Audio* a);
+    /**
+     * Write an Audio to a .wav file.  Returns an error message,
+     * empty if it worked.  If a progress counter is passed it is
+     * updated with the percentage written as we go.
+     */
+    static juce::String write(juce::File, class Audio* a,
+                              std::atomic<int>* progress = nullptr);
 
     static class Audio* read(juce::File, class AudioPool* pool);
 
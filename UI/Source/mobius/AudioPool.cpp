@@ -2,7 +2,6 @@
  * Implementation of AudioPool factored out of Audio
  */
 
-// for CriticalSection/ScopedLock
 #include <JuceHeader.h>
 
 #include "../util/Trace.h"
@@ -12,40 +11,216 @@
 
 #include "core/Mem.h"
 
+thread_local bool AudioPool::Interrupt = false;
+
 /**
  * Create an initially empty audio pool.
  * There is normally only one of these in a Mobius instance.
- * Should have another list for all buffers outstanding?
+ * The table is allocated now so it never has to move, the buffers
+ * are allocated by init() and performMaintenance().
  */
 AudioPool::AudioPool()
 {
-    // mCsect = new CriticalSection("AudioPool");
-    // juce::CriticalSection is a member object
-    mPool = NULL;
+    mTable = new OldPooledBuffer*[AudioPoolMaxBuffers];
+    for (int i = 0 ; i < AudioPoolMaxBuffers ; i++)
+      mTable[i] = nullptr;
+    mTableSize = 0;
+
+    for (int i = 0 ; i < AudioBlockClasses ; i++) {
+        mClean[i] = 0;
+        mDirty[i] = 0;
+        mCleanCount[i] = 0;
+        mDirtyCount[i] = 0;
+        mClassAllocated[i] = 0;
+
+        int samples = getBufferSamples(i);
+        mSilent[i] = new float[samples];
+        memset(mSilent[i], 0, samples * sizeof(float));
+    }
+
+    setMaxMemory(0);
+
     mAllocated = 0;
+    mAllocatedBytes = 0;
     mInUse = 0;
-
-    // needs more testing
-    // !! channels
-    //mNewPool = new SampleBufferPool(FRAMES_PER_BUFFER * 2);
-    //mNewPool = NULL;
+    mMaxInUse = 0;
+    mExhausted = 0;
+    mLastExhausted = 0;
+    mOverflows = 0;
+    mDirtyClears = 0;
+    mShares = 0;
 }
 
 /**
  * Release the kracken.
+ * Anything still in use at this point is leaked, which dump() will
+ * have complained about.
  */
 AudioPool::~AudioPool()
 {
-    // delete mCsect;
-    // delete mNewPool;
+    int size = mTableSize;
+    for (int i = 0 ; i < size ; i++) {
+        OldPooledBuffer* pb = mTable[i];
+        if (pb != nullptr && pb->pooled)
+          delete[] (char*)pb;
+    }
+    delete[] mTable;
+
+    for (int i = 0 ; i < AudioBlockClasses ; i++)
+      delete[] mSilent[i];
+}
+
+/**
+ * Called by the kernel at the start of every block, and by the
+ * TrackRenderer workers, so newBuffer knows not to allocate.
+ */
+void AudioPool::setInterrupt(bool b)
+{
+    Interrupt = b;
+}
+
+/**
+ * Set the buffer memory from the maxLoopMemory configuration.
+ * The pool is brought up to this by init(), and by performMaintenance()
+ * if it is raised later.  Buffers already allocated are not released.
+ */
+void AudioPool::setMaxMemory(int megabytes)
+{
+    if (megabytes <= 0)
+      megabytes = AudioPoolDefaultMemory;
 
-    OldPooledBuffer* next = NULL;
-    for (OldPooledBuffer* p = mPool ; p != NULL ; p = next) {
-        next = p->next;
-        delete p;
+    juce::int64 bytes = (juce::int64)megabytes * 1024 * 1024;
+
+    // never less than the reserve
+    juce::int64 reserve = 0;
+    for (int i = 0 ; i < AudioBlockClasses ; i++)
+      reserve += getBufferBytes(i) * AudioPoolReserve;
+    if (bytes < reserve)
+      bytes = reserve;
+
+    mMaxBytes = bytes;
+}
+
+/**
+ * The number of samples in a buffer of the given class.
+ */
+int AudioPool::getBufferSamples(int sizeClass)
+{
+    return BUFFER_SIZE * AudioBlockSlots(sizeClass);
+}
+
+/**
+ * The full size of a buffer including the header.
+ */
+juce::int64 AudioPool::getBufferBytes(int sizeClass)
+{
+    return sizeof(OldPooledBuffer) + (getBufferSamples(sizeClass) * sizeof(float));
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Free Lists
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate and register a new buffer.
+ * This is the only place we call the system allocator, and it is
+ * never called in the interrupt.  Returns nullptr if the table is
+ * full, a buffer that couldn't be pooled would have to be deleted
+ * by whoever freed it which could be the audio thread.
+ */
+OldPooledBuffer* AudioPool::allocate(int sizeClass)
+{
+    OldPooledBuffer* pb = nullptr;
+
+    // claim a table slot if there is one left
+    int slot = mTableSize.load();
+    while (slot < AudioPoolMaxBuffers &&
+           !mTableSize.compare_exchange_weak(slot, slot + 1)) {
+    }
+
+    if (slot >= AudioPoolMaxBuffers) {
+        mOverflows++;
+    }
+    else {
+        int bytesize = (int)getBufferBytes(sizeClass);
+        char* bytes = new char[bytesize];
+        MemTrack(bytes, "AudioPool:newBuffer", bytesize);
+        memset(bytes, 0, bytesize);
+
+        // placement new for the atomics
+        pb = new (bytes) OldPooledBuffer();
+        pb->index = slot;
+        pb->next = 0;
+        pb->pooled = 0;
+        pb->sizeClass = sizeClass;
+        pb->references = 0;
+        mTable[slot] = pb;
+
+        mAllocated++;
+        mAllocatedBytes += bytesize;
+        mClassAllocated[sizeClass]++;
+    }
+    return pb;
+}
+
+float* AudioPool::getSamples(OldPooledBuffer* pb)
+{
+    return (float*)(((char*)pb) + sizeof(OldPooledBuffer));
+}
+
+OldPooledBuffer* AudioPool::getHeader(float* buffer)
+{
+    return (OldPooledBuffer*)(((char*)buffer) - sizeof(OldPooledBuffer));
+}
+
+/**
+ * Remove the first buffer from a free list.
+ * The tag in the high word changes on every update so a buffer
+ * that was popped and pushed again while we were looking at it
+ * makes the exchange fail.
+ */
+OldPooledBuffer* AudioPool::pop(std::atomic<juce::uint64>& list)
+{
+    OldPooledBuffer* pb = nullptr;
+    juce::uint64 head = list.load(std::memory_order_acquire);
+
+    while (pb == nullptr) {
+        int index = (int)(head & 0xFFFFFFFF);
+        if (index == 0)
+          break;
+
+        OldPooledBuffer* candidate = mTable[index - 1];
+        juce::uint64 tag = (head >> 32) + 1;
+        juce::uint64 neu = (tag << 32) | (juce::uint64)candidate->next.load();
+
+        if (list.compare_exchange_weak(head, neu, std::memory_order_acq_rel,
+                                       std::memory_order_acquire))
+          pb = candidate;
     }
+
+    return pb;
 }
 
+void AudioPool::push(std::atomic<juce::uint64>& list, OldPooledBuffer* pb)
+{
+    juce::uint64 head = list.load(std::memory_order_relaxed);
+    juce::uint64 neu;
+    do {
+        pb->next = (int)(head & 0xFFFFFFFF);
+        juce::uint64 tag = (head >> 32) + 1;
+        neu = (tag << 32) | (juce::uint64)(pb->index + 1);
+    } while (!list.compare_exchange_weak(head, neu, std::memory_order_release,
+                                         std::memory_order_relaxed));
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Audio
+//
+//////////////////////////////////////////////////////////////////////
+
 /**
  * Allocate a new Audio in this pool.
  * We could pool the outer Audio object too, but the buffers are
@@ -76,123 +251,299 @@ void AudioPool::freeAudio(Audio* a)
     a->free();
 }
 
+//////////////////////////////////////////////////////////////////////
+//
+// Buffers
+//
+//////////////////////////////////////////////////////////////////////
+
 /**
- * Allocate a new buffer, using the pool if available.
- * In theory have to have a different pool for each size, assume only
- * one for now.
+ * Allocate a new buffer of the given AudioBlockClass, using the pool
+ * if available.
  * !! channels
+ *
+ * This may be called in the audio thread.  Normally the clean list
+ * has something, if not we zero a dirty one which costs time but
+ * doesn't block.  If both lists are empty the configured memory is
+ * too small.  Outside the interrupt we can allocate another one.
+ * In the interrupt we count it and return the silent block, see
+ * Audio::allocBuffer for what happens to that.
  */
-float* AudioPool::newBuffer()
-{
-	float* buffer;
-
-    /*
-      if (mNewPool) {
-      buffer = mNewPool->allocSamples();
-      }
-      else {
-    */
-
-    // mCsect->enter();
-    { const juce::ScopedLock lock (mCsect);
-        
-		if (mPool == NULL) {
-			int bytesize = sizeof(OldPooledBuffer) + (BUFFER_SIZE * sizeof(float));
-			char* bytes = new char[bytesize];
-            MemTrack(bytes, "AudioPool:newBuffer", bytesize);
-			OldPooledBuffer* pb = (OldPooledBuffer*)bytes;
-			pb->next = NULL;
-			pb->pooled = 0;
-			buffer = (float*)(bytes + sizeof(OldPooledBuffer));
-            mAllocated++;
-		}
-		else {
-			buffer = (float*)(((char*)mPool) + sizeof(OldPooledBuffer));
-			if (!mPool->pooled)
-			  Trace(1, "Audio buffer in pool not marked as pooled!\n");
-			mPool->pooled = 0;
-			mPool = mPool->next;
-		}
-		mInUse++;
-		//mCsect->leave();
-    }
-
-    // in both cases, make sure its empty
-    // !! these are big, need to keep the list clean and do it
-    // in a worker thread
-    memset(buffer, 0, BUFFER_SIZE * sizeof(float));
-
-    //	}
+float* AudioPool::newBuffer(int sizeClass)
+{
+    float* buffer = nullptr;
+
+    if (sizeClass < 0 || sizeClass >= AudioBlockClasses) {
+        Trace(1, "AudioPool: Invalid buffer class %d\n", sizeClass);
+        sizeClass = AudioBlockLarge;
+    }
+
+    OldPooledBuffer* pb = pop(mClean[sizeClass]);
+    if (pb != nullptr) {
+        mCleanCount[sizeClass]--;
+        if (!pb->pooled)
+          Trace(1, "Audio buffer in pool not marked as pooled!\n");
+    }
+    else {
+        pb = pop(mDirty[sizeClass]);
+        if (pb != nullptr) {
+            mDirtyCount[sizeClass]--;
+            if (!pb->pooled)
+              Trace(1, "Audio buffer in pool not marked as pooled!\n");
+            memset(getSamples(pb), 0, getBufferSamples(sizeClass) * sizeof(float));
+            mDirtyClears++;
+        }
+        else if (!Interrupt) {
+            pb = allocate(sizeClass);
+        }
+    }
+
+    if (pb == nullptr) {
+        // only trace the first one, these tend to come in bunches
+        if (mExhausted++ == 0)
+          Trace(1, "AudioPool: Pool exhausted, audio will be lost\n");
+        buffer = mSilent[sizeClass];
+    }
+    else {
+        pb->pooled = 0;
+        pb->references = 1;
+        buffer = getSamples(pb);
+
+        int inuse = ++mInUse;
+        int max = mMaxInUse;
+        while (inuse > max && !mMaxInUse.compare_exchange_weak(max, inuse)) {
+        }
+    }
 
 	return buffer;
 }
 
 /**
  * Return a buffer to the pool.
+ * Buffers go on the dirty list, the maintenance thread will
+ * clean them.  If the buffer is shared this just drops a reference.
  */
 void AudioPool::freeBuffer(float* buffer)
 {
-	if (buffer != NULL) {
+	if (buffer != nullptr && !isSilentBlock(buffer)) {
 
-		//if (mNewPool != NULL) {
-        //mNewPool->freeSamples(buffer);
-        //}
-		//else {
-        
-        OldPooledBuffer* pb = (OldPooledBuffer*)
-            (((char*)buffer) - sizeof(OldPooledBuffer));
+        OldPooledBuffer* pb = getHeader(buffer);
 
         if (pb->pooled)
           Trace(1, "Audio buffer already in pool!\n");
+        else if (pb->references.fetch_sub(1) > 1) {
+            // someone else still has it
+        }
         else {
-            const juce::ScopedLock lock (mCsect);
-            //mCsect->enter();
-            pb->next = mPool;
             pb->pooled = 1;
-            mPool = pb;
+            push(mDirty[pb->sizeClass], pb);
+            mDirtyCount[pb->sizeClass]++;
             mInUse--;
-            //mCsect->leave();
         }
-        // }
 	}
 }
 
-void AudioPool::dump()
+/**
+ * Add a reference to a buffer that is going to be shared by
+ * another Audio.
+ */
+void AudioPool::shareBuffer(float* buffer)
 {
-	//if (mNewPool != NULL) {
-    // need a dump method for the new one
-    //trace("NewBufferPool: %d in use ?? in pool\n", mInUse);
-    //}
-	//else {
-    
-    int pooled = 0;
-    { const juce::ScopedLock lock (mCsect);
-        
-        //mCsect->enter();
-        for (OldPooledBuffer* p = mPool ; p != NULL ; p = p->next)
-          pooled++;
-        //mCsect->leave();
+    if (buffer != nullptr && !isSilentBlock(buffer)) {
+        OldPooledBuffer* pb = getHeader(buffer);
+        if (pb->pooled)
+          Trace(1, "AudioPool: Sharing buffer in the pool!\n");
+        else {
+            pb->references++;
+            mShares++;
+        }
+    }
+}
+
+/**
+ * True if more than one Audio has this buffer.
+ * If this returns false for a buffer you have, nobody else can
+ * start sharing it without going through you.
+ */
+bool AudioPool::isShared(float* buffer)
+{
+    bool shared = false;
+    if (buffer != nullptr && !isSilentBlock(buffer))
+      shared = (getHeader(buffer)->references.load() > 1);
+    return shared;
+}
+
+/**
+ * True if this is what newBuffer returned when the pool was exhausted.
+ */
+bool AudioPool::isSilentBlock(float* buffer)
+{
+    bool silent = false;
+    for (int i = 0 ; i < AudioBlockClasses && !silent ; i++)
+      silent = (buffer == mSilent[i]);
+    return silent;
+}
+
+/**
+ * Allocate the configured memory.
+ * Called by the shell during initialization before the kernel is
+ * allowed to start allocating.
+ */
+void AudioPool::init()
+{
+    for (int i = 0 ; i < AudioBlockClasses ; i++)
+      grow(i, getTarget(i));
+
+    Trace(2, "AudioPool: Allocated %ld megabytes in %ld buffers\n",
+          (long)(mAllocatedBytes / (1024 * 1024)), (long)mAllocated);
+}
+
+/**
+ * The number of buffers of a class the configured memory allows.
+ * Audio works up through a few small and medium buffers before
+ * it starts using large ones, an eighth of the memory goes to
+ * small buffers, a quarter to medium and the rest to large.
+ */
+int AudioPool::getTarget(int sizeClass)
+{
+    juce::int64 small = mMaxBytes / 8;
+    juce::int64 medium = mMaxBytes / 4;
+    juce::int64 share = mMaxBytes - small - medium;
+    if (sizeClass == AudioBlockSmall)
+      share = small;
+    else if (sizeClass == AudioBlockMedium)
+      share = medium;
+
+    int buffers = (int)(share / getBufferBytes(sizeClass));
+    if (buffers < AudioPoolReserve)
+      buffers = AudioPoolReserve;
+    return buffers;
+}
+
+/**
+ * Allocate buffers of one class until there are the given
+ * number in all, or the memory limit is reached.
+ */
+void AudioPool::grow(int sizeClass, int buffers)
+{
+    juce::int64 bytes = getBufferBytes(sizeClass);
+
+    while (mClassAllocated[sizeClass] < buffers &&
+           mAllocatedBytes + bytes <= mMaxBytes) {
+        OldPooledBuffer* pb = allocate(sizeClass);
+        if (pb == nullptr)
+          break;
+        pb->pooled = 1;
+        push(mClean[sizeClass], pb);
+        mCleanCount[sizeClass]++;
+    }
+}
+
+/**
+ * Bring the clean list for one class up to some number of buffers,
+ * or as close as we can get within the memory limit.
+ */
+void AudioPool::fill(int sizeClass, int buffers)
+{
+    juce::int64 bytes = getBufferBytes(sizeClass);
+
+    for (int i = mCleanCount[sizeClass] ; i < buffers ; i++) {
+        if (mAllocatedBytes + bytes > mMaxBytes ||
+            mTableSize >= AudioPoolMaxBuffers)
+          break;
+
+        OldPooledBuffer* pb = allocate(sizeClass);
+        if (pb == nullptr)
+          break;
+        pb->pooled = 1;
+        push(mClean[sizeClass], pb);
+        mCleanCount[sizeClass]++;
+    }
+}
+
+/**
+ * Called periodically by the shell maintenance thread.
+ * Zero any buffers that have been returned, then make sure the clean
+ * lists are back above the reserve.
+ */
+void AudioPool::performMaintenance()
+{
+    for (int i = 0 ; i < AudioBlockClasses ; i++) {
+        int samples = getBufferSamples(i);
+        OldPooledBuffer* pb = pop(mDirty[i]);
+        while (pb != nullptr) {
+            mDirtyCount[i]--;
+            memset(getSamples(pb), 0, samples * sizeof(float));
+            push(mClean[i], pb);
+            mCleanCount[i]++;
+            pb = pop(mDirty[i]);
+        }
+
+        // catch up if maxLoopMemory was raised
+        grow(i, getTarget(i));
+
+        if (mCleanCount[i] < AudioPoolReserve) {
+            if (mAllocatedBytes + getBufferBytes(i) > mMaxBytes) {
+                // only the audio thread can fix this by returning something
+            }
+            else {
+                Trace(2, "AudioPool: Replenishing reserve for class %d, %d clean\n",
+                      i, (int)mCleanCount[i]);
+                fill(i, AudioPoolReserve * 2);
+            }
+        }
     }
 
+    // anything written into the silent blocks is lost, but it
+    // may be read back before the write is finished so keep them quiet
+    int exhausted = mExhausted;
+    if (exhausted != mLastExhausted) {
+        for (int i = 0 ; i < AudioBlockClasses ; i++)
+          memset(mSilent[i], 0, getBufferSamples(i) * sizeof(float));
+        mLastExhausted = exhausted;
+    }
+}
+
+void AudioPool::dump()
+{
+    int pooled = 0;
+    for (int i = 0 ; i < AudioBlockClasses ; i++)
+      pooled += mCleanCount[i] + mDirtyCount[i];
     int used = mAllocated - pooled;
 
     Trace(2, "AudioPool: %d buffers allocated, %d in the pool, %d in use\n",
-           mAllocated, pooled, used);
+          (int)mAllocated, pooled, used);
 
     // this should match
     if (used != mInUse)
       Trace(2, "AudioPool: Unmatched usage counters %d %d\n",
-             used, mInUse);
+            used, (int)mInUse);
 
-    //}
+    traceStatistics();
 }
 
-/**
- * Warm the buffer pool with some number of buffers.
- * Was never implemented.
- */
-void AudioPool::init(int buffers)
+void AudioPool::traceStatistics()
 {
+    Trace(2, "AudioPool: statistics\n");
+    Trace(2, "  Maximum megabytes %d allocated %d maximum in use %d\n",
+          (int)(mMaxBytes / (1024 * 1024)),
+          (int)(mAllocatedBytes / (1024 * 1024)), (int)mMaxInUse);
+
+    for (int i = 0 ; i < AudioBlockClasses ; i++) {
+        Trace(2, "  Class %d frames %d allocated %d clean %d dirty %d\n",
+              i, getBufferSamples(i) / BUFFER_CHANNELS,
+              (int)mClassAllocated[i], (int)mCleanCount[i], (int)mDirtyCount[i]);
+    }
+
+    if (mDirtyClears > 0)
+      Trace(2, "  Dirty buffers cleared in place %d\n", (int)mDirtyClears);
+
+    if (mShares > 0)
+      Trace(2, "  Buffers shared %d\n", (int)mShares);
+
+    if (mExhausted > 0)
+      Trace(1, "  Pool exhausted %d times, %d beyond the table\n",
+            (int)mExhausted, (int)mOverflows);
 }
 
 /****************************************************************************/
@@ -3,50 +3,187 @@
  * There is normally only one of these in a Mobius instance.
  *
  * Broke this out of Audio so we have more control over who uses it.
+ *
+ * Buffers are allocated by both the shell and the kernel, the kernel
+ * does so in the audio thread during recording.  To keep that from
+ * blocking or calling the system allocator, the pool is kept full
+ * by the shell maintenance thread and the free lists are lock free.
+ *
+ * The memory allowed by the maxLoopMemory configuration is allocated
+ * up front by init() and divided between the size classes.  If the
+ * audio thread still runs out, newBuffer does not go to the system
+ * allocator.  It counts the miss and returns the silent block for the
+ * class, which Audio recognizes and doesn't keep, so whatever was
+ * written there is lost.  Threads outside the interrupt, like file
+ * readers, may grow the pool when it runs out.
+ *
+ * There are two free lists.  Buffers returned with freeBuffer go on
+ * the "dirty" list since they still contain audio.  The maintenance
+ * thread moves them to the "clean" list after zeroing them.  newBuffer
+ * takes from the clean list first, and only zeros a dirty buffer if
+ * the clean list is empty.
+ *
+ * Every buffer ever allocated is registered in a fixed size table so
+ * the free lists can be linked by table index and tagged to avoid
+ * ABA problems with a single 64-bit compare-and-swap.  Buffers are
+ * never deleted until the pool is destroyed.
+ *
+ * Buffers come in the size classes defined by AudioBlockClass in
+ * Audio.h, each class has its own pair of free lists and reserve.
+ * A buffer remembers its class so it can be returned without the
+ * caller having to say what it was.
+ *
+ * Buffers may be shared by more than one Audio, see Audio::copy.
+ * Each buffer has a reference count that starts at one when it
+ * leaves the pool, shareBuffer adds a reference and freeBuffer
+ * only returns it to the pool when the last reference is gone.
  */
 
 #pragma once
 
-// for CriticalSection, unfortunate that the users will drag that in
+#include <atomic>
+
+// for juce::uint64, unfortunate that the users will drag that in
 #include <JuceHeader.h>
 
+// for AudioBlockClass
+#include "Audio.h"
+
 /**
  * This structure is allocated at the top of every Audio buffer.
+ * Keep the size a multiple of 16 so the samples stay aligned.
  */
 struct OldPooledBuffer {
 
-	// todo, pool status, statistics
-	OldPooledBuffer* next;
-	int pooled;
+    // index of this buffer in the pool table, -1 if the table
+    // was full and this will be deleted when freed
+	int index;
+
+    // table index plus one of the next buffer on a free list
+    std::atomic<int> next;
+
+    // non-zero when on one of the free lists
+	std::atomic<int> pooled;
+
+    // AudioBlockClass
+    int sizeClass;
+
+    // number of Audios using this buffer
+    std::atomic<int> references;
+
+    // unused, keeps the header at 32 bytes
+    int reserved[3];
 
 };
 
+/**
+ * The number of slots in the buffer table.  This is a hard ceiling
+ * on the number of pooled buffers of all sizes, between 2GB of small
+ * buffers and 32GB of large ones.
+ */
+const int AudioPoolMaxBuffers = 65536;
+
+/**
+ * The buffer memory in megabytes if the configuration does not
+ * specify one.  All of it is allocated when the pool is initialized,
+ * at 44.1K this is about twelve minutes of stereo audio.
+ */
+const int AudioPoolDefaultMemory = 256;
+
+/**
+ * The number of clean buffers of each class the maintenance thread
+ * tries to keep available.  A large stereo buffer at 44.1K is about
+ * 1.5 seconds so this covers several tracks recording at once between
+ * maintenance calls.  Audio works up through the small and medium
+ * buffers before it starts using large ones, so the same number of
+ * those is plenty.
+ */
+const int AudioPoolReserve = 32;
+
 class AudioPool {
-    
+
   public:
 
     AudioPool();
     ~AudioPool();
 
-    void init(int buffers);
+    void init();
+    void setMaxMemory(int megabytes);
+    void performMaintenance();
     void dump();
+    void traceStatistics();
+
+    // statistics for the benchmark
+    int getAllocated() {
+        return mAllocated;
+    }
+    int getExhausted() {
+        return mExhausted;
+    }
 
     class Audio* newAudio();
     // class Audio* newAudio(const char* file);
     void freeAudio(class Audio* a);
 
-    float* newBuffer();
+    float* newBuffer(int sizeClass);
     void freeBuffer(float* b);
+    void shareBuffer(float* b);
+    bool isShared(float* b);
+    bool isSilentBlock(float* b);
+
+    static int getBufferSamples(int sizeClass);
+
+    /**
+     * Called by the threads that run in the audio interrupt
+     * so newBuffer knows it can't allocate.
+     */
+    static void setInterrupt(bool b);
 
   private:
 
-    //class CriticalSection* mCsect;
-    juce::CriticalSection mCsect;
-    
-    OldPooledBuffer* mPool;
-    //class SampleBufferPool* mNewPool;
-    int mAllocated;
-	int mInUse;
+    int getTarget(int sizeClass);
+    void grow(int sizeClass, int buffers);
 
-};
+    OldPooledBuffer* allocate(int sizeClass);
+    OldPooledBuffer* pop(std::atomic<juce::uint64>& list);
+    void push(std::atomic<juce::uint64>& list, OldPooledBuffer* pb);
+    float* getSamples(OldPooledBuffer* pb);
+    OldPooledBuffer* getHeader(float* b);
+    juce::int64 getBufferBytes(int sizeClass);
+    void fill(int sizeClass, int buffers);
 
+    // every pooled buffer by index
+    OldPooledBuffer** mTable;
+    std::atomic<int> mTableSize;
+
+    // free list heads for each class,
+    // tag in the high word, index+1 in the low word
+    std::atomic<juce::uint64> mClean[AudioBlockClasses];
+    std::atomic<juce::uint64> mDirty[AudioBlockClasses];
+    std::atomic<int> mCleanCount[AudioBlockClasses];
+    std::atomic<int> mDirtyCount[AudioBlockClasses];
+
+    // configured limit
+    juce::int64 mMaxBytes;
+
+    // given out when the audio thread exhausts a class
+    float* mSilent[AudioBlockClasses];
+
+    // mExhausted the last time the silent blocks were cleared
+    int mLastExhausted;
+
+    // true in threads that run in the interrupt
+    static thread_local bool Interrupt;
+
+    // statistics
+    std::atomic<int> mAllocated;
+    std::atomic<juce::int64> mAllocatedBytes;
+    std::atomic<int> mClassAllocated[AudioBlockClasses];
+	std::atomic<int> mInUse;
+    std::atomic<int> mMaxInUse;
+    std::atomic<int> mExhausted;
+    std::atomic<int> mOverflows;
+    std::atomic<int> mDirtyClears;
+    std::atomic<int> mShares;
+
+};
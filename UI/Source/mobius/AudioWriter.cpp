@@ -0,0 +1,216 @@
+/**
+ * Background file writer, see AudioWriter.h
+ */
+
+#include <JuceHeader.h>
+
+#include "../util/Trace.h"
+
+#include "Audio.h"
+#include "AudioFile.h"
+#include "core/Layer.h"
+#include "core/Project.h"
+#include "ProjectFile.h"
+#include "MobiusInterface.h"
+
+#include "AudioWriter.h"
+
+/**
+ * How long the destructor waits for the files in the queue
+ * to finish, in milliseconds.  Losing a save because the application
+ * was closed right after it is worse than waiting a little.
+ */
+const int AudioWriterShutdownWait = 30000;
+
+/**
+ * Snapshots are normally taken before this and sent back to the
+ * kernel.  If not, we're shutting down and the audio thread
+ * has stopped so it is safe to return the layers here.
+ */
+AudioWriteRequest::~AudioWriteRequest()
+{
+    delete audio;
+    delete snapshot;
+    delete project;
+}
+
+AudioWriter::AudioWriter() : juce::Thread("Mobius AudioWriter")
+{
+}
+
+/**
+ * Let it finish what it has then stop.
+ */
+AudioWriter::~AudioWriter()
+{
+    if (isThreadRunning()) {
+        signalThreadShouldExit();
+        notify();
+        if (!stopThread(AudioWriterShutdownWait))
+          Trace(1, "AudioWriter: Thread did not stop\n");
+    }
+}
+
+/**
+ * Queue a request and wake up the thread, starting it the
+ * first time we have something to do.
+ */
+void AudioWriter::save(Audio* audio, juce::File file)
+{
+    AudioWriteRequest* request = new AudioWriteRequest();
+    request->audio = audio;
+    request->file = file;
+    add(request);
+}
+
+void AudioWriter::save(LayerSnapshot* snapshot, juce::File file)
+{
+    AudioWriteRequest* request = new AudioWriteRequest();
+    request->snapshot = snapshot;
+    request->file = file;
+    add(request);
+}
+
+void AudioWriter::save(Project* project, juce::File file)
+{
+    AudioWriteRequest* request = new AudioWriteRequest();
+    request->project = project;
+    request->file = file;
+    add(request);
+}
+
+void AudioWriter::add(AudioWriteRequest* request)
+{
+    {
+        juce::ScopedLock lock (criticalSection);
+        pending.add(request);
+    }
+
+    if (!isThreadRunning())
+      startThread();
+    else
+      notify();
+}
+
+int AudioWriter::getProgress()
+{
+    return progress;
+}
+
+int AudioWriter::getPending()
+{
+    juce::ScopedLock lock (criticalSection);
+    return pending.size();
+}
+
+/**
+ * Write files until there are none left, then wait for more.
+ * The request stays on the pending list while it is being written
+ * so the maintenance thread can see what it is.
+ */
+void AudioWriter::run()
+{
+    while (true) {
+        AudioWriteRequest* request = nullptr;
+        {
+            juce::ScopedLock lock (criticalSection);
+            request = pending.getFirst();
+        }
+
+        if (request == nullptr) {
+            if (threadShouldExit())
+              break;
+            wait(-1);
+        }
+        else {
+            juce::String path = request->file.getFullPathName();
+            Trace(2, "AudioWriter: Writing %s\n", path.toUTF8());
+            juce::int64 start = juce::Time::getHighResolutionTicks();
+
+            if (request->audio == nullptr && request->snapshot != nullptr)
+              request->audio = request->snapshot->flatten();
+
+            if (request->project != nullptr)
+              request->error = ProjectFile::write(request->file, request->project);
+            else if (request->audio == nullptr)
+              request->error = "Nothing to save";
+            else
+              request->error = AudioFile::write(request->file, request->audio, &progress);
+
+            double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            Tracej("AudioWriter: Finished " + path + " in " + juce::String(seconds, 2) + " seconds");
+
+            // give the buffers back now rather than when the
+            // notification is sent
+            delete request->audio;
+            request->audio = nullptr;
+            progress = -1;
+            
+            juce::ScopedLock lock (criticalSection);
+            pending.removeObject(request, false);
+            completed.add(request);
+        }
+    }
+}
+
+/**
+ * Send notifications for files that started or finished and
+ * collect the snapshots we're done with.
+ */
+LayerSnapshot* AudioWriter::performMaintenance(MobiusListener* listener)
+{
+    LayerSnapshot* snapshots = nullptr;
+    juce::StringArray alerts;
+    {
+        juce::ScopedLock lock (criticalSection);
+
+        for (auto request : completed) {
+            if (request->snapshot != nullptr) {
+                request->snapshot->setNext(snapshots);
+                snapshots = request->snapshot;
+                request->snapshot = nullptr;
+            }
+            if (request->project != nullptr) {
+                LayerSnapshot* list = request->project->stealSnapshots();
+                while (list != nullptr) {
+                    LayerSnapshot* next = list->getNext();
+                    list->setNext(snapshots);
+                    snapshots = list;
+                    list = next;
+                }
+                // the rest of it can go now
+                delete request->project;
+                request->project = nullptr;
+            }
+            
+            juce::String name = request->file.getFileName();
+            if (request->error.length() > 0)
+              alerts.add("Unable to save " + name + ": " + request->error);
+            else
+              alerts.add("Saved " + name);
+            if (request == announced)
+              announced = nullptr;
+        }
+        completed.clear();
+
+        // let them know about long ones while they're happening,
+        // a short one will already be on the completed list
+        AudioWriteRequest* current = pending.getFirst();
+        if (current != nullptr && current != announced) {
+            alerts.add("Saving " + current->file.getFileName());
+            announced = current;
+        }
+    }
+
+    // call the listener outside the lock
+    if (listener != nullptr) {
+        for (auto alert : alerts)
+          listener->MobiusAlert(alert);
+    }
+
+    return snapshots;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
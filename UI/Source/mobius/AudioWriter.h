@@ -0,0 +1,117 @@
+/**
+ * Background thread for saving Audio to files.
+ *
+ * Saving a long loop used to happen in the maintenance thread while
+ * it was processing the KernelEvent, which meant the UI stopped
+ * refreshing until the file was written.  KernelEventHandler now
+ * takes a copy of the Audio and passes it here.  Copies share buffers
+ * with the original (see Audio::copy) so that part is fast, and the
+ * audio thread makes its own copy of anything it changes while we're
+ * writing.
+ *
+ * Loops are passed as a LayerSnapshot which is flattened here.
+ * Snapshots have to be deleted by the kernel, so when they're done
+ * they are given back to the shell to send down.  Projects are
+ * written with ProjectFile and have snapshots for every layer.
+ *
+ * Requests are written in the order they were made.  When one finishes
+ * it is left on a completed list and MobiusShell::performMaintenance
+ * reports it to the MobiusListener so notifications always come from
+ * the maintenance thread like the others.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <JuceHeader.h>
+
+/**
+ * One file to write.
+ */
+class AudioWriteRequest
+{
+  public:
+
+    AudioWriteRequest() {}
+    ~AudioWriteRequest();
+
+    // owned, returned to its pool when the request is deleted
+    class Audio* audio = nullptr;
+
+    // owned, but must be given back to the kernel
+    class LayerSnapshot* snapshot = nullptr;
+
+    // owned, its snapshots must be given back to the kernel
+    class Project* project = nullptr;
+    
+    juce::File file;
+
+    // set when finished, empty if it worked
+    juce::String error;
+};
+
+class AudioWriter : public juce::Thread
+{
+  public:
+
+    AudioWriter();
+    ~AudioWriter();
+
+    /**
+     * Queue an Audio to be written.  Ownership of the Audio
+     * is taken, it will be deleted when the file is written.
+     */
+    void save(class Audio* audio, juce::File file);
+
+    /**
+     * Queue a layer snapshot to be flattened and written.
+     * Ownership is taken until the snapshot is returned
+     * by performMaintenance.
+     */
+    void save(class LayerSnapshot* snapshot, juce::File file);
+
+    /**
+     * Queue a project captured by the kernel to be written.
+     * Ownership is taken, the snapshots it contains are
+     * returned by performMaintenance.
+     */
+    void save(class Project* project, juce::File file);
+
+    /**
+     * Called by the shell maintenance thread to send notifications
+     * for anything that finished since the last time.
+     * Returns the list of snapshots that are no longer needed
+     * which must be sent back to the kernel.
+     */
+    class LayerSnapshot* performMaintenance(class MobiusListener* listener);
+
+    /**
+     * Percentage of the current file written, -1 if idle.
+     */
+    int getProgress();
+
+    /**
+     * Number of files waiting to be written, including the
+     * one being written now.
+     */
+    int getPending();
+
+    void run() override;
+
+  private:
+
+    void add(AudioWriteRequest* request);
+
+    juce::CriticalSection criticalSection;
+    juce::OwnedArray<AudioWriteRequest> pending;
+    juce::OwnedArray<AudioWriteRequest> completed;
+
+    std::atomic<int> progress {-1};
+    
+    // the pending file we've reported as starting
+    AudioWriteRequest* announced = nullptr;
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -0,0 +1,415 @@
+/**
+ * Offline performance harness, see Benchmark.h for the file format.
+ *
+ * The engine is driven the same way the audio device and MainThread
+ * would drive it.  UIActions go through MobiusShell::doAction and are
+ * picked up by the kernel at the start of the next block, and
+ * performMaintenance is called every 1/10 second of audio.  Only
+ * the listener call is timed, maintenance and file I/O are not.
+ *
+ * Allocations are counted with the MemAllocations counter so only
+ * things allocated through the Mem utilities are seen, which is most
+ * of the core.  AudioPool is counted separately, anything it had to
+ * allocate beyond the reserve is a sign the maintenance interval is
+ * too long for what the timeline is doing.
+ *
+ * Per-track times are only recorded for tracks rendered serially,
+ * so if workers is set tracks given to TrackRenderer won't be counted.
+ */
+
+#include <JuceHeader.h>
+
+#include "../util/Util.h"
+#include "../util/Trace.h"
+#include "../util/FileUtil.h"
+#include "../model/MobiusConfig.h"
+#include "../model/XmlRenderer.h"
+#include "../model/UIAction.h"
+#include "../model/FunctionDefinition.h"
+#include "../model/UIParameter.h"
+
+#include "core/Mobius.h"
+#include "core/Mem.h"
+
+#include "Audio.h"
+#include "AudioFile.h"
+#include "AudioPool.h"
+#include "MobiusShell.h"
+#include "OfflineContainer.h"
+
+#include "Benchmark.h"
+
+Benchmark::Benchmark()
+{
+}
+
+Benchmark::~Benchmark()
+{
+    delete[] trackTimes;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Run
+//
+//////////////////////////////////////////////////////////////////////
+
+bool Benchmark::run(juce::File root, juce::File dir)
+{
+    bool success = false;
+
+    Trace(2, "Benchmark: Running %s\n", dir.getFullPathName().toUTF8());
+
+    MobiusConfig* config = nullptr;
+    if (parse(dir.getChildFile("benchmark.txt")))
+      config = readConfig(root, dir);
+
+    if (config != nullptr) {
+
+        // input and output are kept in a private pool so they
+        // don't show up in the engine's statistics
+        // this must be declared before the Audio objects using it
+        AudioPool pool;
+        Audio* input = nullptr;
+        Audio* output = nullptr;
+
+        if (inputFile.length() > 0) {
+            input = AudioFile::read(dir.getChildFile(inputFile), &pool);
+            if (input == nullptr)
+              Trace(1, "Benchmark: Unable to read input file\n");
+        }
+        if (outputFile.length() > 0) {
+            output = pool.newAudio();
+            output->setSampleRate(sampleRate);
+        }
+
+        // parallel rendering makes per-track timing meaningless
+        // so it is off unless the timeline asks for it
+        config->setTrackWorkers(workers);
+
+        OfflineContainer container(root, sampleRate, blockSize);
+        blockSize = container.getBlockSize();
+
+        MobiusShell* engine = new MobiusShell(&container);
+        engine->configure(config);
+        delete config;
+
+        Mobius* core = engine->getKernel()->getCore();
+        trackCount = core->getTrackCount();
+        delete[] trackTimes;
+        trackTimes = new double[trackCount];
+        for (int i = 0 ; i < trackCount ; i++)
+          trackTimes[i] = 0.0;
+        core->setTrackTimes(trackTimes);
+
+        AudioPool* enginePool = engine->getAudioPool();
+        int poolStart = enginePool->getAllocated();
+        int exhaustedStart = enginePool->getExhausted();
+
+        juce::int64 totalFrames = (juce::int64)(seconds * sampleRate);
+        int maxBlocks = (int)((totalFrames + blockSize - 1) / blockSize);
+        blockTimes.clearQuick();
+        blockTimes.ensureStorageAllocated(maxBlocks);
+        elapsed = 0.0;
+        misses = 0;
+        allocations = 0;
+
+        juce::int64 maintenanceFrames = sampleRate / 10;
+        juce::int64 lastMaintenance = 0;
+        int nextAction = 0;
+        float* inbuf = container.getInputBuffer();
+        float* outbuf = container.getOutputBuffer();
+
+        juce::int64 frame = 0;
+        while (frame < totalFrames) {
+
+            int frames = blockSize;
+            if (totalFrames - frame < frames)
+              frames = (int)(totalFrames - frame);
+
+            // actions whose frame falls within this block
+            while (nextAction < actions.size() &&
+                   actionFrames[nextAction] < frame + frames) {
+                engine->doAction(actions[nextAction]);
+                nextAction++;
+            }
+
+            memset(inbuf, 0, sizeof(float) * frames * AUDIO_MAX_CHANNELS);
+            if (input != nullptr && frame < input->getFrames())
+              input->get(inbuf, frames, (long)frame);
+
+            int allocStart = MemAllocations;
+            juce::int64 start = juce::Time::getHighResolutionTicks();
+
+            container.process(frames);
+
+            juce::int64 end = juce::Time::getHighResolutionTicks();
+            allocations += MemAllocations - allocStart;
+
+            double time = juce::Time::highResolutionTicksToSeconds(end - start);
+            blockTimes.add(time);
+            elapsed += time;
+            if (time > (double)frames / (double)sampleRate)
+              misses++;
+
+            if (output != nullptr)
+              output->put(outbuf, frames, (long)frame);
+
+            frame += frames;
+
+            if (frame - lastMaintenance >= maintenanceFrames) {
+                engine->performMaintenance();
+                FlushTrace();
+                lastMaintenance = frame;
+            }
+        }
+
+        core->setTrackTimes(nullptr);
+        engine->performMaintenance();
+
+        poolAllocations = enginePool->getAllocated() - poolStart;
+        poolExhausted = enginePool->getExhausted() - exhaustedStart;
+
+        report(dir);
+
+        if (output != nullptr)
+          AudioFile::write(dir.getChildFile(outputFile), output);
+
+        delete engine;
+        delete input;
+        delete output;
+
+        success = (maxMisses < 0 || misses <= maxMisses);
+        if (!success)
+          Trace(1, "Benchmark: %ld deadline misses exceeds the maximum of %ld\n",
+                (long)misses, (long)maxMisses);
+    }
+
+    FlushTrace();
+    return success;
+}
+
+/**
+ * Read the MobiusConfig, preferring one in the benchmark directory
+ * so a benchmark can control the track count and presets.
+ */
+MobiusConfig* Benchmark::readConfig(juce::File root, juce::File dir)
+{
+    MobiusConfig* config = nullptr;
+
+    juce::File file = dir.getChildFile("mobius.xml");
+    if (!file.existsAsFile())
+      file = root.getChildFile("mobius.xml");
+
+    char* xml = ReadFile(file.getFullPathName().toUTF8());
+    if (xml == nullptr) {
+        Trace(1, "Benchmark: Unable to read %s\n", file.getFullPathName().toUTF8());
+    }
+    else {
+        XmlRenderer xr;
+        config = xr.parseMobiusConfig(xml);
+        // ReadFile allocates with CopyString which uses new[]
+        delete[] xml;
+    }
+    return config;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Timeline
+//
+//////////////////////////////////////////////////////////////////////
+
+bool Benchmark::parse(juce::File file)
+{
+    bool success = true;
+
+    if (!file.existsAsFile()) {
+        Trace(1, "Benchmark: Missing %s\n", file.getFullPathName().toUTF8());
+        success = false;
+    }
+    else {
+        juce::StringArray lines;
+        file.readLines(lines);
+
+        for (int i = 0 ; i < lines.size() && success ; i++) {
+            juce::String line = lines[i].upToFirstOccurrenceOf("#", false, false).trim();
+            juce::StringArray tokens;
+            tokens.addTokens(line, " \t", "\"");
+            tokens.removeEmptyStrings();
+
+            if (tokens.size() == 0) {
+                // blank or comment
+            }
+            else if (tokens[0].containsOnly("0123456789.")) {
+                success = parseAction(tokens);
+            }
+            else if (tokens.size() < 2) {
+                Trace(1, "Benchmark: Missing value for %s\n", tokens[0].toUTF8());
+                success = false;
+            }
+            else {
+                juce::String name = tokens[0];
+                juce::String value = tokens[1];
+                if (name == "sampleRate")
+                  sampleRate = value.getIntValue();
+                else if (name == "blockSize")
+                  blockSize = value.getIntValue();
+                else if (name == "seconds")
+                  seconds = value.getDoubleValue();
+                else if (name == "workers")
+                  workers = value.getIntValue();
+                else if (name == "maxMisses")
+                  maxMisses = value.getIntValue();
+                else if (name == "input")
+                  inputFile = value;
+                else if (name == "output")
+                  outputFile = value;
+                else {
+                    Trace(1, "Benchmark: Unknown setting %s\n", name.toUTF8());
+                    success = false;
+                }
+            }
+        }
+
+        if (sampleRate <= 0) {
+            Trace(1, "Benchmark: Invalid sample rate\n");
+            success = false;
+        }
+    }
+    return success;
+}
+
+/**
+ * <seconds> <track> <name> [value]
+ * The name may be a function or a parameter, parameters need a value.
+ */
+bool Benchmark::parseAction(juce::StringArray& tokens)
+{
+    bool success = false;
+
+    if (tokens.size() < 3) {
+        Trace(1, "Benchmark: Incomplete action\n");
+    }
+    else {
+        juce::int64 frame = (juce::int64)(tokens[0].getDoubleValue() * sampleRate);
+        juce::String jname = tokens[2];
+        const char* name = jname.toUTF8();
+
+        UIAction* action = new UIAction();
+        action->trigger = TriggerUI;
+        action->down = true;
+        action->scopeTrack = tokens[1].getIntValue();
+        CopyString(name, action->actionName, sizeof(action->actionName));
+
+        FunctionDefinition* function = FunctionDefinition::find(name);
+        UIParameter* parameter = nullptr;
+        if (function != nullptr) {
+            action->type = ActionFunction;
+            action->triggerMode = TriggerModeMomentary;
+            action->implementation.function = function;
+            success = true;
+        }
+        else {
+            parameter = UIParameter::find(name);
+            if (parameter == nullptr) {
+                Trace(1, "Benchmark: Unknown function or parameter %s\n", name);
+            }
+            else if (tokens.size() < 4) {
+                Trace(1, "Benchmark: Missing value for parameter %s\n", name);
+            }
+            else {
+                action->type = ActionParameter;
+                action->triggerMode = TriggerModeContinuous;
+                action->implementation.parameter = parameter;
+                action->arg.setInt(tokens[3].getIntValue());
+                success = true;
+            }
+        }
+
+        if (!success) {
+            delete action;
+        }
+        else {
+            if (actionFrames.size() > 0 && frame < actionFrames.getLast())
+              Trace(1, "Benchmark: Action %s is out of order\n", name);
+            actions.add(action);
+            actionFrames.add(frame);
+        }
+    }
+    return success;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Results
+//
+//////////////////////////////////////////////////////////////////////
+
+void Benchmark::add(juce::String line)
+{
+    Tracej("Benchmark: " + line);
+    results += line + "\n";
+}
+
+void Benchmark::report(juce::File dir)
+{
+    results = "";
+
+    int blocks = blockTimes.size();
+    double audioSeconds = seconds;
+    double deadline = (double)blockSize / (double)sampleRate;
+
+    juce::Array<double> sorted (blockTimes);
+    sorted.sort();
+
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    if (blocks > 0) {
+        p50 = sorted[(int)(blocks * 0.50)];
+        p99 = sorted[juce::jmin(blocks - 1, (int)(blocks * 0.99))];
+        max = sorted.getLast();
+        mean = elapsed / blocks;
+    }
+
+    add("Sample rate " + juce::String(sampleRate) +
+        " block size " + juce::String(blockSize) +
+        " deadline " + juce::String(deadline * 1000.0, 3) + " ms");
+
+    add("Blocks " + juce::String(blocks) +
+        " audio " + juce::String(audioSeconds, 1) + " seconds" +
+        " elapsed " + juce::String(elapsed, 3) + " seconds" +
+        ((elapsed > 0.0) ? (" " + juce::String(audioSeconds / elapsed, 1) + "x real time") : ""));
+
+    add("Block ms mean " + juce::String(mean * 1000.0, 3) +
+        " p50 " + juce::String(p50 * 1000.0, 3) +
+        " p99 " + juce::String(p99 * 1000.0, 3) +
+        " max " + juce::String(max * 1000.0, 3));
+
+    add("Deadline misses " + juce::String(misses));
+
+    for (int i = 0 ; i < trackCount ; i++) {
+        double total = trackTimes[i];
+        add("Track " + juce::String(i + 1) +
+            " total ms " + juce::String(total * 1000.0, 3) +
+            " mean us " + juce::String((blocks > 0) ? (total * 1000000.0 / blocks) : 0.0, 2));
+    }
+
+    add("Allocations in the interrupt " + juce::String(allocations));
+    add("AudioPool buffers allocated " + juce::String(poolAllocations) +
+        " exhausted " + juce::String(poolExhausted));
+
+    juce::File file = dir.getChildFile("benchmark-results.txt");
+    if (!file.replaceWithText(results))
+      Trace(1, "Benchmark: Unable to write %s\n", file.getFullPathName().toUTF8());
+
+    // so command line runners can see it
+    fputs(results.toUTF8(), stdout);
+    fflush(stdout);
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
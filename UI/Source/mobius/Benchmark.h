@@ -0,0 +1,94 @@
+/**
+ * Headless performance harness for the engine.
+ *
+ * Builds a private MobiusShell on an OfflineContainer and pushes
+ * audio through it as fast as it will go, feeding it a WAV file as
+ * input and performing UIActions from a timeline at fixed frames.
+ * Every block is timed against the deadline it would have had on a
+ * real device at the chosen block size and sample rate.
+ *
+ * This is meant to be run from the command line with no UI so it can
+ * be used to compare builds and catch performance regressions in Loop,
+ * Layer, and Synchronizer.  It must not be run inside an application
+ * that already has an engine since the core still has static objects
+ * that would be shared.
+ *
+ * The benchmark directory contains a file named benchmark.txt with
+ * one setting or action per line, # starts a comment.
+ *
+ *     sampleRate 44100
+ *     blockSize 256
+ *     seconds 30
+ *     workers 0
+ *     maxMisses 0
+ *     input input.wav
+ *     output output.wav
+ *
+ *     <seconds> <track> <function>
+ *     <seconds> <track> <parameter> <value>
+ *
+ * Settings must come before the actions since action times are
+ * converted to frames as they are read.
+ * Track zero is the active track.  Actions must be in time order
+ * and are performed at the start of the block containing their frame.
+ * If the directory has a mobius.xml it is used instead of the one
+ * in the installation root.
+ *
+ * The results are traced and written to benchmark-results.txt.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class Benchmark
+{
+  public:
+
+    Benchmark();
+    ~Benchmark();
+
+    /**
+     * Run the benchmark in a directory.
+     * Returns false if it couldn't be run, or if there were more
+     * deadline misses than the maxMisses setting allows.
+     */
+    bool run(juce::File root, juce::File dir);
+
+  private:
+
+    bool parse(juce::File file);
+    bool parseAction(juce::StringArray& tokens);
+    class MobiusConfig* readConfig(juce::File root, juce::File dir);
+    void report(juce::File dir);
+    void add(juce::String line);
+
+    // settings
+    int sampleRate = 44100;
+    int blockSize = 256;
+    double seconds = 10.0;
+    int workers = 0;
+    int maxMisses = -1;
+    juce::String inputFile;
+    juce::String outputFile;
+
+    // the timeline
+    juce::OwnedArray<class UIAction> actions;
+    juce::Array<juce::int64> actionFrames;
+
+    // results
+    juce::Array<double> blockTimes;
+    double* trackTimes = nullptr;
+    int trackCount = 0;
+    double elapsed = 0.0;
+    int misses = 0;
+    int allocations = 0;
+    int poolAllocations = 0;
+    int poolExhausted = 0;
+    juce::String results;
+
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
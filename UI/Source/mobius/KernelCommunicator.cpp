@@ -14,9 +14,66 @@
 
 #include "../util/Trace.h"
 #include "../model/MobiusConfig.h"
+#include "../model/UIAction.h"
 
 #include "KernelCommunicator.h"
 
+//////////////////////////////////////////////////////////////////////
+//
+// KernelMessageRing
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Add a message to the end of the ring.
+ * Only called by the producer thread.
+ */
+bool KernelMessageRing::push(KernelMessage* msg)
+{
+    bool pushed = false;
+    unsigned int t = tail.load(std::memory_order_relaxed);
+    unsigned int h = head.load(std::memory_order_acquire);
+    int queued = (int)(t - h);
+
+    if (queued < KernelMessageSlabSize) {
+        messages[t & (KernelMessageSlabSize - 1)] = msg;
+        tail.store(t + 1, std::memory_order_release);
+        queued++;
+        if (queued > highWater)
+          highWater = queued;
+        pushed = true;
+    }
+    return pushed;
+}
+
+/**
+ * Remove the message at the front of the ring.
+ * Only called by the consumer thread.
+ */
+KernelMessage* KernelMessageRing::pop()
+{
+    KernelMessage* msg = nullptr;
+    unsigned int h = head.load(std::memory_order_relaxed);
+    unsigned int t = tail.load(std::memory_order_acquire);
+
+    if (h != t) {
+        msg = messages[h & (KernelMessageSlabSize - 1)];
+        head.store(h + 1, std::memory_order_release);
+    }
+    return msg;
+}
+
+/**
+ * The number of messages in the ring.  Only exact when called by one
+ * of the two threads, anyone else gets an approximation.
+ */
+int KernelMessageRing::size()
+{
+    unsigned int t = tail.load(std::memory_order_acquire);
+    unsigned int h = head.load(std::memory_order_acquire);
+    return (int)(t - h);
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // KernelCommunicator
@@ -27,11 +84,26 @@
  * There will only ever be one of these and we need it right away
  * so go ahead and build it out now.  We are in the shell context
  * usualy during static construction of MobiusShell.
+ *
+ * This is the only place messages are allocated.
  */
 KernelCommunicator::KernelCommunicator()
 {
-    // initialize default pool
+    slab = new KernelMessage[KernelMessageSlabSize];
+    for (int i = 0 ; i < KernelMessageSlabSize ; i++)
+      shellFree(&(slab[i]));
+
+    // give the kernel its initial reserve
     checkCapacity();
+
+    // the actions are allocated now so the MIDI thread never has to
+    triggerSlab = new KernelMessage[KernelTriggerSlabSize];
+    for (int i = 0 ; i < KernelTriggerSlabSize ; i++) {
+        KernelMessage* msg = &(triggerSlab[i]);
+        msg->type = MsgAction;
+        msg->object.action = new UIAction();
+        triggerPool.push(msg);
+    }
 }
 
 KernelCommunicator::~KernelCommunicator()
@@ -39,108 +111,127 @@ KernelCommunicator::~KernelCommunicator()
     // full stats when debugging, could simplify to
     // just tracing anomolies when things stabalize
     traceStatistics();
-    
-    deleteList(pool);
-    deleteList(toShell);
-    deleteList(toKernel);
+
+    delete[] slab;
+
+    for (int i = 0 ; i < KernelTriggerSlabSize ; i++)
+      delete triggerSlab[i].object.action;
+    delete[] triggerSlab;
+}
+
+/**
+ * Return a message to the shell pool.
+ * Must be called within the csect.
+ */
+void KernelCommunicator::shellFree(KernelMessage* msg)
+{
+    // keep pooled message clean for the next use, could also
+    // do this in alloc but it prevents debugger confusion if it
+    // is clean while in the pool
+    msg->init();
+
+    msg->next = shellPool;
+    shellPool = msg;
+    shellPoolSize++;
 }
 
 /**
- * Reclaim memory for a message list to avoid exit warnings.
+ * Move messages the kernel abandoned back to the shell pool.
+ * Must be called within the csect.
  */
-void KernelCommunicator::deleteList(KernelMessage* list)
+void KernelCommunicator::reclaim()
 {
-	KernelMessage* next = nullptr;
-    while (list != nullptr) {
-        next = list->next;
-        list->next = nullptr;
-        delete list;
-        list = next;
+    KernelMessage* msg = returns.pop();
+    while (msg != nullptr) {
+        shellFree(msg);
+        msg = returns.pop();
     }
 }
 
 /**
- * Ensure that the pool has a confortable number of messages
- * available for use.
- *
- * Emit trace messages if we have to grow it.
+ * Called periodically by the shell to reclaim messages the kernel
+ * has abandoned and to make sure the kernel has enough free messages
+ * for whatever it might want to send before we get here again.
  *
- * This could also be a place to detect if one of the sides is stuck
- * though there might be better places to do that, and there are bigger
- * problems if it happens.
+ * This no longer allocates, the slab is all we get.  If the shell pool
+ * gets low it is most likely a leak, so trace the counters.
  *
- * Access to the counters could be unstable in two cases:
- *   - shell is receiving maintenance timer thread events at the samme
- *     time as it is receiving UI thread requests
- *   - kernel is pushing messages at the same time as we're checking
- *
- * Could wrap a csect around all this but those cases are rare
- * and don't result in any danger except some momentary traced size
- * anomolies.  I suppose we might trigger growth a little too soon but
- * if we're that close we're probably going to grow anyway.
+ * The counters owned by the kernel can change while we're looking
+ * at them so the leak check may be off by a message or two in
+ * transit.  That's fine for diagnostics.
  */
 void KernelCommunicator::checkCapacity()
 {
-    if (totalCreated == 0) {
-        // we're initialzing
-        for (int i = 0 ; i < KernelPoolInitialSize ; i++) {
-            KernelMessage* msg = new KernelMessage();
-            free(msg);
+    juce::ScopedLock lock (criticalSection);
+
+    reclaim();
+
+    while (kernelPool.size() < KernelPoolReserve && shellPool != nullptr) {
+        KernelMessage* msg = shellPool;
+        shellPool = msg->next;
+        msg->next = nullptr;
+        shellPoolSize--;
+        if (!kernelPool.push(msg)) {
+            // can't happen unless something was pushed twice
+            Trace(1, "KernelCommunicator: kernel pool overflow!\n");
+            shellFree(msg);
+            break;
         }
-        minPool = KernelPoolInitialSize;
-        totalCreated = KernelPoolInitialSize;
     }
-    else if (poolSize < KernelPoolSizeConcern) {
-        Trace(2, "KernelCommunicator: pool extension by %d\n", KernelPoolReliefSize);
-        Trace(2, "  poolSize %d toKernel %d toShell %d\n",
-              poolSize, shellSize, kernelSize);
-
-        // technically should have a csect around this
-        int available = poolSize + shellSize + shellUsing + kernelSize + kernelUsing;
-        if (available != totalCreated) {
-            Trace(1, "KernelCommunicator: leak!  %d Created with %d available\n",
-                  totalCreated, available);
-        }
 
-        for (int i = 0 ; i < KernelPoolReliefSize ; i++) {
-            KernelMessage* msg = new KernelMessage();
-            free(msg);
+    if (shellPoolSize < minPool)
+      minPool = shellPoolSize;
+
+    if (shellPoolSize < KernelPoolSizeConcern) {
+        int available = shellPoolSize + shellUsing + kernelPool.size() + returns.size() +
+            toShell.size() + toKernel.size() + kernelUsing;
+
+        Trace(2, "KernelCommunicator: pool is low %d\n", shellPoolSize);
+        Trace(2, "  kernelPool %d toKernel %d toShell %d\n",
+              kernelPool.size(), toKernel.size(), toShell.size());
+
+        if (available != KernelMessageSlabSize) {
+            Trace(1, "KernelCommunicator: possible leak!  %d messages with %d accounted for\n",
+                  KernelMessageSlabSize, available);
         }
-        poolExtensions++;
-        totalCreated += KernelPoolReliefSize;
     }
 }
 
 /**
  * Trace interesting statistics about the pool
- * Not bothering with a csect on this one but it's easy enough.
  * Depending on the trace interval it's going to hard to catch this
- * in action, but the maximums are interesting.
+ * in action, but the maximums and drops are interesting.
  */
 void KernelCommunicator::traceStatistics()
 {
     Trace(2, "KernelCommunicator: statistics\n");
-    Trace(2, "  Created %d available %d\n", totalCreated);
-
-    int available = poolSize + shellSize + kernelSize;
-    if (totalCreated > available)
-      Trace(2, "  Leaked %d\n", totalCreated - available);
+    Trace(2, "  Messages %d shell pool %d kernel pool %d\n",
+          KernelMessageSlabSize, shellPoolSize, kernelPool.size());
 
     Trace(2, "  min pool %d\n", minPool);
-    Trace(2, "  max shell %d\n", maxShell);
-    Trace(2, "  max kernel %d\n", maxKernel);
+    Trace(2, "  max shell %d\n", toShell.getHighWater());
+    Trace(2, "  max kernel %d\n", toKernel.getHighWater());
+    Trace(2, "  max kernel returns %d\n", returns.getHighWater());
 
-    if (shellSize > 0) {
-        Trace(2, "  shell in use %d\n", shellSize);
+    if (shellDrops > 0 || kernelDrops > 0)
+      Trace(1, "  Dropped messages: shell %d kernel %d\n",
+            shellDrops, (int)kernelDrops);
+
+    if (shellUsing > 0) {
+        Trace(2, "  shell in use %d\n", shellUsing);
     }
 
-    if (kernelSize > 0) {
-        Trace(2, "  kernel in use %d\n", kernelSize);
+    if (kernelUsing > 0) {
+        Trace(2, "  kernel in use %d\n", (int)kernelUsing);
     }
 
     Trace(2, "Total shell sends %d\n", totalShellSends);
-    Trace(2, "Total kernel sends %d\n", totalKernelSends);
-    
+    Trace(2, "Total kernel sends %d\n", (int)totalKernelSends);
+    Trace(2, "Total triggers %d max %d\n", (int)totalTriggers, triggers.getHighWater());
+
+    if (triggerDrops > 0)
+      Trace(2, "  Triggers sent through the shell %d\n", (int)triggerDrops);
+
 }
 
 /**
@@ -158,189 +249,214 @@ void KernelMessage::init()
     object.pointer = nullptr;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Shell Message Processing
+//////////////////////////////////////////////////////////////////////
+
 /**
- * Return a message from the pool.
+ * Allocate a message for the shell.
  * Returns nullptr if the pool is exhausted.
- * This is private, shell/kernel must call one of their usage tracking xxxAlloc methods
- * 
  */
-KernelMessage* KernelCommunicator::alloc()
+KernelMessage* KernelCommunicator::shellAlloc()
 {
     juce::ScopedLock lock (criticalSection);
-    KernelMessage* msg = nullptr;
 
-    if (pool == nullptr) {
+    if (shellPool == nullptr)
+      reclaim();
+
+    KernelMessage* msg = shellPool;
+    if (msg == nullptr) {
         Trace(1, "KernelCommunicator: pool has no fucks left to give\n");
+        shellDrops++;
     }
     else {
-        msg = pool;
-        pool = msg->next;
+        shellPool = msg->next;
         msg->next = nullptr;
-        poolSize--;
-        if (poolSize < minPool)
-          minPool = poolSize;
+        shellPoolSize--;
+        if (shellPoolSize < minPool)
+          minPool = shellPoolSize;
+        shellUsing++;
     }
     return msg;
 }
 
 /**
- * Return a message to the pool.
- * This is private, shell/kernel must call one of their usage tracking
- * xxxAbandon or xxxSend methods
+ * Return a message from the shell's queue
  */
-void KernelCommunicator::free(KernelMessage* msg)
+KernelMessage* KernelCommunicator::shellReceive()
 {
-    if (msg->next != nullptr) {
-        Trace(1, "KernelCommunicator: attempt to free message that thinks it is on a list!\n");
-    }
-
-    // keep pooled message clean for the next use, could also
-    // do this in alloc but it prevents debugger confusion if it
-    // is clean while in the pool
-    msg->init();
-
     juce::ScopedLock lock (criticalSection);
-    {
-        msg->next = pool;
-        pool = msg;
-        poolSize++;
-    }
-}
-
-//////////////////////////////////////////////////////////////////////
-// Shell Message Processing
-//////////////////////////////////////////////////////////////////////
 
-/**
- * Allocate a message for the shell.
- */
-KernelMessage* KernelCommunicator::shellAlloc()
-{
-    KernelMessage* msg = alloc();
-    // probably should csect on this if we can have multiple shell-level threads
-    shellUsing++;
+    KernelMessage* msg = toShell.pop();
+    if (msg != nullptr)
+      shellUsing++;
     return msg;
 }
 
 /**
- * Return a message from the shell's list
- * Note that the way this is implemented it's a LIFO rather than FIFO
- * which really shouldn't matter.  If we find a case that does,
- * handle that during insertion.
+ * Shell decided not to use this, after all the work we did for it.
  */
-KernelMessage* KernelCommunicator::shellReceive()
+void KernelCommunicator::shellAbandon(KernelMessage* msg)
 {
     juce::ScopedLock lock (criticalSection);
 
-    KernelMessage* msg = toShell;
-    if (msg != nullptr) {
-        toShell = msg->next;
-        msg->next = nullptr;
-        shellSize--;
-        shellUsing++;
+    if (msg->next != nullptr) {
+        Trace(1, "KernelCommunicator: attempt to free message that thinks it is on a list!\n");
     }
-    return msg;
-}
 
-/**
- * Shell decided not to use this, after all the work we did for it.
- */
-void KernelCommunicator::shellAbandon(KernelMessage* msg)
-{
-    free(msg);
+    shellFree(msg);
     shellUsing--;
 }
 
 /**
- * Add a message to the kernel's list
+ * Add a message to the kernel's queue
  */
 void KernelCommunicator::shellSend(KernelMessage* msg)
 {
     juce::ScopedLock lock (criticalSection);
 
     // since we must be in the shell, check capacity every time
-    // to extend the pool if necessary, seeing exhaustion when
+    // to keep the kernel pool full, seeing exhaustion when
     // twisting control knobs rapidly and a lot of UIAction events come
     // in during the 1/10 second maintenance interval
-    // could be smarter about merging unprocessed actions, but the Kernel keeps
-    // up pretty well as it is on audio interrupttiming, the shell waits longer
     checkCapacity();
-    
+
     if (msg->next != nullptr) {
         Trace(1, "KernelCommunicator: attempt to push message that thinks it is on a list!\n");
     }
 
-    msg->next = toKernel;
-    toKernel = msg;
-    kernelSize++;
-    if (kernelSize > maxKernel)
-      maxKernel = kernelSize;
+    if (!toKernel.push(msg)) {
+        // the ring is as large as the slab so this means
+        // the message was sent twice
+        Trace(1, "KernelCommunicator: kernel queue overflow!\n");
+        shellDrops++;
+    }
     shellUsing--;
     totalShellSends++;
 }
 
 //////////////////////////////////////////////////////////////////////
 // Kernel Message Processing
+//
+// These are called in the audio thread and must not block.
 //////////////////////////////////////////////////////////////////////
 
 /**
  * Allocate a message for the kernel.
+ * Returns nullptr if the shell hasn't kept up.
  */
 KernelMessage* KernelCommunicator::kernelAlloc()
 {
-    KernelMessage* msg = alloc();
-    // probably should csect on this if we can have multiple shell-level threads
-    kernelUsing++;
+    KernelMessage* msg = kernelPool.pop();
+    if (msg == nullptr) {
+        Trace(1, "KernelCommunicator: kernel pool exhausted\n");
+        kernelDrops++;
+    }
+    else {
+        kernelUsing++;
+    }
     return msg;
 }
 
 /**
- * Return a message from the kernel's list
+ * Return a message from the kernel's queue
  */
 KernelMessage* KernelCommunicator::kernelReceive()
 {
-    juce::ScopedLock lock (criticalSection);
-
-    KernelMessage* msg = toKernel;
-    if (msg != nullptr) {
-        toKernel = msg->next;
-        msg->next = nullptr;
-        kernelSize--;
-        kernelUsing++;
-    }
+    KernelMessage* msg = toKernel.pop();
+    if (msg != nullptr)
+      kernelUsing++;
     return msg;
 }
 
 /**
- * Shell decided not to use this, after all the work we did for it.
+ * Kernel decided not to use this, after all the work we did for it.
+ * We can't touch the shell pool so it goes back to the shell
+ * and will be reclaimed on the next alloc or capacity check.
  */
 void KernelCommunicator::kernelAbandon(KernelMessage* msg)
 {
-    free(msg);
+    if (!returns.push(msg)) {
+        Trace(1, "KernelCommunicator: return queue overflow!\n");
+        kernelDrops++;
+    }
     kernelUsing--;
 }
 
 /**
- * Add a message to the shell's list
- * See comments in popShell for potential issues with ordering.
+ * Add a message to the shell's queue
  */
 void KernelCommunicator::kernelSend(KernelMessage* msg)
 {
-    juce::ScopedLock lock (criticalSection);
-
-    if (msg->next != nullptr) {
-        Trace(1, "KernelCommunicator: attempt to push message that thinks it is on a list!\n");
+    if (!toShell.push(msg)) {
+        Trace(1, "KernelCommunicator: shell queue overflow!\n");
+        kernelDrops++;
     }
-
-    msg->next = toShell;
-    toShell = msg;
-    shellSize++;
-    if (shellSize > maxShell)
-      maxShell = shellSize;
     kernelUsing--;
     totalKernelSends++;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Trigger Lane
+//
+// The MIDI thread allocates and sends, the kernel receives and returns.
+// Neither side ever touches the shell CriticalSection.
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Allocate a trigger message for the MIDI thread.
+ * Returns nullptr if the kernel hasn't given enough back, the caller
+ * should then send the action through the shell as usual.
+ * The UIAction in the message is left as it was, the caller
+ * is expected to copy over it.
+ */
+KernelMessage* KernelCommunicator::triggerAlloc()
+{
+    juce::SpinLock::ScopedLockType lock (triggerLock);
+
+    KernelMessage* msg = triggerPool.pop();
+    if (msg == nullptr)
+      triggerDrops++;
+    return msg;
+}
+
+/**
+ * Send a trigger to the kernel.
+ */
+void KernelCommunicator::triggerSend(KernelMessage* msg)
+{
+    juce::SpinLock::ScopedLockType lock (triggerLock);
+
+    // both rings are larger than the trigger slab so this can't fail
+    // unless a message was sent twice
+    if (!triggers.push(msg))
+      triggerDrops++;
+    else
+      totalTriggers++;
+}
+
+/**
+ * Return the next trigger sent by the MIDI thread.
+ */
+KernelMessage* KernelCommunicator::triggerReceive()
+{
+    return triggers.pop();
+}
+
+/**
+ * Give a trigger back to the MIDI thread when the kernel is done with it.
+ */
+void KernelCommunicator::triggerReturn(KernelMessage* msg)
+{
+    if (!triggerPool.push(msg))
+      Trace(1, "KernelCommunicator: trigger pool overflow!\n");
+}
+
+bool KernelCommunicator::isTrigger(KernelMessage* msg)
+{
+    return (msg >= triggerSlab && msg < triggerSlab + KernelTriggerSlabSize);
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -10,14 +10,26 @@
  * Would be nice to work out some more elegant polymorphism here.
  *
  * KernelCommunicator is a singleton object shared by the shell and kernel
- * and contains several lists of KernelMessages.  These are pooled for
- * reuse and prevent memory management within the kernel.  Everying
- * is guarded with CriticalSections.
+ * and contains several queues of KernelMessages.  These are allocated
+ * once in a fixed slab and reused to prevent memory management within
+ * the kernel.
+ *
+ * The queues between the shell and the kernel are bounded single producer,
+ * single consumer rings so the kernel never waits on a lock.  The shell
+ * side still uses a CriticalSection since it may be touched by more than
+ * one thread, but the kernel never takes it, so a UI thread holding it
+ * can't cause an audio dropout.
+ *
+ * Actions triggered from the MIDI input thread have their own lane
+ * with a small slab of messages that each own a preallocated UIAction.
+ * They go directly from the MIDI thread to the kernel and back without
+ * passing through the shell.
  *
  */
 
 #pragma once
 
+#include <atomic>
 #include <JuceHeader.h>
 
 //////////////////////////////////////////////////////////////////////
@@ -36,6 +48,12 @@
  *
  * Event messages are sent from kernel to shell to do something
  * that can't be done in the kernel like file access or user interaction.
+ *
+ * Snapshot messages return LayerSnapshots to the kernel after
+ * the shell has finished saving them.
+ *
+ * Project messages pass a Project down to be loaded, the kernel
+ * sends it back to be deleted.
  * 
  */
 typedef enum {
@@ -49,7 +67,9 @@ typedef enum {
     MsgAction,
     MsgSamples,
     MsgScripts,
-    MsgEvent
+    MsgEvent,
+    MsgSnapshot,
+    MsgProject
 
 } MessageType;
 
@@ -66,20 +86,21 @@ typedef union {
     class SampleManager* samples;
     class Scriptarian* scripts;
     class KernelEvent* event;
+    class LayerSnapshot* snapshot;
+    class Project* project;
     
 } MessageObject;
 
 /**
  * A message object that can be passed up or down.
- * Messages may be maintined on one of several linked lists.
- * avoiding vectors right now to reduce memory allocation headaches
- * and a good old fashioned list works well enough and is encapsulated.
+ * Messages live in a fixed slab owned by the communicator and
+ * are passed around by pointer, they are never allocated individually.
  */
 class KernelMessage
 {
   public:
 
-    // message list chain, nullptr if not on a list
+    // free list chain, nullptr if not on the shell's free list
     KernelMessage* next = nullptr;
 
     // what it is
@@ -93,31 +114,78 @@ class KernelMessage
     void init();
 };
 
+/**
+ * The maximum number of messages.  These are all allocated when
+ * the communicator is constructed and never grow.
+ * This must be a power of two since the rings use it for their capacity.
+ */
+const int KernelMessageSlabSize = 256;
+
+/**
+ * A bounded queue of messages with one producer thread and one
+ * consumer thread.  Push and pop never block or loop.
+ *
+ * The capacity is the same as the number of messages in the slab
+ * so a push can only fail if a message is pushed twice.
+ */
+class KernelMessageRing
+{
+  public:
+
+    bool push(KernelMessage* msg);
+    KernelMessage* pop();
+    int size();
+
+    // the largest number of messages that were ever queued
+    int getHighWater() {
+        return highWater;
+    }
+
+  private:
+
+    KernelMessage* messages[KernelMessageSlabSize] = {};
+
+    // head is advanced only by the consumer, tail only by the producer
+    // these wrap, the difference is always the number of messages
+    std::atomic<unsigned int> head {0};
+    std::atomic<unsigned int> tail {0};
+
+    // only touched by the producer
+    int highWater = 0;
+};
+
 /**
  * The singleton object used for communciation between the shell and the kernel.
- * Maintains the following message lists.
+ * Maintains the following message queues.
+ *
+ *    shellPool     free messages available to the shell
+ *    kernelPool    free messages the shell has set aside for the kernel
+ *    returns       messages the kernel is done with, going back to the shell
+ *    toKernel      messages sent from the shell to the kernel
+ *    toShell       messages sent from the kernel to the shell
  *
- *    pool          a pool of free messages
- *    toKernel      a list of message sent from the shell to the kernel
- *    toShell       list of message sent from the kernel to the shell
+ * Everything other than shellPool is a KernelMessageRing with the
+ * shell on one end and the kernel on the other.  shellPool is an ordinary
+ * linked list guarded by the shell CriticalSection.
  *
  * The kernel consumes it's event list at the start of every audio interrupt.
  * The shell consumes it's event list during performMaintenance which is normally
  * called by a timer thread with 1/10 a second interval.
  *
- * During consumption, the receiver will call either popShell() or popKernel()
- * to obtain the next message in the queue.  After processing it should return
- * this to the pool with free().
+ * During consumption, the receiver will call either shellReceive() or
+ * kernelReceive() to obtain the next message in the queue.  After processing
+ * it should either send it back or return it with the abandon method.
+ * Messages are received in the order they were sent.
  *
  * During interval processing a message to be sent is allocated with alloc(),
- * filled out with content, then added to one of the lists with either pushShell()
- * or pushKernel()
+ * filled out with content, then sent with either shellSend() or kernelSend().
  *
- * Only the shell is allowed to periocially call checkCapacity() which will
- * make sure that the internal message pool is large enough to handle future
- * message allocations.
+ * Only the shell is allowed to periocially call checkCapacity() which
+ * moves messages the kernel has returned back to the shell pool, and
+ * refills the kernel pool.
  *
- * If alloc() is called and the pool is empty, it will return nullptr.
+ * If alloc() is called and the pool is empty, it will return nullptr
+ * and the message is counted as dropped.
  * In normal use this is almost always an indication of a memory leak.
  * In theory, a period of extremely intense activity could need more messages
  * than we have available but that really shouldn't happen in practice.
@@ -147,7 +215,7 @@ class KernelMessage
  *
  *    shellReceive
  *      shell retrieves a message sent by the kernel, increment shellUsing
- *      this must be followed by shellAbandon or pushKernel
+ *      this must be followed by shellAbandon or shellSend
  *      usually this would be shellAbandon because there are few if any
  *      cases where the shell wants to reuse a message it just popped to
  *      send back to the kernel
@@ -186,46 +254,69 @@ class KernelCommunicator
     // only for shell maintenance
     void checkCapacity();
     void traceStatistics();
-    
-  private:
 
-    KernelMessage* alloc();
-    void free(KernelMessage* msg);
+    // trigger lane, MIDI input thread methods
+    KernelMessage* triggerAlloc();
+    void triggerSend(KernelMessage* msg);
 
-    void pushKernel(KernelMessage* msg);
-    KernelMessage* popKernel();
+    // trigger lane, kernel methods
+    KernelMessage* triggerReceive();
+    void triggerReturn(KernelMessage* msg);
 
-    void pushShell(KernelMessage* msg);
-    KernelMessage* popShell();
+    /**
+     * True if this is one of the trigger messages.  These must not be
+     * abandoned or sent to the shell, they go back with triggerReturn.
+     */
+    bool isTrigger(KernelMessage* msg);
     
-    juce::CriticalSection criticalSection;
+  private:
 
-    // the total number of message allocations created with new
-    // normally also maxPool
-    int totalCreated = 0;
+    // guards shellPool and the shell ends of the rings
+    // the kernel must never use this
+    juce::CriticalSection criticalSection;
 
-    // shared free pool
-    KernelMessage* pool = nullptr;
-    int poolSize = 0;
+    // every message there will ever be
+    KernelMessage* slab = nullptr;
 
-    // shell message queue
-    KernelMessage* toShell = nullptr;
-    int shellSize = 0;
+    // shell free list
+    KernelMessage* shellPool = nullptr;
+    int shellPoolSize = 0;
     int shellUsing = 0;
+
+    // kernel free messages, filled by the shell
+    KernelMessageRing kernelPool;
+    std::atomic<int> kernelUsing {0};
+
+    // messages abandoned by the kernel
+    KernelMessageRing returns;
     
-    // kernel queue
-    KernelMessage* toKernel = nullptr;
-    int kernelSize = 0;
-    int kernelUsing = 0;
+    KernelMessageRing toShell;
+    KernelMessageRing toKernel;
+
+    // trigger messages with their UIActions
+    KernelMessage* triggerSlab = nullptr;
+
+    // free triggers returned by the kernel
+    KernelMessageRing triggerPool;
+
+    // triggers sent to the kernel
+    KernelMessageRing triggers;
+
+    // there may be more than one MIDI device thread, this keeps them
+    // to one producer at a time, the kernel never uses it
+    juce::SpinLock triggerLock;
+
+    void shellFree(KernelMessage* msg);
+    void reclaim();
     
-    int minPool = 0;
-    int maxShell = 0;
-    int maxKernel = 0;
-    int poolExtensions = 0;
+    // statistics
+    int minPool = KernelMessageSlabSize;
+    int shellDrops = 0;
+    std::atomic<int> kernelDrops {0};
     int totalShellSends = 0;
-    int totalKernelSends = 0;
-    
-    void deleteList(KernelMessage* list);
+    std::atomic<int> totalKernelSends {0};
+    std::atomic<int> triggerDrops {0};
+    std::atomic<int> totalTriggers {0};
         
 };
 
@@ -234,30 +325,25 @@ class KernelCommunicator
 //
 
 /**
- * The inital size of the pool.
- * This should ideally be set high enough to avoid additional
- * allocations during normal use.
- */
-const int KernelPoolInitialSize = 20;
-
-/**
- * The threshold for new allocations.
- * If the free pool dips below this size, another block
- * is allocated.
+ * The number of free messages the shell tries to keep in the
+ * kernel pool.  This needs to cover everything the kernel might
+ * allocate between two maintenance cycles.
  */
-const int KernelPoolSizeConcern = 5;
+const int KernelPoolReserve = 32;
 
 /**
- * The number of messages to allocate when the
- * SizeConern threshold is reached.
+ * The threshold for shell pool warnings.
+ * If the shell pool dips below this size something is probably
+ * leaking messages.
  */
-const int KernelPoolReliefSize = 10;
+const int KernelPoolSizeConcern = 16;
 
 /**
- * The number of messages on the shell or kernel queue above which
- * we start to question our life choices.
+ * The number of trigger messages.  This is how many triggers can
+ * arrive within one audio block before they start being sent through
+ * the shell instead.  Must not be larger than KernelMessageSlabSize.
  */
-const int KernelPoolUseConcern = 3;
+const int KernelTriggerSlabSize = 64;
 
 /****************************************************************************/
 /****************************************************************************/
@@ -28,6 +28,8 @@ void KernelEvent::init()
     type = EventNone;
     returnCode = 0;
     project = nullptr;
+    snapshot = nullptr;
+    capture = nullptr;
     strcpy(arg1, "");
     strcpy(arg2, "");
     strcpy(arg3, "");
@@ -107,10 +107,20 @@ class KernelEvent
     // this was the only event that could return something
     int returnCode;
 
-    // EventSaveProject used to pass entire Projects around
-    // not sure I like this
+    // EventSaveProject passes the Project captured by the Save statement
+    // like snapshot, if it is still here when the event comes back
+    // the kernel deletes it
     class Project* project;
 
+    // EventSaveLoop passes a copy of the play layer made in the kernel
+    // the handler may take it, if it is still here when the event
+    // comes back the kernel deletes it
+    class LayerSnapshot* snapshot;
+
+    // EventSaveCapture passes a copy of the capture made in the kernel
+    // which shares blocks with it, same ownership as snapshot
+    class Audio* capture;
+
     // set an argument with the usual bounds checking
     // returns true if the value fit, calls are encouraged to bail if it doesn't
     // this was used a lot to pass file paths but we really shouldn't be doing
@@ -16,12 +16,17 @@
 
 #include "Audio.h"
 #include "AudioFile.h"
+#include "AudioPool.h"
+#include "AudioWriter.h"
+#include "ProjectFile.h"
 
 #include "KernelEvent.h"
 #include "MobiusShell.h"
 #include "UnitTests.h"
 
 #include "core/Mobius.h"
+#include "core/Layer.h"
+#include "core/Project.h"
 
 #include "KernelEventHandler.h"
 
@@ -85,28 +90,25 @@ void KernelEventHandler::doEvent(KernelEvent* e)
 
 /**
  * This is where we end up at the end of the SaveCapture function.
- * The event contains the file name the script wants to save it in
- * but not the actual Audio to save.  For that we have to
- * call back to Mobius.
- *
- * Not sure I like having to reach down there from the shell.
- * It would be cleaner to pass the Audio back in the KernelEvent?
- *
- * Note that the Audio object is still owned by Mobius and must
- * not be deleted.  Mobius is supposed to not be touching
- * this while we have it.
+ * Mobius stopped the capture before sending the event and made
+ * a copy of it in the kernel which comes up in the event.  The copy
+ * shares blocks with the capture so no sample data is duplicated,
+ * and we never touch the Audio the kernel still owns.
  *
  * When called from a script, the file name is in the event.
  * When called by the user, a file might have been specified
  * as a function argument in the binding/action which
  * should also have been left in the event.
+ *
+ * The copy is taken from the event and written by AudioWriter
+ * which deletes it when it finishes.  Unit tests compare the file
+ * as soon as the function finishes so they still write it here.
  */
 void KernelEventHandler::doSaveCapture(KernelEvent* e)
 {
-    // get the Audio to save
-    MobiusKernel* kernel = shell->getKernel();
-    Mobius* mobius = kernel->getCore();
-    Audio* capture = mobius->getCapture();
+    // take the copy so the kernel doesn't delete it
+    Audio* capture = e->capture;
+    e->capture = nullptr;
 
     juce::File file;
     if (UnitTests::Instance->isEnabled()) {
@@ -115,8 +117,17 @@ void KernelEventHandler::doSaveCapture(KernelEvent* e)
     else {
         file = getSaveFile(e->arg1, "capture", ".wav");
     }
-    
-    AudioFile::write(file, capture);
+
+    if (capture == nullptr) {
+        Trace(1, "KernelEventHandler::doSaveCapture event has no capture");
+    }
+    else if (UnitTests::Instance->isEnabled()) {
+        AudioFile::write(file, capture);
+        delete capture;
+    }
+    else {
+        shell->audioWriter.save(capture, file);
+    }
 }
 
 void KernelEventHandler::doAlert(KernelEvent* e)
@@ -131,9 +142,11 @@ void KernelEventHandler::doAlert(KernelEvent* e)
 /**
  * This is where we end up at the end of the SaveLoop function.
  *
- * Still have the old convention of not passing the loop Audio
- * in the event, but expecting the handler to call back to getPlaybackAudio.
- * See comments over there why this sucks and is dangerous.
+ * This used to call back to Mobius::getPlaybackAudio to flatten the
+ * play layer from here, which was dangerous for the reasons below.
+ * Now the kernel makes a LayerSnapshot before sending the event, which
+ * is close to option 1 below except that the copy shares buffers so
+ * it is cheap.  The old comments are left for history.
  *
  * For any complex state file saves the problem from the UI/shell is that it
  * is unreliable to capture the state of an Audio object while the audio thread
@@ -165,18 +178,17 @@ void KernelEventHandler::doAlert(KernelEvent* e)
  * then added a numeric suffix to make it unique.
  * Not doing uniqueness yet but need to.
  *
- * Note that the Audio returned by getPlaybackAudio becomes owned by the caller
- * and must be freed.  The blocks came from the common AudioPool.
+ * The snapshot must be deleted by the kernel.  Outside of unit tests
+ * it is handed to AudioWriter which flattens and writes it in the
+ * background, then gives it back to the shell to send down.  Unit tests
+ * flatten it here and leave it in the event which the kernel cleans up.
  */
 void KernelEventHandler::doSaveLoop(KernelEvent* e)
 {
-    // get the Audio to save
-    MobiusKernel* kernel = shell->getKernel();
-    Mobius* mobius = kernel->getCore();
-    Audio* loop = mobius->getPlaybackAudio();
+    LayerSnapshot* snapshot = e->snapshot;
 
-    if (loop == nullptr) {
-        Trace(1, "KernelEventHandler::doSaveLoop getPlaybackAudio returned nullptr");
+    if (snapshot == nullptr) {
+        Trace(1, "KernelEventHandler::doSaveLoop no layer snapshot");
     }
     else {
         juce::File file;
@@ -195,18 +207,48 @@ void KernelEventHandler::doSaveLoop(KernelEvent* e)
             file = getSaveFile(e->arg1, quickfile, ".wav");
         }
 
-        AudioFile::write(file, loop);
-
-        // we own this
-        delete loop;
+        if (UnitTests::Instance->isEnabled()) {
+            Audio* loop = snapshot->flatten();
+            AudioFile::write(file, loop);
+            // we own this
+            delete loop;
+        }
+        else {
+            // the writer owns it now
+            e->snapshot = nullptr;
+            shell->audioWriter.save(snapshot, file);
+        }
     }
 }
 
 /**
- * This was also fraught with peril
+ * Here at the end of the script Save statement.
+ *
+ * The kernel captured the tracks in a Project with layer snapshots
+ * that we flatten and write in the binary project format, see ProjectFile.
+ * Like SaveLoop this happens in AudioWriter, except for unit tests
+ * which write it here and leave the project in the event for the
+ * kernel to delete.
  */
 void KernelEventHandler::doSaveProject(KernelEvent* e)
 {
+    Project* project = e->project;
+
+    if (project == nullptr) {
+        Trace(1, "KernelEventHandler::doSaveProject no project");
+    }
+    else {
+        juce::File file = getSaveFile(e->arg1, "project", ProjectFileExtension);
+        
+        if (UnitTests::Instance->isEnabled()) {
+            ProjectFile::write(file, project);
+        }
+        else {
+            // the writer owns it now
+            e->project = nullptr;
+            shell->audioWriter.save(project, file);
+        }
+    }
 }
 
 /**
@@ -220,8 +262,63 @@ void KernelEventHandler::doSaveConfig(KernelEvent* e)
 {
 }
 
+/**
+ * Here for the script Load statement.
+ *
+ * A .wav file replaces the active loop, anything else is read as
+ * a binary project.  Either way a Project is sent down to the kernel.
+ * Projects from files are loaded in two parts, the play layers first
+ * and the rest of the undo layers when ProjectLoader has read them.
+ * Unit tests get it all at once.
+ *
+ * The project is sent before this event is returned to the kernel
+ * so a script waiting on the Load will see the loops when it resumes.
+ */
 void KernelEventHandler::doLoadLoop(KernelEvent* e)
 {
+    const char* name = e->arg1;
+    juce::File file;
+    if (juce::File::isAbsolutePath(name))
+      file = juce::File(name);
+    else
+      file = shell->getContainer()->getRoot().getChildFile(name);
+
+    if (file.getFileExtension().length() == 0)
+      file = file.withFileExtension(ProjectFileExtension);
+
+    juce::String error;
+    if (!file.existsAsFile()) {
+        error = "File not found " + file.getFullPathName();
+    }
+    else if (file.hasFileExtension(".wav")) {
+        Audio* audio = AudioFile::read(file, shell->getAudioPool());
+        if (audio == nullptr) {
+            error = "Unable to read " + file.getFileName();
+        }
+        else {
+            // track and loop -1 are the active ones
+            Project* p = new Project(audio, -1, -1);
+            shell->loadProject(p, nullptr);
+        }
+    }
+    else {
+        ProjectLoader* loader = new ProjectLoader(shell->getAudioPool(), file);
+        Project* p = loader->read(!UnitTests::Instance->isEnabled());
+        if (p == nullptr) {
+            error = loader->getError();
+            delete loader;
+        }
+        else {
+            shell->loadProject(p, loader);
+        }
+    }
+
+    if (error.length() > 0) {
+        Trace(1, "KernelEventHandler::doLoadLoop %s\n", error.toUTF8());
+        MobiusListener* l = shell->getListener();
+        if (l != nullptr)
+          l->MobiusAlert("Unable to load: " + error);
+    }
 }
 
 /**
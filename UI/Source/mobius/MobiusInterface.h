@@ -158,6 +158,17 @@ class MobiusInterface {
      */
     virtual void doAction(class UIAction* action) = 0;
 
+    /**
+     * Perform an action directly from the MIDI input thread.
+     * The timestamp is juce::Time::getMillisecondCounterHiRes
+     * when the trigger arrived and is used to place the action
+     * within the next audio block.
+     *
+     * This never blocks or allocates.  Returns false if the action
+     * can't be done this way and the caller must use doAction.
+     */
+    virtual bool doTrigger(class UIAction* action, double timestamp) = 0;
+
     // TODO: need something to check queued UIAction status
 
     /**
@@ -12,14 +12,18 @@
 #include "MobiusShell.h"
 
 #include "Audio.h"
+#include "AudioPool.h"
 #include "SampleManager.h"
 
 // drag this bitch in
 #include "core/Mobius.h"
+#include "core/Layer.h"
+#include "core/Project.h"
 #include "core/Function.h"
 #include "core/Action.h"
 #include "core/Parameter.h"
 #include "core/Mem.h"
+#include "core/BlockProfiler.h"
 
 #include "MobiusKernel.h"
 
@@ -143,6 +147,8 @@ void MobiusKernel::consumeCommunications()
             case MsgScripts: installScripts(msg); break;
             case MsgAction: doAction(msg); break;
             case MsgEvent: doEvent(msg); break;
+            case MsgSnapshot: freeSnapshots(msg); break;
+            case MsgProject: loadProject(msg); break;
         }
         
         msg = communicator->kernelReceive();
@@ -250,6 +256,13 @@ void MobiusKernel::containerAudioAvailable(MobiusContainer* cont)
     // make sure this is clear
     coreActions = nullptr;
 
+    // buffers can't be allocated from here on, this is cleared
+    // at the end in case the thread is used for something else
+    AudioPool::setInterrupt(true);
+
+    BlockProfiler* profiler = mCore->getProfiler();
+    profiler->startBlock();
+
     // sanity check, don't really need to pass this
     if (cont != container) {
         // if this happens, you're going to be getting a lot of
@@ -269,6 +282,9 @@ void MobiusKernel::containerAudioAvailable(MobiusContainer* cont)
     // this level are placed in coreActions
     consumeCommunications();
 
+    // actions sent directly from the MIDI thread go after those
+    UIAction* triggers = consumeTriggers();
+
     // todo: it was around this point that we used to ask the Recorder
     // to echo the input to the output for monitoring
     //    rec->setEcho(mConfig->isMonitorAudio());
@@ -277,8 +293,11 @@ void MobiusKernel::containerAudioAvailable(MobiusContainer* cont)
     // equivalent here
 
     // let SampleManager do it's thing
-    if (samples != nullptr)
-      samples->containerAudioAvailable(cont);
+    if (samples != nullptr) {
+        juce::int64 start = BlockProfiler::now();
+        samples->containerAudioAvailable(cont);
+        profiler->mark(ProfileSamples, start);
+    }
 
     // TODO: We now have UIActions to send to core in poorly defined order
     // this usually does not matter but for for sweep controls like OutputLevel
@@ -295,9 +314,9 @@ void MobiusKernel::containerAudioAvailable(MobiusContainer* cont)
     mCore->containerAudioAvailable(cont, coreActions);
 
     // we now need to return the queued core actions back to the
-    // shell for deletion
+    // shell for deletion, the triggers at the end are ours
     UIAction* next = nullptr;
-    while (coreActions != nullptr) {
+    while (coreActions != nullptr && coreActions != triggers) {
         next = coreActions->next;
         KernelMessage* msg = communicator->kernelAlloc();
         msg->type = MsgAction;
@@ -305,9 +324,12 @@ void MobiusKernel::containerAudioAvailable(MobiusContainer* cont)
         communicator->kernelSend(msg);
         coreActions = next;
     }
+    coreActions = nullptr;
+    returnTriggers();
 
     // end whining
     MemTraceEnabled = false;
+    AudioPool::setInterrupt(false);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -401,6 +423,26 @@ void MobiusKernel::doAction(KernelMessage* msg)
 {
     UIAction* action = msg->object.action;
 
+    bool processed = doKernelAction(action);
+    if (!processed) {
+        // not handled above core, pass it down
+        action->next = coreActions;
+        coreActions = action;
+    }
+    
+    // if we handled it immediately, return it to the shell for deletion
+    if (processed)
+      communicator->kernelSend(msg);
+    else
+      communicator->kernelAbandon(msg);
+}
+
+/**
+ * Perform an action that doesn't need the core.
+ * Returns false if it needs to be passed down.
+ */
+bool MobiusKernel::doKernelAction(UIAction* action)
+{
     // todo: more flexitility in targeting tracks
     // upper tracks vs. core tracks etc.
 
@@ -409,10 +451,12 @@ void MobiusKernel::doAction(KernelMessage* msg)
     // flag up here rather than having it make it's way all the way down
     // to Actionator
 
+    // sample actions never go to core, even the up transitions we ignore
     bool processed = false;
     if (action->type == ActionFunction) {
         FunctionDefinition* f = action->implementation.function;
         if (f == SamplePlay) {
+            processed = true;
             // FunctionDefinition doesn't have a sustainable flag yet so filter up actions
             if (action->down) {
                 if (samples != nullptr) {
@@ -429,17 +473,12 @@ void MobiusKernel::doAction(KernelMessage* msg)
                     // if they didn't set an arg, then just play the first one
                     int index = (number > 0) ? number - 1 : 0;
                     samples->trigger(container, index, action->down);
-                    processed = true;
                 }
             }
         }
-        else {
-            // not handled above core, pass it down
-            action->next = coreActions;
-            coreActions = action;
-        }
     }
     else if (action->type == ActionSample) {
+        processed = true;
         if (action->down) {
             // new way to do this with DynamicAction
             // don't like the duplication, need to decide the best path
@@ -448,21 +487,72 @@ void MobiusKernel::doAction(KernelMessage* msg)
                 // start one of the samples playing
                 // ordinal is properly zero based unlike the Function action above
                 samples->trigger(container, action->implementation.ordinal, action->down);
-                processed = true;
             }
         }
     }
-    else {
-        // Parameter, Activation, Script action
-        action->next = coreActions;
-        coreActions = action;
-    }
     
-    // if we handled it immediately, return it to the shell for deletion
-    if (processed)
-      communicator->kernelSend(msg);
-    else
-      communicator->kernelAbandon(msg);
+    // Parameter, Activation, Script actions always go to core
+    return processed;
+}
+
+/**
+ * Receive the actions sent by the MIDI thread during the last block.
+ * The ones we can do here are returned immediately, the rest
+ * are appended to coreActions in the order they arrived so
+ * their block offsets are applied in order.
+ * Returns the first one passed to core.
+ */
+UIAction* MobiusKernel::consumeTriggers()
+{
+    UIAction* first = nullptr;
+    UIAction* last = nullptr;
+    
+    KernelMessage* msg = communicator->triggerReceive();
+    while (msg != nullptr) {
+        UIAction* action = msg->object.action;
+        action->next = nullptr;
+        if (doKernelAction(action)) {
+            communicator->triggerReturn(msg);
+        }
+        else {
+            if (last == nullptr)
+              first = action;
+            else
+              last->next = action;
+            last = action;
+
+            msg->next = triggerMessages;
+            triggerMessages = msg;
+        }
+        msg = communicator->triggerReceive();
+    }
+
+    if (first != nullptr) {
+        if (coreActions == nullptr) {
+            coreActions = first;
+        }
+        else {
+            UIAction* tail = coreActions;
+            while (tail->next != nullptr)
+              tail = tail->next;
+            tail->next = first;
+        }
+    }
+    return first;
+}
+
+/**
+ * Give the triggers passed to core back to the MIDI thread.
+ */
+void MobiusKernel::returnTriggers()
+{
+    while (triggerMessages != nullptr) {
+        KernelMessage* next = triggerMessages->next;
+        triggerMessages->next = nullptr;
+        triggerMessages->object.action->next = nullptr;
+        communicator->triggerReturn(triggerMessages);
+        triggerMessages = next;
+    }
 }
 
 /**
@@ -583,6 +673,19 @@ void MobiusKernel::doEvent(KernelMessage* msg)
         if (mCore != nullptr) 
           mCore->kernelEventCompleted(e);
 
+        // the handler didn't want the layer snapshot
+        delete e->snapshot;
+        e->snapshot = nullptr;
+
+        // or the project from the Save statement, this
+        // has snapshots too so it has to be deleted here
+        delete e->project;
+        e->project = nullptr;
+
+        // or the capture copy
+        delete e->capture;
+        e->capture = nullptr;
+
         // return to our pool
         eventPool.returnEvent(e);
     }
@@ -591,6 +694,35 @@ void MobiusKernel::doEvent(KernelMessage* msg)
     communicator->kernelAbandon(msg);
 }
 
+/**
+ * Handle a MsgSnapshot sent down from the shell with a list of
+ * LayerSnapshots that have been saved.  These have private layers
+ * from the LayerPool which is only safe to touch from here.
+ */
+void MobiusKernel::freeSnapshots(KernelMessage* msg)
+{
+    // this will delete the chain
+    delete msg->object.snapshot;
+    
+    communicator->kernelAbandon(msg);
+}
+
+/**
+ * Handle a MsgProject sent down from the shell with a Project
+ * to load.  Layers are allocated from the LayerPool so this
+ * has to happen here rather than in the shell.  The Project is sent
+ * back so the shell can delete it along with any Audio we didn't use.
+ */
+void MobiusKernel::loadProject(KernelMessage* msg)
+{
+    Project* p = msg->object.project;
+    
+    if (mCore != nullptr && p != nullptr)
+      mCore->loadProject(p);
+
+    communicator->kernelSend(msg);
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
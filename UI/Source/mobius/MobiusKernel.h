@@ -144,12 +144,20 @@ class MobiusKernel : public MobiusContainer::AudioListener
     class Mobius* mCore = nullptr;
     class UIAction* coreActions = nullptr;
 
+    // trigger messages whose actions were passed to core
+    class KernelMessage* triggerMessages = nullptr;
+
     // KernelMessage handling
     void reconfigure(class KernelMessage*);
     void installSamples(class KernelMessage* msg);
     void installScripts(class KernelMessage* msg);
     void doAction(KernelMessage* msg);
+    bool doKernelAction(class UIAction* action);
+    class UIAction* consumeTriggers();
+    void returnTriggers();
     void doEvent(KernelMessage* msg);
+    void freeSnapshots(KernelMessage* msg);
+    void loadProject(KernelMessage* msg);
     
     void clearExternalInput();
 };
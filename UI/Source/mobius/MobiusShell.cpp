@@ -50,7 +50,6 @@
 #include "../model/Setup.h"
 #include "../model/Preset.h"
 #include "../model/UIAction.h"
-#include "../model/XmlRenderer.h"
 #include "../model/UIEventType.h"
 #include "../model/DynamicConfig.h"
 #include "../model/ScriptConfig.h"
@@ -59,6 +58,8 @@
 #include "core/Mobius.h"
 #include "core/Scriptarian.h"
 #include "core/Script.h"
+#include "core/Layer.h"
+#include "core/Project.h"
 
 #include "MobiusContainer.h"
 #include "MobiusKernel.h"
@@ -176,15 +177,22 @@ void MobiusShell::configure(MobiusConfig* config)
 {
     bool firstTime =  (configuration == nullptr);
     
-    // clone it so we can make internal modifications
+    // clone one copy for the kernel
+    MobiusConfig* kernelCopy = config->clone();
+
+    // compare with the previous one so the kernel only
+    // propagates what changed to the tracks
+    if (!firstTime)
+      kernelCopy->diff(configuration);
+
+    // and another so we can make internal modifications
     // since we can be called after config editing, delete the existing one
-    // give this class a proper clone() method so we don't have to use XML
     delete configuration;
-    XmlRenderer xr;
-    configuration = xr.clone(config);
+    configuration = config->clone();
 
-    // clone it again and give it to the kernel
-    MobiusConfig* kernelCopy = xr.clone(config);
+    // this only changes how far the pool will grow
+    audioPool.setMaxMemory(configuration->getMaxLoopMemory());
+    
     if (firstTime) {
 
         // start tracking internal runtime changes that the UI
@@ -203,6 +211,10 @@ void MobiusShell::configure(MobiusConfig* config)
         // push it all down once in initialize() or have it pull
         // it one at a time inside initialize, can do some things
         // in the constructor, but not all like audioPool and config
+
+        // fill the pool so the kernel never has to allocate
+        audioPool.init();
+        
         kernel.initialize(container, kernelCopy);
 
     }
@@ -270,6 +282,37 @@ void MobiusShell::doAction(UIAction* action)
     }
 }
 
+/**
+ * Send a function or parameter action directly to the kernel from
+ * the MIDI thread.  The action is copied into one of the communicator's
+ * trigger messages so nothing is allocated.  Anything the shell would
+ * handle itself goes through doAction.
+ */
+bool MobiusShell::doTrigger(UIAction* action, double timestamp)
+{
+    bool direct = false;
+    if (!doSimulation && action->implementation.object != nullptr) {
+        if (action->type == ActionFunction)
+          direct = (action->implementation.function != UnitTestMode);
+        else if (action->type == ActionParameter)
+          direct = true;
+    }
+    
+    bool sent = false;
+    if (direct) {
+        KernelMessage* msg = communicator.triggerAlloc();
+        if (msg != nullptr) {
+            UIAction* copy = msg->object.action;
+            copy->copy(action);
+            copy->next = nullptr;
+            copy->timestamp = timestamp;
+            communicator.triggerSend(msg);
+            sent = true;
+        }
+    }
+    return sent;
+}
+
 /**
  * Pass the UIAction to the kernel through KernelCommunicator.
  *
@@ -654,15 +697,14 @@ void MobiusShell::installDynamicConfig(SampleManager* manager)
  * to the UI.  It is intended to be called periodically from the
  * Maintenance Thread, though it is safe to call from the UI thread.
  *
- * The object is owned by the shell and must not be deleted or modified.
- * It will live as long as the MobiusInterface/MobiusShell does so the
- * UI is allowed to retain a pointer to it.  Not sure I like this,
- * we could require that this be called every time and may return
- * different objects, but a handful of componenents now expect to retain
- * pointers into the middle of this.
+ * The object is owned by the engine and must not be deleted or modified.
+ * The kernel publishes a new one at the end of every interrupt, and this
+ * returns the most recent.  It may return a different object each time,
+ * and the previous object may be reused by the engine once this is called
+ * again.  Components that retain pointers into the middle of it must
+ * refresh them every time they are given a new state.
  *
- * So while this will return the same object every time, this does serve
- * as the trigger to refresh the state.
+ * Call this only from one thread, normally the maintenance thread.
  *
  * Needs redesign, but this is old and it's all over the core so it will
  * be sensitive.
@@ -689,6 +731,14 @@ MobiusState* MobiusShell::getState()
         // so return the simulation state, just so we don't crash during testing
         state = &simulatorState;
     }
+
+    if (state == &simulatorState) {
+        // the simulator doesn't track changes, so everything is
+        // always different
+        simulatorState.version++;
+        for (int i = 0 ; i < MobiusStateMaxTracks ; i++)
+          simulatorState.tracks[i].version++;
+    }
     
     return state;
 }
@@ -713,7 +763,34 @@ void MobiusShell::performMaintenance()
     // extend the message pool if necessary
     communicator.checkCapacity();
 
-    // todo: all object pool fluffing should be done here now too
+    // return the audio of layers freed by the kernel and refill
+    // the layer reserve, before the AudioPool so the buffers are cleaned now
+    Mobius* core = kernel.getCore();
+    if (core != nullptr)
+      core->getLayerPool()->performMaintenance();
+
+    // clean returned audio buffers and replenish the reserve
+    audioPool.performMaintenance();
+
+    // read the rest of streaming samples that were triggered
+    sampleLibrary.performMaintenance();
+
+    // report background file saves and give back the
+    // layer snapshots they used
+    LayerSnapshot* snapshots = audioWriter.performMaintenance(listener);
+    if (snapshots != nullptr)
+      sendSnapshots(snapshots);
+
+    // send the rest of the last project once the undo layers are read
+    if (projectLoader != nullptr) {
+        Project* history = projectLoader->takeHistory();
+        if (history != nullptr)
+          sendProject(history);
+        if (projectLoader->isFinished())
+          projectLoader.reset();
+    }
+
+    // todo: the other object pools should be fluffed here too
     // need to redesign the old pools to be consistent and allow
     // management from another thread
 }
@@ -737,6 +814,54 @@ AudioPool* MobiusShell::getAudioPool()
     return &audioPool;
 }
 
+/**
+ * Return LayerSnapshots to the kernel after AudioWriter has
+ * written them.  They contain layers that must be returned to
+ * the LayerPool in the audio thread.
+ */
+void MobiusShell::sendSnapshots(LayerSnapshot* list)
+{
+    KernelMessage* msg = communicator.shellAlloc();
+    if (msg != nullptr) {
+        msg->type = MsgSnapshot;
+        msg->object.snapshot = list;
+        communicator.shellSend(msg);
+    }
+    else {
+        // shouldn't happen, better to leak than to free
+        // them in the wrong thread
+        Trace(1, "MobiusShell: Unable to return layer snapshots\n");
+    }
+}
+
+/**
+ * Send a Project down to be loaded.  If it came from a project file
+ * the loader is reading the undo layers and we send those when it's
+ * done.  A loader from an earlier project is stopped, its history
+ * would otherwise end up under the loops that were just replaced.
+ */
+void MobiusShell::loadProject(Project* p, ProjectLoader* loader)
+{
+    projectLoader.reset(loader);
+    sendProject(p);
+}
+
+void MobiusShell::sendProject(Project* p)
+{
+    KernelMessage* msg = communicator.shellAlloc();
+    if (msg != nullptr) {
+        msg->type = MsgProject;
+        msg->object.project = p;
+        communicator.shellSend(msg);
+    }
+    else {
+        // layers aren't allocated until the kernel gets it
+        // so this one is safe to delete
+        Trace(1, "MobiusShell: Unable to send project\n");
+        delete p;
+    }
+}
+
 /**
  * Send the kernel its copy of the MobiusConfig
  * The object is already a copy
@@ -775,6 +900,7 @@ void MobiusShell::consumeCommunications()
                 
             case MsgSamples: {
                 // kernel is giving us back the old SampleManager
+                sampleLibrary.release(msg->object.samples);
                 delete msg->object.samples;
             }
                 break;
@@ -801,6 +927,13 @@ void MobiusShell::consumeCommunications()
                 
             }
                 break;
+
+            case MsgProject: {
+                // kernel is done loading a project, this
+                // deletes any Audio it didn't use
+                delete msg->object.project;
+            }
+                break;
         }
 
         if (abandon) communicator.shellAbandon(msg);
@@ -854,23 +987,43 @@ void MobiusShell::consumeCommunications()
 // a SampleManager which restructures the float buffers into
 // a segmented Audio object.
 //
+// With the streamSamples option SampleLibrary is used instead of
+// SampleReader.  It maps the files and the loaded SampleConfig
+// has only the start of each sample.  The rest is read when the
+// sample is first triggered.
+//
 //////////////////////////////////////////////////////////////////////
 
 /**
  * Take a SampleConfig containing file paths, load the sample data
  * and build the SampManager ready to send down to the kernel.
+ *
+ * Unit tests expect samples to be complete as soon as they are
+ * installed so they don't stream.
  */
 SampleManager* MobiusShell::loadSamples(SampleConfig* src)
 {
     SampleManager* manager = nullptr;
     
     if (src != nullptr) {
+        bool stream = (configuration != nullptr &&
+                       configuration->isStreamSamples() &&
+                       !unitTests.isEnabled());
+
         // create a new "loaded" SampleConfig from the source
-        SampleReader reader;
-        SampleConfig* loaded = reader.loadSamples(src);
+        SampleConfig* loaded = nullptr;
+        if (stream) {
+            loaded = sampleLibrary.loadSamples(src);
+        }
+        else {
+            SampleReader reader;
+            loaded = reader.loadSamples(src);
+        }
 
         // turn the loaded samples into a SampleManager
         manager = new SampleManager(&audioPool, loaded);
+        if (stream)
+          sampleLibrary.attach(manager);
 
         // SampleManager copied the loaded float buffers into
         // Audio objects, it didn't actually steal the float buffers
@@ -905,6 +1058,7 @@ void MobiusShell::sendSamples(SampleManager* manager, bool safeMode)
             // at this point we would normally send a MsgSamples
             // down through KernelCommunicator, but we're going to play
             // fast and loose and assume kernel was left in GlobalReset
+            sampleLibrary.release(kernel.samples);
             kernel.slamSampleManager(manager);
         }
         else {
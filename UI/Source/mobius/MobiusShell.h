@@ -14,6 +14,9 @@
 #include "MobiusContainer.h"
 #include "KernelCommunicator.h"
 #include "AudioPool.h"
+#include "AudioWriter.h"
+#include "ProjectFile.h"
+#include "SampleLibrary.h"
 #include "MobiusKernel.h"
 #include "MobiusInterface.h"
 #include "Simulator.h"
@@ -27,6 +30,7 @@ class MobiusShell : public MobiusInterface
     friend class KernelEventHandler;
     friend class UnitTests;
     friend class AudioDifferencer;
+    friend class Benchmark;
     
   public:
 
@@ -40,6 +44,7 @@ class MobiusShell : public MobiusInterface
     
     MobiusState* getState();    // also shared by the kernel
     void doAction(class UIAction* action);
+    bool doTrigger(class UIAction* action, double timestamp);
     int getParameter(UIParameter* p, int tracknum = 0);
     
     void installSamples(SampleConfig* samples);
@@ -109,6 +114,18 @@ class MobiusShell : public MobiusInterface
     // todo: try to avoid passing this down, can we do
     // everything with messages?
     MobiusKernel kernel {this, &communicator};
+
+    // background file writer, declared after the pool and kernel
+    // so it is stopped and returns its Audio and layer snapshots
+    // before they go away
+    AudioWriter audioWriter;
+
+    // reads the undo layers of the last project loaded
+    std::unique_ptr<ProjectLoader> projectLoader;
+
+    // mapped sample files when streamSamples is on, declared after
+    // the kernel so the thread stops before the players are deleted
+    SampleLibrary sampleLibrary {&audioPool};
     
     // temporary simulator
     bool doSimulation = false;
@@ -135,6 +152,9 @@ class MobiusShell : public MobiusInterface
     void sendScripts(class Scriptarian* manager, bool safeMode);
     
     void consumeCommunications();
+    void sendSnapshots(class LayerSnapshot* list);
+    void loadProject(class Project* p, class ProjectLoader* loader);
+    void sendProject(class Project* p);
     void sendKernelConfigure(class MobiusConfig* config);
     void doKernelAction(UIAction* action);
 
@@ -0,0 +1,143 @@
+/**
+ * MobiusContainer without an audio device, see OfflineContainer.h
+ *
+ * There is one stereo port in each direction which is all
+ * JuceMobiusContainer supports too.
+ */
+
+#include <JuceHeader.h>
+
+#include "../util/Trace.h"
+
+#include "MobiusContainer.h"
+#include "OfflineContainer.h"
+
+OfflineContainer::OfflineContainer(juce::File argRoot, int rate, int block)
+{
+    root = argRoot;
+    sampleRate = rate;
+    blockSize = block;
+
+    if (blockSize <= 0 || blockSize > AUDIO_MAX_FRAMES_PER_BUFFER) {
+        Trace(1, "OfflineContainer: Invalid block size %ld\n", (long)blockSize);
+        blockSize = AUDIO_FRAMES_PER_BUFFER;
+    }
+
+    memset(inputBuffer, 0, sizeof(inputBuffer));
+    memset(outputBuffer, 0, sizeof(outputBuffer));
+}
+
+OfflineContainer::~OfflineContainer()
+{
+}
+
+/**
+ * Run one block through the listener.
+ * The input buffer is expected to have been filled, the output
+ * buffer is cleared first just like JuceMobiusContainer does.
+ */
+void OfflineContainer::process(int frames)
+{
+    if (frames > AUDIO_MAX_FRAMES_PER_BUFFER)
+      frames = AUDIO_MAX_FRAMES_PER_BUFFER;
+
+    blockFrames = frames;
+    memset(outputBuffer, 0, sizeof(float) * frames * AUDIO_MAX_CHANNELS);
+
+    if (audioListener != nullptr)
+      audioListener->containerAudioAvailable(this);
+
+    lastBlockStart = totalFrames;
+    totalFrames += frames;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// MobiusContainer
+//
+//////////////////////////////////////////////////////////////////////
+
+juce::File OfflineContainer::getRoot()
+{
+    return root;
+}
+
+void OfflineContainer::setAudioListener(MobiusContainer::AudioListener* l)
+{
+    audioListener = l;
+}
+
+/**
+ * Simulated time, based on the number of frames processed.
+ */
+int OfflineContainer::getMillisecondCounter()
+{
+    return (int)((totalFrames * 1000) / sampleRate);
+}
+
+/**
+ * Nothing waits in the offline world.
+ */
+void OfflineContainer::sleep(int millis)
+{
+    (void)millis;
+}
+
+int OfflineContainer::getInputPorts()
+{
+    return 1;
+}
+
+int OfflineContainer::getOutputPorts()
+{
+    return 1;
+}
+
+int OfflineContainer::getSampleRate()
+{
+    return sampleRate;
+}
+
+/**
+ * There is no device so there is no latency.
+ */
+int OfflineContainer::getInputLatency()
+{
+    return 0;
+}
+
+int OfflineContainer::getOutputLatency()
+{
+    return 0;
+}
+
+double OfflineContainer::getStreamTime()
+{
+    return (double)totalFrames / (double)sampleRate;
+}
+
+double OfflineContainer::getLastInterruptStreamTime()
+{
+    return (double)lastBlockStart / (double)sampleRate;
+}
+
+AudioTime* OfflineContainer::getAudioTime()
+{
+    return nullptr;
+}
+
+long OfflineContainer::getInterruptFrames()
+{
+    return blockFrames;
+}
+
+void OfflineContainer::getInterruptBuffers(int inport, float** input,
+                                           int outport, float** output)
+{
+    if (input != nullptr) *input = inputBuffer;
+    if (output != nullptr) *output = outputBuffer;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
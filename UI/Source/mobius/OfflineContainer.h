@@ -0,0 +1,84 @@
+/**
+ * Implementation of MobiusContainer with no audio device.
+ *
+ * Used by the Benchmark to drive the engine faster than real time.
+ * The caller fills the interleaved input buffer, calls process()
+ * to run one block through the AudioListener, then takes what it
+ * wants from the output buffer.
+ *
+ * Time is derived from the number of frames processed rather than
+ * the system clock so anything in the core that looks at the
+ * millisecond counter sees the same thing it would in real time.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "MobiusContainer.h"
+#include "core/AudioConstants.h"
+
+class OfflineContainer : public MobiusContainer
+{
+  public:
+
+    OfflineContainer(juce::File root, int sampleRate, int blockSize);
+    ~OfflineContainer();
+
+    // Benchmark interface
+    int getBlockSize() {
+        return blockSize;
+    }
+    float* getInputBuffer() {
+        return inputBuffer;
+    }
+    float* getOutputBuffer() {
+        return outputBuffer;
+    }
+    void process(int frames);
+
+    // MobiusContainer
+    juce::File getRoot();
+    void setAudioListener(class MobiusContainer::AudioListener* l);
+    int getMillisecondCounter();
+    void sleep(int millis);
+    int getInputPorts();
+    int getOutputPorts();
+    int getSampleRate();
+    int getInputLatency();
+    int getOutputLatency();
+
+    bool isPlugin() {
+        return false;
+    }
+
+    double getStreamTime();
+    double getLastInterruptStreamTime();
+    class AudioTime* getAudioTime();
+	long getInterruptFrames();
+	void getInterruptBuffers(int inport, float** input,
+                             int outport, float** output);
+
+  private:
+
+    juce::File root;
+    class MobiusContainer::AudioListener* audioListener = nullptr;
+
+    int sampleRate = 0;
+    int blockSize = 0;
+
+    // frames in the block being processed
+    int blockFrames = 0;
+
+    // frames processed so far, this is our clock
+    juce::int64 totalFrames = 0;
+    juce::int64 lastBlockStart = 0;
+
+    float inputBuffer[AUDIO_MAX_SAMPLES_PER_BUFFER];
+    float outputBuffer[AUDIO_MAX_SAMPLES_PER_BUFFER];
+
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
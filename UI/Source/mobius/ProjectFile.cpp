@@ -0,0 +1,626 @@
+/**
+ * Binary project files, see ProjectFile.h
+ */
+
+#include <JuceHeader.h>
+
+#include "../util/Trace.h"
+#include "../util/List.h"
+
+#include "Audio.h"
+#include "AudioPool.h"
+#include "AudioFile.h"
+#include "core/Project.h"
+
+#include "ProjectFile.h"
+
+const char* const ProjectFileMagic = "MOBP";
+const int ProjectFileVersion = 1;
+
+const char* const ProjectChunkProject = "PROJ";
+const char* const ProjectChunkTrack = "TRAK";
+
+// ProjectLayer flags
+const int ProjectLayerProtected = 1;
+const int ProjectLayerDeferredFadeLeft = 2;
+const int ProjectLayerDeferredFadeRight = 4;
+const int ProjectLayerContainsDeferredFadeLeft = 8;
+const int ProjectLayerContainsDeferredFadeRight = 16;
+const int ProjectLayerReverseRecord = 32;
+
+// limits on the directory counts, well over anything Mobius saves
+const int ProjectMaxLoops = 64;
+const int ProjectMaxLayers = 65536;
+const int ProjectMaxSegments = 65536;
+
+// the smallest directory entries, see writeTrack
+const int ProjectLoopBytes = 17;
+const int ProjectLayerBytes = 36;
+const int ProjectSegmentBytes = 48;
+
+/**
+ * How long the destructor waits for the loader to notice
+ * it should stop, in milliseconds.  It checks between chunks
+ * so this should be quick.
+ */
+const int ProjectLoaderShutdownWait = 10000;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Write
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Write the samples for an Audio, see AudioFile::write.
+ * Audio is always two channels.
+ */
+static void WriteProjectAudio(juce::OutputStream& out, Audio* a)
+{
+    int channels = 2;
+    long frames = a->getFrames();
+    int samples = AudioFileChunkFrames * channels;
+    float* buffer = new float[samples];
+
+    long frame = 0;
+    while (frame < frames) {
+        long chunk = frames - frame;
+        if (chunk > AudioFileChunkFrames)
+          chunk = AudioFileChunkFrames;
+
+        // Audio::get adds to what is in the buffer
+        memset(buffer, 0, samples * sizeof(float));
+        a->get(buffer, chunk, frame);
+        out.write(buffer, chunk * channels * sizeof(float));
+
+        frame += chunk;
+    }
+
+    delete[] buffer;
+}
+
+/**
+ * Write one track chunk without the id and length.
+ * The audio goes first so layers can be flattened and released
+ * one at a time, the directory is built as we go and written last.
+ */
+static juce::String WriteProjectTrack(juce::File file, ProjectTrack* track, int number)
+{
+    juce::FileOutputStream out (file);
+    if (!out.openedOk())
+      return "Unable to open " + file.getFullPathName();
+
+    juce::MemoryOutputStream dir;
+    dir.writeInt(number);
+    dir.writeBool(track->isActive());
+    dir.writeInt(track->getGroup());
+    dir.writeBool(track->isFocusLock());
+    dir.writeInt(track->getInputLevel());
+    dir.writeInt(track->getOutputLevel());
+    dir.writeInt(track->getFeedback());
+    dir.writeInt(track->getAltFeedback());
+    dir.writeInt(track->getPan());
+    dir.writeBool(track->isReverse());
+    dir.writeInt(track->getSpeedOctave());
+    dir.writeInt(track->getSpeedStep());
+    dir.writeInt(track->getSpeedBend());
+    dir.writeInt(track->getSpeedToggle());
+    dir.writeInt(track->getPitchOctave());
+    dir.writeInt(track->getPitchStep());
+    dir.writeInt(track->getPitchBend());
+    dir.writeInt(track->getTimeStretch());
+    dir.writeString(juce::String(track->getPreset()));
+
+    List* loops = track->getLoops();
+    int loopCount = (loops != nullptr) ? loops->size() : 0;
+    dir.writeInt(loopCount);
+
+    for (int i = 0 ; i < loopCount ; i++) {
+        ProjectLoop* loop = (ProjectLoop*)loops->get(i);
+        dir.writeInt(i);
+        dir.writeBool(loop->isActive());
+        dir.writeInt64(loop->getFrame());
+
+        List* layers = loop->getLayers();
+        int layerCount = (layers != nullptr) ? layers->size() : 0;
+        dir.writeInt(layerCount);
+
+        for (int j = 0 ; j < layerCount ; j++) {
+            ProjectLayer* layer = (ProjectLayer*)layers->get(j);
+            bool flattened = (layer->getSnapshot() != nullptr && layer->getAudio() == nullptr);
+            layer->flatten();
+
+            Audio* audio = layer->getAudio();
+            juce::int64 position = out.getPosition();
+            juce::int64 frames = 0;
+            int sampleRate = 0;
+            if (audio != nullptr) {
+                frames = audio->getFrames();
+                sampleRate = audio->getSampleRate();
+                WriteProjectAudio(out, audio);
+            }
+
+            // don't hold on to every flattened layer in the track
+            if (flattened)
+              delete layer->stealAudio();
+
+            int flags = 0;
+            if (layer->isProtected()) flags |= ProjectLayerProtected;
+            if (layer->isDeferredFadeLeft()) flags |= ProjectLayerDeferredFadeLeft;
+            if (layer->isDeferredFadeRight()) flags |= ProjectLayerDeferredFadeRight;
+            if (layer->isContainsDeferredFadeLeft()) flags |= ProjectLayerContainsDeferredFadeLeft;
+            if (layer->isContainsDeferredFadeRight()) flags |= ProjectLayerContainsDeferredFadeRight;
+            if (layer->isReverseRecord()) flags |= ProjectLayerReverseRecord;
+
+            dir.writeInt(layer->getId());
+            dir.writeInt(layer->getCycles());
+            dir.writeInt(flags);
+            dir.writeInt(sampleRate);
+            dir.writeInt64(frames);
+            dir.writeInt64(position);
+
+            List* segments = layer->getSegments();
+            int segmentCount = (segments != nullptr) ? segments->size() : 0;
+            dir.writeInt(segmentCount);
+            for (int k = 0 ; k < segmentCount ; k++) {
+                ProjectSegment* seg = (ProjectSegment*)segments->get(k);
+                dir.writeInt(seg->getLayer());
+                dir.writeInt64(seg->getOffset());
+                dir.writeInt64(seg->getStartFrame());
+                dir.writeInt64(seg->getFrames());
+                dir.writeInt(seg->getFeedback());
+                dir.writeInt64(seg->getLocalCopyLeft());
+                dir.writeInt64(seg->getLocalCopyRight());
+            }
+        }
+    }
+
+    juce::int64 dirPosition = out.getPosition();
+    out.write(dir.getData(), dir.getDataSize());
+    out.writeInt64(dirPosition);
+    out.flush();
+
+    if (out.getStatus().failed())
+      return out.getStatus().getErrorMessage();
+
+    return juce::String();
+}
+
+/**
+ * Writes one track to a temporary file next to the project.
+ */
+class ProjectTrackWriter : public juce::Thread
+{
+  public:
+
+    ProjectTrackWriter(ProjectTrack* t, int n, juce::File target) :
+        juce::Thread("Mobius ProjectTrackWriter"), temp(target) {
+        track = t;
+        number = n;
+    }
+
+    void run() override {
+        error = WriteProjectTrack(temp.getFile(), track, number);
+    }
+
+    ProjectTrack* track;
+    int number;
+    juce::TemporaryFile temp;
+    juce::String error;
+};
+
+/**
+ * Tracks are independent so they are flattened and written in parallel.
+ * JUCE won't let more than one stream write the same file, so each
+ * track goes to its own file which are copied into place when they're
+ * all done.  The project itself is written to a temporary file too
+ * so a failed save doesn't lose the last one.
+ */
+juce::String ProjectFile::write(juce::File file, Project* p)
+{
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+
+    file.getParentDirectory().createDirectory();
+
+    juce::OwnedArray<ProjectTrackWriter> writers;
+    List* tracks = p->getTracks();
+    if (tracks != nullptr) {
+        for (int i = 0 ; i < tracks->size() ; i++) {
+            ProjectTrack* track = (ProjectTrack*)tracks->get(i);
+            writers.add(new ProjectTrackWriter(track, i, file));
+        }
+    }
+
+    for (auto writer : writers)
+      writer->startThread();
+
+    juce::String error;
+    for (auto writer : writers) {
+        writer->waitForThreadToExit(-1);
+        if (error.isEmpty())
+          error = writer->error;
+    }
+
+    if (error.isEmpty()) {
+        juce::TemporaryFile result (file);
+        {
+            juce::FileOutputStream out (result.getFile());
+            if (!out.openedOk()) {
+                error = "Unable to open " + result.getFile().getFullPathName();
+            }
+            else {
+                out.write(ProjectFileMagic, 4);
+                out.writeInt(ProjectFileVersion);
+                out.writeInt(writers.size());
+
+                juce::MemoryOutputStream proj;
+                proj.writeString(juce::String(p->getSetup()));
+                out.write(ProjectChunkProject, 4);
+                out.writeInt64((juce::int64)proj.getDataSize());
+                out.write(proj.getData(), proj.getDataSize());
+
+                for (auto writer : writers) {
+                    juce::File trackFile = writer->temp.getFile();
+                    juce::FileInputStream in (trackFile);
+                    out.write(ProjectChunkTrack, 4);
+                    out.writeInt64(trackFile.getSize());
+                    out.writeFromInputStream(in, -1);
+                }
+                out.flush();
+
+                if (out.getStatus().failed())
+                  error = out.getStatus().getErrorMessage();
+            }
+        }
+
+        if (error.isEmpty() && !result.overwriteTargetFileWithTemporary())
+          error = "Unable to replace " + file.getFullPathName();
+    }
+
+    if (error.isNotEmpty()) {
+        Trace(1, "ProjectFile: Error writing %s: %s\n",
+              file.getFullPathName().toUTF8(), error.toUTF8());
+    }
+    else {
+        double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        Tracej("ProjectFile: Wrote " + juce::String(writers.size()) + " tracks in " +
+               juce::String(seconds, 2) + " seconds");
+    }
+
+    return error;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Read
+//
+//////////////////////////////////////////////////////////////////////
+
+ProjectLoader::ProjectLoader(AudioPool* pool, juce::File f) : juce::Thread("Mobius ProjectLoader")
+{
+    audioPool = pool;
+    file = f;
+}
+
+ProjectLoader::~ProjectLoader()
+{
+    if (isThreadRunning()) {
+        signalThreadShouldExit();
+        if (!stopThread(ProjectLoaderShutdownWait))
+          Trace(1, "ProjectLoader: Thread did not stop\n");
+    }
+    delete history;
+}
+
+juce::String ProjectLoader::getError()
+{
+    return error;
+}
+
+/**
+ * Read the chunks.  Chunks we don't recognize are skipped
+ * so newer files can still be loaded.
+ */
+Project* ProjectLoader::read(bool lazy)
+{
+    Project* project = nullptr;
+
+    map.reset(new juce::MemoryMappedFile(file, juce::MemoryMappedFile::readOnly));
+    const char* data = (const char*)map->getData();
+    juce::int64 size = (juce::int64)map->getSize();
+
+    if (data == nullptr) {
+        error = "Unable to open " + file.getFileName();
+    }
+    else if (size < 12 || memcmp(data, ProjectFileMagic, 4) != 0) {
+        error = file.getFileName() + " is not a project file";
+    }
+    else if ((int)juce::ByteOrder::littleEndianInt(data + 4) > ProjectFileVersion) {
+        error = file.getFileName() + " was saved by a newer version";
+    }
+    else {
+        project = new Project();
+        if (lazy) {
+            history = new Project();
+            history->setHistory(true);
+        }
+
+        int tracks = 0;
+        juce::int64 position = 12;
+        while (error.isEmpty() && position < size) {
+            const char* id = data + position;
+            juce::int64 length = -1;
+            if (position + 12 <= size)
+              length = (juce::int64)juce::ByteOrder::littleEndianInt64(data + position + 4);
+            position += 12;
+
+            if (length < 0 || length > size - position) {
+                error = file.getFileName() + " is truncated";
+            }
+            else if (memcmp(id, ProjectChunkProject, 4) == 0) {
+                juce::MemoryInputStream in (data + position, (size_t)length, false);
+                juce::String setup = in.readString();
+                if (setup.isNotEmpty())
+                  project->setSetup(setup.toUTF8());
+            }
+            else if (memcmp(id, ProjectChunkTrack, 4) == 0) {
+                if (!readTrack(project, history, tracks, position, length, lazy))
+                  error = file.getFileName() + " has a damaged track";
+                tracks++;
+            }
+            position += length;
+        }
+    }
+
+    if (error.isNotEmpty()) {
+        Trace(1, "ProjectLoader: %s\n", error.toUTF8());
+        delete project;
+        project = nullptr;
+        delete history;
+        history = nullptr;
+        pending.clear();
+    }
+    else if (pending.size() == 0) {
+        delete history;
+        history = nullptr;
+    }
+
+    if (history != nullptr) {
+        startThread();
+    }
+    else {
+        map.reset();
+        finished = true;
+    }
+
+    return project;
+}
+
+/**
+ * Check a count read from a track directory before using it.
+ * A damaged file could otherwise ask for an enormous number of
+ * objects, the count has to be sane and the entries have to fit
+ * in what is left of the directory.
+ */
+static bool CheckCount(juce::MemoryInputStream& in, int count, int max, int entryBytes)
+{
+    return (count >= 0 && count <= max &&
+            (juce::int64)count * entryBytes <= in.getNumBytesRemaining());
+}
+
+/**
+ * Read the directory for one track.  Track and loop numbers
+ * in the history project are the positions in this file since
+ * that is how Mobius::loadProject assigns them.
+ */
+bool ProjectLoader::readTrack(Project* p, Project* hist, int number,
+                              juce::int64 start, juce::int64 length, bool lazy)
+{
+    const char* data = (const char*)map->getData();
+    if (length < 8)
+      return false;
+
+    juce::int64 dirPosition = (juce::int64)juce::ByteOrder::littleEndianInt64(data + start + length - 8);
+    if (dirPosition < 0 || dirPosition > length - 8)
+      return false;
+
+    juce::MemoryInputStream in (data + start + dirPosition, (size_t)(length - 8 - dirPosition), false);
+
+    ProjectTrack* track = new ProjectTrack();
+    p->add(track);
+    track->setNumber(in.readInt());
+    track->setActive(in.readBool());
+    track->setGroup(in.readInt());
+    track->setFocusLock(in.readBool());
+    track->setInputLevel(in.readInt());
+    track->setOutputLevel(in.readInt());
+    track->setFeedback(in.readInt());
+    track->setAltFeedback(in.readInt());
+    track->setPan(in.readInt());
+    track->setReverse(in.readBool());
+    track->setSpeedOctave(in.readInt());
+    track->setSpeedStep(in.readInt());
+    track->setSpeedBend(in.readInt());
+    track->setSpeedToggle(in.readInt());
+    track->setPitchOctave(in.readInt());
+    track->setPitchStep(in.readInt());
+    track->setPitchBend(in.readInt());
+    track->setTimeStretch(in.readInt());
+    juce::String preset = in.readString();
+    if (preset.isNotEmpty())
+      track->setPreset(preset.toUTF8());
+
+    ProjectTrack* historyTrack = nullptr;
+
+    int loopCount = in.readInt();
+    if (!CheckCount(in, loopCount, ProjectMaxLoops, ProjectLoopBytes))
+      return false;
+
+    for (int i = 0 ; i < loopCount ; i++) {
+        ProjectLoop* loop = new ProjectLoop();
+        track->add(loop);
+        loop->setNumber(in.readInt());
+        loop->setActive(in.readBool());
+        loop->setFrame((long)in.readInt64());
+
+        juce::Array<LayerSource> sources;
+        // undo layers can only wait if no segments reference them
+        bool split = lazy;
+
+        int layerCount = in.readInt();
+        bool damaged = !CheckCount(in, layerCount, ProjectMaxLayers, ProjectLayerBytes);
+        for (int j = 0 ; j < layerCount && !damaged ; j++) {
+            ProjectLayer* layer = new ProjectLayer();
+            layer->setId(in.readInt());
+            layer->setCycles(in.readInt());
+            int flags = in.readInt();
+            layer->setProtected((flags & ProjectLayerProtected) != 0);
+            layer->setDeferredFadeLeft((flags & ProjectLayerDeferredFadeLeft) != 0);
+            layer->setDeferredFadeRight((flags & ProjectLayerDeferredFadeRight) != 0);
+            layer->setContainsDeferredFadeLeft((flags & ProjectLayerContainsDeferredFadeLeft) != 0);
+            layer->setContainsDeferredFadeRight((flags & ProjectLayerContainsDeferredFadeRight) != 0);
+            layer->setReverseRecord((flags & ProjectLayerReverseRecord) != 0);
+
+            LayerSource src;
+            src.layer = layer;
+            src.sampleRate = in.readInt();
+            src.frames = in.readInt64();
+            src.position = start + in.readInt64();
+            sources.add(src);
+
+            int segmentCount = in.readInt();
+            damaged = !CheckCount(in, segmentCount, ProjectMaxSegments, ProjectSegmentBytes);
+            for (int k = 0 ; k < segmentCount && !damaged ; k++) {
+                ProjectSegment* seg = new ProjectSegment();
+                seg->setLayer(in.readInt());
+                seg->setOffset((long)in.readInt64());
+                seg->setStartFrame((long)in.readInt64());
+                seg->setFrames((long)in.readInt64());
+                seg->setFeedback(in.readInt());
+                seg->setLocalCopyLeft((long)in.readInt64());
+                seg->setLocalCopyRight((long)in.readInt64());
+                layer->add(seg);
+                split = false;
+            }
+
+            // audio must be in the chunk before the directory,
+            // check the frames first so the byte count can't overflow
+            juce::int64 frameBytes = 2 * sizeof(float);
+            if (!damaged &&
+                (src.frames < 0 || src.frames > dirPosition / frameBytes ||
+                 src.position < start ||
+                 src.position + (src.frames * frameBytes) > start + dirPosition))
+              damaged = true;
+        }
+
+        if (damaged) {
+            for (auto& s : sources)
+              delete s.layer;
+            return false;
+        }
+
+        for (int j = 0 ; j < sources.size() ; j++) {
+            LayerSource& src = sources.getReference(j);
+            if (j == 0 || !split) {
+                loop->add(src.layer);
+                if (src.frames > 0)
+                  src.layer->setAudio(readAudio(src));
+            }
+            else {
+                if (historyTrack == nullptr) {
+                    historyTrack = new ProjectTrack();
+                    historyTrack->setNumber(number);
+                    hist->add(historyTrack);
+                }
+                List* loops = historyTrack->getLoops();
+                ProjectLoop* historyLoop = nullptr;
+                if (loops != nullptr && loops->size() > 0)
+                  historyLoop = (ProjectLoop*)loops->get(loops->size() - 1);
+                if (historyLoop == nullptr || historyLoop->getNumber() != i) {
+                    historyLoop = new ProjectLoop();
+                    historyLoop->setNumber(i);
+                    historyTrack->add(historyLoop);
+                }
+                historyLoop->add(src.layer);
+                pending.add(src);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Copy layer audio out of the map.  The map is read only and
+ * Audio wants a buffer it can touch so copy a chunk at a time.
+ */
+Audio* ProjectLoader::readAudio(LayerSource& src)
+{
+    const char* data = (const char*)map->getData() + src.position;
+    Audio* audio = audioPool->newAudio();
+    if (src.sampleRate > 0)
+      audio->setSampleRate(src.sampleRate);
+
+    int channels = 2;
+    float* buffer = new float[AudioFileChunkFrames * channels];
+
+    juce::int64 frame = 0;
+    while (frame < src.frames && !threadShouldExit()) {
+        juce::int64 chunk = src.frames - frame;
+        if (chunk > AudioFileChunkFrames)
+          chunk = AudioFileChunkFrames;
+
+        memcpy(buffer, data + (frame * channels * sizeof(float)), (size_t)(chunk * channels * sizeof(float)));
+        audio->append(buffer, (long)chunk);
+        frame += chunk;
+    }
+
+    delete[] buffer;
+    return audio;
+}
+
+/**
+ * Read the undo layers left by read().
+ */
+void ProjectLoader::run()
+{
+    juce::int64 start = juce::Time::getHighResolutionTicks();
+
+    for (auto& src : pending) {
+        if (threadShouldExit())
+          break;
+        if (src.frames > 0)
+          src.layer->setAudio(readAudio(src));
+    }
+
+    if (!threadShouldExit()) {
+        double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        Tracej("ProjectLoader: Read " + juce::String(pending.size()) + " undo layers in " +
+               juce::String(seconds, 2) + " seconds");
+        ready = true;
+    }
+
+    pending.clear();
+    map.reset();
+    finished = true;
+}
+
+Project* ProjectLoader::takeHistory()
+{
+    Project* p = nullptr;
+    if (ready) {
+        p = history;
+        history = nullptr;
+        ready = false;
+    }
+    return p;
+}
+
+bool ProjectLoader::isFinished()
+{
+    return finished && history == nullptr;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
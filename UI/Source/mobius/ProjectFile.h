@@ -0,0 +1,124 @@
+/**
+ * Binary project files.
+ *
+ * Old code saved a Project as an XML file with a .wav file next to it
+ * for every layer, which was slow to write and slower to read back with
+ * deep undo history.  Projects are now saved as a single file with a
+ * small directory for each track followed by raw audio.
+ *
+ *     "MOBP" version trackCount
+ *     chunk...
+ *
+ * A chunk is a four character id, a 64 bit length and the contents.
+ * There is one PROJ chunk with the setup name, then a TRAK chunk for
+ * each track.  A TRAK chunk has the audio for every layer in the track
+ * as interleaved 32 bit floats, then the directory with the track
+ * settings, loops, layers and segments, then the offset of the
+ * directory within the chunk.  Layer audio is located by its offset
+ * within the chunk so each track can be written on its own.
+ *
+ * Integers are little endian.  Samples are written in native order,
+ * which is little endian on everything we build for.
+ *
+ * Saving flattens each track on its own thread into a temporary file,
+ * then copies them into the project.
+ *
+ * Loading maps the file.  The play layer of each loop is read right away
+ * and the project can be loaded while ProjectLoader reads the rest of the
+ * undo layers on its own thread.  Those are sent down in a second
+ * project, see Loop::loadHistory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <JuceHeader.h>
+
+/**
+ * The extension used when a project file name doesn't have one.
+ */
+const char* const ProjectFileExtension = ".mobp";
+
+class ProjectFile
+{
+  public:
+
+    /**
+     * Write a Project to a file, flattening layer snapshots as we go.
+     * Returns an error message, empty if it worked.  The snapshots are
+     * left in the Project.
+     */
+    static juce::String write(juce::File file, class Project* p);
+
+};
+
+/**
+ * Reads a project file in two parts.
+ */
+class ProjectLoader : public juce::Thread
+{
+  public:
+
+    ProjectLoader(class AudioPool* pool, juce::File file);
+    ~ProjectLoader();
+
+    /**
+     * Read the file and return the Project to load, nullptr if the
+     * file couldn't be read.  When lazy is true the undo layers are
+     * left in the file and the thread is started to read them.
+     */
+    class Project* read(bool lazy);
+
+    /**
+     * Reason the last read failed.
+     */
+    juce::String getError();
+
+    /**
+     * Return the project with the undo layers once they have been read.
+     * Ownership passes to the caller.  This returns nullptr until
+     * the layers are ready, and after they have been taken.
+     */
+    class Project* takeHistory();
+
+    /**
+     * True when there is nothing more to read or take.
+     */
+    bool isFinished();
+
+    void run() override;
+
+  private:
+
+    /**
+     * Where the audio for one layer is in the file.
+     */
+    class LayerSource
+    {
+      public:
+        class ProjectLayer* layer = nullptr;
+        juce::int64 position = 0;
+        juce::int64 frames = 0;
+        int sampleRate = 0;
+    };
+
+    bool readTrack(class Project* p, class Project* history, int number,
+                   juce::int64 start, juce::int64 length, bool lazy);
+    class Audio* readAudio(LayerSource& src);
+
+    class AudioPool* audioPool;
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> map;
+    juce::String error;
+
+    // undo layers waiting to be read
+    juce::Array<LayerSource> pending;
+    class Project* history = nullptr;
+
+    std::atomic<bool> ready {false};
+    std::atomic<bool> finished {false};
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -230,6 +230,9 @@ SamplePlayer::~SamplePlayer()
 {
     delete mFilename;
 	delete mAudio;
+    delete mPreroll;
+    // streamed after the last block
+    delete mStreamAudio.load();
 
     // if we had a global cursor pool, this should
     // return it to the pool instead of deleting
@@ -296,6 +299,7 @@ void SampleCursor::init()
     mStopped = false;
     mFrame = 0;
     mMaxFrames = 0;
+    mStarved = false;
 }
 
 SampleCursor::~SampleCursor()
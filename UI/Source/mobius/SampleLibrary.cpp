@@ -0,0 +1,408 @@
+/**
+ * Memory mapped sample files, see SampleLibrary.h
+ */
+
+#include <JuceHeader.h>
+
+#include "../util/Trace.h"
+#include "../model/SampleConfig.h"
+
+#include "Audio.h"
+#include "AudioPool.h"
+#include "AudioFile.h"
+#include "WaveFile.h"
+#include "SampleManager.h"
+#include "core/Mem.h"
+
+#include "SampleLibrary.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// SampleSource
+//
+//////////////////////////////////////////////////////////////////////
+
+SampleSource::SampleSource(juce::File f)
+{
+    file = f;
+    modified = f.getLastModificationTime();
+}
+
+SampleSource::~SampleSource()
+{
+}
+
+/**
+ * Walk the RIFF chunks looking for the format and the data.
+ * This accepts the same formats as WaveFile: 16 bit PCM and
+ * 32 or 64 bit IEEE.
+ */
+juce::String SampleSource::open()
+{
+    map.reset(new juce::MemoryMappedFile(file, juce::MemoryMappedFile::readOnly));
+    const unsigned char* start = (const unsigned char*)map->getData();
+    size_t size = map->getSize();
+    if (start == nullptr)
+      return "Unable to map file";
+
+    if (size < 12 || memcmp(start, "RIFF", 4) || memcmp(start + 8, "WAVE", 4))
+      return "Not a wave file";
+
+    size_t position = 12;
+    while (data == nullptr && position + 8 <= size) {
+        const unsigned char* chunk = start + position;
+        size_t chunkSize = juce::ByteOrder::littleEndianInt(chunk + 4);
+        position += 8;
+        if (chunkSize > size - position)
+          chunkSize = size - position;
+
+        if (!memcmp(chunk, "fmt ", 4) && chunkSize >= 16) {
+            format = juce::ByteOrder::littleEndianShort(chunk + 8);
+            channels = juce::ByteOrder::littleEndianShort(chunk + 10);
+            blockAlign = juce::ByteOrder::littleEndianShort(chunk + 20);
+            bitsPerSample = juce::ByteOrder::littleEndianShort(chunk + 22);
+        }
+        else if (!memcmp(chunk, "data", 4)) {
+            if (format == 0)
+              return "Missing format chunk";
+            if (format == WAV_FORMAT_PCM) {
+                if (bitsPerSample != 16)
+                  return "Unsupported sample size";
+            }
+            else if (format == WAV_FORMAT_IEEE) {
+                if (bitsPerSample != 32 && bitsPerSample != 64)
+                  return "Unsupported sample size";
+            }
+            else {
+                return "Compressed files are not supported";
+            }
+            if (channels <= 0 || channels == 5 || channels > 6)
+              return "Unsupported number of channels";
+            if (blockAlign != channels * (bitsPerSample / 8))
+              return "Invalid block alignment";
+
+            data = chunk + 8;
+            frames = (int)(chunkSize / blockAlign);
+        }
+
+        // chunks are padded to an even boundary
+        position += chunkSize + (chunkSize & 1);
+    }
+
+    if (data == nullptr)
+      return "Missing data chunk";
+
+    return juce::String();
+}
+
+/**
+ * Everything is converted to stereo like WaveFile does.
+ * Mono is doubled, 4 channels are assumed to be surround and
+ * 6 channels take the front left and right.
+ */
+void SampleSource::read(float* dest, int startFrame, int count)
+{
+    int left = 0;
+    int right = 1;
+    if (channels == 1)
+      right = 0;
+    else if (channels == 4)
+      right = 2;
+    else if (channels == 6) {
+        left = 1;
+        right = 4;
+    }
+
+    int bytes = bitsPerSample / 8;
+    const unsigned char* src = data + ((size_t)startFrame * blockAlign);
+    for (int i = 0 ; i < count ; i++) {
+        const unsigned char* l = src + (left * bytes);
+        const unsigned char* r = src + (right * bytes);
+        if (format == WAV_FORMAT_PCM) {
+            *dest++ = (short)juce::ByteOrder::littleEndianShort(l) * (1.0f / 32768.0f);
+            *dest++ = (short)juce::ByteOrder::littleEndianShort(r) * (1.0f / 32768.0f);
+        }
+        else if (bitsPerSample == 32) {
+            float sample;
+            memcpy(&sample, l, sizeof(float));
+            *dest++ = sample;
+            memcpy(&sample, r, sizeof(float));
+            *dest++ = sample;
+        }
+        else {
+            double sample;
+            memcpy(&sample, l, sizeof(double));
+            *dest++ = (float)sample;
+            memcpy(&sample, r, sizeof(double));
+            *dest++ = (float)sample;
+        }
+        src += blockAlign;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SampleLibrary
+//
+//////////////////////////////////////////////////////////////////////
+
+SampleLibrary::SampleLibrary(AudioPool* pool) : juce::Thread("Mobius SampleLibrary")
+{
+    audioPool = pool;
+}
+
+/**
+ * The players are owned by the kernel, they will be deleted
+ * after we are.
+ */
+SampleLibrary::~SampleLibrary()
+{
+    if (isThreadRunning()) {
+        signalThreadShouldExit();
+        notify();
+        if (!stopThread(5000))
+          Trace(1, "SampleLibrary: Thread did not stop\n");
+    }
+}
+
+/**
+ * Find the mapped file or map it.  A file that changed since
+ * it was mapped is mapped again, the old one stays until the
+ * SampleManager using it is released.
+ */
+SampleSource* SampleLibrary::getSource(juce::File file)
+{
+    juce::Time modified = file.getLastModificationTime();
+    for (auto source : sources) {
+        if (source->file == file && source->modified == modified)
+          return source;
+    }
+
+    SampleSource* source = new SampleSource(file);
+    juce::String error = source->open();
+    if (error.length() > 0) {
+        Tracej("SampleLibrary: Unable to read " + file.getFullPathName() + ": " + error);
+        delete source;
+        source = nullptr;
+    }
+    else {
+        sources.add(source);
+    }
+    return source;
+}
+
+/**
+ * Build a loaded SampleConfig with just the start of each sample.
+ * Files that are already mapped are not read again.
+ */
+SampleConfig* SampleLibrary::loadSamples(SampleConfig* src)
+{
+    juce::ScopedLock lock (criticalSection);
+
+    SampleConfig* loaded = new SampleConfig();
+    if (src != nullptr) {
+        for (Sample* s = src->getSamples() ; s != nullptr ; s = s->getNext()) {
+            const char* filename = s->getFilename();
+            if (filename != nullptr) {
+                juce::File file(filename);
+                if (!file.exists()) {
+                    Trace(1, "Sample file not found: %s\n", filename);
+                }
+                else {
+                    SampleSource* source = getSource(file);
+                    if (source != nullptr) {
+                        int frames = source->frames;
+                        if (frames > SamplePrerollFrames)
+                          frames = SamplePrerollFrames;
+                        float* data = MemNewFloat("SampleLibrary::loadSamples", frames * 2);
+                        source->read(data, 0, frames);
+
+                        Sample* copy = new Sample(s);
+                        copy->setData(data, frames);
+                        loaded->add(copy);
+                    }
+                }
+            }
+        }
+    }
+    return loaded;
+}
+
+/**
+ * Players are matched with the mapped files by name, the same
+ * way SampleManager::isDifference does it.  Players whose sample
+ * fit in the pre-roll are complete and don't need a stream.
+ */
+void SampleLibrary::attach(SampleManager* manager)
+{
+    juce::ScopedLock lock (criticalSection);
+
+    for (SamplePlayer* p = manager->getPlayers() ; p != nullptr ; p = p->getNext()) {
+        SampleSource* source = nullptr;
+        juce::File file(p->getFilename());
+        for (auto s : sources) {
+            if (s->file == file)
+              source = s;
+        }
+
+        if (source == nullptr) {
+            Trace(1, "SampleLibrary: No source for %s\n", p->getFilename());
+        }
+        else {
+            source->references++;
+            if (source->frames > p->getFrames()) {
+                p->setStreamFrames(source->frames);
+                SampleStream* stream = new SampleStream();
+                stream->player = p;
+                stream->source = source;
+                streams.add(stream);
+            }
+        }
+    }
+
+    prune();
+}
+
+/**
+ * Forget the players in a SampleManager that is about to be deleted.
+ * If the thread is reading one of them it finishes and throws
+ * the Audio away.
+ */
+void SampleLibrary::release(SampleManager* manager)
+{
+    if (manager == nullptr)
+      return;
+
+    juce::ScopedLock lock (criticalSection);
+
+    for (SamplePlayer* p = manager->getPlayers() ; p != nullptr ; p = p->getNext()) {
+        juce::File file(p->getFilename());
+        for (auto s : sources) {
+            if (s->file == file && s->references > 0) {
+                s->references--;
+                break;
+            }
+        }
+    }
+
+    for (int i = streams.size() - 1 ; i >= 0 ; i--) {
+        SampleStream* stream = streams[i];
+        for (SamplePlayer* p = manager->getPlayers() ; p != nullptr ; p = p->getNext()) {
+            if (stream->player == p) {
+                if (stream == reading)
+                  stream->player = nullptr;
+                else
+                  streams.remove(i);
+                break;
+            }
+        }
+    }
+
+    prune();
+}
+
+/**
+ * Unmap files nothing is using, other than the one
+ * the thread is reading.
+ */
+void SampleLibrary::prune()
+{
+    for (int i = sources.size() - 1 ; i >= 0 ; i--) {
+        SampleSource* source = sources[i];
+        if (source->references == 0 &&
+            (reading == nullptr || reading->source != source))
+          sources.remove(i);
+    }
+}
+
+/**
+ * Wake up the thread if a streaming sample was triggered.
+ */
+void SampleLibrary::performMaintenance()
+{
+    bool wanted = false;
+    {
+        juce::ScopedLock lock (criticalSection);
+        for (auto stream : streams) {
+            if (!stream->started && stream->player->isStreamWanted()) {
+                wanted = true;
+                break;
+            }
+        }
+    }
+
+    if (wanted) {
+        if (!isThreadRunning())
+          startThread();
+        else
+          notify();
+    }
+}
+
+/**
+ * Read the rest of the triggered samples.  The stream is removed
+ * when it is done, the player has the complete Audio from then on.
+ */
+void SampleLibrary::run()
+{
+    while (!threadShouldExit()) {
+        SampleStream* stream = nullptr;
+        {
+            juce::ScopedLock lock (criticalSection);
+            for (auto s : streams) {
+                if (!s->started && s->player->isStreamWanted()) {
+                    stream = s;
+                    break;
+                }
+            }
+            if (stream != nullptr) {
+                stream->started = true;
+                reading = stream;
+            }
+        }
+
+        if (stream == nullptr) {
+            wait(-1);
+        }
+        else {
+            juce::int64 start = juce::Time::getHighResolutionTicks();
+            Audio* audio = readAudio(stream->source);
+            double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            Tracej("SampleLibrary: Read " + stream->source->file.getFileName() + " in " +
+                   juce::String(seconds, 3) + " seconds");
+
+            juce::ScopedLock lock (criticalSection);
+            if (stream->player != nullptr && !threadShouldExit())
+              stream->player->setStreamAudio(audio);
+            else
+              delete audio;
+            reading = nullptr;
+            streams.removeObject(stream);
+            prune();
+        }
+    }
+}
+
+Audio* SampleLibrary::readAudio(SampleSource* source)
+{
+    Audio* audio = audioPool->newAudio();
+    float* buffer = new float[AudioFileChunkFrames * 2];
+
+    int frame = 0;
+    while (frame < source->frames && !threadShouldExit()) {
+        int chunk = source->frames - frame;
+        if (chunk > AudioFileChunkFrames)
+          chunk = AudioFileChunkFrames;
+
+        source->read(buffer, frame, chunk);
+        audio->append(buffer, chunk);
+        frame += chunk;
+    }
+
+    delete[] buffer;
+    return audio;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
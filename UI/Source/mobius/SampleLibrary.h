@@ -0,0 +1,130 @@
+/**
+ * Memory mapped sample files.
+ *
+ * SampleReader reads every sample file completely with WaveFile and
+ * SamplePlayer copies it again into Audio, so startup time and memory
+ * grow with the size of the sample library.  When the streamSamples
+ * option is on the shell loads samples through here instead.
+ *
+ * Each file is mapped and only the first SamplePrerollFrames are
+ * converted when the SampleManager is built.  The first time a sample
+ * is triggered it plays from that pre-roll while the library thread
+ * reads the rest of the file into a complete Audio, which SamplePlayer
+ * swaps in at the start of a block.
+ *
+ * Mapped files are kept as long as a SampleManager is using them so
+ * reloading a SampleConfig doesn't read unchanged files again.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Number of frames converted when the samples are loaded.
+ * This needs to cover the time it takes for the maintenance thread
+ * to notice the trigger and for the rest of the file to be read.
+ */
+const int SamplePrerollFrames = 32768;
+
+/**
+ * One mapped .wav file.
+ */
+class SampleSource
+{
+  public:
+
+    SampleSource(juce::File f);
+    ~SampleSource();
+
+    /**
+     * Map the file and find the sample data.
+     * Returns an error message, empty if it worked.
+     */
+    juce::String open();
+
+    /**
+     * Convert frames to interleaved stereo floats.
+     */
+    void read(float* dest, int startFrame, int frames);
+
+    juce::File file;
+    juce::Time modified;
+    int frames = 0;
+
+    // number of SampleManagers using this
+    int references = 0;
+
+  private:
+
+    std::unique_ptr<juce::MemoryMappedFile> map;
+    const unsigned char* data = nullptr;
+    int format = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    int blockAlign = 0;
+};
+
+class SampleLibrary : public juce::Thread
+{
+  public:
+
+    SampleLibrary(class AudioPool* pool);
+    ~SampleLibrary();
+
+    /**
+     * Like SampleReader::loadSamples but the Samples only have
+     * the pre-roll.  Pass the SampleManager built from this
+     * to attach().
+     */
+    class SampleConfig* loadSamples(class SampleConfig* src);
+
+    /**
+     * Start tracking the players in a SampleManager built
+     * from loadSamples before it is sent to the kernel.
+     */
+    void attach(class SampleManager* manager);
+
+    /**
+     * Called when a SampleManager comes back from the kernel,
+     * before it is deleted.  Files that are no longer used are unmapped.
+     */
+    void release(class SampleManager* manager);
+
+    /**
+     * Called by the shell maintenance thread to start reading
+     * samples that were triggered.
+     */
+    void performMaintenance();
+
+    void run() override;
+
+  private:
+
+    /**
+     * A player that needs the rest of its sample.
+     */
+    class SampleStream
+    {
+      public:
+        class SamplePlayer* player = nullptr;
+        SampleSource* source = nullptr;
+        bool started = false;
+    };
+
+    SampleSource* getSource(juce::File file);
+    void prune();
+    class Audio* readAudio(SampleSource* source);
+
+    class AudioPool* audioPool;
+    juce::CriticalSection criticalSection;
+    juce::OwnedArray<SampleSource> sources;
+    juce::OwnedArray<SampleStream> streams;
+
+    // the stream being read by the thread
+    SampleStream* reading = nullptr;
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
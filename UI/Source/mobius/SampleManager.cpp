@@ -104,14 +104,38 @@ bool SamplePlayer::isConcurrent()
 	return mConcurrent;
 }
 
+/**
+ * While streaming this is the length of the file, not what we
+ * have in memory so cursors play for the full length.
+ */
 long SamplePlayer::getFrames()
 {
-	long frames = 0;
-	if (mAudio != nullptr)
+	long frames = mStreamFrames;
+	if (frames == 0 && mAudio != nullptr)
 	  frames = mAudio->getFrames();
 	return frames;
 }
 
+void SamplePlayer::setStreamFrames(long frames)
+{
+    mStreamFrames = frames;
+}
+
+bool SamplePlayer::isStreaming()
+{
+    return (mStreamFrames > 0);
+}
+
+bool SamplePlayer::isStreamWanted()
+{
+    return mStreamWanted;
+}
+
+void SamplePlayer::setStreamAudio(Audio* a)
+{
+    mStreamAudio = a;
+}
+
 /**
  * Incorporate changes made to the global configuration.
  * Trying to avoid a Mobius dependency here so pass in what we need.
@@ -139,6 +163,10 @@ void SamplePlayer::updateConfiguration(int inputLatency, int outputLatency)
  */
 void SamplePlayer::trigger(bool down)
 {
+    // first use of a streaming sample, SampleLibrary will
+    // read the rest of it while we play the pre-roll
+    if (down && mStreamFrames > 0)
+      mStreamWanted = true;
 
 	// !! still having the auto-repeat problem with non-sustained
 	// concurrent samples
@@ -190,6 +218,17 @@ void SamplePlayer::trigger(bool down)
  */
 void SamplePlayer::play(float* inbuf, float* outbuf, long frames)
 {
+    // pick up the rest of a streaming sample, cursors get the
+    // Audio from us every block and the start of it is the same
+    if (mStreamFrames > 0) {
+        Audio* streamed = mStreamAudio.exchange(nullptr);
+        if (streamed != nullptr) {
+            mPreroll = mAudio;
+            mAudio = streamed;
+            mStreamFrames = 0;
+        }
+    }
+
     // process triggers
     while (mTriggerHead != mTriggerTail) {
         SampleTrigger* t = &mTriggers[mTriggerHead++];
@@ -342,6 +381,7 @@ void SampleCursor::setSample(SamplePlayer* s)
     mStop = false;
     mStopped = false;
     mMaxFrames = 0;
+    mStarved = false;
 
     if (mRecord != nullptr) {
         // we're a play cursor
@@ -394,8 +434,7 @@ void SampleCursor::stop()
 {
     if (!mStop) {
 		long maxFrames = 0;
-        Audio* audio = mSample->getAudio();
-		long sampleFrames = audio->getFrames();
+		long sampleFrames = mSample->getFrames();
 		maxFrames = mFrame + AudioFade::getRange();
 		if (maxFrames >= sampleFrames) {
 			// must play to the end assume it has been trimmed
@@ -475,20 +514,20 @@ void SampleCursor::play(float* outbuf, long frames)
 			mAudioCursor->setAudio(audio);
 			mAudioCursor->setFrame(mFrame);
 
-            long sampleFrames = audio->getFrames();
+            long sampleFrames = mSample->getFrames();
             if (mMaxFrames > 0)
               sampleFrames = mMaxFrames;
             
             long lastBufferFrame = mFrame + frames - 1;
             if (lastBufferFrame < sampleFrames) {
-				mAudioCursor->get(&b);
+				get(&b, audio);
                 mFrame += frames;
             }
             else {
                 long avail = sampleFrames - mFrame;
                 if (avail > 0) {
 					b.frames = avail;
-					mAudioCursor->get(&b);
+					get(&b, audio);
                     mFrame += avail;
                 }
 
@@ -513,7 +552,7 @@ void SampleCursor::play(float* outbuf, long frames)
                     mMaxFrames = 0;
                     mFrame = 0;
 
-                    sampleFrames = audio->getFrames();
+                    sampleFrames = mSample->getFrames();
                     if (sampleFrames < remainder) {
                         // sample is less than the buffer size?
                         // shouldn't happen, handling this would make this
@@ -525,7 +564,7 @@ void SampleCursor::play(float* outbuf, long frames)
 					b.buffer = outbuf;
 					b.frames = remainder;
 					mAudioCursor->setFrame(mFrame);
-					mAudioCursor->get(&b);
+					get(&b, audio);
                     mFrame += remainder;
                 }
             }
@@ -533,6 +572,32 @@ void SampleCursor::play(float* outbuf, long frames)
     }
 }
 
+/**
+ * Get frames from the cursor at mFrame.
+ * A streaming sample may not have been read this far yet if
+ * it was triggered right after loading, the rest of the block
+ * is left empty rather than waiting on the file.
+ */
+void SampleCursor::get(AudioBuffer* b, Audio* audio)
+{
+    long available = audio->getFrames() - mFrame;
+    if (b->frames <= available) {
+        mAudioCursor->get(b);
+    }
+    else {
+        if (!mStarved) {
+            Trace(1, "SampleCursor: Sample not read in time\n");
+            mStarved = true;
+        }
+        if (available > 0) {
+            long frames = b->frames;
+            b->frames = available;
+            mAudioCursor->get(b);
+            b->frames = frames;
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // SampleManager
@@ -21,6 +21,7 @@
 #pragma once
 
 //#include <stdio.h>
+#include <atomic>
 
 #include "../model/SampleConfig.h"
 #include "../model/DynamicConfig.h"
@@ -118,6 +119,20 @@ class SamplePlayer
     bool isButton() {
         return mButton;
     }
+
+    //
+    // Streaming, see SampleLibrary
+    //
+
+    // set by the shell when the Audio has only the start of the sample
+    void setStreamFrames(long frames);
+    bool isStreaming();
+
+    // true once a streaming sample has been triggered
+    bool isStreamWanted();
+
+    // called by the SampleLibrary thread with the complete Audio
+    void setStreamAudio(class Audio* a);
     
   protected:
 
@@ -197,6 +212,32 @@ class SamplePlayer
     bool mDown;
 
     bool mButton = false;
+
+    /**
+     * When the sample is being streamed, the length of the complete
+     * sample.  mAudio has only the pre-roll until the complete Audio
+     * is swapped in, then this goes back to zero.
+     */
+    long mStreamFrames = 0;
+
+    /**
+     * Set on the first trigger of a streaming sample so the
+     * SampleLibrary knows to read the rest.
+     */
+    std::atomic<bool> mStreamWanted {false};
+
+    /**
+     * The complete Audio, left here by the SampleLibrary thread
+     * and swapped in at the start of the next block.
+     */
+    std::atomic<class Audio*> mStreamAudio {nullptr};
+
+    /**
+     * The pre-roll Audio after the complete one was swapped in.
+     * A cursor may still be using it during that block so it is
+     * kept until we're deleted by the shell.
+     */
+    class Audio* mPreroll = nullptr;
     
 };
 
@@ -241,6 +282,7 @@ class SampleCursor
 
     void init();
 	void stop(long maxFrames);
+    void get(class AudioBuffer* b, class Audio* audio);
 
     SampleCursor* mNext;
     // this cursor is used when injecting audio into the input buffers??
@@ -264,6 +306,13 @@ class SampleCursor
 	 */
 	long mMaxFrames;
 
+    /**
+     * True after we've run past the end of the pre-roll of a streaming
+     * sample before the rest was read.  Only used to avoid
+     * tracing every block.
+     */
+    bool mStarved;
+
 };
 
 //////////////////////////////////////////////////////////////////////
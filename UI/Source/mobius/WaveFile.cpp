@@ -957,6 +957,11 @@ void WaveFile::write16(FILE* fp, myuint16 value)
 /**
  * Write a block of frames.  A call to writeStart must
  * have been made first.
+ *
+ * This used to write one sample at a time which is one fwrite
+ * per sample.  Floats are now written in one call and PCM is
+ * converted in chunks.  Byte swapping still happens a sample
+ * at a time, but nothing we run on needs it.
  */
 int WaveFile::write(float* buffer, long frames)
 {
@@ -964,21 +969,41 @@ int WaveFile::write(float* buffer, long frames)
 		if (mHandle == NULL)
 		  mError = AUF_ERROR_NO_OUTPUT_FILE;
 		else {
-			int samples = frames * mChannels;
+			long samples = frames * mChannels;
+#ifdef __BIG_ENDIAN__
 			if (mFormat == WAV_FORMAT_PCM) {
-				for (int i = 0 ; i < samples ; i++) {
+				for (long i = 0 ; i < samples ; i++) {
 					float sample = buffer[i];
 					myint16 isample = toInt16(sample);
 					write16(mHandle, isample);
 				}
 			}
 			else {
-				// foo, would be simpler just to blast out the entire block
-				for (int i = 0 ; i < samples ; i++) {
+				for (long i = 0 ; i < samples ; i++) {
 					float sample = buffer[i];
 					writeFloat(mHandle, sample);
 				}
 			}
+#else
+			if (mFormat == WAV_FORMAT_PCM) {
+				myint16 pcm[WAVE_WRITE_CHUNK];
+				long i = 0;
+				while (i < samples && !mError) {
+					long chunk = samples - i;
+					if (chunk > WAVE_WRITE_CHUNK)
+					  chunk = WAVE_WRITE_CHUNK;
+					for (long j = 0 ; j < chunk ; j++)
+					  pcm[j] = toInt16(buffer[i + j]);
+					if (fwrite(pcm, sizeof(myint16), chunk, mHandle) != (size_t)chunk)
+					  mError = AUF_ERROR_OUTPUT_FILE;
+					i += chunk;
+				}
+			}
+			else {
+				if (fwrite(buffer, sizeof(float), samples, mHandle) != (size_t)samples)
+				  mError = AUF_ERROR_OUTPUT_FILE;
+			}
+#endif
         }
     }
 
@@ -41,6 +41,11 @@
 #define AUF_ERROR_NO_INPUT_FILE 13
 #define AUF_ERROR_NO_OUTPUT_FILE 14
 
+/**
+ * Number of samples converted at a time when writing PCM.
+ */
+#define WAVE_WRITE_CHUNK 4096
+
 class WaveFile {
 
   public:
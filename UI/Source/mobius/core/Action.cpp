@@ -104,6 +104,7 @@ void Action::init()
     escapeQuantization = false;
     noLatency = false;
     noSynchronization = false;
+    blockOffset = 0;
 
     // Arguments
     bindingArgs[0] = 0;
@@ -234,6 +235,7 @@ void Action::clone(Action* src)
     escapeQuantization = src->escapeQuantization;
     noLatency = src->noLatency;
     noSynchronization = src->noSynchronization;
+    blockOffset = src->blockOffset;
 
     // Arguments
     strcpy(bindingArgs, src->bindingArgs);
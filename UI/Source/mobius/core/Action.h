@@ -227,6 +227,12 @@ class Action {
      */
     bool noSynchronization;
 
+    /**
+     * Frames into the block where the trigger happened.
+     * Added to the event frame along with input latency.
+     */
+    long blockOffset;
+
     //////////////////////////////////////////////////////////////////////
     // Arguments
     //////////////////////////////////////////////////////////////////////
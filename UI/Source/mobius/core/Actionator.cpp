@@ -38,6 +38,7 @@ Actionator::Actionator(Mobius* m)
     mTriggerState = new TriggerState();
     mFunctionMap = nullptr;
     mParameterMap = nullptr;
+    mBlockTime = 0.0;
 
     // safe to do this in the constructor?
     // we need to do it during structure initialization because
@@ -316,14 +317,25 @@ void Actionator::completeAction(Action* a)
  * The doAction() method below is called by a small number of internal
  * components that manufacture actions as a side effect of something other
  * than a trigger.
+ *
+ * Actions with a timestamp are placed within the block.  They arrived
+ * some time between the last block and this one, so that span is mapped
+ * onto this block the same way MidiQueue places sync events.  They are
+ * all a block late but keep their spacing.
  */
 void Actionator::doInterruptActions(UIAction* actions, long frames)
 {
+    double blockStart = mBlockTime;
+    mBlockTime = juce::Time::getMillisecondCounterHiRes();
+
     // we do not delete these, they are converted to Action
     // and may have results in them, but the caller owns them
     UIAction* action = actions;
     while (action != nullptr) {
-        doCoreAction(action);
+        long offset = 0;
+        if (action->timestamp > 0.0)
+          offset = getBlockOffset(action->timestamp, blockStart, frames);
+        doCoreAction(action, offset);
         action = action->next;
     }
 
@@ -332,6 +344,24 @@ void Actionator::doInterruptActions(UIAction* actions, long frames)
     mTriggerState->advance(this, frames);
 }
 
+/**
+ * Convert a trigger time into a frame within this block.
+ * The first block has nothing to measure from and uses the start.
+ */
+long Actionator::getBlockOffset(double time, double blockStart, long frames)
+{
+    long offset = 0;
+    double blockLength = mBlockTime - blockStart;
+    if (blockStart > 0.0 && blockLength > 0.0 && frames > 0) {
+        offset = (long)(((time - blockStart) / blockLength) * frames);
+        if (offset < 0)
+          offset = 0;
+        else if (offset >= frames)
+          offset = frames - 1;
+    }
+    return offset;
+}
+
 /**
  * We're bypassing some of the old logic with Mobius::doAction
  * that validated various things, and decided whether or not
@@ -347,7 +377,7 @@ void Actionator::doInterruptActions(UIAction* actions, long frames)
  * call Mobius::freeAction because ownership may have transferreed
  * to an Event.
  */
-void Actionator::doCoreAction(UIAction* action)
+void Actionator::doCoreAction(UIAction* action, long blockOffset)
 {
     Action* coreAction = nullptr;
     
@@ -405,6 +435,7 @@ void Actionator::doCoreAction(UIAction* action)
     }
 
     if (coreAction != nullptr) {
+        coreAction->blockOffset = blockOffset;
         doActionNow(coreAction);
         completeAction(coreAction);
     }
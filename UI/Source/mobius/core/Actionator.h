@@ -45,6 +45,9 @@ class Actionator
     class ActionPool* mActionPool;
     class TriggerState* mTriggerState;
 
+    // high resolution time of the last doInterruptActions
+    double mBlockTime;
+
     // UI to core Function mapping
     // std::vector<class Function*> functionMap;
     // !! has the dynamic growth problem, not so bad
@@ -58,7 +61,8 @@ class Actionator
     void initFunctionMap();
     void initParameterMap();
     
-    void doCoreAction(UIAction* action);
+    void doCoreAction(UIAction* action, long blockOffset);
+    long getBlockOffset(double time, double blockStart, long frames);
 
     void doPreset(class Action* a);
     void doSetup(class Action* a);
@@ -0,0 +1,204 @@
+/**
+ * Audio interrupt timing, see BlockProfiler.h
+ */
+
+#include <JuceHeader.h>
+
+#include "../../model/MobiusState.h"
+
+#include "BlockProfiler.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// ProfileHistogram
+//
+//////////////////////////////////////////////////////////////////////
+
+ProfileHistogram::ProfileHistogram()
+{
+    reset();
+}
+
+void ProfileHistogram::reset()
+{
+    for (int i = 0 ; i < ProfileBuckets ; i++)
+      buckets[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Times under 4 microseconds get their own buckets, after that
+ * the top bit is the octave and the next two bits divide it.
+ */
+int ProfileHistogram::getBucket(int micros)
+{
+    int bucket = 0;
+    if (micros < 4) {
+        if (micros > 0)
+          bucket = micros;
+    }
+    else {
+        int octave = juce::findHighestSetBit((juce::uint32)micros);
+        int sub = (micros >> (octave - 2)) & 3;
+        bucket = (octave * 4) + sub;
+    }
+    return bucket;
+}
+
+/**
+ * The largest time that falls in a bucket.
+ */
+int ProfileHistogram::getBucketLimit(int bucket)
+{
+    juce::int64 limit = bucket;
+    if (bucket >= 4) {
+        int octave = bucket / 4;
+        int sub = bucket % 4;
+        limit = ((juce::int64)(5 + sub) << (octave - 2)) - 1;
+    }
+    return (int)juce::jmin(limit, (juce::int64)INT_MAX);
+}
+
+void ProfileHistogram::add(int micros)
+{
+    buckets[getBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    // there is only one writer for each histogram so this doesn't
+    // need to be a compare and swap
+    if (micros > max.load(std::memory_order_relaxed))
+      max.store(micros, std::memory_order_relaxed);
+}
+
+int ProfileHistogram::getCount()
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+int ProfileHistogram::getMax()
+{
+    return max.load(std::memory_order_relaxed);
+}
+
+/**
+ * Return the upper limit of the bucket containing the percentile,
+ * but never more than the actual maximum.
+ */
+int ProfileHistogram::getPercentile(int percent)
+{
+    int result = 0;
+    int total = getCount();
+    if (total > 0) {
+        int target = ((total * percent) + 99) / 100;
+        int seen = 0;
+        for (int i = 0 ; i < ProfileBuckets ; i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                result = getBucketLimit(i);
+                break;
+            }
+        }
+        result = juce::jmin(result, getMax());
+    }
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// BlockProfiler
+//
+//////////////////////////////////////////////////////////////////////
+
+BlockProfiler::BlockProfiler()
+{
+    mMicrosPerTick = 1000000.0 / (double)juce::Time::getHighResolutionTicksPerSecond();
+    mBlockStart = 0;
+    mWindowFrames = 0;
+    mOverruns = 0;
+}
+
+BlockProfiler::~BlockProfiler()
+{
+}
+
+int BlockProfiler::toMicros(juce::int64 ticks)
+{
+    return (int)(ticks * mMicrosPerTick);
+}
+
+void BlockProfiler::startBlock()
+{
+    mBlockStart = now();
+}
+
+juce::int64 BlockProfiler::mark(ProfilePhase phase, juce::int64 start)
+{
+    juce::int64 end = now();
+    mPhases[phase].add(toMicros(end - start));
+    return end;
+}
+
+void BlockProfiler::addTrack(int track, juce::int64 ticks)
+{
+    if (track >= 0 && track < MobiusStateMaxTracks)
+      mTracks[track].add(toMicros(ticks));
+}
+
+/**
+ * Time the whole block, and if we've seen about a second of audio
+ * reduce the histograms and start a new window.
+ */
+void BlockProfiler::endBlock(long frames, int sampleRate)
+{
+    if (sampleRate > 0 && mBlockStart != 0) {
+        int micros = toMicros(now() - mBlockStart);
+        mPhases[ProfileBlock].add(micros);
+
+        int deadline = (int)(((juce::int64)frames * 1000000) / sampleRate);
+        if (micros > deadline)
+          mOverruns++;
+
+        mWindowFrames += frames;
+        if (mWindowFrames >= sampleRate) {
+            closeWindow(deadline);
+            mWindowFrames = 0;
+        }
+    }
+}
+
+void BlockProfiler::closeWindow(int deadline)
+{
+    for (int i = 0 ; i < ProfilePhaseCount ; i++)
+      reduce(&(mPhases[i]), &(mResults.phases[i]));
+
+    for (int i = 0 ; i < MobiusStateMaxTracks ; i++)
+      reduce(&(mTracks[i]), &(mResults.tracks[i]));
+
+    MobiusTimingState* block = &(mResults.phases[ProfileBlock]);
+    mResults.deadline = deadline;
+    if (deadline > 0) {
+        mResults.utilization50 = (block->p50 * 100) / deadline;
+        mResults.utilization99 = (block->p99 * 100) / deadline;
+        mResults.utilizationMax = (block->max * 100) / deadline;
+    }
+    mResults.overruns = mOverruns;
+    mResults.window++;
+}
+
+void BlockProfiler::reduce(ProfileHistogram* h, MobiusTimingState* state)
+{
+    state->p50 = h->getPercentile(50);
+    state->p99 = h->getPercentile(99);
+    state->max = h->getMax();
+    h->reset();
+}
+
+void BlockProfiler::getState(MobiusProfileState* state)
+{
+    *state = mResults;
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -0,0 +1,112 @@
+/**
+ * Low overhead timing of the audio interrupt.
+ *
+ * Each phase of the interrupt and each track is timed with the high
+ * resolution counter and the result is dropped into a histogram.
+ * About once a second of audio the histograms are reduced to p50,
+ * p99, and max and left in a MobiusProfileState that Mobius copies
+ * into every MobiusState it publishes, then they start over.
+ *
+ * The histograms are written by the audio thread and by TrackRenderer
+ * workers, each track only ever has one writer in a block.  Buckets are
+ * atomic counters so nothing here waits.  Only the audio thread closes
+ * a window, which happens after the workers are finished.
+ *
+ * Recording a time is one counter read and a few integer operations
+ * so this is always on.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <JuceHeader.h>
+
+#include "../../model/MobiusState.h"
+
+/**
+ * Histogram buckets.  Times are in microseconds with four buckets
+ * per octave, which covers 2^32 microseconds with about 20% error.
+ */
+const int ProfileBuckets = 128;
+
+class ProfileHistogram
+{
+  public:
+
+    ProfileHistogram();
+
+    void add(int micros);
+    void reset();
+
+    int getCount();
+    int getMax();
+    int getPercentile(int percent);
+
+  private:
+
+    static int getBucket(int micros);
+    static int getBucketLimit(int bucket);
+
+    std::atomic<int> buckets[ProfileBuckets];
+    std::atomic<int> count;
+    std::atomic<int> max;
+};
+
+class BlockProfiler
+{
+  public:
+
+    BlockProfiler();
+    ~BlockProfiler();
+
+    static juce::int64 now() {
+        return juce::Time::getHighResolutionTicks();
+    }
+
+    /**
+     * Called by the kernel when the block begins.
+     */
+    void startBlock();
+
+    /**
+     * Record the time since start for a phase and return
+     * the current time so phases can be chained.
+     */
+    juce::int64 mark(ProfilePhase phase, juce::int64 start);
+
+    /**
+     * Record the time spent in one track.
+     */
+    void addTrack(int track, juce::int64 ticks);
+
+    /**
+     * Called by Mobius at the end of the block.
+     */
+    void endBlock(long frames, int sampleRate);
+
+    /**
+     * Copy the results of the last window.
+     */
+    void getState(MobiusProfileState* state);
+
+  private:
+
+    int toMicros(juce::int64 ticks);
+    void closeWindow(int deadline);
+    void reduce(ProfileHistogram* h, MobiusTimingState* state);
+
+    double mMicrosPerTick;
+    juce::int64 mBlockStart;
+    long mWindowFrames;
+    int mOverruns;
+
+    ProfileHistogram mPhases[ProfilePhaseCount];
+    ProfileHistogram mTracks[MobiusStateMaxTracks];
+
+    MobiusProfileState mResults;
+
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
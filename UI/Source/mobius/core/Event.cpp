@@ -342,6 +342,13 @@ void Event::init()
 	mParent		= NULL;
 	mChildren	= NULL;
 	mSibling	= NULL;
+	mPrev		= NULL;
+	mLane		= EVENT_LANE_NONE;
+	mIndexFrame	= 0;
+	mSequence	= 0;
+	mPriority	= 0;
+	mLeft		= NULL;
+	mRight		= NULL;
 	mPresetValid = false;
 	mScript     = NULL;
     mAction     = NULL;
@@ -575,6 +582,32 @@ Function* Event::getInvokingFunction()
     return f;
 }
 
+/**
+ * The fields are public and were historically just assigned.
+ * Once the event is in an indexed list it has to be repositioned
+ * when any of the fields that determine its place change.
+ */
+void Event::setFrame(long f)
+{
+    frame = f;
+    if (mList != NULL)
+      mList->index(this);
+}
+
+void Event::setPending(bool b)
+{
+    pending = b;
+    if (mList != NULL)
+      mList->index(this);
+}
+
+void Event::setImmediate(bool b)
+{
+    immediate = b;
+    if (mList != NULL)
+      mList->index(this);
+}
+
 /**
  * Make a copy of the current preset parameter values. 
  * Leave the copy around so we gradually have one for all events in 
@@ -634,7 +667,7 @@ void Event::addChild(Event* e)
 	// this is now happening when we stack events under a SwitchEvent
 	// probably not necessary but make them consistent
 	if (pending && !e->pending)
-	  e->pending = true;
+	  e->setPending(true);
 
 	if (e != NULL) {
 		// order these for undo and display
@@ -862,6 +895,22 @@ void Event::cancelScriptWait()
 EventList::EventList()
 {
     mEvents = NULL;
+    mLast = NULL;
+    mIndexed = false;
+    mSequence = 0;
+    mRandom = 0x9E3779B9;
+    mTimed = NULL;
+    mImmediate = NULL;
+    mPending = NULL;
+}
+
+/**
+ * Only the list EventManager uses for scheduled events is indexed.
+ * The pool and the sync event lists don't need it.
+ */
+EventList::EventList(bool indexed) : EventList()
+{
+    mIndexed = indexed;
 }
 
 EventList::~EventList()
@@ -913,11 +962,20 @@ EventList* EventList::transfer()
 {
 	EventList* list = NEW(EventList);
 
-	for (Event* e = mEvents ; e != NULL ; e = e->getNext())
-	  e->setList(list);
+	for (Event* e = mEvents ; e != NULL ; e = e->getNext()) {
+        e->setList(list);
+        e->mLane = EVENT_LANE_NONE;
+        e->mLeft = NULL;
+        e->mRight = NULL;
+    }
 
 	list->mEvents = mEvents;
+	list->mLast = mLast;
 	mEvents = NULL;
+	mLast = NULL;
+	mTimed = NULL;
+	mImmediate = NULL;
+	mPending = NULL;
 
 	return list;
 }
@@ -940,16 +998,24 @@ void EventList::add(Event* event)
             Trace(1, "Attempt to add an event already on another list!\n");
         }
 		else {
-			Event* last = NULL;
-			for (last = mEvents ; last != NULL && last->getNext() != NULL ; 
-				 last = last->getNext());
-
-			if (last != NULL)
-			  last->setNext(event);
+			if (mLast != NULL)
+			  mLast->setNext(event);
 			else
 			  mEvents = event;
 
+			event->mPrev = mLast;
+			mLast = event;
 			event->setList(this);
+
+			event->mSequence = mSequence++;
+			if (mIndexed) {
+                // xorshift, the priorities only need to look random
+                mRandom ^= mRandom << 13;
+                mRandom ^= mRandom >> 17;
+                mRandom ^= mRandom << 5;
+                event->mPriority = mRandom;
+                index(event);
+            }
 		}
 	}
 }
@@ -973,16 +1039,24 @@ void EventList::insert(Event* event)
                   prev = e;
             }   
 
-            if (prev != NULL) {
-                event->setNext(prev->getNext());
-                prev->setNext(event);
-            }
-            else {
-                event->setNext(mEvents);
-                mEvents = event;
-            }
+            Event* next = (prev != NULL) ? prev->getNext() : mEvents;
+            event->setNext(next);
+            event->mPrev = prev;
+            if (next != NULL)
+              next->mPrev = event;
+            else
+              mLast = event;
+            if (prev != NULL)
+              prev->setNext(event);
+            else
+              mEvents = event;
 
             event->setList(this);
+
+            // this is only used for the sync event lists, if it were
+            // indexed the sequence would not match the list order
+            if (mIndexed)
+              Trace(1, "EventList: Frame insert into an indexed list!\n");
         }
     }
 }
@@ -993,22 +1067,23 @@ void EventList::insert(Event* event)
  */
 void EventList::remove(Event* event)
 {
-	if (event != NULL) {
-		Event* prev = NULL;
-		Event* e;
-
-		for (e = mEvents ; e != NULL && e != event ; e = e->getNext())
-		  prev = e;
+	if (event != NULL && event->getList() == this) {
+		unindex(event);
 
-		if (e == event) {
-			if (prev == NULL)
-			  mEvents = e->getNext();
-			else 
-			  prev->setNext(e->getNext());
+		Event* prev = event->mPrev;
+		Event* next = event->getNext();
+		if (prev == NULL)
+		  mEvents = next;
+		else 
+		  prev->setNext(next);
+		if (next == NULL)
+		  mLast = prev;
+		else
+		  next->mPrev = prev;
 
-			e->setList(NULL);
-			e->setNext(NULL);
-		}
+		event->setList(NULL);
+		event->setNext(NULL);
+		event->mPrev = NULL;
 	}
 }
 
@@ -1017,29 +1092,43 @@ void EventList::remove(Event* event)
  */
 bool EventList::contains(Event* event)
 {
-	bool contains = false;
-
-	for (Event* e = mEvents ; e != NULL ; e = e->getNext()) {
-		if (e == event) {
-			contains = true;
-			break;
-		}
-	}
-	return contains;
+	return (event != NULL && event->getList() == this);
 }
 
 /**
  * Return the first event on a frame.
+ * When indexed the timed lane has the first ordinary event on the
+ * frame, but a pending or immediate event with the same frame may
+ * have been added before it.  Those lanes are short.
  */
 Event* EventList::find(long frame)
 {
 	Event* event = NULL;
-	for (Event* e = mEvents ; e != NULL ; e = e->getNext()) {
-		if (e->frame == frame) {
-			event = e;
-			break;
-		}
-	}
+    if (mIndexed) {
+        event = getTimed(frame);
+        if (event != NULL && event->mIndexFrame != frame)
+          event = NULL;
+
+        for (int i = 0 ; i < 2 ; i++) {
+            EventLane lane = (i == 0) ? EVENT_LANE_IMMEDIATE : EVENT_LANE_PENDING;
+            for (Event* e = getFirst(lane) ; e != NULL ; e = getNextInLane(e)) {
+                if (event != NULL && e->mSequence > event->mSequence)
+                  break;
+                else if (e->frame == frame) {
+                    event = e;
+                    break;
+                }
+            }
+        }
+    }
+    else {
+        for (Event* e = mEvents ; e != NULL ; e = e->getNext()) {
+            if (e->frame == frame) {
+                event = e;
+                break;
+            }
+        }
+    }
 	return event;	
 }
 
@@ -1101,9 +1190,209 @@ Event* EventList::steal()
 {
     Event* stolen = mEvents;
     mEvents = nullptr;
+    mLast = nullptr;
     return stolen;
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                                FRAME INDEX                               *
+ *                                                                          *
+ ****************************************************************************/
+
+Event** EventList::getLane(EventLane lane)
+{
+    Event** root = NULL;
+    if (lane == EVENT_LANE_TIMED)
+      root = &mTimed;
+    else if (lane == EVENT_LANE_IMMEDIATE)
+      root = &mImmediate;
+    else if (lane == EVENT_LANE_PENDING)
+      root = &mPending;
+    return root;
+}
+
+/**
+ * Lane ordering.  Timed events are ordered by the frame they were
+ * indexed with, then by addition order which is what
+ * EventManager::getNextScheduledEvent expects for events on the
+ * same frame.  The other lanes are just addition order.
+ */
+bool EventList::isBefore(Event* e1, Event* e2)
+{
+    if (e1->mLane == EVENT_LANE_TIMED && e1->mIndexFrame != e2->mIndexFrame)
+      return (e1->mIndexFrame < e2->mIndexFrame);
+    else
+      return (e1->mSequence < e2->mSequence);
+}
+
+/**
+ * Join two trees where everything in the left tree is
+ * before everything in the right.
+ */
+Event* EventList::merge(Event* left, Event* right)
+{
+    Event* root = NULL;
+    if (left == NULL)
+      root = right;
+    else if (right == NULL)
+      root = left;
+    else if (left->mPriority >= right->mPriority) {
+        left->mRight = merge(left->mRight, right);
+        root = left;
+    }
+    else {
+        right->mLeft = merge(left, right->mLeft);
+        root = right;
+    }
+    return root;
+}
+
+/**
+ * Divide a tree into the events before and after the given event.
+ */
+void EventList::split(Event* root, Event* e, Event** left, Event** right)
+{
+    if (root == NULL) {
+        *left = NULL;
+        *right = NULL;
+    }
+    else if (isBefore(root, e)) {
+        split(root->mRight, e, &(root->mRight), right);
+        *left = root;
+    }
+    else {
+        split(root->mLeft, e, left, &(root->mLeft));
+        *right = root;
+    }
+}
+
+/**
+ * Put an event in the lane its flags say it belongs in, or move it
+ * if the lane or frame changed since it was last indexed.
+ */
+void EventList::index(Event* e)
+{
+    if (mIndexed) {
+        EventLane lane = EVENT_LANE_TIMED;
+        if (e->pending)
+          lane = EVENT_LANE_PENDING;
+        else if (e->immediate)
+          lane = EVENT_LANE_IMMEDIATE;
+
+        if (lane != e->mLane ||
+            (lane == EVENT_LANE_TIMED && e->frame != e->mIndexFrame)) {
+
+            unindex(e);
+            e->mLane = lane;
+            e->mIndexFrame = e->frame;
+
+            // descend until the priority fits, then the subtree
+            // there is divided around the new event
+            Event** link = getLane(lane);
+            while (*link != NULL && (*link)->mPriority >= e->mPriority) {
+                if (isBefore(e, *link))
+                  link = &((*link)->mLeft);
+                else
+                  link = &((*link)->mRight);
+            }
+            split(*link, e, &(e->mLeft), &(e->mRight));
+            *link = e;
+        }
+    }
+}
+
+void EventList::unindex(Event* e)
+{
+    if (e->mLane != EVENT_LANE_NONE) {
+        Event** link = getLane(e->mLane);
+        while (*link != NULL && *link != e) {
+            if (isBefore(e, *link))
+              link = &((*link)->mLeft);
+            else
+              link = &((*link)->mRight);
+        }
+
+        if (*link == e)
+          *link = merge(e->mLeft, e->mRight);
+        else
+          Trace(1, "EventList: Event missing from the frame index!\n");
+
+        e->mLane = EVENT_LANE_NONE;
+        e->mLeft = NULL;
+        e->mRight = NULL;
+    }
+}
+
+/**
+ * The first event in a lane.
+ */
+Event* EventList::getFirst(EventLane lane)
+{
+    Event* first = NULL;
+    Event** root = getLane(lane);
+    if (root != NULL) {
+        for (first = *root ; first != NULL && first->mLeft != NULL ;
+             first = first->mLeft);
+    }
+    return first;
+}
+
+/**
+ * The first timed event on or after a frame.
+ */
+Event* EventList::getTimed(long frame)
+{
+    Event* found = NULL;
+    Event* e = mTimed;
+    while (e != NULL) {
+        if (e->mIndexFrame >= frame) {
+            found = e;
+            e = e->mLeft;
+        }
+        else {
+            e = e->mRight;
+        }
+    }
+    return found;
+}
+
+/**
+ * The event following this one in its lane.
+ */
+Event* EventList::getNextInLane(Event* event)
+{
+    Event* next = NULL;
+    if (event->getList() == this && event->mLane != EVENT_LANE_NONE) {
+        Event* e = *(getLane(event->mLane));
+        while (e != NULL) {
+            if (isBefore(event, e)) {
+                next = e;
+                e = e->mLeft;
+            }
+            else {
+                e = e->mRight;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * Move every event that isn't pending by the same amount.
+ * The order doesn't change so the index is adjusted in place.
+ */
+void EventList::offsetFrames(long delta)
+{
+    for (Event* e = mEvents ; e != NULL ; e = e->getNext()) {
+        if (!e->pending) {
+            e->frame += delta;
+            if (e->mLane == EVENT_LANE_TIMED)
+              e->mIndexFrame += delta;
+        }
+    }
+}
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
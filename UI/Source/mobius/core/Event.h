@@ -214,6 +214,20 @@ typedef enum {
 
 extern const char* GetSyncPulseTypeName(SyncPulseType type);
 
+/**
+ * The lanes of an indexed EventList.  Events that are neither pending
+ * nor immediate are ordered by frame, the others are kept in the order
+ * they were added.
+ */
+typedef enum {
+
+	EVENT_LANE_NONE,
+	EVENT_LANE_TIMED,
+	EVENT_LANE_IMMEDIATE,
+	EVENT_LANE_PENDING
+
+} EventLane;
+
 /**
  * An event to be processed by the interrupt handler.
  *
@@ -309,6 +323,12 @@ class Event {
     void setInvokingFunction(class Function* f);
     class Function* getInvokingFunction();
 
+    // use these rather than assigning the fields once the event
+    // may be scheduled, they keep the EventList frame index current
+    void setFrame(long f);
+    void setPending(bool b);
+    void setImmediate(bool b);
+
 	//
 	// Common Fields
 	//
@@ -659,6 +679,24 @@ class Event {
 	 */
 	Event* mSibling;
 
+	/**
+	 * The previous event on the list so remove doesn't have to search.
+	 */
+	Event* mPrev;
+
+	/**
+	 * Frame index state maintained by EventList.  The lane and frame
+	 * are what the event was ordered by, which may be behind the
+	 * public fields while they are being changed.  Sequence is the
+	 * addition order which breaks ties on the same frame.
+	 */
+	EventLane mLane;
+	long mIndexFrame;
+	long mSequence;
+	unsigned int mPriority;
+	Event* mLeft;
+	Event* mRight;
+
     /**
      * Private copy of the preset at the moment this event was scheduled.
      */
@@ -707,12 +745,22 @@ class Event {
 /**
  * An object that encapsulates a list of events and provides some
  * utilities for managing them.
+ *
+ * The list is in addition order.  The list used by EventManager is
+ * also indexed so the next event can be found without walking
+ * everything scheduled.  Each lane is a treap, a binary tree ordered
+ * by the lane key that stays balanced by keeping a pseudo random
+ * priority in heap order, which gives O(log n) insert, remove and
+ * search without allocating anything in the interrupt.
  */
 class EventList {
 
+    friend class Event;
+
   public:
 
     EventList();
+    EventList(bool indexed);
     ~EventList();
 
     Event* getEvents();
@@ -731,9 +779,30 @@ class EventList {
     void flush(bool reset, bool keepScriptEvents);
     Event* steal();
 
+    // frame index, these return NULL if the list is not indexed
+    Event* getFirst(EventLane lane);
+    Event* getTimed(long frame);
+    Event* getNextInLane(Event* e);
+    void offsetFrames(long delta);
+
   private:
 
+    void index(Event* e);
+    void unindex(Event* e);
+    Event** getLane(EventLane lane);
+    bool isBefore(Event* e1, Event* e2);
+    Event* merge(Event* left, Event* right);
+    void split(Event* root, Event* e, Event** left, Event** right);
+
     Event* mEvents;
+    Event* mLast;
+
+    bool mIndexed;
+    long mSequence;
+    unsigned int mRandom;
+    Event* mTimed;
+    Event* mImmediate;
+    Event* mPending;
 
 };
 
@@ -157,7 +157,7 @@
 EventManager::EventManager(Track* track)
 {
     mTrack = track;
-	mEvents = NEW(EventList);
+	mEvents = NEW1(EventList, true);
     mSwitch = NULL;
 
     // special event we can inject at sync boundaries
@@ -447,6 +447,9 @@ Event* EventManager::getFunctionEvent(Action* action,
 	// not after adding in input latency.   Interpreter will set this flag
 	int latency = (action->noLatency) ? 0 : loop->getInputStream()->latency;
 
+    // triggers placed within the block happen that much later
+    latency += action->blockOffset;
+
     // calculate the frame
 
     if (action->rescheduling != NULL) {
@@ -643,7 +646,7 @@ Event* EventManager::getFunctionEvent(Action* action,
 		}
 	}
     
-    event->frame = frame;
+    event->setFrame(frame);
 
 	// If there are any events preceeding this one whose
 	// event type indiciates that it will reschedule events,
@@ -687,7 +690,7 @@ void EventManager::shiftEvents(long frames)
 		Event* events = mEvents->getEvents();
 		for (Event* e = events ; e != NULL ; e = e->getNext()) {
 			if (!e->pending && e->frame >= frames)
-              e->frame -= frames;
+              e->setFrame(e->frame - frames);
 		}
 	}
 }
@@ -729,7 +732,7 @@ void EventManager::advanceScriptWaits(long frames)
             long loopFrame = loop->getFrame();
             if (newFrame < loopFrame)
               newFrame = loopFrame;
-            e->frame = newFrame;
+            e->setFrame(newFrame);
         }
     }
 }
@@ -758,7 +761,7 @@ void EventManager::loopSwitchScriptWaits(Loop* current, long nextFrame)
             Trace(mTrack, 2, "EventManager: rescheduling wait event frame from %ld to %ld\n",
                   e->frame, newFrame);
 
-            e->frame = newFrame;
+            e->setFrame(newFrame);
         }
         else {
             // If the event was scheduled before the switch frame
@@ -841,26 +844,15 @@ void EventManager::moveEvent(Loop* loop, Event* e, long newFrame)
     if (newFrame < 0)
       Trace(mTrack, 1, "EventManager::moveEvent frame went negative!\n");
 
-	e->frame = newFrame;
+	e->setFrame(newFrame);
 	e->latencyLoss = latencyLoss;
 }
 
 /**
  * Called when we change direction.
  * The events keep their same relative position in the new direction.
- */
-void EventManager::reverseEvents(long originalFrame, long newFrame)
-{
-    for (Event* e = mEvents->getEvents() ; e != NULL ; e = e->getNext()) {
-        if (!e->pending)
-          e->frame = reverseFrame(originalFrame, newFrame, e->frame);
-    }
-}
-
-/**
- * Perform an "event" reflection of a frame.  
- * Rather than a script reflection based on the size of the loop, this
- * one reflects to maintain the same relative distance from an origin.
+ * Since they all move by the same amount the order doesn't change
+ * and the list can adjust the frame index in place.
  *
  * !!: if this is a ScriptEvent, we may need to do a full loop reflection
  * rather than relative to the origin if the wait frame was calcualted
@@ -869,14 +861,15 @@ void EventManager::reverseEvents(long originalFrame, long newFrame)
  * Will need to use the "pending" waits instead of absolute waits if
  * you want this to work in reverse mode.
  */
-long EventManager::reverseFrame(long origin, long newOrigin, long frame)
+void EventManager::reverseEvents(long originalFrame, long newFrame)
 {
-    long delta = frame - origin;
-    if (delta < 0) {
-        // the event preceeded the current record frame, shouldn't happen
-        Trace(mTrack, 1, "EventManager: reverseEventFrame anomoly!\n");
+    for (Event* e = mEvents->getEvents() ; e != NULL ; e = e->getNext()) {
+        if (!e->pending && e->frame < originalFrame) {
+            // the event preceeded the current record frame, shouldn't happen
+            Trace(mTrack, 1, "EventManager: reverseEventFrame anomoly!\n");
+        }
     }
-    return newOrigin + delta;
+    mEvents->offsetFrames(newFrame - originalFrame);
 }
 
 /****************************************************************************
@@ -1316,7 +1309,7 @@ void EventManager::scheduleSwitchStack(Event* event)
 		// do we really need to do this?  
 		// should the preset affect all stacked events
 		event->savePreset(mTrack->getPreset());
-		event->pending = true;
+		event->setPending(true);
 
 		mTrack->enterCriticalSection("scheduleSwitchStack");
 
@@ -1825,7 +1818,7 @@ Event* EventManager::scheduleReturnEvent(Loop* loop, Event* trigger,
         // Reset so have to check the mode too
         if (loop->getFrames() == 0 && loop->getMode() == RecordMode) {
             Trace(mTrack, 2, "EventManager: Deferring return transition scheduling till end of record\n");
-            re->pending = true;
+            re->setPending(true);
             addEvent(re);
         }
         else
@@ -1858,8 +1851,8 @@ void EventManager::finishReturnEvent(Loop* loop, Event* re)
         // it will be pending if we had to wait for the initial recording
         // to finish, otherwise the frame has been set
         if (re->pending) {
-            re->frame = loop->getFrames();
-            re->pending = false;
+            re->setFrame(loop->getFrames());
+            re->setPending(false);
         }
 
         // should already be set, make sure
@@ -2159,6 +2152,48 @@ long EventManager::reflectFrame(Loop* loop, long frame)
  *                                                                          *
  ****************************************************************************/
 
+/**
+ * Return true if nothing will happen in this track during the next
+ * block of frames other than recording and playing.  Used by Mobius
+ * to decide whether the track can be rendered in parallel with others.
+ *
+ * This is conservative, it only needs to be right when it says yes.
+ * There must be no scheduled events, including pending script waits,
+ * no speed shift that makes the frame math fuzzy, and the block must
+ * not reach a subcycle, cycle or loop boundary where getNextScheduledEvent
+ * would inject a pseudo event that can resume scripts.  Sync events are
+ * checked by Mobius since those are shared by all tracks.
+ *
+ * The range uses the same one frame slop as getNextScheduledEvent.
+ */
+bool EventManager::isQuiet(long frames)
+{
+    bool quiet = false;
+    Loop* loop = mTrack->getLoop();
+    InputStream* istream = mTrack->getInputStream();
+
+    if (!hasEvents() && istream->getSpeed() == 1.0f) {
+
+        if (loop->getMode() == ResetMode) {
+            quiet = true;
+        }
+        else {
+            long startFrame = loop->getFrame();
+            long lastFrame = startFrame + frames;
+            long loopFrames = loop->getFrames();
+
+            // frame zero is a loop boundary, don't bother figuring
+            // out whether we've already done it
+            if (loopFrames > 0 && startFrame > 0 && lastFrame < loopFrames) {
+                long next = getQuantizedFrame(loop, startFrame, Preset::QUANTIZE_SUBCYCLE, false);
+                quiet = (next < startFrame || next > lastFrame);
+            }
+        }
+    }
+
+    return quiet;
+}
+
 /**
  * Return the next event in this track.
  */
@@ -2323,25 +2358,36 @@ Event* EventManager::getNextScheduledEvent(int availFrames,
 	long startFrame = loop->getFrame();
 	long lastFrame = startFrame + availFrames;
 
-	// look for pending script events that happen at the loop boundary
-	Event* pendingScript = NULL;
+	// Locate the first event marked "immediate", or the event nearest
+	// to the startFrame.  The list keeps these in separate lanes,
+	// timed events are ordered by frame then by the order they were
+	// scheduled.  When paused only events that allow it are considered.
+    bool paused = loop->isPaused();
+
+    for (Event* e = mEvents->getFirst(EVENT_LANE_IMMEDIATE) ; e != NULL ;
+         e = mEvents->getNextInLane(e)) {
+        if (!paused || e->pauseEnabled) {
+            event = e;
+            break;
+        }
+    }
 
-	// Locate the event nearest to the startFrame, or the first
-	// event marked "immediate"
+    if (event == NULL) {
+        for (Event* e = mEvents->getTimed(startFrame) ;
+             e != NULL && e->frame <= lastFrame ;
+             e = mEvents->getNextInLane(e)) {
 
-    for (Event* e = mEvents->getEvents() ; e != NULL ; e = e->getNext()) {
-        if ((!loop->isPaused() || e->pauseEnabled) &&
-            !e->pending && 
-			(e->immediate ||
-			 (e->frame >= startFrame && e->frame <= lastFrame))) {
-			// within range
-			if (event == NULL || e->immediate || e->frame < event->frame) {
-				event = e;
-				// stop on the first immediate event
-				if (e->immediate)
-				  break;
-			}
-			else if (e->getParent() == event && e->frame == event->frame) {
+            if (paused && !e->pauseEnabled) {
+                // keep looking
+            }
+            else if (event == NULL) {
+                event = e;
+            }
+            else if (e->frame != event->frame) {
+                // nothing else can come before it
+                break;
+            }
+            else if (e->getParent() == event) {
 				// found a child on the same frame as it's parent,
 				// but scheduled after, always do children first
                 // NO! Only do this for JumpPlayEvent, now that
@@ -2359,10 +2405,6 @@ Event* EventManager::getNextScheduledEvent(int availFrames,
                 }
             }
 		}
-		else if (e->pending && e->type == ScriptEvent &&
-				 (e->fields.script.waitType == WAIT_START || 
-				  e->fields.script.waitType == WAIT_END))
-		  pendingScript = e;
 	}
 
 	// check the sync event
@@ -2404,17 +2446,28 @@ Event* EventManager::getNextScheduledEvent(int availFrames,
 				// There are two types one for "Wait start" and another
 				// for "Wait end".  Wait end will be processed immediately,
 				// Wait start will be processed after we loop back to zero.
+				// look for pending script events that happen at the
+				// loop boundary, the last one scheduled wins
+				Event* pendingScript = NULL;
+				for (Event* e = mEvents->getFirst(EVENT_LANE_PENDING) ; e != NULL ;
+					 e = mEvents->getNextInLane(e)) {
+					if (e->type == ScriptEvent &&
+						(e->fields.script.waitType == WAIT_START || 
+						 e->fields.script.waitType == WAIT_END))
+					  pendingScript = e;
+				}
+
 				event = NULL;
 				if (pendingScript != NULL) {
 					Trace(mTrack, 2, "EventManager: Activating pending script event\n");
-					pendingScript->pending = false;
+					pendingScript->setPending(false);
 					if (pendingScript->fields.script.waitType == WAIT_START) {
 						// the loop still happens first
-						pendingScript->frame = 0;
+						pendingScript->setFrame(0);
 					}
 					else if (pendingScript->fields.script.waitType == WAIT_END) {
 						// the event happens before the loop
-						pendingScript->frame = loopFrames;
+						pendingScript->setFrame(loopFrames);
 						event = pendingScript;
 					}
 				}
@@ -109,6 +109,7 @@ class EventManager {
     // Selection
 
 	Event* getNextEvent();
+    bool isQuiet(long frames);
 
     // Processing
 
@@ -134,7 +135,6 @@ class EventManager {
     void removeAll(Event* e);
     void undoAndFree(Event* e);
     void undoProcessedEvents(Event* event);
-    long reverseFrame(long origin, long newOrigin, long frame);
     void finishReturnEvent(Loop* loop, Event* re);
 
     void getEventSummary(class MobiusLoopState* s, Event* e, bool stacked);
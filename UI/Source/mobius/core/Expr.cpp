@@ -1055,6 +1055,11 @@ bool ExNode::isSymbol()
 	return false;
 }
 
+bool ExNode::isLiteral()
+{
+	return false;
+}
+
 int ExNode::getPrecedence()
 {
 	return 0;
@@ -1136,6 +1141,19 @@ ExLiteral::ExLiteral(const char* str)
 	mValue.setString(str);
 }
 
+/**
+ * Used when folding constant expressions.
+ */
+ExLiteral::ExLiteral(ExValue* value)
+{
+	mValue.set(value);
+}
+
+bool ExLiteral::isLiteral()
+{
+	return true;
+}
+
 void ExLiteral::eval(ExContext* context, ExValue* value)
 {
 	value->set(&mValue);
@@ -1176,6 +1194,23 @@ const char* ExSymbol::getName()
 	return mName;
 }
 
+bool ExSymbol::isResolved()
+{
+	return mResolved;
+}
+
+/**
+ * Scripts resolve their symbols when they are compiled so
+ * the first evaluation doesn't have to search for them.
+ * A null resolver is remembered too, the value is the name.
+ */
+void ExSymbol::setResolver(ExResolver* r)
+{
+	delete mResolver;
+	mResolver = r;
+	mResolved = true;
+}
+
 /**
  * If we have not looked for an ExResolver, do so now, but
  * only do this once.  If there is no resolver, the value is the
@@ -2512,11 +2547,51 @@ ExNode* ExParser::parse(const char* src)
 				}
 			}
 		}
+
+		if (root != NULL)
+		  root = fold(root);
 	}
 
 	return root;
 }
 
+/**
+ * Replace operators whose operands are all literals with the result
+ * so scripts don't compute things like "1000 * 4" every time they
+ * are evaluated.  Functions are left alone, rand() has to run
+ * every time and the others are rarely given constants.
+ */
+ExNode* ExParser::fold(ExNode* node)
+{
+	ExNode* children = node->stealChildren();
+	ExNode* next = NULL;
+	for (ExNode* c = children ; c != NULL ; c = next) {
+		next = c->getNext();
+		c->setNext(NULL);
+		node->addChild(fold(c));
+	}
+
+	if (node->isOperator() && node->getChildren() != NULL) {
+		bool constant = true;
+		for (ExNode* c = node->getChildren() ; c != NULL ; c = c->getNext()) {
+			if (!c->isLiteral()) {
+				constant = false;
+				break;
+			}
+		}
+
+		if (constant) {
+			ExValue value;
+			node->eval(NULL, &value);
+			ExNode* literal = NEW1(ExLiteral, &value);
+			deleteNode(node);
+			node = literal;
+		}
+	}
+
+	return node;
+}
+
 /**
  * Called when we're transforming a node.  Delete the original
  * and remove any potential references to avoid invalid memory refs.
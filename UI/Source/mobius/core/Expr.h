@@ -275,6 +275,7 @@ class ExNode {
 	virtual bool isOperator();
 	virtual bool isBlock();
 	virtual bool isSymbol();
+	virtual bool isLiteral();
 	virtual int getPrecedence();
     virtual int getDesiredOperands();
 
@@ -317,7 +318,9 @@ class ExLiteral : public ExNode {
 	ExLiteral(int i);
 	ExLiteral(float f);
 	ExLiteral(const char* str);
+	ExLiteral(ExValue* value);
 
+	bool isLiteral();
 	void toString(class Vbuf* b);
 	void eval(ExContext* context, ExValue *value);
 
@@ -344,6 +347,9 @@ class ExSymbol : public ExNode {
 	void toString(class Vbuf* b);
 	void eval(ExContext* context, ExValue *value);
 
+    bool isResolved();
+    void setResolver(ExResolver* r);
+
   private:
 
 	char* mName;
@@ -701,6 +707,7 @@ class ExParser {
     bool isOperatorSatisfied();
 	void shiftOperator();
     void deleteNode(ExNode* node);
+    ExNode* fold(ExNode* node);
 
 	ExNode* nextToken();
 	ExNode* nextTokenForReal();
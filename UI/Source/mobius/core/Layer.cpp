@@ -2921,10 +2921,23 @@ void Layer::getNoReflect(LayerContext* con, long startFrame,
  * processing of audio blocks entirely while the save takes place, but this would cause
  * a major disruption of the audio stream, sort of like GlobalPause which has to do
  * edge fades when it starts and when it resumes to avoid clicks.
+ *
+ * UPDATE: SaveLoop now makes a LayerSnapshot in the interrupt which is
+ * cheap now that Audio buffers can be shared.  This is then called on
+ * the private copy in the snapshot which the audio thread can't touch.
  */
 Audio* Layer::flatten()
 {
 	Audio* flat = mAudioPool->newAudio();
+
+	// if there is nothing but local audio we can share its buffers,
+	// the audio thread gets a private copy of anything it changes
+	// after this
+	if (mSegments == NULL && mAudio->getFrames() == getFrames()) {
+		flat->copy(mAudio);
+		return flat;
+	}
+
 	AudioCursor* cursor = NEW2(AudioCursor, "flatten", NULL);
 	float buffer[AUDIO_MAX_FRAMES_PER_BUFFER * AUDIO_MAX_CHANNELS];
 
@@ -4793,6 +4806,16 @@ LayerPool::LayerPool(AudioPool* aupool)
     mMuteLayer = NULL;
     mCopyContext = NULL;
     mCopyBuffer = nullptr;
+    mGraveyard = nullptr;
+    mBacklog = nullptr;
+    mReclaimed = nullptr;
+    mReserve = 0;
+    mBlocks = 0;
+    mMaintenanceBlocks = 0;
+    mBuried = 0;
+    mReclaimedCount = 0;
+    mMaxBacklog = 0;
+    mInterruptAllocations = 0;
 }
 
 /**
@@ -4810,6 +4833,9 @@ LayerPool::~LayerPool()
 
     // this will delete the prev pointer chain
     delete mLayers;
+    delete mGraveyard.load();
+    delete mBacklog;
+    delete mReclaimed.load();
 }
 
 /**
@@ -4858,13 +4884,20 @@ Layer* LayerPool::newLayer(Loop* loop)
 {
 	Layer* layer = mLayers;
 
+    // take everything the maintenance thread has reclaimed
+	if (layer == NULL)
+      layer = mReclaimed.exchange(nullptr);
+
 	if (layer == NULL) {
+        // the reserve ran out before maintenance could refill it
         layer = NEW2(Layer, this, mAudioPool);
         layer->setAllocation(mAllocated++);
+        mInterruptAllocations++;
     }
 	else {
         // pool is chained by the prev pointer...confusing!
 		mLayers = layer->getPrev();
+        mReserve--;
 		if (!layer->mPooled)
 		  Trace(1, "Layer:  Layer in pool not marked as pooled\n");
 		layer->mPooled = false;
@@ -4899,6 +4932,10 @@ Layer* LayerPool::newLayer(Loop* loop)
 
 /**
  * Return a layer to the pool.
+ * The segments are released now since they hold references to
+ * other layers, the Audio is left for the maintenance thread.
+ * The mPooled flag catches layers freed twice, the graveyard
+ * and reclaimed lists can't be searched from here.
  */
 void LayerPool::freeLayer(Layer* layer)
 {
@@ -4908,24 +4945,10 @@ void LayerPool::freeLayer(Layer* layer)
 		else {
 			int refs = layer->decReferences();
 			if (refs <= 0) {
-				layer->reset();
-				layer->setPrev(mLayers);
+				layer->resetSegments();
 				layer->mPooled = true;
-				
-				bool checkpool = true;
-				if (!checkpool)
-				  mLayers = layer;
-				else {
-					Layer* found = NULL;
-					for (found = mLayers ; found != NULL ; found = found->getPrev()) {
-						if (found == layer)
-						  break;
-					}
-					if (found != NULL) 
-					  Trace(1, "Layer: Attempt to free layer already in the pool!\n");
-					else
-					  mLayers = layer;
-				}
+                push(mGraveyard, layer);
+                mBuried++;
 			}
 			else {
 				// do NOT null the prev pointer, it may still be on a list
@@ -4962,9 +4985,229 @@ void LayerPool::dump()
 
     for (Layer* l = mLayers ; l != NULL ; l = l->getPrev())
       count++;
+    for (Layer* l = mReclaimed ; l != NULL ; l = l->getPrev())
+      count++;
+
+    int allocated = mAllocated;
+    int backlog = getBacklog();
+    printf("LayerPool: %d allocated, %d in the pool, %d waiting, %d in use\n", 
+           allocated, count, backlog, allocated - count - backlog);
+
+    traceStatistics();
+}
+
+/**
+ * Push a layer on one of the lock free lists.
+ * The lists are linked by the prev pointer like the pool.
+ * They are only ever taken all at once with exchange so
+ * there is no ABA problem.
+ */
+void LayerPool::push(std::atomic<Layer*>& list, Layer* layer)
+{
+    Layer* head = list.load();
+    do {
+        layer->setPrev(head);
+    } while (!list.compare_exchange_weak(head, layer));
+}
 
-    printf("LayerPool: %d allocated, %d in the pool, %d in use\n", 
-           mAllocated, count, mAllocated - count);
+/**
+ * Count the audio blocks so maintenance can scale its budget
+ * to how long it has been since it last ran.
+ */
+void LayerPool::interruptEnd()
+{
+    mBlocks++;
+}
+
+/**
+ * Called by the shell maintenance thread to return the Audio
+ * buffers of freed layers to the AudioPool.  Only a limited number
+ * are done for each audio block since the last call so a large undo
+ * trim doesn't hold up the other maintenance, the rest wait for the
+ * next call.  Then the reserve is topped up with new layers if
+ * reclaiming didn't leave enough.
+ */
+void LayerPool::performMaintenance()
+{
+    Layer* buried = mGraveyard.exchange(nullptr);
+    if (buried != nullptr) {
+        Layer* last = buried;
+        while (last->getPrev() != NULL)
+          last = last->getPrev();
+        last->setPrev(mBacklog);
+        mBacklog = buried;
+
+        int backlog = getBacklog();
+        if (backlog > mMaxBacklog)
+          mMaxBacklog = backlog;
+    }
+
+    int blocks = mBlocks;
+    int budget = (blocks - mMaintenanceBlocks) * LAYER_RECLAIM_BUDGET;
+    if (budget < LAYER_RECLAIM_BUDGET)
+      budget = LAYER_RECLAIM_BUDGET;
+    mMaintenanceBlocks = blocks;
+
+    int reclaimed = 0;
+    while (mBacklog != nullptr && reclaimed < budget) {
+        Layer* layer = mBacklog;
+        mBacklog = layer->getPrev();
+        layer->mAudio->reset();
+        layer->mOverdub->reset();
+        push(mReclaimed, layer);
+        mReserve++;
+        reclaimed++;
+    }
+    mReclaimedCount += reclaimed;
+
+    while (mReserve < LAYER_RESERVE) {
+        Layer* layer = NEW2(Layer, this, mAudioPool);
+        layer->setAllocation(mAllocated++);
+        layer->mPooled = true;
+        push(mReclaimed, layer);
+        mReserve++;
+    }
+}
+
+/**
+ * Number of freed layers whose Audio has not been reset yet.
+ */
+int LayerPool::getBacklog()
+{
+    return mBuried - mReclaimedCount;
+}
+
+int LayerPool::getMaxBacklog()
+{
+    return mMaxBacklog;
+}
+
+void LayerPool::traceStatistics()
+{
+    Trace(2, "LayerPool: %ld allocated, %ld reclaimed, backlog %ld maximum %ld\n",
+          (long)mAllocated, (long)mReclaimedCount, (long)getBacklog(),
+          (long)mMaxBacklog);
+    Trace(2, "LayerPool: %ld allocated in the interrupt, reserve %ld\n",
+          (long)mInterruptAllocations, (long)mReserve);
+}
+
+/****************************************************************************
+ *                                                                          *
+ *                                 SNAPSHOT                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Capture the contents of a layer.  This must be called in the interrupt.
+ */
+LayerSnapshot::LayerSnapshot(Layer* src)
+{
+    mNext = NULL;
+    mPool = NULL;
+    mLayers = NULL;
+    mRoot = NULL;
+    mSampleRate = CD_SAMPLE_RATE;
+
+    if (src != NULL) {
+        mPool = src->mLayerPool;
+        mRoot = copy(src);
+    }
+}
+
+/**
+ * Return the private layers to the pool, this must be called
+ * in the interrupt.  The segments hold references to the other
+ * private layers so they may not actually go back until the
+ * last one is freed.
+ */
+LayerSnapshot::~LayerSnapshot()
+{
+    SnapshotLayer* next = NULL;
+    for (SnapshotLayer* l = mLayers ; l != NULL ; l = next) {
+        next = l->next;
+        l->copy->free();
+        delete l;
+    }
+
+    // this will delete the chain
+    delete mNext;
+}
+
+LayerSnapshot* LayerSnapshot::getNext()
+{
+    return mNext;
+}
+
+void LayerSnapshot::setNext(LayerSnapshot* s)
+{
+    mNext = s;
+}
+
+void LayerSnapshot::setSampleRate(int rate)
+{
+    mSampleRate = rate;
+}
+
+long LayerSnapshot::getFrames()
+{
+    return (mRoot != NULL) ? mRoot->getFrames() : 0;
+}
+
+/**
+ * Make a private copy of a layer and the layers it references.
+ * The Audio shares the source buffers and the segments are cloned
+ * then pointed at the private copies.  A layer referenced by more
+ * than one segment, which is common after multiply, is only copied once.
+ *
+ * Only the things getNoReflect needs are copied, the copy
+ * has no Loop and can't be played or recorded.
+ */
+Layer* LayerSnapshot::copy(Layer* src)
+{
+    Layer* layer = NULL;
+
+    for (SnapshotLayer* l = mLayers ; l != NULL && layer == NULL ; l = l->next) {
+        if (l->source == src)
+          layer = l->copy;
+    }
+
+    if (layer == NULL) {
+        layer = mPool->newLayer(NULL);
+
+        SnapshotLayer* entry = NEW(SnapshotLayer);
+        entry->source = src;
+        entry->copy = layer;
+        entry->next = mLayers;
+        mLayers = entry;
+
+        layer->mAudio->copy(src->mAudio);
+        layer->mFrames = src->mFrames;
+        layer->mCycles = src->mCycles;
+
+        for (Segment* seg = src->mSegments ; seg != NULL ; seg = seg->getNext()) {
+            Segment* clone = NEW1(Segment, seg);
+            Layer* ref = seg->getLayer();
+            if (ref != NULL)
+              clone->setLayer(copy(ref));
+            layer->addSegment(clone);
+        }
+    }
+
+    return layer;
+}
+
+/**
+ * Flatten the private copy.  Nothing else can see these layers
+ * so this doesn't have to be in any particular thread.
+ */
+Audio* LayerSnapshot::flatten()
+{
+    Audio* audio = NULL;
+    if (mRoot != NULL) {
+        audio = mRoot->flatten();
+        audio->setSampleRate(mSampleRate);
+    }
+    return audio;
 }
 
 /****************************************************************************
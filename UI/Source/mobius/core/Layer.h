@@ -12,6 +12,8 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include <atomic>
+
 #include "../../util/Trace.h"
 #include "../Audio.h"
 #include "../../model/MobiusState.h"
@@ -82,6 +84,7 @@ class Layer : public TraceContext
 {
     friend class LayerPool;
 	friend class Segment;
+	friend class LayerSnapshot;
 
   public:
 
@@ -444,9 +447,37 @@ class Layer : public TraceContext
  *                                                                          *
  ****************************************************************************/
 
+/**
+ * The maximum number of layers LayerPool::performMaintenance
+ * will reclaim for each audio block since the last call.
+ */
+#define LAYER_RECLAIM_BUDGET 2
+
+/**
+ * The number of reset layers the maintenance thread keeps ready
+ * for newLayer, allocating more if not enough were reclaimed.
+ */
+#define LAYER_RESERVE 16
+
 /**
  * A pool of layers.  Normally only one of these managed
  * by a Mobius instance.
+ *
+ * Unreferenced layers are not reset in the interrupt.  Giving the
+ * Audio buffers of a long layer back to the AudioPool takes time
+ * proportional to its length, and checkMaxUndo or Loop::shift can
+ * free several of them right at the loop boundary.  freeLayer still
+ * deletes the segments since they reference other layers, then pushes
+ * the layer on a lock free graveyard list.  The shell maintenance
+ * thread resets the Audio of a limited number of them each time
+ * it runs and pushes them on the reclaimed list where newLayer
+ * finds them when the pool is empty.
+ *
+ * Maintenance only runs every 100ms or so, so short loops and bursts
+ * of undo could use up the pool before then.  The maintenance thread
+ * also tops up the reclaimed list with new layers so there are always
+ * LAYER_RESERVE ready.  newLayer only allocates if that runs out,
+ * and counts each time it had to.
  */
 class LayerPool {
 
@@ -466,14 +497,47 @@ class LayerPool {
     void resetCounter();
     void dump();
 
+    // called by Mobius at the end of each audio block
+    void interruptEnd();
+
+    // called by the shell maintenance thread
+    void performMaintenance();
+    int getBacklog();
+    int getMaxBacklog();
+    void traceStatistics();
+
   private:
 
 	void flush();
+    void push(std::atomic<Layer*>& list, Layer* layer);
 
     class AudioPool* mAudioPool;
     Layer* mLayers;
     int mCounter;
-    int mAllocated;
+    std::atomic<int> mAllocated;
+
+    // freed layers waiting for their Audio to be reset
+    std::atomic<Layer*> mGraveyard;
+
+    // taken from the graveyard but not reclaimed yet,
+    // only touched by the maintenance thread
+    Layer* mBacklog;
+
+    // reset layers waiting for newLayer
+    std::atomic<Layer*> mReclaimed;
+
+    // number of reset layers in mLayers and mReclaimed
+    std::atomic<int> mReserve;
+
+    // audio blocks processed, and the count at the last maintenance
+    std::atomic<int> mBlocks;
+    int mMaintenanceBlocks;
+
+    // statistics
+    std::atomic<int> mBuried;
+    std::atomic<int> mReclaimedCount;
+    std::atomic<int> mMaxBacklog;
+    std::atomic<int> mInterruptAllocations;
     
     Layer* mMuteLayer;
     LayerContext* mCopyContext;
@@ -481,6 +545,72 @@ class LayerPool {
     
 };
 
+/****************************************************************************
+ *                                                                          *
+ *                                 SNAPSHOT                                 *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * One of the private layers in a snapshot and the layer it was
+ * copied from.
+ */
+class SnapshotLayer {
+
+  public:
+
+    Layer* source;
+    Layer* copy;
+    SnapshotLayer* next;
+};
+
+/**
+ * A frozen copy of a layer that can be flattened outside the interrupt.
+ *
+ * Layer::flatten walks the segments and Audio of a live layer, which
+ * is only safe in the audio thread.  A snapshot is made in the interrupt
+ * and contains a private copy of the layer and every layer it references
+ * through segments.  The copies share Audio buffers with the originals
+ * so only block pointers are copied, and since the audio thread makes
+ * its own copy of any shared block it modifies, the contents of the
+ * snapshot won't change after it is made.
+ *
+ * The snapshot can then be flattened by any thread.  The private layers
+ * come from the LayerPool so the snapshot must be deleted in the
+ * audio thread.  The shell sends them back down when it is done.
+ */
+class LayerSnapshot {
+
+  public:
+
+    LayerSnapshot(Layer* src);
+    ~LayerSnapshot();
+
+    LayerSnapshot* getNext();
+    void setNext(LayerSnapshot* s);
+
+    void setSampleRate(int rate);
+    long getFrames();
+
+    /**
+     * Build a new Audio with the flattened contents.
+     * This may be called from any thread, and the result
+     * is owned by the caller.
+     */
+    Audio* flatten();
+
+  private:
+
+    Layer* copy(Layer* src);
+
+    LayerSnapshot* mNext;
+    LayerPool* mPool;
+    SnapshotLayer* mLayers;
+    Layer* mRoot;
+    int mSampleRate;
+
+};
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -169,6 +169,7 @@ void Loop::init(Mobius* m, Track* track,
     mPlay = NULL;
     mPrePlay = NULL;
 	mRedo = NULL;
+	mHistoryAnchor = NULL;
 
 	mNumber = 0;
     mFrame = 0;
@@ -361,6 +362,8 @@ void Loop::loadProject(ProjectLoop* pl)
 			if (l != NULL) {
 				l->setLoop(this);
 				l->setPrev(mPlay);
+				if (mPlay == NULL)
+				  mHistoryAnchor = l;
 				mPlay = l;
 			}
 		}
@@ -395,6 +398,48 @@ void Loop::loadProject(ProjectLoop* pl)
 	}
 }
 
+/**
+ * True if the oldest layer from the last loadProject is still
+ * at the end of the undo list.  If the loop was reset or
+ * trimmed its undo layers since then, a history that arrives
+ * later no longer belongs here.
+ */
+bool Loop::canLoadHistory()
+{
+	Layer* tail = mPlay;
+	while (tail != NULL && tail->getPrev() != NULL)
+	  tail = tail->getPrev();
+
+	return (tail != NULL && tail == mHistoryAnchor);
+}
+
+/**
+ * Add the undo layers from a history project under the
+ * layers set by loadProject.  Large projects are loaded in two parts
+ * so the loops can start playing before the rest has been read.
+ * The layers must already be allocated, and the caller must have
+ * checked canLoadHistory.
+ */
+void Loop::loadHistory(ProjectLoop* pl)
+{
+	Layer* tail = mHistoryAnchor;
+	List* layers = pl->getLayers();
+	if (tail != NULL && layers != NULL) {
+		// these are stored most recent first like loadProject
+		for (int i = 0 ; i < layers->size() ; i++) {
+            ProjectLayer* player = (ProjectLayer*)layers->get(i);
+            Layer* l = player->getLayer();
+			if (l != NULL) {
+				l->setLoop(this);
+				tail->setPrev(l);
+				tail = l;
+			}
+		}
+	}
+	// only once
+	mHistoryAnchor = NULL;
+}
+
 /****************************************************************************
  *                                                                          *
  *   						  FRAMES AND STATUS                             *
@@ -846,34 +891,30 @@ void Loop::setRedoLayer(Layer* l)
 }
 
 /**
- * Return a copy of the loop that is currently audible.
+ * Return a snapshot of the loop that is currently audible.
  * Used in the implementation of "quick save" and "save loop".
  *
  * Note that with the introduction of segments, the play layer's
  * Audio is usually, sparse, so you have to "flatten" it to get
  * an accurate representation of what is playing.
  *
- * The returned object is owned by the caller and must be freed.
- * 
- * This is normally called from a KernelEvent handler in the maintenance
- * thread.
- * 
- * !! There can be race conditions here that cause AudioCursor
- * play frame overflow.  In Rehearse mode at the exact end of the loop,
- * mPlay is about to be reclaimed since we do not keep an undo list.
- * It's a very small window though and in practice getting it to happen
- * exactly on the loop boundary only happens in scripts.  Still there
- * are plenty of other things that could cause the play layer to modified.
- * Think about a way to lock it while it is being flattened.
+ * This used to flatten the play layer directly from a KernelEvent
+ * handler in the maintenance thread, which raced with anything that
+ * modified or reclaimed the play layer, Rehearse at the exact end of the
+ * loop being the usual example.  Now this is called in the interrupt
+ * and returns a private copy that can be flattened later.
+ *
+ * The returned object is owned by the caller and must be deleted
+ * in the interrupt.
  */
-Audio* Loop::getPlaybackAudio()
+LayerSnapshot* Loop::getPlaybackSnapshot()
 {
-	Audio* playing = NULL;
+	LayerSnapshot* snapshot = NULL;
 	if (mPlay != NULL) {
-		playing = mPlay->flatten();
+		snapshot = NEW1(LayerSnapshot, mPlay);
 	}
 
-	return playing;
+	return snapshot;
 }
 
 /**
@@ -1664,8 +1705,8 @@ void Loop::record()
 				// beyind that frame by the time it calls Loop::record.
 				Trace(this, 2, "Loop: Activating threshold record event\n");
 				em->removeEvent(start);
-				start->frame = mFrame;
-				start->pending = false;
+				start->setFrame(mFrame);
+				start->setPending(false);
                 em->processEvent(start);
 				mRecord->record(mInput, mFrame, feedback);
 			}
@@ -2100,6 +2141,7 @@ void Loop::clear()
         redo->freeAll();
     }
     mRedo = NULL;
+	mHistoryAnchor = NULL;
 }
 
 /****************************************************************************
@@ -2751,7 +2793,7 @@ Event* Loop::scheduleRoundingModeEnd(Action* action, Event* event)
 			// must be a calculation error
 			Trace(this, 1, "Loop: %s end frame less than record stop frame: %ld %ld\n",
 				  mMode->getDisplayName(), endFrame, recordStop->frame);
-			recordStop->frame = endFrame;
+			recordStop->setFrame(endFrame);
 		}
 
 		// For MultipyMode=Simple, we'll try to stop immediately, but 
@@ -2768,7 +2810,7 @@ Event* Loop::scheduleRoundingModeEnd(Action* action, Event* event)
 				// proabaly a calculation error?
 				Trace(this, 1, "Loop: Multiply end frame less than record end frame: %ld %ld\n",
 					  endFrame, recordStop->frame);
-				recordStop->frame = endFrame;
+				recordStop->setFrame(endFrame);
 			}
 		}
 
@@ -5150,8 +5192,8 @@ void Loop::switchEvent(Event* event)
 		if (e->type != JumpPlayEvent) {
 			// promote it
 			event->removeChild(e);
-			e->pending = false;
-			e->frame = next->mFrame;
+			e->setPending(false);
+			e->setFrame(next->mFrame);
             em->addEvent(e);
 		}
         else {
@@ -5334,7 +5376,7 @@ void Loop::switchEvent(Event* event)
                 Event* sus = em->newEvent(event->function, SUSReturnEvent, 0);
                 sus->savePreset(mPreset);
                 sus->fields.loopSwitch.nextLoop = this;
-                sus->pending = true;
+                sus->setPending(true);
                 em->addEvent(sus);
             }
             else {
@@ -5386,7 +5428,7 @@ void Loop::switchEvent(Event* event)
             Event* sus = em->newEvent(event->function, SUSReturnEvent, 0);
             sus->savePreset(mPreset);
             sus->fields.loopSwitch.nextLoop = this;
-            sus->pending = true;
+            sus->setPending(true);
             em->addEvent(sus);
         }
         else if (recording) {
@@ -5719,10 +5761,10 @@ void Loop::returnEvent(Event* event)
 	if (wait != NULL && 
         wait->pending && 
 		wait->fields.script.waitType == WAIT_RETURN) {
-		wait->pending = false;
+		wait->setPending(false);
 		// note that we use the special immediate option just to make sure
-		wait->immediate = true;
-		wait->frame = next->getFrame();
+		wait->setImmediate(true);
+		wait->setFrame(next->getFrame());
 	}
 
     mTrack->setLoop(next);
@@ -137,6 +137,8 @@ class Loop : public TraceContext {
 
 	void updateConfiguration(class MobiusConfig* config);
 	void loadProject(class ProjectLoop* l);
+	bool canLoadHistory();
+	void loadHistory(class ProjectLoop* l);
 
 	void setNumber(int i);
 	int getNumber();
@@ -186,7 +188,7 @@ class Loop : public TraceContext {
 	class Layer* getRecordLayer();
 	class Layer* getPlayLayer();
 	class Layer* getRedoLayer();
-    class Audio* getPlaybackAudio();
+    class LayerSnapshot* getPlaybackSnapshot();
     void setAltFeedback(int i);
     int getAltFeedback();
 	long getInputLatency();
@@ -359,6 +361,10 @@ class Loop : public TraceContext {
     class Layer* mPrePlay;
 	class Layer* mRedo;
 
+	// the oldest layer set by loadProject, the project
+	// history is added under this one
+	class Layer* mHistoryAnchor;
+
 	int mNumber;
     long mFrame;
 	long mPlayFrame;
@@ -9,8 +9,12 @@
 bool MemTraceEnabled = false;
 bool MemForceTrace = false;
 
+// per-thread so the benchmark isn't confused by other engines
+thread_local int MemAllocations = 0;
+
 void MemTrack(void* obj, const char* className, int size)
 {
+    MemAllocations++;
     if (MemTraceEnabled || MemForceTrace) {
         // ugh, Trace doesn't support 64 bit pointers
         char buf[1024];
@@ -21,6 +25,7 @@ void MemTrack(void* obj, const char* className, int size)
 
 void* MemNew(void* obj, const char* className, int size)
 {
+    MemAllocations++;
     if (MemTraceEnabled || MemForceTrace) {
         // ugh, Trace doesn't support 64 bit pointers
         char buf[1024];
@@ -33,6 +38,7 @@ void* MemNew(void* obj, const char* className, int size)
 float* MemNewFloat(const char* context, int size)
 {
     float* buffer = new float[size];
+    MemAllocations++;
     if (MemTraceEnabled || MemForceTrace) {
         char buf[1024];
         sprintf(buf, "Memory: Allocated float buffer for %s size %d %p\n",
@@ -45,6 +51,7 @@ float* MemNewFloat(const char* context, int size)
 char* MemCopyString(const char* context, const char* src)
 {
     char* copy = CopyString(src);
+    MemAllocations++;
     if (copy != nullptr && (MemTraceEnabled || MemForceTrace)) {
         char buf[1024];
         sprintf(buf, "Memory: CopyString for %s size %d %p\n",
@@ -5,6 +5,10 @@
 
 extern bool MemTraceEnabled;
 
+// number of tracked allocations made by the calling thread
+// the offline benchmark watches this to catch allocations in the interrupt
+extern thread_local int MemAllocations;
+
 extern void MemTrack(void* obj, const char* className, int size);
 extern void* MemNew(void* obj, const char* className, int size);
 extern void MemDelete(void* obj, const char* name);
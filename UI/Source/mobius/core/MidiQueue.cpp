@@ -35,11 +35,18 @@
  *     SYNC_UNIT_MIDI_CLOCK
  *     SYNC_UNIT_MIDI_BEAT
  *
+ * Events are stamped with a high resolution timer when they are added
+ * so the external queue can place them within the block and estimate
+ * the tempo from the clock spacing.
+ *
  */
 
 #include <stdlib.h>
 #include <memory.h>
 #include <stdarg.h>
+#include <math.h>
+
+#include <JuceHeader.h>
 
 //#include "Port.h"
 #include "../../util/Trace.h"
@@ -80,6 +87,23 @@
  */
 #define MAXIMUM_CLOCK_DISTANCE 666
 
+/**
+ * Bandwidth in Hz of the delay locked loop that estimates the
+ * tempo from the clock timestamps.  Lower is smoother but takes longer
+ * to follow a tempo change, at 1Hz the loop settles within a few beats.
+ */
+#define CLOCK_LOCK_BANDWIDTH 1.0
+
+/**
+ * Number of clocks the loop has to see before the tempo is used.
+ */
+#define CLOCK_LOCK_SETTLE 24
+
+/**
+ * Weight given to each clock in the running jitter average.
+ */
+#define CLOCK_JITTER_WEIGHT 0.05
+
 /****************************************************************************
  *                                                                          *
  *   							  MIDI STATE                                *
@@ -100,6 +124,8 @@ MidiState::MidiState()
 
 	waitingStatus = 0;
 	started = false;
+
+	resetLock();
 }
 
 MidiState::~MidiState()
@@ -121,6 +147,71 @@ void MidiState::tick(long currentClock)
 		if (delta > MAXIMUM_CLOCK_DISTANCE) {
 			Trace(2, "MidiState %s stopped receiving clocks\n", name);
 			receivingClocks = false;
+			resetLock();
+		}
+	}
+}
+
+/**
+ * Start the tempo estimator over.  The tempo stays at zero
+ * until it locks again.
+ */
+void MidiState::resetLock()
+{
+	tempo = 0.0f;
+	jitter = 0.0f;
+	maxJitter = 0.0f;
+	clockPeriod = 0.0;
+	nextClockTime = 0.0;
+	lockClocks = 0;
+}
+
+/**
+ * Second order delay locked loop over the clock timestamps.
+ * nextClockTime is where we expect the next clock and clockPeriod
+ * the filtered distance between them.  Each clock corrects both
+ * by the prediction error, the same filter audio drivers use to
+ * smooth their callback times.  The error is what's left after
+ * the filter, which is our measure of jitter.
+ *
+ * A gap longer than MAXIMUM_CLOCK_DISTANCE starts over.
+ */
+void MidiState::lock(double time)
+{
+	if (lockClocks > 0 &&
+		(time - (nextClockTime - clockPeriod) > MAXIMUM_CLOCK_DISTANCE ||
+		 time < nextClockTime - clockPeriod))
+	  resetLock();
+
+	if (lockClocks == 0) {
+		nextClockTime = time;
+		lockClocks = 1;
+	}
+	else if (lockClocks == 1) {
+		// the first interval seeds the period, ignore clocks
+		// the driver delivered in the same millisecond
+		double period = time - nextClockTime;
+		if (period >= 1.0) {
+			clockPeriod = period;
+			nextClockTime = time + period;
+			lockClocks = 2;
+		}
+	}
+	else {
+		double error = time - nextClockTime;
+		double omega = 2.0 * 3.14159265358979 * CLOCK_LOCK_BANDWIDTH * (clockPeriod / 1000.0);
+		nextClockTime += clockPeriod + (sqrt(2.0) * omega * error);
+		clockPeriod += omega * omega * error;
+
+		double distance = fabs(error);
+		jitter += (float)((distance - jitter) * CLOCK_JITTER_WEIGHT);
+		if (lockClocks < CLOCK_LOCK_SETTLE)
+		  lockClocks++;
+		else {
+			if (distance > maxJitter)
+			  maxJitter = (float)distance;
+			// 24 clocks per beat
+			tempo = (float)(60000.0 / (clockPeriod * 24.0));
 		}
 	}
 }
@@ -186,6 +277,8 @@ void MidiState::advance(MidiSyncEvent* e)
 				receivingClocks = true;
 			}
 
+			lock(e->time);
+
 			// these can come in when the sequencer isn't running,
 			// but continue counting so the loop can still run
 			if (!started && waitingStatus == MS_CONTINUE) {
@@ -233,6 +326,8 @@ MidiQueue::MidiQueue()
 {
     // MidiState self initializes
 	mOverflows = 0;
+	mOffsetEvents = false;
+	mBlockTime = 0.0;
 	mHead = 0;
 	mTail = 0;
 	memset(&mEvents, 0, sizeof(mEvents));
@@ -269,6 +364,7 @@ void MidiQueue::add(MidiEvent* e)
 
 	mEvents[mHead].status = status;
 	mEvents[mHead].clock = e->getClock();
+	mEvents[mHead].time = juce::Time::getMillisecondCounterHiRes();
 	if (status == MS_SONGPOSITION)
 	  mEvents[mHead].songpos = e->getSongPosition();
 	else
@@ -295,6 +391,7 @@ void MidiQueue::add(int status, long clock)
 
 	mEvents[mHead].status = status;
 	mEvents[mHead].clock = clock;
+	mEvents[mHead].time = juce::Time::getMillisecondCounterHiRes();
 	mEvents[mHead].songpos = 0;
 	
 	if (next != mTail)
@@ -317,6 +414,11 @@ void MidiQueue::interruptStart(long millisecond)
 	mState.tick(millisecond);
 }
 
+void MidiQueue::setOffsetEvents(bool b)
+{
+	mOffsetEvents = b;
+}
+
 /****************************************************************************
  *                                                                          *
  *                              EVENT CONVERSION                            *
@@ -339,22 +441,33 @@ void MidiQueue::interruptStart(long millisecond)
  * a script might be expecting us to be started.  I really hope
  * this isn't important, if so we'll have to annotate the Events.
  *
- * !! We should try to offset these into the buffer based on when they
- * were received, but I think we need a finer resolution clock.  See
- * See Synchronizer::adjustEventFrame for an earlier attempt at this.
- * If we do adjust these we can only return ones that fit within
- * the given interruptFrames.  As it stands now, we process all of them
- * at the beginning of the buffer.
+ * When mOffsetEvents is on the events are placed in the buffer from
+ * their timestamps.  The events we have now arrived between the last
+ * call and this one, so that span is mapped onto the block.  This delays
+ * every event by one block, but the delay is constant so the spacing
+ * between pulses matches the spacing of the clocks that were received,
+ * where processing all of them at the start of the buffer made the pulse
+ * width wobble by up to a block.  The first call has nothing to measure
+ * from and leaves them at the start.
  */
 Event* MidiQueue::getEvents(EventPool* pool, long interruptFrames)
 {
     Event* events = NULL;
     Event* lastEvent = NULL;
-
-    // in theory we should try to offset these into the buffer
-    // based on when they were received...need a finer resolution clock
     long offset = 0;
 
+    double now = juce::Time::getMillisecondCounterHiRes();
+    double blockStart = mBlockTime;
+    double blockLength = 0.0;
+    if (mOffsetEvents && blockStart > 0.0)
+      blockLength = now - blockStart;
+    mBlockTime = now;
+
+    // let go of the tempo if the clocks stopped
+    if (mState.lockClocks > 0 &&
+        now - (mState.nextClockTime - mState.clockPeriod) > MAXIMUM_CLOCK_DISTANCE)
+      mState.resetLock();
+
 	while (mTail != mHead) {
 
 		MidiSyncEvent* e = &(mEvents[mTail]);
@@ -408,8 +521,15 @@ Event* MidiQueue::getEvents(EventPool* pool, long interruptFrames)
 			// squirell this away for trace debugging
             newEvent->fields.sync.millisecond = e->clock;
 
-            // TODO: set event->frame to buffer offset!1
-            
+            if (blockLength > 0.0 && interruptFrames > 0) {
+                offset = (long)(((e->time - blockStart) / blockLength) * interruptFrames);
+                if (offset < 0)
+                  offset = 0;
+                else if (offset >= interruptFrames)
+                  offset = interruptFrames - 1;
+            }
+            newEvent->frame = offset;
+
             if (lastEvent == NULL)
               events = newEvent;
             else
@@ -43,6 +43,7 @@ class MidiSyncEvent {
 	int status;		// one of the MS_ constants (START, STOP, CLOCK, etc.)
 	int songpos;	// valid if MS_SONG_POSITION
 	long clock;		// millisecond timer clock
+	double time;	// high resolution millisecond timer
 };
 
 /****************************************************************************
@@ -64,6 +65,13 @@ class MidiState {
 	void tick(long millisecond);
 	void advance(MidiSyncEvent* e);
 
+	/**
+	 * Feed the high resolution time of an MS_CLOCK to the
+	 * tempo estimator.
+	 */
+	void lock(double time);
+	void resetLock();
+
 	/**
 	 * Name used for trace messages.
 	 */
@@ -125,6 +133,30 @@ class MidiState {
 	 */ 
 	bool started;
 
+	/**
+	 * Tempo of the clock stream estimated by a delay locked loop
+	 * fed with the clock timestamps.  Zero until the loop has
+	 * seen enough clocks to settle.
+	 */
+	float tempo;
+
+	/**
+	 * Average distance in milliseconds between when clocks arrived
+	 * and when the loop predicted they would.  This is the jitter
+	 * of the clock source plus the MIDI driver.
+	 */
+	float jitter;
+
+	/**
+	 * Largest prediction error since the loop was reset.
+	 */
+	float maxJitter;
+
+	// delay locked loop state
+	double clockPeriod;
+	double nextClockTime;
+	int lockClocks;
+
 };
 
 /****************************************************************************
@@ -169,6 +201,12 @@ class MidiQueue {
 	 */
 	void interruptStart(long millisecond);
 
+	/**
+	 * When set, getEvents places events within the block from
+	 * the time they were received rather than at the start.
+	 */
+	void setOffsetEvents(bool b);
+
     /**
      * Convert the queued MidiSyncEvents into a list of Event
      * objects that can be procesed in this interrupt.
@@ -191,6 +229,12 @@ class MidiQueue {
 	// number of events we couldn't process
 	long mOverflows;
 
+	// place events within the block, see setOffsetEvents
+	bool mOffsetEvents;
+
+	// high resolution time of the last getEvents
+	double mBlockTime;
+
 	// counters incremented by the MIDI thread
 	int mHead;
 	int mTail;
@@ -20,6 +20,8 @@
  *
  */
 
+#include <JuceHeader.h>
+
 #include "../../util/Util.h"
 #include "../../util/List.h"
 
@@ -39,19 +41,22 @@
 #include "Action.h"
 #include "Actionator.h"
 #include "Event.h"
+#include "EventManager.h"
 #include "Export.h"
 #include "Function.h"
 #include "Layer.h"
 #include "Loop.h"
 #include "Mode.h"
 #include "Parameter.h"
-//#include "Project.h"
+#include "Project.h"
 #include "Scriptarian.h"
 #include "ScriptCompiler.h"
 #include "Script.h"
 #include "ScriptRuntime.h"
 #include "Synchronizer.h"
 #include "Track.h"
+#include "TrackRenderer.h"
+#include "BlockProfiler.h"
 
 // for ScriptInternalVariable, encapsulation sucks
 #include "Variable.h"
@@ -98,6 +103,10 @@ Mobius::Mobius(MobiusKernel* kernel)
 	mTracks = NULL;
 	mTrack = NULL;
 	mTrackCount = 0;
+    mProfiler = new BlockProfiler();
+    mTrackRenderer = new TrackRenderer();
+    mTrackRenderer->setProfiler(mProfiler);
+    mTrackTimes = nullptr;
 
 	mCaptureAudio = NULL;
 	mCapturing = false;
@@ -158,6 +167,8 @@ Mobius::~Mobius()
     // and then kill the app/plugin.
     delete mActionator;
 
+    delete mTrackRenderer;
+    delete mProfiler;
     delete mSynchronizer;
     delete mVariables;
 
@@ -206,6 +217,9 @@ void Mobius::shutdown()
     // the audio devices at this point, not sure about MIDI
 	mContainer->sleep(100);
 
+    // audio should have stopped, stop the track workers
+    mTrackRenderer->stop();
+
 	// paranioa to help catch shutdown errors
 	for (int i = 0 ; i < mTrackCount ; i++) {
 		Track* t = mTracks[i];
@@ -288,6 +302,10 @@ void Mobius::initialize(MobiusConfig* config)
 	// Build the track list
     initializeTracks();
 
+    // optional worker threads for parallel track rendering
+    // these can't be started later in reconfigure()
+    mTrackRenderer->start(config->getTrackWorkers(), mTrackCount);
+
     // compile and install scripts, builds the ScriptLibrary
     // !! be consistent about where subcomponents are allocated
     // in the Mobius constructor like Scriptarian, or here
@@ -296,6 +314,10 @@ void Mobius::initialize(MobiusConfig* config)
     
     // common, thread safe configuration propagation
     propagateConfiguration();
+
+    // give the UI something to look at before the first interrupt
+    publishState();
+    
     Trace(2, "Mobius::initialize finished");
 }
 
@@ -428,21 +450,29 @@ void Mobius::reconfigure(class MobiusConfig* config)
  */
 void Mobius::propagateConfiguration()
 {
-    // cache various parameters directly on the Function objects
-    propagateFunctionPreferences();
+    // the shell compares the new config with the old one and
+    // leaves flags for the things that didn't change
+    if (!mConfig->isNoGlobalChanges()) {
+        // cache various parameters directly on the Function objects
+        propagateFunctionPreferences();
+
+        // Synchronizer needs maxSyncDrift, driftCheckPoint
+        if (mSynchronizer != NULL)
+          mSynchronizer->updateConfiguration(mConfig);
 
-    // Synchronizer needs maxSyncDrift, driftCheckPoint
-    if (mSynchronizer != NULL)
-      mSynchronizer->updateConfiguration(mConfig);
+        // Modes track altFeedbackDisables
+        MobiusMode::updateConfiguration(mConfig);
 
-    // Modes track altFeedbackDisables
-    MobiusMode::updateConfiguration(mConfig);
+        // parallel rendering can be turned off, but the number of
+        // workers was fixed in initialize()
+        mTrackRenderer->setEnabled(mConfig->getTrackWorkers() > 0);
 
-    // used to allow configuration of fade length
-    // should be hidden now and can't be changed randomly
-    // this is defined by Audio and should be done in Kernel since
-    // it owns Audio now
-	AudioFade::setRange(mConfig->getFadeFrames());
+        // used to allow configuration of fade length
+        // should be hidden now and can't be changed randomly
+        // this is defined by Audio and should be done in Kernel since
+        // it owns Audio now
+        AudioFade::setRange(mConfig->getFadeFrames());
+    }
 
     // tracks are sensitive to lots of things in the Setup
     // they will look at Setup::loopCount and adjust the number of loops
@@ -461,8 +491,8 @@ void Mobius::propagateConfiguration()
     // but only if all tracks were in reset
     // seems relatively harmless to change the active track
     // don't remember why I was anal about global reset
-    bool allReset = true;
-    for (int i = 0 ; i < mTrackCount ; i++) {
+    bool allReset = !mConfig->isNoSetupChanges();
+    for (int i = 0 ; allReset && i < mTrackCount ; i++) {
         Track* t = mTracks[i];
         Loop* l = t->getLoop();
         if (l != nullptr) {
@@ -764,18 +794,100 @@ void Mobius::containerAudioAvailable(MobiusContainer* cont, UIAction* actions)
         }
     }
 
-    if (master != nullptr)
-      master->containerAudioAvailable(cont);
+    juce::int64 tracksStart = BlockProfiler::now();
 
-	for (int i = 0 ; i < mTrackCount ; i++) {
-		Track* t = mTracks[i];
-        if (t != master) {
-            t->containerAudioAvailable(cont);
+    if (master != nullptr)
+      advanceTrack(cont, master);
+
+    // if TrackRenderer is enabled and every other track is quiet, let
+    // the workers have them, otherwise process them serially
+    if (!renderParallel(cont, master)) {
+        for (int i = 0 ; i < mTrackCount ; i++) {
+            Track* t = mTracks[i];
+            if (t != master) {
+                advanceTrack(cont, t);
+            }
         }
     }
 
+    mProfiler->mark(ProfileTracks, tracksStart);
+
     // post-processing
     endAudioInterrupt();
+
+    mProfiler->endBlock(cont->getInterruptFrames(), getSampleRate());
+
+    // let the UI see what we did
+    publishState();
+}
+
+/**
+ * Advance one track in the audio thread and give the time to the
+ * profiler, and the Benchmark if it asked.  Tracks given to
+ * TrackRenderer are timed there, but not for the Benchmark.
+ */
+void Mobius::advanceTrack(MobiusContainer* cont, Track* t)
+{
+    juce::int64 start = BlockProfiler::now();
+    t->containerAudioAvailable(cont);
+    juce::int64 ticks = BlockProfiler::now() - start;
+
+    mProfiler->addTrack(t->getRawNumber(), ticks);
+    if (mTrackTimes != nullptr)
+      mTrackTimes[t->getRawNumber()] += juce::Time::highResolutionTicksToSeconds(ticks);
+}
+
+void Mobius::setTrackTimes(double* times)
+{
+    mTrackTimes = times;
+}
+
+/**
+ * Attempt to render the non-master tracks in parallel.
+ * Return false if the tracks must be processed serially.
+ *
+ * This is all or nothing.  If any track has something to do in this
+ * block besides record and play, it could be an event that reaches
+ * into another track, a script being resumed, or TrackCopy, and those
+ * expect to see the tracks before it already advanced and the tracks
+ * after it not yet advanced.  The simplest way to keep that order is
+ * to process every track serially in those blocks, which are rare
+ * compared to the ones where nothing happens.
+ *
+ * Sync events are shared by all tracks and are checked after the
+ * master track has run since it may generate track sync events
+ * for the others.
+ */
+bool Mobius::renderParallel(MobiusContainer* cont, Track* master)
+{
+    bool rendered = false;
+
+    if (mTrackRenderer->isEnabled() && !mSynchronizer->hasInterruptEvents()) {
+
+        long frames = cont->getInterruptFrames();
+        bool quiet = true;
+
+        mTrackRenderer->reset();
+        for (int i = 0 ; i < mTrackCount && quiet ; i++) {
+            Track* t = mTracks[i];
+            if (t != master) {
+                quiet = t->getEventManager()->isQuiet(frames) &&
+                    mTrackRenderer->add(t);
+            }
+        }
+
+        if (quiet && mTrackRenderer->getCount() > 1) {
+            mSynchronizer->setParallel(true);
+            mTrackRenderer->render(cont);
+            mSynchronizer->setParallel(false);
+            rendered = true;
+        }
+        else {
+            mTrackRenderer->reset();
+        }
+    }
+
+    return rendered;
 }
 
 /**
@@ -844,7 +956,9 @@ void Mobius::beginAudioInterrupt(UIAction* actions)
         }
     }
     
+    juce::int64 start = BlockProfiler::now();
 	mSynchronizer->interruptStart(mContainer);
+    start = mProfiler->mark(ProfileSyncStart, start);
 
 	// prepare the tracks before running scripts
     // this is a holdover from the old days, do we still need
@@ -860,6 +974,8 @@ void Mobius::beginAudioInterrupt(UIAction* actions)
 
 	// process scripts
     mScriptarian->doScriptMaintenance();
+
+    mProfiler->mark(ProfileActions, start);
 }
 
 /**
@@ -875,7 +991,12 @@ void Mobius::endAudioInterrupt()
 
     long frames = mContainer->getInterruptFrames();
 
+    juce::int64 start = BlockProfiler::now();
 	mSynchronizer->interruptEnd();
+    start = mProfiler->mark(ProfileSyncEnd, start);
+
+    // lets maintenance pace the layer reclaiming
+    mLayerPool->interruptEnd();
 	
 	// if we're recording, capture whatever was left in the output buffer
 	// !! need to support merging of all of the output buffers for
@@ -902,6 +1023,7 @@ void Mobius::endAudioInterrupt()
 
 			mCaptureAudio->append(output, frames);
 		}
+        mProfiler->mark(ProfileCapture, start);
 	}
 
 	// if any of the tracks have requested a UI update, post a message
@@ -1076,6 +1198,10 @@ void Mobius::stopCapture(Action* action)
  * we can still be in an active capture when Mobius::getCapture
  * is eventually called by the event handler which makes the returned
  * Audio unstable.  So stop it now.
+ *
+ * The shell can't touch mCaptureAudio, so the event carries a copy
+ * made here that shares blocks with the capture.  Sharing marks the
+ * source blocks so that has to happen on this thread too.
  */
 void Mobius::saveCapture(Action* action)
 {
@@ -1102,6 +1228,12 @@ void Mobius::saveCapture(Action* action)
     // so no ownership issues of the string
     e->setArg(0, file);
 
+    Audio* capture = getCapture();
+    if (capture != NULL) {
+        e->capture = mAudioPool->newAudio();
+        e->capture->copy(capture);
+    }
+
     if (action != NULL) {
         // here we save the event we're sending up on the Action
         // so the script that is calling us can wait on it
@@ -1112,36 +1244,15 @@ void Mobius::saveCapture(Action* action)
 }
 
 /**
- * Eventually called by KernelEvent to implement the SaveCapture function.
- * 
- * We are now in the maintenance thread since mCaptureAudio was not copied
- * and passed in the event.  There is a subtle ownership window here
- * that isn't a problem for test scripts but could be if this becomes
- * a more general feature.
- *
- * The maintenance thread expects the Audio object we're returning to
- * remain stable for as long as it takes to save the file.  This
- * means that mCapture must be OFF at this point, which it noramlly will
- * be, but if they're calling SaveCapture from a UI component that isn't
- * necessarily the case.
- *
- * Further, once this method returns, mCaptureAudio should be considered
- * to be in a "checked out" state and any further modifications should
- * be prevented until it is "checked in" later when the KernelEvent
- * sent up by saveCapture is completed.   That happens in
- * Mobius::kernelEventCompleted which right now just informs the
- * script that it can stop waiting.
- *
- * If you want to make this safer, should set a "pending save"
- * flag here and clear it in kernelEventCompleted so more capture
- * can happen.  That does however mean that if a kernel bug fails
- * to complete the event, we could disable future captures forever
- * which isn't so bad.
- *
- * To avoid expensive copying of a large Audio object, the caller
- * MUST NOT DELETE the returned object.  It remains owned by Mobius
- * and should only be used for a short period of time.
- * 
+ * Return the captured Audio once the capture has stopped.
+ * Used by saveCapture to make the copy it sends up in the KernelEvent.
+ *
+ * This used to be called by the shell from the maintenance thread
+ * which had an ownership window while the file was written.  Now it
+ * is only called in the kernel and the Audio never leaves it.
+ *
+ * The caller MUST NOT DELETE the returned object, it remains owned
+ * by Mobius.
  */
 Audio* Mobius::getCapture()
 {
@@ -1300,20 +1411,12 @@ void Mobius::toggleBounceRecording(Action* action)
  * which will be created under the root configuration directory unless
  * the parameter value is an absolute path.
  *
- * This still follows the old convention of simply sending the maintenance
- * thread a message that a save should happen and expecting it to call
- * getPlaybackAudio when it is ready.
- *
- * Unlike capture which is stable, this is fraught with race conditions
- * because we're returning a pointer directly into a potentially active loop.
- * As long as the loop is not being modified it works well enough for
- * unit tests, but this can't be used reliably by end users.
- *
- * It would be MUCH better for this to make a copy of the loop
- * now while we're in the audio thread and pass the whole thing back
- * rather than making the thread call back to get a live object.
- * Takes a little more memory and since the copy happens in the audio thread
- * it could cause a buffer underrun, but at least it is less likely to crash.
+ * This used to send the maintenance thread a message and expect it to
+ * call back to flatten the play layer while the loop was still active,
+ * which was fraught with race conditions.  Now we make a LayerSnapshot
+ * here in the audio thread and pass it up with the event.  The snapshot
+ * shares Audio buffers with the loop so it is cheap to make.  The shell
+ * sends it back down when it has been written, see MobiusKernel.
  */
 void Mobius::saveLoop(Action* action)
 {
@@ -1333,6 +1436,7 @@ void Mobius::saveLoop(Action* action)
     KernelEvent* e = newKernelEvent();
     e->type = EventSaveLoop;
     e->setArg(0, file);
+    e->snapshot = getPlaybackSnapshot();
 
     if (action != NULL) {
         // here we save the event we're sending up on the Action
@@ -1344,30 +1448,206 @@ void Mobius::saveLoop(Action* action)
 }
 
 /**
- * Eventually called by KernelEvent handling to implement SaveLoop.
- *
- * Obvsiously serious race conditions here, but relatively safe
- * as long as you don't do a Reset while it is being saved.  Even then
- * the buffers will be returned to the pool so we should at least
- * not have invalid pointers.
- *
- * !! The Rehearse test scripts can get into a race condition
- * if they SaveLoop at the exact end of the loop when we're
- * about to enter another record phase.
- *
- * new: Yeah that sucks, see comments above Layer::flatten for some thoughts.
- *
+ * Capture the play layer of the active track for SaveLoop.
+ * This must be called in the audio thread.
  */
-Audio* Mobius::getPlaybackAudio()
+LayerSnapshot* Mobius::getPlaybackSnapshot()
 {
-    Audio* audio = mTrack->getPlaybackAudio();
+    LayerSnapshot* snapshot = mTrack->getPlaybackSnapshot();
 
     // since this might be saved to a file make sure the
     // sample rate is correct
-	if (audio != NULL)
-	  audio->setSampleRate(getSampleRate());
+	if (snapshot != NULL)
+	  snapshot->setSampleRate(getSampleRate());
+
+    return snapshot;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Projects
+//
+//////////////////////////////////////////////////////////////////////
 
-    return audio;
+/**
+ * Capture the state of the tracks in a Project for the Save statement.
+ *
+ * Old code did this outside the interrupt and gave the Project
+ * pointers to the live Audio objects, hoping nothing changed them
+ * before the files were written.  Now the layers are captured
+ * as LayerSnapshots which share buffers with the loops so this
+ * is cheap enough to do here.  They are flattened when the shell
+ * writes the file and must then be sent back, see Project::stealSnapshots.
+ *
+ * The binding overlay is no longer saved, bindings are managed
+ * by the UI now.
+ */
+Project* Mobius::saveProject()
+{
+    Project* p = NEW(Project);
+
+	if (mSetup != NULL)
+	  p->setSetup(mSetup->getName());
+
+	p->setTracks(this);
+	p->setFinished(true);
+
+    return p;
+}
+
+/**
+ * Load a Project built by the shell.
+ * This was loadProjectInternal in old code which was called at the
+ * start of the interrupt after the UI thread left it in mPendingProject.
+ * The project is now passed down in a message so we can do it
+ * immediately.  The project is not deleted, the kernel sends it
+ * back with whatever Audio we didn't use.
+ *
+ * Projects read from binary files may be followed by a second
+ * project containing the undo layers, see loadProjectHistory.
+ */
+void Mobius::loadProject(Project* p)
+{
+    if (p->isHistory()) {
+        loadProjectHistory(p);
+        return;
+    }
+    
+	p->resolveLayers(mLayerPool);
+
+	List* tracks = p->getTracks();
+
+    if (tracks == NULL) {
+        Trace(2, "Mobius::loadProject empty project\n");
+    }
+    else if (!p->isIncremental()) {
+		// globalReset to start from a clean slate
+		globalReset(NULL);
+
+		const char* name = p->getSetup();
+		if (name != NULL) {
+            if (mConfig->getSetup(name) != NULL)
+              setActiveSetup(name);
+            else
+              Trace(1, "Mobius::loadProject unknown setup %s\n", name);
+        }
+
+		// Global reset again to get the tracks adjusted to the 
+		// state in the Setup.
+		globalReset(NULL);
+
+        // should we let the project determine the track count
+        // or force the project to fit the configured tracks?
+		for (int i = 0 ; i < mTrackCount ; i++) {
+			if (i < tracks->size()) {
+				ProjectTrack* pt = (ProjectTrack*)tracks->get(i);
+				mTracks[i]->loadProject(pt);
+				if (pt->isActive())
+				  setActiveTrack(i);
+			}
+		}
+
+        // may now have master tracks
+        mSynchronizer->loadProject(p);
+	}
+	else {
+        // Replace only the loops in the project identified by number.
+        // Currently used only when loading individual loops.  Could beef
+        // this up so we can set more of the track.
+        // A negative number means the active track or loop.
+
+		for (int i = 0 ; i < tracks->size() ; i++) {
+			ProjectTrack* pt = (ProjectTrack*)tracks->get(i);
+            int tnum = pt->getNumber();
+            if (tnum < 0)
+              tnum = mTrack->getRawNumber();
+            
+            if (tnum >= mTrackCount)
+              Trace(1, "Incremental project load: track %ld is out of range\n",
+                    (long)tnum);
+            else {
+                Track* track = mTracks[tnum];
+
+                List* loops = pt->getLoops();
+                if (loops == NULL) 
+                  Trace(2, "Mobius::loadProject empty track\n");
+                else {
+                    for (int j = 0 ; j < loops->size() ; j++) {
+                        ProjectLoop* pl = (ProjectLoop*)loops->get(j);
+                        int lnum = pl->getNumber();
+                        if (lnum < 0)
+                          lnum = track->getLoop()->getNumber() - 1;
+                        
+                        // don't allow extending LoopCount
+                        if (lnum >= track->getLoopCount())
+                          Trace(1, "Incremental project load: loop %ld is out of range\n",
+                                (long)lnum);
+                        else {
+                            Loop* loop = track->getLoop(lnum);
+                            if (pl->isActive())
+                              track->setLoop(loop);
+                            else {
+                                // this is important for Loop::loadProject
+                                // to start it in Pause mode
+                                if (loop == track->getLoop())
+                                  pl->setActive(true);
+                            }
+
+                            loop->reset(NULL);
+                            loop->loadProject(pl);
+
+                            // Kludge: Synchronizer wants to be notified when
+                            // we load individual loops, but we're using
+                            // incremental projects to do that. Rather than
+                            // calling loadProject() call loadLoop() for
+                            // each track.
+                            // !! Revisit this, it would be nice to handle
+                            // these the same way
+                            if (loop == track->getLoop())
+                              mSynchronizer->loadLoop(loop);
+                        }
+                    }
+                }
+            }
+		}
+	}
+}
+
+/**
+ * Add the undo layers that were left out of the last project.
+ * Track and loop numbers are always specified.  Layers are only
+ * allocated for loops that can still take them, the Audio for the
+ * others goes back to the shell with the project.
+ */
+void Mobius::loadProjectHistory(Project* p)
+{
+	List* tracks = p->getTracks();
+    if (tracks != NULL) {
+		for (int i = 0 ; i < tracks->size() ; i++) {
+			ProjectTrack* pt = (ProjectTrack*)tracks->get(i);
+            int tnum = pt->getNumber();
+            List* loops = pt->getLoops();
+            if (tnum >= 0 && tnum < mTrackCount && loops != NULL) {
+                Track* track = mTracks[tnum];
+                for (int j = 0 ; j < loops->size() ; j++) {
+                    ProjectLoop* pl = (ProjectLoop*)loops->get(j);
+                    int lnum = pl->getNumber();
+                    if (lnum >= 0 && lnum < track->getLoopCount()) {
+                        Loop* loop = track->getLoop(lnum);
+                        if (!loop->canLoadHistory()) {
+                            Trace(2, "Mobius::loadProject loop %ld changed, ignoring history\n",
+                                  (long)lnum);
+                        }
+                        else {
+                            pl->allocLayers(mLayerPool);
+                            pl->resolveLayers(p);
+                            loop->loadHistory(pl);
+                        }
+                    }
+                }
+            }
+        }
+    }
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1636,34 +1916,49 @@ Function* Mobius::getFunction(const char * name)
 //////////////////////////////////////////////////////////////////////
 
 /**
- * Refresh and return the full MobiusState object.
+ * Return the most recently published MobiusState.
  * Called at regular intervals by the UI refresh thread.
- * We could just let the internal MobiusState object be retained by the
- * caller but this still serves as the mechanism to refresh it.
+ *
+ * This used to walk the tracks in the UI thread while the audio
+ * thread was changing them.  Now the state is built at the end of
+ * each interrupt by publishState and this just picks up the latest one.
+ * The returned object will not change until the next call.
  */
-
 MobiusState* Mobius::getState()
 {
-	MobiusState* s = &mState;
+	return mState.getReadState();
+}
+
+/**
+ * Fill in the next MobiusState and make it available to getState.
+ * Called at the end of every interrupt.
+ * Only the tracks and loops that exist are refreshed.
+ */
+void Mobius::publishState()
+{
+	MobiusState* s = mState.getWriteState();
 
 	// why not just keep it here?
     // this got lost, if you want it back just let this be the main location for it
-	//strcpy(mState.customMode, mCustomMode);
+	//strcpy(s->customMode, mCustomMode);
 
-	mState.globalRecording = mCapturing;
+	s->globalRecording = mCapturing;
 
     // OG Mobius only refreshed the active track, now we do all of them
     // since the TrackStrips will want most things
-    
-    for (int i = 0 ; i < mTrackCount ; i++) {
+    int count = (mTrackCount < MobiusStateMaxTracks) ? mTrackCount : MobiusStateMaxTracks;
+    for (int i = 0 ; i < count ; i++) {
         Track* t = mTracks[i];
-        MobiusTrackState* tstate = &(mState.tracks[i]);
+        MobiusTrackState* tstate = &(s->tracks[i]);
         t->getState(tstate);
     }
-    
-    mState.activeTrack = getActiveTrack();
 
-	return &mState;
+    s->trackCount = count;
+    s->activeTrack = getActiveTrack();
+
+    mProfiler->getState(&(s->profile));
+
+    mState.publish();
 }
 
 /**
@@ -96,7 +96,7 @@ class Mobius
     static void freeStaticObjects();
 
     /**
-     * Refresh and return state for the engine and the active track.
+     * Return the most recent state published by the audio thread.
      */
     class MobiusState* getState();
 
@@ -113,15 +113,35 @@ class Mobius
     class Audio* getCapture();
 
     /**
-     * Retrieve the contents of the current loop for the KernelEvent
-     * handler for SaveLoop.
+     * Capture the contents of the current loop for SaveLoop.
      */
-	class Audio* getPlaybackAudio();
+	class LayerSnapshot* getPlaybackSnapshot();
+
+    /**
+     * Capture the tracks for the Save statement, and load
+     * them back.  Both must be called in the audio thread.
+     */
+    class Project* saveProject();
+    void loadProject(class Project* p);
 
     /**
      * Special interface only for UnitTests
      */
     void slamScriptarian(class Scriptarian* scriptarian);
+
+    /**
+     * Special interface only for the offline Benchmark.
+     * When set, the seconds spent in each serially rendered track
+     * are added to this array, indexed by track number.
+     */
+    void setTrackTimes(double* times);
+
+    /**
+     * Interrupt timing, the kernel adds a few things of its own.
+     */
+    class BlockProfiler* getProfiler() {
+        return mProfiler;
+    }
     
     //////////////////////////////////////////////////////////////////////
     //
@@ -292,10 +312,16 @@ class Mobius
     void propagateConfiguration();
     void propagateFunctionPreferences();
     void propagateSetup();
+
+    // projects
+    void loadProjectHistory(class Project* p);
     
     // audio buffers
     void beginAudioInterrupt(class UIAction* actions);
+    bool renderParallel(class MobiusContainer* cont, class Track* master);
+    void advanceTrack(class MobiusContainer* cont, class Track* t);
     void endAudioInterrupt();
+    void publishState();
 
     //
     // Member Variables
@@ -322,6 +348,9 @@ class Mobius
     class Track** mTracks;
 	class Track* mTrack;
 	int mTrackCount;
+    class TrackRenderer* mTrackRenderer;
+    class BlockProfiler* mProfiler;
+    double* mTrackTimes;
     
 	class MobiusConfig *mConfig;
     class Setup* mSetup;
@@ -333,7 +362,7 @@ class Mobius
 	long mCaptureOffset;
 	
 	// state exposed to the outside world
-	MobiusState mState;
+	MobiusStateBuffer mState;
     
 	bool mHalting;
     
@@ -1,4 +1,4 @@
-// Formerly wrapped SoundTouch, stubbed out till we find something better
+// Formerly wrapped SoundTouch, now uses the built in WsolaPlugin
 
 /*
  * Copyright (c) 2010 Jeffrey S. Larson  <jeff@circularlabs.com>
@@ -25,6 +25,9 @@
  *
  * We started with PseudoPlugin during initial porting, then added
  * SoundTouchPlugin.
+ *
+ * SoundTouch was never brought over to the new build so WsolaPlugin
+ * does the shifting now, see the comments there.
  * 
  */
 
@@ -33,6 +36,8 @@
 #include <math.h>
 #include <string.h>
 
+#include <JuceHeader.h>
+
 //#include "SoundTouch.h"
 //using namespace soundtouch;
 
@@ -45,6 +50,12 @@
 #include "FadeWindow.h"
 #include "Mem.h"
 
+#if JUCE_USE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+#include <arm_neon.h>
+#endif
+
 Audio* Kludge = NULL;
 
 //////////////////////////////////////////////////////////////////////
@@ -89,6 +100,540 @@ void PseudoPlugin::updatePitch()
 {
 }
 
+//////////////////////////////////////////////////////////////////////
+//
+// WsolaPlugin
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Length of the crossfade when the read tap jumps.
+ */
+#define WSOLA_OVERLAP_MS 8.0f
+
+/**
+ * How far on either side of the jump we look for the best
+ * place to join.
+ */
+#define WSOLA_SEEK_MS 6.0f
+
+/**
+ * Length of the jump.
+ */
+#define WSOLA_SEQUENCE_MS 24.0f
+
+/**
+ * Ratios are limited to two octaves in either direction, beyond that
+ * the tap would catch up to the input during the crossfade.
+ */
+#define WSOLA_MAX_RATIO 4.0f
+
+/**
+ * Time domain pitch shifter.
+ *
+ * Input goes into a delay line and the output is read from it with
+ * a tap that moves at the pitch ratio, which is a simple resampler.
+ * Shifting up the tap gains on the input and shifting down it falls
+ * behind.  When it gets too close or too far the tap jumps back or
+ * ahead by about one sequence and crossfades from the old position
+ * to the new one.  The exact position of the jump is found by
+ * searching for the point that best matches the waveform under the old
+ * tap (WSOLA), which keeps the splice from being audible on pitched
+ * material.
+ *
+ * Between jumps the delay moves in a sawtooth around the center so that
+ * is what we report as latency.  Changing the ratio while shifting just
+ * changes the speed of the tap so there is no break.
+ *
+ * Everything is allocated in the constructor.  The delay line is kept
+ * twice, the second copy one buffer length after the first, so
+ * any window we read is contiguous and the join search is a
+ * SIMD dot product, see Correlate.  The taps can jump in the middle
+ * of a block so render goes a frame at a time, doing both channels
+ * of each tap at once.
+ *
+ * Only stereo is supported which is all Stream uses.
+ */
+class WsolaPlugin : public PitchPlugin {
+
+  public:
+
+    WsolaPlugin(int sampleRate);
+    ~WsolaPlugin();
+
+    void reset();
+    int getLatency();
+    bool canChangePitch();
+
+    long process(float* input, float* output, long frames);
+
+  protected:
+
+    void updatePitch();
+    long getAvailableFrames();
+    long getFrames(float* buffer, long frames);
+    void putFrames(float* buffer, long frames);
+
+  private:
+
+    void write(float* input, long frames);
+    void render(float* output, long frames, long base, bool draining);
+    void splice(long base);
+    int seek(long base, double oldDelay, double newDelay);
+    float correlate(const float* a, const float* b, int frames);
+    float favor(int offset);
+
+    // delay line geometry in frames
+    int mSize;
+    int mMask;
+    int mOverlap;
+    int mSeek;
+    int mSequence;
+    int mMinDelay;
+    int mMaxDelay;
+    int mLatency;
+
+    // where the tap jumps and how far for the current ratio
+    double mLow;
+    double mHigh;
+    double mJump;
+
+    // stereo and mono delay lines, mirrored
+    float* mBuffer;
+    float* mMono;
+
+    // next frame to write
+    long mWrite;
+
+    // ratio clamped to what we can do
+    float mRate;
+
+    // true when there is shifted content in the delay line
+    bool mActive;
+
+    // distance of the tap behind mWrite
+    double mDelay;
+
+    // the tap we're fading to during a jump
+    bool mFading;
+    double mFadeDelay;
+    int mFadeFrame;
+};
+
+WsolaPlugin::WsolaPlugin(int sampleRate)
+    : PitchPlugin(sampleRate)
+{
+    if (mSampleRate <= 0)
+      mSampleRate = 44100;
+
+    float msec = mSampleRate / 1000.0f;
+    mOverlap = (int)(WSOLA_OVERLAP_MS * msec);
+    mSeek = (int)(WSOLA_SEEK_MS * msec);
+    mSequence = (int)(WSOLA_SEQUENCE_MS * msec);
+
+    // the tap moves toward the input during a crossfade, leave
+    // room for the fastest ratio plus the interpolation frame
+    mMinDelay = (int)(mOverlap * (WSOLA_MAX_RATIO - 1.0f)) + mSeek + 8;
+    mMaxDelay = mMinDelay + mSequence + mSeek;
+    mLatency = mMinDelay + ((mSequence + mSeek) / 2);
+
+    // process() writes up to an overlap of input before reading,
+    // and a crossfading tap can fall another overlap behind
+    int needed = mMaxDelay + (mOverlap * 2) + mSeek + 16;
+    mSize = 1;
+    while (mSize < needed)
+      mSize <<= 1;
+    mMask = mSize - 1;
+
+    mBuffer = MemNewFloat("WsolaPlugin:buffer", mSize * 2 * mChannels);
+    mMono = MemNewFloat("WsolaPlugin:mono", mSize * 2);
+
+    mRate = 1.0f;
+    mActive = false;
+    mLow = mMinDelay;
+    mHigh = mMaxDelay;
+    mJump = mSequence;
+
+	// for shutdown fades when we can't drain enough
+	mTailWindow = NEW(FadeWindow);
+
+    reset();
+}
+
+WsolaPlugin::~WsolaPlugin()
+{
+    delete[] mBuffer;
+    delete[] mMono;
+}
+
+void WsolaPlugin::reset()
+{
+    memset(mBuffer, 0, sizeof(float) * mSize * 2 * mChannels);
+    memset(mMono, 0, sizeof(float) * mSize * 2);
+    mWrite = 0;
+    mDelay = mLatency;
+    mFading = false;
+    mFadeDelay = 0.0;
+    mFadeFrame = 0;
+    if (mTailWindow != NULL)
+      mTailWindow->reset();
+}
+
+int WsolaPlugin::getLatency()
+{
+    return mLatency;
+}
+
+bool WsolaPlugin::canChangePitch()
+{
+    return true;
+}
+
+/**
+ * Starting a shift begins with an empty delay line, the stream has
+ * already moved the play frame ahead by our latency.  Changing the
+ * ratio while shifting doesn't need anything but the new tap speed.
+ */
+void WsolaPlugin::updatePitch()
+{
+    if (mPitch == 1.0f) {
+        mActive = false;
+    }
+    else {
+        mRate = mPitch;
+        if (mRate > WSOLA_MAX_RATIO)
+          mRate = WSOLA_MAX_RATIO;
+        else if (mRate < 1.0f / WSOLA_MAX_RATIO)
+          mRate = 1.0f / WSOLA_MAX_RATIO;
+
+        // both taps move during the crossfade, the jump has to be
+        // long enough that the new one is still in range when it ends
+        double drift = mOverlap * fabs(mRate - 1.0);
+        mJump = mSequence;
+        if (mJump < mSeek + drift)
+          mJump = mSeek + drift;
+
+        // the delay averages half way between the jump point and
+        // where the new tap is when the fade ends, center that
+        // on the latency so it doesn't change with the ratio
+        double half = (mJump - drift) / 2.0;
+        mLow = mLatency - half;
+        mHigh = mLatency + half;
+
+        if (!mActive) {
+            reset();
+            startupFade();
+            mActive = true;
+        }
+    }
+}
+
+/**
+ * Add input to both copies of the delay lines.
+ */
+void WsolaPlugin::write(float* input, long frames)
+{
+    int channels = mChannels;
+    while (frames > 0) {
+        long span = mSize - mWrite;
+        if (span > frames)
+          span = frames;
+
+        float* dest = &mBuffer[mWrite * channels];
+        float* mirror = &mBuffer[(mWrite + mSize) * channels];
+        float* mono = &mMono[mWrite];
+        int samples = (int)(span * channels);
+        if (input != NULL) {
+            juce::FloatVectorOperations::copy(dest, input, samples);
+            juce::FloatVectorOperations::copy(mirror, input, samples);
+            for (long i = 0 ; i < span ; i++)
+              mono[i] = input[i * 2] + input[(i * 2) + 1];
+            input += samples;
+        }
+        else {
+            juce::FloatVectorOperations::clear(dest, samples);
+            juce::FloatVectorOperations::clear(mirror, samples);
+            juce::FloatVectorOperations::clear(mono, (int)span);
+        }
+        juce::FloatVectorOperations::copy(&mMono[mWrite + mSize], mono, (int)span);
+
+        mWrite = (mWrite + span) & mMask;
+        frames -= span;
+    }
+}
+
+/**
+ * Interpolate a stereo frame fraction of the way between src
+ * and the next frame, both channels at once.
+ */
+static inline void TapStereo(const float* src, float frac, float* dest)
+{
+#if JUCE_USE_SSE_INTRINSICS
+    __m128 frames = _mm_loadu_ps(src);
+    __m128 next = _mm_movehl_ps(frames, frames);
+    __m128 tap = _mm_add_ps(frames, _mm_mul_ps(_mm_sub_ps(next, frames),
+                                               _mm_set1_ps(frac)));
+    _mm_storel_pi((__m64*)dest, tap);
+#elif JUCE_USE_ARM_NEON
+    float32x2_t frame = vld1_f32(src);
+    float32x2_t next = vld1_f32(src + 2);
+    vst1_f32(dest, vmla_n_f32(frame, vsub_f32(next, frame), frac));
+#else
+    dest[0] = src[0] + (src[2] - src[0]) * frac;
+    dest[1] = src[1] + (src[3] - src[1]) * frac;
+#endif
+}
+
+/**
+ * Read frames from the tap.  Delays are relative to the write
+ * position, base is the position the first frame is read against.
+ * When input is being added this moves forward one frame per output
+ * frame.  When draining it stays put and the tap just moves toward it.
+ */
+void WsolaPlugin::render(float* output, long frames, long base, bool draining)
+{
+    double advance = (draining) ? -mRate : 1.0 - mRate;
+
+    for (long i = 0 ; i < frames ; i++) {
+        long position = (draining) ? base : base + i;
+        float* dest = &output[i * 2];
+
+        double pos = position - mDelay;
+        long index = (long)floor(pos);
+        TapStereo(&mBuffer[(index & mMask) * 2], (float)(pos - index), dest);
+
+        if (mFading) {
+            float fade[2];
+            pos = position - mFadeDelay;
+            index = (long)floor(pos);
+            TapStereo(&mBuffer[(index & mMask) * 2], (float)(pos - index), fade);
+
+            float gain = (float)mFadeFrame / (float)mOverlap;
+            dest[0] += (fade[0] - dest[0]) * gain;
+            dest[1] += (fade[1] - dest[1]) * gain;
+
+            mFadeDelay += advance;
+            mFadeFrame++;
+            if (mFadeFrame >= mOverlap) {
+                mDelay = mFadeDelay;
+                mFading = false;
+            }
+            else {
+                mDelay += advance;
+            }
+        }
+        else {
+            mDelay += advance;
+            // only jump when input is coming in, draining
+            // just uses what is left
+            if (!draining &&
+                ((mRate > 1.0f && mDelay < mLow) ||
+                 (mRate < 1.0f && mDelay > mHigh)))
+              splice(position + 1);
+        }
+    }
+}
+
+/**
+ * The tap went out of range, find where to jump and
+ * start the crossfade.
+ */
+void WsolaPlugin::splice(long base)
+{
+    double target;
+    if (mRate > 1.0f)
+      target = mDelay + mJump;
+    else
+      target = mDelay - mJump;
+
+    mFadeDelay = target + seek(base, mDelay, target);
+    mFadeFrame = 0;
+    mFading = true;
+}
+
+/**
+ * Find the offset from the new delay where the input looks most like
+ * what the old tap is about to play.  A coarse search every few
+ * frames is followed by a fine search around the best one.
+ */
+int WsolaPlugin::seek(long base, double oldDelay, double newDelay)
+{
+    int window = mOverlap;
+    const float* reference = &mMono[(base - (long)oldDelay) & mMask];
+    long start = base - (long)newDelay;
+
+    int best = 0;
+    float bestScore = -1.0e30f;
+    for (int offset = -mSeek ; offset <= mSeek ; offset += 4) {
+        // a larger delay is further back in the input
+        const float* candidate = &mMono[(start - offset) & mMask];
+        float score = correlate(reference, candidate, window) * favor(offset);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    }
+
+    int coarse = best;
+    for (int offset = coarse - 3 ; offset <= coarse + 3 ; offset++) {
+        if (offset != coarse && offset >= -mSeek && offset <= mSeek) {
+            const float* candidate = &mMono[(start - offset) & mMask];
+            float score = correlate(reference, candidate, window) * favor(offset);
+            if (score > bestScore) {
+                bestScore = score;
+                best = offset;
+            }
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Periodic material matches equally well every cycle, lean toward
+ * the middle of the search so the joins don't always land at one
+ * end and push the delay away from the latency we report.
+ */
+float WsolaPlugin::favor(int offset)
+{
+    float x = (float)offset / (float)mSeek;
+    return 1.0f - (0.25f * x * x);
+}
+
+/**
+ * Correlation of two windows, normalized by the energy of the
+ * candidate so loud places don't always win.  Four frames are done
+ * at once with four partial sums for each, summed at the end, and
+ * whatever is left over after the last group of four one at a time.
+ */
+float WsolaPlugin::correlate(const float* a, const float* b, int frames)
+{
+    float dot = 0.0f;
+    float energy = 0.0f;
+    int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+    __m128 dots = _mm_setzero_ps();
+    __m128 energies = _mm_setzero_ps();
+    for ( ; i + 4 <= frames ; i += 4) {
+        __m128 x = _mm_loadu_ps(&a[i]);
+        __m128 y = _mm_loadu_ps(&b[i]);
+        dots = _mm_add_ps(dots, _mm_mul_ps(x, y));
+        energies = _mm_add_ps(energies, _mm_mul_ps(y, y));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, dots);
+    dot = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, energies);
+    energy = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif JUCE_USE_ARM_NEON
+    float32x4_t dots = vdupq_n_f32(0.0f);
+    float32x4_t energies = vdupq_n_f32(0.0f);
+    for ( ; i + 4 <= frames ; i += 4) {
+        float32x4_t x = vld1q_f32(&a[i]);
+        float32x4_t y = vld1q_f32(&b[i]);
+        dots = vmlaq_f32(dots, x, y);
+        energies = vmlaq_f32(energies, y, y);
+    }
+    float32x2_t d = vadd_f32(vget_low_f32(dots), vget_high_f32(dots));
+    float32x2_t e = vadd_f32(vget_low_f32(energies), vget_high_f32(energies));
+    dot = vget_lane_f32(vpadd_f32(d, d), 0);
+    energy = vget_lane_f32(vpadd_f32(e, e), 0);
+#else
+    float dots[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float energies[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for ( ; i + 4 <= frames ; i += 4) {
+        for (int j = 0 ; j < 4 ; j++) {
+            dots[j] += a[i + j] * b[i + j];
+            energies[j] += b[i + j] * b[i + j];
+        }
+    }
+    dot = (dots[0] + dots[1]) + (dots[2] + dots[3]);
+    energy = (energies[0] + energies[1]) + (energies[2] + energies[3]);
+#endif
+
+    for ( ; i < frames ; i++) {
+        dot += a[i] * b[i];
+        energy += b[i] * b[i];
+    }
+    return dot / sqrtf(energy + 1.0e-9f);
+}
+
+/**
+ * The delay line always produces as many frames as it is given.
+ * At the start of a shift that is silence until the tap reaches the
+ * new input, which is what the stream latency adjustment is for.
+ */
+long WsolaPlugin::process(float* input, float* output, long frames)
+{
+    long processed = frames;
+    if (frames > 0) {
+        if (mChannels != 2) {
+            // not expecting this, pass it through
+            if (input != NULL)
+              memcpy(output, input, sizeof(float) * frames * mChannels);
+            else
+              memset(output, 0, sizeof(float) * frames * mChannels);
+        }
+        else {
+            // split the block so we never write over what the tap
+            // still has to read
+            while (frames > 0) {
+                long chunk = frames;
+                if (chunk > mOverlap)
+                  chunk = mOverlap;
+
+                long base = mWrite;
+                write(input, chunk);
+                render(output, chunk, base + 1, false);
+
+                if (input != NULL)
+                  input += (chunk * 2);
+                output += (chunk * 2);
+                frames -= chunk;
+            }
+        }
+    }
+
+    mBlocks++;
+    return processed;
+}
+
+/**
+ * Frames we can play from what is in the delay line without
+ * any more input, used for the shutdown fade tail.
+ */
+long WsolaPlugin::getAvailableFrames()
+{
+    long avail = 0;
+    double delay = (mFading && mFadeDelay < mDelay) ? mFadeDelay : mDelay;
+    if (delay > 2.0)
+      avail = (long)((delay - 2.0) / mRate);
+    return avail;
+}
+
+long WsolaPlugin::getFrames(float* buffer, long frames)
+{
+    long avail = getAvailableFrames();
+    if (frames > avail)
+      frames = avail;
+    if (frames > 0 && mChannels == 2)
+      render(buffer, frames, mWrite, true);
+    return frames;
+}
+
+void WsolaPlugin::putFrames(float* buffer, long frames)
+{
+    if (frames > 0 && mChannels == 2) {
+        // the tap stays where it was in the input so it
+        // falls further behind
+        write(buffer, frames);
+        mDelay += frames;
+        if (mFading)
+          mFadeDelay += frames;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // SoundTouchPlugin
@@ -564,7 +1109,8 @@ long SoundTouchPlugin::process(float* input, float* output,
 
 PitchPlugin* PitchPlugin::getPlugin(int sampleRate)
 {
-	return NEW1(PseudoPlugin, 0);
+	return NEW1(WsolaPlugin, sampleRate);
+	//return NEW1(PseudoPlugin, 0);
 	//return new SoundTouchPlugin(sampleRate);
 }
 
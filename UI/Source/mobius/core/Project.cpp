@@ -298,8 +298,11 @@ ProjectLayer::ProjectLayer(MobiusConfig* config, Project* p, Layer* l)
     // if NoFlattening is on then we must save segments
     if (!l->isNoFlattening()) {
 
-        // this will make a copy we own
-        setAudio(l->flatten());
+        // this is called in the audio thread, flattening is
+        // too expensive to do here so capture the layer and let
+        // the shell flatten it when the project is written
+        mSnapshot = new LayerSnapshot(l);
+        mSnapshot->setSampleRate(l->getLoop()->getMobius()->getSampleRate());
 
         // the Isolated Overdubs global parameter was experimental
         // and is no longer exposed, so this should never be true
@@ -324,12 +327,16 @@ ProjectLayer::ProjectLayer(MobiusConfig* config, Project* p, Layer* l)
 		}
     }
 	else {
-		// we don't own the Audio objects so don't delete them
-		mExternalAudio = true;
-
+        // this used to reference the Audio owned by the layer and
+        // set mExternalAudio, but the project is now written after the
+        // loop has moved on so keep a copy, which shares buffers
 		Audio* a = l->getAudio();
-		if (!a->isEmpty())
-		  setAudio(a);
+		if (!a->isEmpty()) {
+            Audio* copy = a->getPool()->newAudio();
+            copy->copy(a);
+            copy->setSampleRate(l->getLoop()->getMobius()->getSampleRate());
+            setAudio(copy);
+        }
 
 		for (Segment* seg = l->getSegments() ; seg != NULL ; 
 			 seg = seg->getNext()) {
@@ -361,7 +368,10 @@ void ProjectLayer::init()
     mProtected = false;
 	mDeferredFadeLeft = false;
 	mDeferredFadeRight = false;
+	mContainsDeferredFadeLeft = false;
+	mContainsDeferredFadeRight = false;
 	mReverseRecord = false;
+	mSnapshot = NULL;
 	mLayer = NULL;
 }
 
@@ -372,6 +382,9 @@ ProjectLayer::~ProjectLayer()
 		delete mAudio;
 		delete mOverdub;
 	}
+    // this is only safe in the kernel, the shell must
+    // use Project::stealSnapshots before deleting
+    delete mSnapshot;
 	if (mSegments != NULL) {
 		for (int i = 0 ; i < mSegments->size() ; i++) {
 			ProjectSegment* s = (ProjectSegment*)mSegments->get(i);
@@ -449,6 +462,11 @@ int ProjectLayer::getId()
 	return mId;
 }
 
+void ProjectLayer::setId(int i)
+{
+	mId = i;
+}
+
 Layer* ProjectLayer::getLayer()
 {
 	return mLayer;
@@ -496,6 +514,42 @@ Audio* ProjectLayer::getOverdub()
 	return mOverdub;
 }
 
+LayerSnapshot* ProjectLayer::getSnapshot()
+{
+	return mSnapshot;
+}
+
+LayerSnapshot* ProjectLayer::stealSnapshot()
+{
+	LayerSnapshot* s = mSnapshot;
+	mSnapshot = NULL;
+	return s;
+}
+
+/**
+ * Convert the snapshot captured in the audio thread into an
+ * Audio we own.  The snapshot is kept so it can be returned
+ * to the kernel.  This may be called from any thread.
+ */
+void ProjectLayer::flatten()
+{
+	if (mSnapshot != NULL && mAudio == NULL)
+	  setAudio(mSnapshot->flatten());
+}
+
+/**
+ * The length of the layer, available before it is flattened.
+ */
+long ProjectLayer::getFrames()
+{
+	long frames = 0;
+	if (mAudio != NULL)
+	  frames = mAudio->getFrames();
+	else if (mSnapshot != NULL)
+	  frames = mSnapshot->getFrames();
+	return frames;
+}
+
 Audio* ProjectLayer::stealOverdub()
 {
 	Audio* a = mOverdub;
@@ -565,6 +619,26 @@ bool ProjectLayer::isReverseRecord()
 	return mReverseRecord;
 }
 
+void ProjectLayer::setContainsDeferredFadeLeft(bool b)
+{
+	mContainsDeferredFadeLeft = b;
+}
+
+bool ProjectLayer::isContainsDeferredFadeLeft()
+{
+	return mContainsDeferredFadeLeft;
+}
+
+void ProjectLayer::setContainsDeferredFadeRight(bool b)
+{
+	mContainsDeferredFadeRight = b;
+}
+
+bool ProjectLayer::isContainsDeferredFadeRight()
+{
+	return mContainsDeferredFadeRight;
+}
+
 void ProjectLayer::add(ProjectSegment* seg)
 {
 	if (mSegments == NULL)
@@ -572,11 +646,19 @@ void ProjectLayer::add(ProjectSegment* seg)
 	mSegments->add(seg);
 }
 
+List* ProjectLayer::getSegments()
+{
+	return mSegments;
+}
+
 void ProjectLayer::writeAudio(const char* baseName, int tracknum, int loopnum,
 							  int layernum)
 {
 	char path[1024];
 
+    // projects captured in the audio thread haven't been flattened yet
+    flatten();
+
     if (mAudio != NULL && !mAudio->isEmpty() && !mProtected) {
 
         // todo: need to support inline audio in the XML
@@ -1361,6 +1443,7 @@ void Project::init()
 	mError = false;
 	strcpy(mMessage, "");
 	mIncremental = false;
+	mHistory = false;
     mIncludeAudio = true;
 
 	mFile = NULL;
@@ -1539,6 +1622,16 @@ bool Project::isIncremental()
 	return mIncremental;
 }
 
+void Project::setHistory(bool b)
+{
+	mHistory = b;
+}
+
+bool Project::isHistory()
+{
+	return mHistory;
+}
+
 void Project::setFinished(bool b)
 {
 	mFinished = b;
@@ -1549,6 +1642,40 @@ bool Project::isFinished()
 	return mFinished;
 }
 
+/**
+ * Remove the layer snapshots captured when the project was built
+ * and return them as a list.  Projects built in the audio thread
+ * are deleted by the shell, but the snapshots have to go back
+ * to the kernel.
+ */
+LayerSnapshot* Project::stealSnapshots()
+{
+	LayerSnapshot* list = NULL;
+	if (mTracks != NULL) {
+		for (int i = 0 ; i < mTracks->size() ; i++) {
+			ProjectTrack* t = (ProjectTrack*)mTracks->get(i);
+			List* loops = t->getLoops();
+			if (loops != NULL) {
+				for (int j = 0 ; j < loops->size() ; j++) {
+					ProjectLoop* l = (ProjectLoop*)loops->get(j);
+					List* layers = l->getLayers();
+					if (layers != NULL) {
+						for (int k = 0 ; k < layers->size() ; k++) {
+							ProjectLayer* pl = (ProjectLayer*)layers->get(k);
+							LayerSnapshot* s = pl->stealSnapshot();
+							if (s != NULL) {
+								s->setNext(list);
+								list = s;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	return list;
+}
+
 /**
  * Delete all of the external layer files associated with 
  * this project.  This is called prior to saving a project so 
@@ -80,6 +80,7 @@ class ProjectLayer {
     ~ProjectLayer();
 
 	int getId();
+	void setId(int i);
 
 	void setCycles(int i);
 	int getCycles();
@@ -91,6 +92,11 @@ class ProjectLayer {
     Audio* getOverdub();
     Audio* stealOverdub();
 
+    class LayerSnapshot* getSnapshot();
+    class LayerSnapshot* stealSnapshot();
+    void flatten();
+    long getFrames();
+
 	void setBuffers(int i);
 	int getBuffers();
 
@@ -103,6 +109,7 @@ class ProjectLayer {
     bool isProtected();
 
 	void add(ProjectSegment* seg);
+	class List* getSegments();
 
 	void writeAudio(const char* baseName, int tracknum, int loopnum, 
 					int layernum);
@@ -115,6 +122,10 @@ class ProjectLayer {
 	bool isDeferredFadeRight();
 	void setReverseRecord(bool b);
 	bool isReverseRecord();
+	void setContainsDeferredFadeLeft(bool b);
+	bool isContainsDeferredFadeLeft();
+	void setContainsDeferredFadeRight(bool b);
+	bool isContainsDeferredFadeRight();
 
 	Layer* getLayer();
 	Layer* allocLayer(class LayerPool* pool);
@@ -151,6 +162,13 @@ class ProjectLayer {
 	 */
 	bool mExternalAudio;
 
+	/**
+	 * Set when the project is captured in the audio thread.
+	 * The layer is flattened later by whoever saves the project,
+	 * the snapshot must then be given back to the kernel.
+	 */
+	class LayerSnapshot* mSnapshot;
+
 	/**
 	 * Transient, set during project loading.
 	 * Segments can reference layers by id, and the layers can appear
@@ -294,8 +312,8 @@ class ProjectTrack {
 	void add(ProjectLoop* l);
 	class List* getLoops();
 
-	void setVariable(const char* name, ExValue* value);
-	void getVariable(const char* name, ExValue* value);
+	void setVariable(const char* name, class ExValue* value);
+	void getVariable(const char* name, class ExValue* value);
 
 	Layer* findLayer(int id);
 	void allocLayers(class LayerPool* pool);
@@ -395,7 +413,7 @@ class Project {
 	void clear();
 	Layer* findLayer(int id);
 	void resolveLayers(class LayerPool* pool);
-	void setTracks(Mobius* m);
+	void setTracks(class Mobius* m);
 	void add(ProjectTrack* t);
 	class List* getTracks();
 
@@ -424,6 +442,9 @@ class Project {
 	void setIncremental(bool b);
 	bool isIncremental();
 
+	void setHistory(bool b);
+	bool isHistory();
+
 	//
 	// Save options
 	//
@@ -443,6 +464,8 @@ class Project {
 	bool isFinished();
 	void setFinished(bool b);
 
+    class LayerSnapshot* stealSnapshots();
+
     void deleteAudioFiles();
 
 	void toXml(class XmlBuffer* b);
@@ -519,6 +542,13 @@ class Project {
 	 */
 	bool mIncremental;
 
+	/**
+	 * When true, the project contains only undo layers for loops
+	 * that were already loaded by an earlier project.
+	 * See Loop::loadHistory.
+	 */
+	bool mHistory;
+
     /**
      * When true, layer Audio will loaded with the project.
      * WHen false, only the path name to the layer Audio file
@@ -17,14 +17,23 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
+#include <JuceHeader.h>
+
 #include "../../util/Util.h"
 #include "../../util/Trace.h"
 
 #include "Resampler.h"
 #include "Mem.h"
 
+#if JUCE_USE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+#include <arm_neon.h>
+#endif
+
 /****************************************************************************
  *                                                                          *
  *   							  UTILITIES                                 *
@@ -145,6 +154,36 @@ float Resampler::getSpeed(int octave, int step, int bend, int stretch)
     return speed;
 }
 
+const char* Resampler::getQualityName(ResampleQuality q)
+{
+    const char* name = "linear";
+    if (q == RESAMPLE_CUBIC)
+      name = "cubic";
+    else if (q == RESAMPLE_SINC16)
+      name = "sinc16";
+    else if (q == RESAMPLE_SINC64)
+      name = "sinc64";
+    return name;
+}
+
+/**
+ * Rough cost of each quality tier, the number of multiplies
+ * per stereo output frame.  The sinc tiers interpolate one
+ * coefficient per tap then do a dot product for each channel.
+ * This is used to decide which tracks can afford the better ones.
+ */
+int Resampler::getQualityCost(ResampleQuality q)
+{
+    int cost = 4;
+    if (q == RESAMPLE_CUBIC)
+      cost = 20;
+    else if (q == RESAMPLE_SINC16)
+      cost = 16 * 3;
+    else if (q == RESAMPLE_SINC64)
+      cost = 64 * 3;
+    return cost;
+}
+
 /****************************************************************************
  *                                                                          *
  *                                 RESAMPLER                                *
@@ -170,6 +209,15 @@ void Resampler::init()
 	mInverseSpeed = (float)(1.0f / mSpeed);
     mChannels = 2;
 
+    mQuality = RESAMPLE_LINEAR;
+    mTaps = 2;
+    mCutoff = 0.0f;
+    mKernel = MemNewFloat("Resampler:kernel", 
+                          (RESAMPLE_PHASES + 1) * MAX_RESAMPLE_TAPS);
+    memset(mHistory, 0, sizeof(mHistory));
+    memset(mSeam, 0, sizeof(mSeam));
+    initWindows();
+
 	reset();
 
 	for (int i = 0 ; i < mChannels ; i++)
@@ -178,6 +226,7 @@ void Resampler::init()
 
 Resampler::~Resampler()
 {
+    delete[] mKernel;
 }
 
 void Resampler::reset()
@@ -212,6 +261,7 @@ void Resampler::setSpeed(float speed)
 		mThreshold = 1.0f;
 		mSpeed = speed;
 		mInverseSpeed = (float)(1.0 / mSpeed);
+        buildKernel();
 	}
 }
 
@@ -301,6 +351,8 @@ long Resampler::resample(float* src, long srcFrames,
 			}
 		}
 
+        keep(src, srcFrames);
+
         for (int i = 0 ; i < samples ; i++)
           *dest++ = *src++;
 
@@ -493,6 +545,9 @@ long Resampler::transpose(float* src, long srcFrames,
 	// might happen if we're processing events stacked on the same frame
 	if (srcFrames <= 0) return 0;
 
+    if (mQuality != RESAMPLE_LINEAR)
+      prepareHistory(src, srcFrames);
+
 	// if this comes in less than 1 assume there is enough
 	if (destFrames > 0)
 	  lastDestFrame = &dest[(destFrames - 1) * mChannels];
@@ -501,11 +556,17 @@ long Resampler::transpose(float* src, long srcFrames,
 
     // combine last frame from previous block with first frame of this block
     while (mThreshold <= 1.0f) {
-		for (int i = 0 ; i < mChannels ; i++) {
-			float f1 = (1.0f - mThreshold) * mLastFrame[i];
-			float f2 = mThreshold * srcFrame[i];
-			*destFrame++ = f1 + f2;
-		}
+        if (mQuality != RESAMPLE_LINEAR) {
+            interpolate(src, -1, mThreshold, destFrame);
+            destFrame += mChannels;
+        }
+        else {
+            for (int i = 0 ; i < mChannels ; i++) {
+                float f1 = (1.0f - mThreshold) * mLastFrame[i];
+                float f2 = mThreshold * srcFrame[i];
+                *destFrame++ = f1 + f2;
+            }
+        }
 		advance++;
         mThreshold += speed;
     }
@@ -535,11 +596,18 @@ long Resampler::transpose(float* src, long srcFrames,
 			Trace(1, "Transposition remainder overflow!\n");
 		}
 		else { 
-			for (int i = 0 ; i < mChannels ; i++) {
-				float f1 = (1.0f - mThreshold) * srcFrame[i];
-				float f2 = mThreshold * nextFrame[i];
-				*destFrame++ = f1 + f2;
-			}
+            if (mQuality != RESAMPLE_LINEAR) {
+                interpolate(src, (long)((srcFrame - src) / mChannels),
+                            mThreshold, destFrame);
+                destFrame += mChannels;
+            }
+            else {
+                for (int i = 0 ; i < mChannels ; i++) {
+                    float f1 = (1.0f - mThreshold) * srcFrame[i];
+                    float f2 = mThreshold * nextFrame[i];
+                    *destFrame++ = f1 + f2;
+                }
+            }
 			advance++;
 
 			if (remainder)
@@ -566,6 +634,7 @@ long Resampler::transpose(float* src, long srcFrames,
         for (int i = 0 ; i < mChannels ; i++)
           mLastFrame[i] = lastFrame[i];
     }
+    keep(src, srcFrames);
 
 	if (destFrames > 0 && advance < destFrames)
 	  Trace(1, "Transposition underflow!\n");
@@ -586,6 +655,339 @@ void Resampler::transposeOnce(float* src, float* dest,
     transpose(src, frames, dest, 0, speed);
 }
 
+/****************************************************************************
+ *                                                                          *
+ *   							   KERNELS                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+#define RESAMPLE_PI 3.14159265358979
+
+/**
+ * Kaiser windows for the sinc tiers, shared by all Resamplers.
+ * These only depend on the tap position so they are calculated once,
+ * the kernels are rebuilt from them when the cutoff changes.
+ */
+static float Sinc16Window[(RESAMPLE_PHASES + 1) * 16];
+static float Sinc64Window[(RESAMPLE_PHASES + 1) * 64];
+static bool WindowsInitialized = false;
+
+/**
+ * Window shape and how far below Nyquist the cutoff is.  The shorter
+ * kernel has a wider transition band so it needs to start earlier.
+ */
+#define SINC16_BETA 5.0
+#define SINC16_ROLLOFF 0.80f
+#define SINC64_BETA 8.5
+#define SINC64_ROLLOFF 0.92f
+
+static double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double half = x / 2.0;
+    for (int k = 1 ; k < 50 ; k++) {
+        double f = half / k;
+        term *= (f * f);
+        sum += term;
+        if (term < sum * 1.0e-12)
+          break;
+    }
+    return sum;
+}
+
+static void BuildWindow(float* window, int taps, double beta)
+{
+    double half = taps / 2;
+    double norm = BesselI0(beta);
+    for (int p = 0 ; p <= RESAMPLE_PHASES ; p++) {
+        for (int j = 0 ; j < taps ; j++) {
+            // distance of the tap from the interpolated position
+            double x = (j - half + 1) - ((double)p / RESAMPLE_PHASES);
+            double r = x / half;
+            double w = 0.0;
+            if (r > -1.0 && r < 1.0)
+              w = BesselI0(beta * sqrt(1.0 - (r * r))) / norm;
+            window[(p * taps) + j] = (float)w;
+        }
+    }
+}
+
+/**
+ * Done when the first Resampler is constructed which is
+ * during Track construction, never in the interrupt.
+ */
+void Resampler::initWindows()
+{
+    if (!WindowsInitialized) {
+        BuildWindow(Sinc16Window, 16, SINC16_BETA);
+        BuildWindow(Sinc64Window, 64, SINC64_BETA);
+        WindowsInitialized = true;
+    }
+}
+
+ResampleQuality Resampler::getQuality()
+{
+    return mQuality;
+}
+
+/**
+ * Change the interpolation quality.  The history is cleared
+ * so the new kernel starts from silence rather than frames
+ * that may be from a long time ago.
+ */
+void Resampler::setQuality(ResampleQuality q)
+{
+    if (q != mQuality) {
+        mQuality = q;
+        if (q == RESAMPLE_CUBIC)
+          mTaps = 4;
+        else if (q == RESAMPLE_SINC16)
+          mTaps = 16;
+        else if (q == RESAMPLE_SINC64)
+          mTaps = 64;
+        else
+          mTaps = 2;
+
+        memset(mHistory, 0, sizeof(mHistory));
+        mCutoff = 0.0f;
+        buildKernel();
+
+        Trace(2, "Resampler: %s quality, %ld multiplies per frame\n",
+              getQualityName(q), (long)getQualityCost(q));
+    }
+}
+
+/**
+ * The kernels are centered half way through the taps so the
+ * output is this many source frames behind the position the
+ * threshold says we're at.  Returned in loop frames for the
+ * given playback speed, the input stream source is the interrupt
+ * block so it is scaled.  Nothing is resampled at 1.0.
+ */
+int Resampler::getLatency(float speed)
+{
+    int latency = 0;
+    if (speed != 1.0) {
+        int delay = (mTaps / 2) - 1;
+        if (mInput)
+          latency = (int)ceil(delay * speed);
+        else
+          latency = delay;
+    }
+    return latency;
+}
+
+/**
+ * Calculate the sinc tables for the current speed.  When decimating
+ * the cutoff drops with the speed so what is above the new Nyquist
+ * frequency doesn't alias.  The tap count stays the same so the
+ * transition band gets wider, but it is still far better than
+ * the linear interpolator.
+ *
+ * This is called in the interrupt when the speed changes.  The sines
+ * are stepped with a rotation rather than calling sin() for every
+ * coefficient so it is cheap enough to do on every bend change.
+ */
+void Resampler::buildKernel()
+{
+    if (mQuality != RESAMPLE_SINC16 && mQuality != RESAMPLE_SINC64)
+      return;
+
+    const float* window = Sinc64Window;
+    float cutoff = SINC64_ROLLOFF;
+    if (mQuality == RESAMPLE_SINC16) {
+        window = Sinc16Window;
+        cutoff = SINC16_ROLLOFF;
+    }
+
+    float speed = ((mInput) ? mInverseSpeed : mSpeed);
+    if (speed > 1.0f)
+      cutoff /= speed;
+
+    if (cutoff == mCutoff)
+      return;
+    mCutoff = cutoff;
+
+    int taps = mTaps;
+    double half = taps / 2;
+    double step = RESAMPLE_PI * cutoff;
+    double stepSin = sin(step);
+    double stepCos = cos(step);
+
+    for (int p = 0 ; p <= RESAMPLE_PHASES ; p++) {
+        float* row = &mKernel[p * taps];
+        const float* wrow = &window[p * taps];
+        double x = (1 - half) - ((double)p / RESAMPLE_PHASES);
+        double s = sin(step * x);
+        double c = cos(step * x);
+        double sum = 0.0;
+
+        for (int j = 0 ; j < taps ; j++) {
+            double h;
+            if (fabs(x) < 1.0e-9)
+              h = cutoff;
+            else
+              h = s / (RESAMPLE_PI * x);
+            h *= wrow[j];
+            row[j] = (float)h;
+            sum += h;
+
+            double next = (s * stepCos) + (c * stepSin);
+            c = (c * stepCos) - (s * stepSin);
+            s = next;
+            x += 1.0;
+        }
+
+        // normalize each phase so the gain doesn't ripple
+        // with the fractional position
+        if (sum != 0.0) {
+            float scale = (float)(1.0 / sum);
+            for (int j = 0 ; j < taps ; j++)
+              row[j] *= scale;
+        }
+    }
+}
+
+/**
+ * Remember the last source frames for the taps that reach back
+ * before the next block.  This is also called when the stream is
+ * at 1.0 and not resampling so it has the right history when the
+ * speed changes.  Linear keeps just mLastFrame like it always has.
+ */
+void Resampler::keep(float* src, long frames)
+{
+    if (mQuality == RESAMPLE_LINEAR || frames <= 0)
+      return;
+
+    int channels = mChannels;
+    long keepFrames = mTaps - 1;
+    if (frames >= keepFrames) {
+        memcpy(mHistory, &src[(frames - keepFrames) * channels], 
+               sizeof(float) * keepFrames * channels);
+    }
+    else {
+        long shift = keepFrames - frames;
+        memmove(mHistory, &mHistory[frames * channels],
+                sizeof(float) * shift * channels);
+        memcpy(&mHistory[shift * channels], src, 
+               sizeof(float) * frames * channels);
+    }
+}
+
+/**
+ * Put the history in front of the start of the source block so
+ * the first few output frames can read their taps contiguously.
+ * Later frames read straight from the source.
+ */
+void Resampler::prepareHistory(float* src, long srcFrames)
+{
+    int channels = mChannels;
+    long keepFrames = mTaps - 1;
+    long copyFrames = (srcFrames < keepFrames) ? srcFrames : keepFrames;
+    memcpy(mSeam, mHistory, sizeof(float) * keepFrames * channels);
+    memcpy(&mSeam[keepFrames * channels], src,
+           sizeof(float) * copyFrames * channels);
+}
+
+/**
+ * Dot product of the coefficients with interleaved stereo taps.
+ * Each pair of coefficients is duplicated so two frames are
+ * multiplied at once, the even and odd frames are summed at the end.
+ * The tap counts are all even.
+ */
+static inline void DotStereo(const float* coefficients, const float* input,
+                             int taps, float* dest)
+{
+#if JUCE_USE_SSE_INTRINSICS
+    __m128 sum = _mm_setzero_ps();
+    for (int j = 0 ; j < taps ; j += 2) {
+        __m128 c = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&coefficients[j]);
+        c = _mm_unpacklo_ps(c, c);
+        sum = _mm_add_ps(sum, _mm_mul_ps(c, _mm_loadu_ps(&input[j * 2])));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    dest[0] = lanes[0] + lanes[2];
+    dest[1] = lanes[1] + lanes[3];
+#elif JUCE_USE_ARM_NEON
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (int j = 0 ; j < taps ; j += 2) {
+        float32x2_t c = vld1_f32(&coefficients[j]);
+        float32x2x2_t pair = vzip_f32(c, c);
+        sum = vmlaq_f32(sum, vcombine_f32(pair.val[0], pair.val[1]),
+                        vld1q_f32(&input[j * 2]));
+    }
+    dest[0] = vgetq_lane_f32(sum, 0) + vgetq_lane_f32(sum, 2);
+    dest[1] = vgetq_lane_f32(sum, 1) + vgetq_lane_f32(sum, 3);
+#else
+    float left = 0.0f;
+    float right = 0.0f;
+    for (int j = 0 ; j < taps ; j++) {
+        left += coefficients[j] * input[j * 2];
+        right += coefficients[j] * input[(j * 2) + 1];
+    }
+    dest[0] = left;
+    dest[1] = right;
+#endif
+}
+
+/**
+ * Calculate one output frame between source frame and frame + 1,
+ * fraction of the way.  Frame -1 is the last one in the previous block.
+ * The kernel is delayed so the last tap is frame + 1 which is the
+ * furthest transpose() ever looks ahead.
+ */
+void Resampler::interpolate(float* src, long frame, float fraction, 
+                            float* dest)
+{
+    float coefficients[MAX_RESAMPLE_TAPS];
+    int taps = mTaps;
+    int channels = mChannels;
+
+    long first = frame - taps + 2;
+    const float* input;
+    if (first >= 0)
+      input = &src[first * channels];
+    else
+      input = &mSeam[(first + taps - 1) * channels];
+
+    if (mQuality == RESAMPLE_CUBIC) {
+        // Catmull-Rom between the middle two
+        float t = fraction;
+        float t2 = t * t;
+        float t3 = t2 * t;
+        coefficients[0] = 0.5f * (-t3 + (2.0f * t2) - t);
+        coefficients[1] = 0.5f * ((3.0f * t3) - (5.0f * t2) + 2.0f);
+        coefficients[2] = 0.5f * ((-3.0f * t3) + (4.0f * t2) + t);
+        coefficients[3] = 0.5f * (t3 - t2);
+    }
+    else {
+        float position = fraction * RESAMPLE_PHASES;
+        int phase = (int)position;
+        if (phase >= RESAMPLE_PHASES)
+          phase = RESAMPLE_PHASES - 1;
+        float delta = position - phase;
+        const float* k0 = &mKernel[phase * taps];
+        const float* k1 = k0 + taps;
+        juce::FloatVectorOperations::subtract(coefficients, k1, k0, taps);
+        juce::FloatVectorOperations::multiply(coefficients, delta, taps);
+        juce::FloatVectorOperations::add(coefficients, k0, taps);
+    }
+
+    if (channels == 2) {
+        DotStereo(coefficients, input, taps, dest);
+    }
+    else {
+        for (int i = 0 ; i < channels ; i++) {
+            float sample = 0.0f;
+            for (int j = 0 ; j < taps ; j++)
+              sample += coefficients[j] * input[(j * channels) + i];
+            dest[i] = sample;
+        }
+    }
+}
+
 /****************************************************************************
  *                                                                          *
  *   								TESTS                                   *
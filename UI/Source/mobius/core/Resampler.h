@@ -110,6 +110,37 @@
  */
 #define BEND_FACTOR 1.000085f
 
+/**
+ * Maximum number of source frames used to calculate one output frame.
+ */
+#define MAX_RESAMPLE_TAPS 64
+
+/**
+ * Number of fractional positions in the sinc kernel tables.
+ * Coefficients between two phases are interpolated.
+ */
+#define RESAMPLE_PHASES 64
+
+/**
+ * Interpolation quality.
+ *
+ * Linear is the original algorithm, cheap but it aliases badly
+ * when the speed is far from 1.0.  Cubic is a 4 point Catmull-Rom spline.
+ * The sinc tiers are band limited with a Kaiser windowed kernel
+ * whose cutoff follows the speed so decimation doesn't alias.
+ *
+ * Everything other than linear delays the audio by a few source frames,
+ * see getLatency.
+ */
+typedef enum {
+
+    RESAMPLE_LINEAR,
+    RESAMPLE_CUBIC,
+    RESAMPLE_SINC16,
+    RESAMPLE_SINC64
+
+} ResampleQuality;
+
 //////////////////////////////////////////////////////////////////////
 // 
 // Resampler
@@ -129,6 +160,8 @@ class Resampler {
 	//
 
     static float getSpeed(int octave, int step, int bend, int stretch);
+    static const char* getQualityName(ResampleQuality q);
+    static int getQualityCost(ResampleQuality q);
 
     // 
     // Methods called by Stream
@@ -136,6 +169,10 @@ class Resampler {
     
 	void reset();
     void setSpeed(float speed);
+    void setQuality(ResampleQuality q);
+    ResampleQuality getQuality();
+    int getLatency(float speed);
+    void keep(float* src, long frames);
     long addRemainder(float* buffer, long maxFrames);
 	float getThreshold();
 
@@ -174,6 +211,11 @@ class Resampler {
 	long scaleToDestFrames(float speed, float threshold, long srcFrames);
 	long scaleToSourceFrames(float speed, float threshold, long destFrames);
 
+    static void initWindows();
+    void buildKernel();
+    void prepareHistory(float* src, long srcFrames);
+    void interpolate(float* src, long frame, float fraction, float* dest);
+
 	//
 	// Fields
 	//
@@ -188,6 +230,17 @@ class Resampler {
 	float mLastFrame[AUDIO_MAX_CHANNELS];
 	float mThreshold;
 
+    // kernel interpolation
+    ResampleQuality mQuality;
+    int mTaps;
+    float mCutoff;
+    float* mKernel;
+
+    // the last mTaps - 1 source frames followed by the start of the
+    // current source block, for taps that reach back before it
+    float mHistory[(MAX_RESAMPLE_TAPS - 1) * AUDIO_MAX_CHANNELS];
+    float mSeam[((MAX_RESAMPLE_TAPS * 2) - 2) * AUDIO_MAX_CHANNELS];
+
 };
 
 /****************************************************************************/
@@ -164,6 +164,7 @@ void ScriptResolver::init(ExSymbol* symbol)
     mInternalVariable = NULL;
     mVariable = NULL;
     mParameter = NULL;
+    mInterpreterVariable = NULL;
 }
 
 ScriptResolver::ScriptResolver(ExSymbol* symbol, int arg)
@@ -201,6 +202,76 @@ ScriptResolver::~ScriptResolver()
 	// we don't own the symbol, it owns us
 }
 
+/**
+ * An array containing names of variables that may be set by the interpreter
+ * but do not need to be declared.
+ */
+const char* InterpreterVariables[] = {
+    "interrupted",
+    NULL
+};
+
+/**
+ * Given a symbol in an expression, search for a stack argument,
+ * internal variable, Variable declared in the block, parameter,
+ * or auto-declared interpreter variable with the same name.
+ * If one is found return a resolver that will be called during
+ * evaluation to retrieve the value.
+ *
+ * ScriptCompiler calls this once the script is parsed, so the
+ * audio thread doesn't search for these or allocate resolvers
+ * the first time an expression is evaluated.
+ */
+ScriptResolver* ScriptResolver::resolve(Mobius* m, ScriptBlock* block,
+                                        ExSymbol* symbol)
+{
+	ScriptResolver* resolver = NULL;
+	const char* name = symbol->getName();
+	int arg = 0;
+
+	// a leading $ is required for numeric stack argument references,
+	// but must also support them for legacy symbolic references
+	if (name[0] == '$') {
+		name = &name[1];
+		arg = ToInt(name);
+	}
+
+	if (arg > 0)
+	  resolver = NEW2(ScriptResolver, symbol, arg);
+
+    // next try internal variables
+	if (resolver == NULL) {
+		ScriptInternalVariable* iv = ScriptInternalVariable::getVariable(name);
+		if (iv != NULL)
+		  resolver = NEW2(ScriptResolver, symbol, iv);
+	}
+    
+    // next look for a Variable in the innermost block
+	if (resolver == NULL && block != NULL) {
+        ScriptVariableStatement* v = block->findVariable(name);
+        if (v != NULL)
+          resolver = NEW2(ScriptResolver, symbol, v);
+    }
+
+	if (resolver == NULL) {
+		Parameter* p = m->getParameter(name);
+		if (p != NULL)
+		  resolver = NEW2(ScriptResolver, symbol, p);
+	}
+
+    // try some auto-declared system variables
+    if (resolver == NULL) {
+        for (int i = 0 ; InterpreterVariables[i] != NULL ; i++) {
+            if (StringEqualNoCase(name, InterpreterVariables[i])) {
+                resolver = NEW2(ScriptResolver, symbol, name);
+                break;
+            }
+        }
+    }
+
+	return resolver;
+}
+
 /**
  * Return the value of a resolved reference.
  * The ExContext passed here will be a ScriptInterpreter.
@@ -241,7 +312,7 @@ void ScriptResolver::getExValue(ExContext* exContext, ExValue* value)
 		}
         
         if (vars != NULL)
-          vars->get(name, value);
+          vars->get(name, value, &mSlot);
 	}
     else if (mParameter != NULL) {
         // reuse an export 
@@ -259,7 +330,7 @@ void ScriptResolver::getExValue(ExContext* exContext, ExValue* value)
     else if (mInterpreterVariable != NULL) {
         UserVariables* vars = si->getVariables();
         if (vars != NULL)
-          vars->get(mInterpreterVariable, value);
+          vars->get(mInterpreterVariable, value, &mSlot);
     }
     else {
 		// if it didn't resolve, we shouldn't have made it
@@ -389,7 +460,7 @@ void ScriptArgument::get(ScriptInterpreter* si, ExValue* value)
 		}
 
         if (vars != NULL)
-          vars->get(name, value);
+          vars->get(name, value, &mSlot);
 	}
     else if (mParameter != NULL) {
         Export* exp = si->getExport();
@@ -454,7 +525,7 @@ void ScriptArgument::set(ScriptInterpreter* si, ExValue* value)
 		}
         
         if (vars != NULL)
-          vars->set(name, value);
+          vars->set(name, value, &mSlot);
 	}
 	else if (mParameter != NULL) {
         const char* name = mParameter->getName();
@@ -2512,7 +2583,12 @@ ScriptStatement* ScriptSaveStatement::eval(ScriptInterpreter* si)
     Trace(2, "Script %s: save %s\n", si->getTraceName(), file);
 
     if (strlen(file) > 0) {
-        si->sendKernelEvent(EventSaveProject, file);
+        // the tracks are captured now, the shell writes the file
+        KernelEvent* e = si->newKernelEvent();
+        e->type = EventSaveProject;
+        e->setArg(0, file);
+        e->project = si->getMobius()->saveProject();
+        si->sendKernelEvent(e);
     }
 
     return NULL;
@@ -3523,7 +3599,7 @@ ScriptStatement* ScriptWaitStatement::eval(ScriptInterpreter* si)
             Trace(2, "Script %s: wait %s\n", 
                   si->getTraceName(), WaitTypeNames[mWaitType]);
 			Event* e = setupWaitEvent(si, 0);
-			e->pending = true;
+			e->setPending(true);
 			e->fields.script.waitType = mWaitType;
 		}
 		break;
@@ -5961,15 +6037,6 @@ void ScriptInterpreter::expand(const char* value, ExValue* retval)
  *                                                                          *
  ****************************************************************************/
 
-/**
- * An array containing names of variables that may be set by the interpreter
- * but do not need to be declared.
- */
-const char* InterpreterVariables[] = {
-    "interrupted",
-    NULL
-};
-
 /**
  * ExContext interface.
  * Given the a symbol in an expression, search for a parameter,
@@ -5977,70 +6044,25 @@ const char* InterpreterVariables[] = {
  * If one is found return an ExResolver that will be called during evaluation
  * to retrieve the value.
  *
- * Note that this is called during the first evaluation, so we have
- * to get the current script from the interpreter stack.  
- *
- * !! Consider doing resolver assignment up front for consistency
- * with how ScriptArguments are resolved?
- * 
+ * Expressions parsed by ScriptCompiler had their symbols resolved when
+ * the script was compiled, so this is only reached for ones that weren't.
+ * It is called during the first evaluation, so we have to get the
+ * current script from the interpreter stack.  
  */
 ExResolver* ScriptInterpreter::getExResolver(ExSymbol* symbol)
 {
-	ExResolver* resolver = NULL;
-	const char* name = symbol->getName();
-	int arg = 0;
-
-	// a leading $ is required for numeric stack argument references,
-	// but must also support them for legacy symbolic references
-	if (name[0] == '$') {
-		name = &name[1];
-		arg = ToInt(name);
-	}
-
-	if (arg > 0)
-	  resolver = NEW2(ScriptResolver, symbol, arg);
+    ScriptBlock* block = NULL;
 
-    // next try internal variables
-	if (resolver == NULL) {
-		ScriptInternalVariable* iv = ScriptInternalVariable::getVariable(name);
-		if (iv != NULL)
-		  resolver = NEW2(ScriptResolver, symbol, iv);
-	}
-    
-    // next look for a Variable in the innermost block
-	if (resolver == NULL) {
-        // we should only be called during evaluation!
-        if (mStatement == NULL)
-          Trace(1, "Script %s: getExResolver has no statement!\n", getTraceName());
-        else {
-            ScriptBlock* block = mStatement->getParentBlock();
-            if (block == NULL)
-              Trace(1, "Script %s: getExResolver has no block!\n", getTraceName());
-            else {
-                ScriptVariableStatement* v = block->findVariable(name);
-                if (v != NULL)
-                  resolver = NEW2(ScriptResolver, symbol, v);
-            }
-        }
-    }
-
-	if (resolver == NULL) {
-		Parameter* p = mMobius->getParameter(name);
-		if (p != NULL)
-		  resolver = NEW2(ScriptResolver, symbol, p);
-	}
-
-    // try some auto-declared system variables
-    if (resolver == NULL) {
-        for (int i = 0 ; InterpreterVariables[i] != NULL ; i++) {
-            if (StringEqualNoCase(name, InterpreterVariables[i])) {
-                resolver = NEW2(ScriptResolver, symbol, name);
-                break;
-            }
-        }
+    // we should only be called during evaluation!
+    if (mStatement == NULL)
+      Trace(1, "Script %s: getExResolver has no statement!\n", getTraceName());
+    else {
+        block = mStatement->getParentBlock();
+        if (block == NULL)
+          Trace(1, "Script %s: getExResolver has no block!\n", getTraceName());
     }
 
-	return resolver;
+	return ScriptResolver::resolve(mMobius, block, symbol);
 }
 
 /**
@@ -15,6 +15,7 @@
 #include <stdio.h>
 
 #include "../../model/Preset.h"
+#include "../../model/UserVariable.h"
 #include "../KernelEvent.h"
 
 #include "Expr.h"
@@ -479,6 +480,9 @@ class ScriptResolver : public ExResolver {
 	ScriptResolver(ExSymbol* symbol, const char* name);
 	~ScriptResolver();
 
+    static ScriptResolver* resolve(class Mobius* m, class ScriptBlock* block,
+                                   ExSymbol* symbol);
+
 	void getExValue(ExContext* exContext, ExValue* value);
 
   private:
@@ -495,6 +499,9 @@ class ScriptResolver : public ExResolver {
     class ScriptVariableStatement* mVariable;
 	Parameter* mParameter;
     const char* mInterpreterVariable;
+
+    // where the user variable was last found
+    UserVariableSlot mSlot;
 };
 
 /****************************************************************************
@@ -552,6 +559,9 @@ class ScriptArgument {
     class ScriptVariableStatement* mVariable;
 	Parameter* mParameter;
 
+    // where the user variable was last found
+    UserVariableSlot mSlot;
+
 };
 
 /****************************************************************************
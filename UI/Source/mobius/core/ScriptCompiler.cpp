@@ -43,6 +43,7 @@ ScriptCompiler::ScriptCompiler()
     // these are dyamically allocated
     mParser     = NULL;
     mLibrary        = NULL;
+    mExpressions = NULL;
 
     // these are intermediate compile state that will end
     // up in mLibrary
@@ -59,6 +60,13 @@ ScriptCompiler::~ScriptCompiler()
     delete mParser;
     // shouldn't be dangling
     delete mLibrary;
+
+    // also shouldn't be any left
+    while (mExpressions != NULL) {
+        ScriptCompilerExpression* next = mExpressions->next;
+        delete mExpressions;
+        mExpressions = next;
+    }
 }
 
 /**
@@ -191,6 +199,38 @@ void ScriptCompiler::link(Script* s)
     mScript = s;
 
     s->link(this);
+
+    // function statements parse their expressions here
+    resolveExpressions();
+}
+
+/**
+ * Resolve the symbols in the expressions parsed since the last call.
+ * ScriptInterpreter would otherwise do this the first time each
+ * expression is evaluated, searching the block and Parameters by name
+ * and allocating resolvers in the audio thread.
+ */
+void ScriptCompiler::resolveExpressions()
+{
+    while (mExpressions != NULL) {
+        ScriptCompilerExpression* next = mExpressions->next;
+        ScriptStatement* stmt = mExpressions->statement;
+        resolveSymbols(stmt->getParentBlock(), mExpressions->expression);
+        delete mExpressions;
+        mExpressions = next;
+    }
+}
+
+void ScriptCompiler::resolveSymbols(ScriptBlock* block, ExNode* node)
+{
+    for ( ; node != NULL ; node = node->getNext()) {
+        if (node->isSymbol()) {
+            ExSymbol* symbol = (ExSymbol*)node;
+            if (!symbol->isResolved())
+              symbol->setResolver(ScriptResolver::resolve(mMobius, block, symbol));
+        }
+        resolveSymbols(block, node->getChildren());
+    }
 }
 
 /**
@@ -413,6 +453,9 @@ bool ScriptCompiler::parse(FILE* fp, Script* script)
     // do internal resolution
     script->resolve(mMobius);
 
+    // Variable declarations are all known now
+    resolveExpressions();
+
     // TODO: do some sanity checks, like looking for Param
     // statements in a script that isn't declared with !parameter
 
@@ -694,6 +737,14 @@ ExNode* ScriptCompiler::parseExpression(ScriptStatement* stmt,
 
 	expr = mParser->parse(src);
 
+    if (expr != NULL) {
+        ScriptCompilerExpression* pending = new ScriptCompilerExpression();
+        pending->next = mExpressions;
+        pending->statement = stmt;
+        pending->expression = expr;
+        mExpressions = pending;
+    }
+
     const char* error = mParser->getError();
 	if (error != NULL) {
 		// !! need a console or something for these
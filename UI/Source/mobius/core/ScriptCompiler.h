@@ -11,6 +11,17 @@
 
 #define SCRIPT_MAX_LINE 1024
 
+/**
+ * An expression parsed for a statement, remembered until the
+ * script's blocks are complete so the symbols can be resolved.
+ */
+class ScriptCompilerExpression {
+  public:
+    ScriptCompilerExpression* next;
+    class ScriptStatement* statement;
+    class ExNode* expression;
+};
+
 /**
  * Parses script files and builds Script objects.
  * 
@@ -61,6 +72,8 @@ class ScriptCompiler {
     void parseDeclaration(const char* line, const char* keyword);
     void link(class Script* s);
     Script* resolveScript(class Script* scripts, const char* name);
+    void resolveExpressions();
+    void resolveSymbols(class ScriptBlock* block, class ExNode* node);
 
     /**
      * Supplies resolution for some references.
@@ -72,6 +85,9 @@ class ScriptCompiler {
      */
 	class ExParser* mParser;
 
+    // expressions parsed since the last resolveExpressions
+    ScriptCompilerExpression* mExpressions;
+
     // Environment we're compiling into
     class ScriptLibrary* mLibrary;
 
@@ -32,6 +32,8 @@
 #include <memory.h>
 #include <math.h>
 
+#include <JuceHeader.h>
+
 #include "../../util/Util.h"
 #include "../../util/Trace.h"
 #include "../Audio.h"
@@ -120,6 +122,24 @@ float Smoother::getTarget()
 	return mTarget;
 }
 
+/**
+ * Fill a buffer with the values for the next block of frames,
+ * advancing as we go.  This is the same as calling getValue
+ * and advance for each frame.
+ */
+void Smoother::fill(float* values, long frames)
+{
+	if (!mActive) {
+		juce::FloatVectorOperations::fill(values, mValue, (int)frames);
+	}
+	else {
+		for (int i = 0 ; i < frames ; i++) {
+			values[i] = mValue;
+			advance();
+		}
+	}
+}
+
 void Smoother::advance()
 {
 	if (mActive) {
@@ -157,6 +177,7 @@ Stream::Stream()
 {
 	latency = 0;
 	mNormalLatency = 0;
+	mPitchLatency = 0;
 
     mSpeedOctave = 0;
     mSpeedStep = 0;
@@ -354,6 +375,9 @@ void Stream::setTimeStretch(int degree)
  *
  * UPDATE: The previous comment should become irrelevant once we implement
  * "chasing" to correct record/playback frame alignment after rate shift.
+ *
+ * This is also called when pitch changes, while shifting the pitch
+ * shifter delay is added.
  */
 void Stream::adjustSpeedLatency()
 {
@@ -362,7 +386,26 @@ void Stream::adjustSpeedLatency()
 	else {
         // round up
         latency = (int)ceil(mNormalLatency * mSpeed);
+
+        // interpolation kernels add a little more
+        if (mResampler != NULL)
+          latency += mResampler->getLatency(mSpeed);
 	}
+
+    if (mPitch != 1.0)
+      latency += mPitchLatency;
+}
+
+/**
+ * Select the interpolation used when the speed is shifted.
+ * The better ones add latency so this adjusts it.
+ */
+void Stream::setResampleQuality(int quality)
+{
+    if (mResampler != NULL) {
+        mResampler->setQuality((ResampleQuality)quality);
+        adjustSpeedLatency();
+    }
 }
 
 /**
@@ -370,8 +413,13 @@ void Stream::adjustSpeedLatency()
  */
 int Stream::getAdjustedLatency(int latency)
 {
-	if (mSpeed != 1.0)
-	  latency = (int)ceil(latency * mSpeed);
+	if (mSpeed != 1.0) {
+        latency = (int)ceil(latency * mSpeed);
+        if (mResampler != NULL)
+          latency += mResampler->getLatency(mSpeed);
+    }
+    if (mPitch != 1.0)
+      latency += mPitchLatency;
 	return latency;
 }
 
@@ -386,8 +434,15 @@ int Stream::getAdjustedLatency(int octave, int semitone, int bend,
 	int latency = mNormalLatency;
 
     float rate = Resampler::getSpeed(octave, semitone, bend, stretch);
-	if (rate != 1.0)
-	  latency = (int)ceil(latency * rate);
+	if (rate != 1.0) {
+        latency = (int)ceil(latency * rate);
+        if (mResampler != NULL)
+          latency += mResampler->getLatency(rate);
+    }
+
+    // pitch isn't changed by the jump
+    if (mPitch != 1.0)
+      latency += mPitchLatency;
 
 	return latency;
 }
@@ -410,6 +465,7 @@ void Stream::initPitch()
     mPitchOctave = 0;
     mPitchStep = 0;
     mPitchBend = 0;
+    adjustSpeedLatency();
 }
 
 /**
@@ -421,6 +477,7 @@ void Stream::recalculatePitch()
     // pitch gets faster
     int stretch = -mTimeStretch;
     mPitch = Resampler::getSpeed(mPitchOctave, mPitchStep, mPitchBend, stretch);
+    adjustSpeedLatency();
 }
 
 int Stream::getPitchOctave()
@@ -603,11 +660,16 @@ OutputStream::OutputStream(InputStream* in, AudioPool* aupool)
     mAudioPool = aupool;
     mResampler = NEW1(Resampler, false);
 	mPitchShifter = PitchPlugin::getPlugin(in->getSampleRate());
+	mPitchLatency = mPitchShifter->getLatency();
 	mPlugin = NULL;
 	mPan = 64;
 	mMono = false;
 	mLoopBuffer = NULL;
     mSpeedBuffer = NULL;
+	mGainBuffer = NULL;
+	mLevelRamp = NULL;
+	mLeftRamp = NULL;
+	mRightRamp = NULL;
 	mMaxSample = 0.0;
 
 	mLastLayer = NULL;
@@ -639,6 +701,13 @@ OutputStream::OutputStream(InputStream* in, AudioPool* aupool)
     // the highest speed multiplier.  +8 to guard against remainders
 	long rateBufferSamples = (long)((loopBufferSamples * MAX_RATE_SHIFT) + 4);
     mSpeedBuffer = MemNewFloat("Outputstream:speedBuffer", rateBufferSamples);
+
+    // buffers for adjustLevel, gains for every sample and the smoother
+    // values for every frame
+    mGainBuffer = MemNewFloat("OutputStream:gainBuffer", loopBufferSamples);
+    mLevelRamp = MemNewFloat("OutputStream:levelRamp", loopBufferFrames);
+    mLeftRamp = MemNewFloat("OutputStream:leftRamp", loopBufferFrames);
+    mRightRamp = MemNewFloat("OutputStream:rightRamp", loopBufferFrames);
 	mCapture = false;
 	mCaptureAudio = NULL;
 	mCaptureTotal = 0;
@@ -651,6 +720,10 @@ OutputStream::~OutputStream()
 	delete mOuterTail;
 	delete mLoopBuffer;
 	delete mSpeedBuffer;
+	delete[] mGainBuffer;
+	delete[] mLevelRamp;
+	delete[] mLeftRamp;
+	delete[] mRightRamp;
 	delete mPitchShifter;
     delete mPlugin;
 	delete mLeft;
@@ -926,7 +999,7 @@ void OutputStream::play(Loop* loop, long blockFrames, bool last)
 					// set this to force a layer fade in in the play() callback below
 					mForceFadeIn = true;
 				}
-				else {
+				else if (!mPitchShifter->canChangePitch()) {
 					// shift changing
 					capturePitchShutdownFadeTail();
 				}
@@ -1031,8 +1104,12 @@ void OutputStream::play(Loop* loop, long blockFrames, bool last)
 
 			// now apply rate adjustments, note that the remainder from
 			// the previous resampler call is not included 
-			if (mSpeed == 1.0)
-			  remaining = 0;
+			if (mSpeed == 1.0) {
+                // let the resampler see what we played in case
+                // the speed changes
+                mResampler->keep(playBuffer, adjustedFrames);
+                remaining = 0;
+            }
 			else {
 				// If we have an ignore count, transpose with the non
 				// adjusted frame count which will ignore the extra one
@@ -1128,14 +1205,19 @@ void OutputStream::capturePitchShutdownFadeTail()
  * Copy the result of a Loop play into the interrupt buffer applying
  * output level adjustment and panning.
  *
- * Multiplied the logic to reduce the number of multiplies.
- * May not save much but it just feels better.
+ * This is done in two passes.  First the gain for every sample is worked
+ * out from the smoothers, which is the only part that has to be done one
+ * frame at a time.  Then the gains are applied and the result merged into
+ * the interrupt buffer with vector operations.  The values from the smoothers
+ * and the order of the multiplies are the same as when this was all done
+ * in one loop so the result is identical.
  */
 void OutputStream::adjustLevel(long frames)
 {
 	long samples = frames * channels;
 	float outLevel = mSmoother->getValue();
 	float* src = mLoopBuffer;
+	float* gains = mGainBuffer;
 
 	bool noSmoothing = 
 		!mSmoother->isActive() && !mLeft->isActive() && !mRight->isActive();
@@ -1145,125 +1227,149 @@ void OutputStream::adjustLevel(long frames)
 		// of each input channel into each output channel.  Usually in this mode
 		// only one input channel will have non-zero content, but if they do, sum them.
 		// Start with the complex case, simplify later if necessary.
+		float* leftMods = mLeftRamp;
+		float* rightMods = mRightRamp;
+		float* levels = mLevelRamp;
+
+		if (!mLeft->isActive() && !mRight->isActive()) {
+			// pan can't change during this block
+			float leftMod, rightMod;
+			advanceMonoPan(&leftMod, &rightMod);
+			juce::FloatVectorOperations::fill(leftMods, leftMod, (int)frames);
+			juce::FloatVectorOperations::fill(rightMods, rightMod, (int)frames);
+		}
+		else {
+			for (int i = 0 ; i < frames ; i++)
+			  advanceMonoPan(&leftMods[i], &rightMods[i]);
+		}
+		mSmoother->fill(levels, frames);
 
-		float leftLevel, rightLevel;
-		float leftMod, rightMod;
-
-		for (int i = 0 ; i < samples ; i += 2) {
-
-			leftLevel = mLeft->getValue();
-			rightLevel = mRight->getValue();
-
-			if (leftLevel == 1.0 && rightLevel == 1.0) {
-				// dead center
-				leftMod = 0.5f;
-				rightMod = 0.5f;
-				// could advance either way, but better not be both!
-				mLeft->advance();
-				mRight->advance();
-			}
-			else {
-				// we're panning in one direction
-				// must always complete a seep on one side before beginning the next
-				bool left;
-
-				// redundant logic, but important to see
-
-				if (leftLevel < 1.0 && mLeft->getTarget() == 1.0) {
-					// panned right, but crossed back over to the left
-					// advance left level only
-					left = true;
-				}
-				else if (rightLevel < 1.0 && mRight->getTarget() == 1.0) {
-					// panned left, but crossed back over to the right
-					// advance right level only
-					left = false;
-				}
-				else if (leftLevel < 1.0) {
-					// panning right
-					left = true;
-				}
-				else if (rightLevel < 1.0) {
-					// panning left
-					left = false;
-				}
-
-				if (left) {
-					leftMod = leftLevel * 0.5f;
-					rightMod = 1.0f - leftMod;
-					mLeft->advance();
-				}
-				else {
-					rightMod = rightLevel * 0.5f;
-					leftMod = 1.0f - rightMod;
-					mRight->advance();
-				}
-			}
-
+		for (int i = 0 ; i < frames ; i++) {
 			// sum the inputs
 			float sample = *src++;
 			sample += *src++;
 
 			// adjust for output level
-			sample *= mSmoother->getValue();
+			sample *= levels[i];
 			
 			// pan
-			float psample = sample * leftMod;
-			checkMax(psample);
-			*mAudioPtr++ += psample;
-
-			psample = sample * rightMod;
-			checkMax(psample);
-			*mAudioPtr++ += psample;
-
-			mSmoother->advance();
+			*gains++ = sample * leftMods[i];
+			*gains++ = sample * rightMods[i];
 		}
+		mergeBlock(mGainBuffer, samples);
 	}
 	else if (mPan == 64 && outLevel == 1.0 && noSmoothing) {
 		// the usual case
-		for (int i = 0 ; i < samples ; i++) {
-			float sample = *src++;
-			checkMax(sample);
-			*mAudioPtr++ += sample;
-		}
+		mergeBlock(src, samples);
 	}
 	else {
-		float leftMod = mLeft->getValue();
-		float rightMod = mRight->getValue();
-
 		// !! channel issues: pan only makes sense with two channels, 
 		// if we have more than two which samples are L and R?
 
 		if (noSmoothing) {
 			// can reduce to one multiply per sample
-			leftMod *= outLevel;
-			rightMod *= outLevel;
-			for (int i = 0 ; i < samples ; i += 2) {
-				float sample = *src++ * leftMod;
-				checkMax(sample);
-				*mAudioPtr++ += sample;
-				sample = *src++ * rightMod;
-				checkMax(sample);
-				*mAudioPtr++ += sample;
+			float leftMod = mLeft->getValue() * outLevel;
+			float rightMod = mRight->getValue() * outLevel;
+			if (leftMod == rightMod) {
+				juce::FloatVectorOperations::multiply(gains, src, leftMod, (int)samples);
+			}
+			else {
+				for (int i = 0 ; i < samples ; i += 2) {
+					gains[i] = leftMod;
+					gains[i+1] = rightMod;
+				}
+				juce::FloatVectorOperations::multiply(gains, src, (int)samples);
 			}
 		}
 		else {
 			// need a pair of multiplies per sample
-			for (int i = 0 ; i < samples ; i += 2) {
-				leftMod = mLeft->getValue();
-				rightMod = mRight->getValue();
-				outLevel = mSmoother->getValue();
-				float sample = *src++ * (leftMod * outLevel);
-				checkMax(sample);
-				*mAudioPtr++ += sample;
-				sample = *src++ * (rightMod * outLevel);
-				checkMax(sample);
-				*mAudioPtr++ += sample;
-				mSmoother->advance();
-				mLeft->advance();
-				mRight->advance();
+			mLeft->fill(mLeftRamp, frames);
+			mRight->fill(mRightRamp, frames);
+			mSmoother->fill(mLevelRamp, frames);
+			for (int i = 0 ; i < frames ; i++) {
+				*gains++ = mLeftRamp[i] * mLevelRamp[i];
+				*gains++ = mRightRamp[i] * mLevelRamp[i];
 			}
+			juce::FloatVectorOperations::multiply(mGainBuffer, src, (int)samples);
+		}
+		mergeBlock(mGainBuffer, samples);
+	}
+}
+
+/**
+ * Calculate the left and right pan multipliers for one frame in mono
+ * mode and advance the pan smoothers.
+ */
+void OutputStream::advanceMonoPan(float* leftResult, float* rightResult)
+{
+	float leftLevel = mLeft->getValue();
+	float rightLevel = mRight->getValue();
+	float leftMod, rightMod;
+
+	if (leftLevel == 1.0 && rightLevel == 1.0) {
+		// dead center
+		leftMod = 0.5f;
+		rightMod = 0.5f;
+		// could advance either way, but better not be both!
+		mLeft->advance();
+		mRight->advance();
+	}
+	else {
+		// we're panning in one direction
+		// must always complete a seep on one side before beginning the next
+		bool left = false;
+
+		// redundant logic, but important to see
+
+		if (leftLevel < 1.0 && mLeft->getTarget() == 1.0) {
+			// panned right, but crossed back over to the left
+			// advance left level only
+			left = true;
+		}
+		else if (rightLevel < 1.0 && mRight->getTarget() == 1.0) {
+			// panned left, but crossed back over to the right
+			// advance right level only
+			left = false;
+		}
+		else if (leftLevel < 1.0) {
+			// panning right
+			left = true;
+		}
+		else if (rightLevel < 1.0) {
+			// panning left
+			left = false;
+		}
+
+		if (left) {
+			leftMod = leftLevel * 0.5f;
+			rightMod = 1.0f - leftMod;
+			mLeft->advance();
 		}
+		else {
+			rightMod = rightLevel * 0.5f;
+			leftMod = 1.0f - rightMod;
+			mRight->advance();
+		}
+	}
+
+	*leftResult = leftMod;
+	*rightResult = rightMod;
+}
+
+/**
+ * Add a block of adjusted samples to the interrupt buffer and
+ * remember the loudest one.
+ */
+void OutputStream::mergeBlock(float* block, long samples)
+{
+	if (samples > 0) {
+		juce::Range<float> range =
+			juce::FloatVectorOperations::findMinAndMax(block, (int)samples);
+		checkMax(range.getStart());
+		checkMax(range.getEnd());
+
+		juce::FloatVectorOperations::add(mAudioPtr, block, (int)samples);
+		mAudioPtr += samples;
 	}
 }
 
@@ -2137,6 +2243,7 @@ void InputStream::scaleInput()
 	if (mSpeed == 1.0) {
 		// we may be returning to 1.0 after being away to reset refs
 		mAudioPtr = src;
+        mResampler->keep(src, remaining);
 		mRemainingFrames = remaining;
 		mLastThreshold = 1.0f;
 	}
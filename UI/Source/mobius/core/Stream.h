@@ -112,6 +112,7 @@ class Smoother {
 	float getValue();
 	float getTarget();
 	void advance();
+	void fill(float* values, long frames);
 
   private:
 
@@ -190,6 +191,9 @@ class Stream : public LayerContext {
 	int getAdjustedLatency(int latency);
 	int getAdjustedLatency(int octave, int semitone, int bend, int stretch);
 
+    // one of the ResampleQuality values
+    void setResampleQuality(int quality);
+
 	long getInterruptFrames();
 	virtual void initProcessedFrames();
 	virtual long getProcessedFrames();
@@ -226,6 +230,13 @@ class Stream : public LayerContext {
 	 */
 	int mNormalLatency;
 
+	/**
+	 * Latency of the pitch shifter, added while pitch is shifted.
+	 * This is in loop frames since the shifter runs before the
+	 * speed resampler, so it isn't speed adjusted.
+	 */
+	int mPitchLatency;
+
 	/**
 	 * The speed adjustment.  This is always calculated
      * from mSpeedOctave, mSpeedStep, and mSpeedBend.
@@ -490,6 +501,8 @@ class OutputStream : public Stream {
 	void checkMax(float sample);
 	void capture(float* buffer, long frames);
 	void adjustLevel(long frames);
+	void advanceMonoPan(float* leftMod, float* rightMod);
+	void mergeBlock(float* block, long samples);
 	void captureOutsideFadeTail();
 	void capturePitchShutdownFadeTail();
 
@@ -546,6 +559,16 @@ class OutputStream : public Stream {
 	 */
 	float* mSpeedBuffer;
 
+	/**
+	 * Buffers used by adjustLevel.  The gain buffer has the gain for
+	 * every sample in the loop buffer, then the adjusted samples.
+	 * The ramps have the smoother values for every frame.
+	 */
+	float* mGainBuffer;
+	float* mLevelRamp;
+	float* mLeftRamp;
+	float* mRightRamp;
+
 	/**
 	 * The last layer from which frames were taken.
 	 */
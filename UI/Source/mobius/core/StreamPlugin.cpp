@@ -83,6 +83,11 @@ int StreamPlugin::getTweak(int tweak)
     return 0;
 }
 
+int StreamPlugin::getLatency()
+{
+    return 0;
+}
+
 void StreamPlugin::debug()
 {
 }
@@ -275,6 +280,7 @@ PitchPlugin::PitchPlugin(int sampleRate)
     : StreamPlugin(sampleRate)
 {
     mPitch = 1.0f;
+    mPitchStep = 0;
 }
 
 PitchPlugin::~PitchPlugin()
@@ -342,6 +348,11 @@ int PitchPlugin::getPitchSemitones()
     return mPitchStep;
 }
 
+bool PitchPlugin::canChangePitch()
+{
+    return false;
+}
+
 /**
  * Test function to simulate the processing of interrupt blocks
  */
@@ -47,6 +47,11 @@ class StreamPlugin {
     virtual int getTweak(int tweak);
 	virtual void startupFade();
 
+	/**
+	 * Number of frames the plugin delays the audio passing through it.
+	 */
+	virtual int getLatency();
+
 	long process(float* buffer, long frames);
 
     virtual long process(float* input, float* output, long frames) = 0;
@@ -144,6 +149,13 @@ class PitchPlugin : public StreamPlugin {
     float getPitchRatio();
     int getPitchSemitones();
 
+	/**
+	 * True if the pitch can be changed while shifting without
+	 * a break in the output, so the stream doesn't need to
+	 * capture a fade tail.
+	 */
+	virtual bool canChangePitch();
+
     float semitonesToRatio(int semitones);
     int ratioToSemitones(float ratio);
 
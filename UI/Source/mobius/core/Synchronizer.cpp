@@ -182,6 +182,8 @@ Synchronizer::Synchronizer(Mobius* mob, MidiInterface* midi)
     mReturnEvent = new Event(nullptr);
     // suppresses a warning
     mReturnEvent->setOwned(true);
+    mNextAvailableEvent = NULL;
+    mParallel = false;
     
 	mHostTempo = 0.0f;
 	mHostBeat = 0;
@@ -198,6 +200,7 @@ Synchronizer::Synchronizer(Mobius* mob, MidiInterface* midi)
 
 	// assign trace names
 	mMidiQueue.setName("external");
+	mMidiQueue.setOffsetEvents(true);
 }
 
 Synchronizer::~Synchronizer()
@@ -559,12 +562,40 @@ int Synchronizer::getInBeatsPerBar()
  * This is the same value returned by "tempo" but only if the
  * current track is in SyncMode In, MIDIBeat, or MIDIBar.
  * Note that this is the full precision tempo, not the "smooth" tempo.
+ *
+ * Once the MidiQueue has locked on to the clock timestamps we use
+ * its estimate, it follows the average clock spacing rather than
+ * the distance between the last few clocks.
  */
 float Synchronizer::getInTempo()
 {
+	MidiState* s = mMidiQueue.getMidiState();
+	if (s->tempo > 0.0f)
+	  return s->tempo;
 	return mMidi->getInputTempo();
 }
 
+/**
+ * Exposed as variable syncInJitter.
+ * Average milliseconds between when external clocks were received
+ * and when the tempo estimator expected them.
+ */
+float Synchronizer::getInJitter()
+{
+	MidiState* s = mMidiQueue.getMidiState();
+	return s->jitter;
+}
+
+/**
+ * Exposed as variable syncInMaxJitter.
+ * The largest prediction error since the clock last locked.
+ */
+float Synchronizer::getInMaxJitter()
+{
+	MidiState* s = mMidiQueue.getMidiState();
+	return s->maxJitter;
+}
+
 /**
  * Exposed as syncInRawBeat
  * The current beat count derived from the external MIDI clock.
@@ -737,7 +768,7 @@ float Synchronizer::getTempo(Track* t)
             break;
 
 		case SYNC_MIDI:
-			tempo = mMidi->getInputTempo();
+			tempo = getInTempo();
             break;
 
 		case SYNC_HOST:
@@ -1117,7 +1148,7 @@ Event* Synchronizer::scheduleRecordStart(Action* action,
 			if (frame == event->frame) {
 				l->setFrame(0);
 				l->setPlayFrame(0);
-				event->frame = 0;
+				event->setFrame(0);
 			}
 		}
 
@@ -1593,7 +1624,7 @@ bool Synchronizer::undoRecordStop(Loop* loop)
 			stop->number = newBars;
 
 			if (!isRecordStopPulsed(loop)) {
-				stop->frame = newFrames;
+				stop->setFrame(newFrames);
 
 				// When you schedule stop events on specific frames, we have
 				// to set the loop cycle count since Synchronizer is no
@@ -1678,7 +1709,7 @@ void Synchronizer::setAutoStopEvent(Action* action, Loop* loop,
 	}
 
 	stop->number = bars;
-	stop->frame = (long)totalFrames;
+	stop->setFrame((long)totalFrames);
 
 	// When you schedule stop events on specific frames, we have to set
 	// the loop cycle count since Synchronizer is no longer watching.
@@ -1908,7 +1939,7 @@ void Synchronizer::getRecordUnit(Loop* l, SyncUnitInfo* unit)
             // We have an internal parameter to select the mode, figure
             // out the best one and stick with it!
 
-            float tempo = mMidi->getInputTempo();
+            float tempo = getInTempo();
             traceTempo(l, "MIDI", tempo);
 
             int smooth = mMidi->getInputSmoothTempo();
@@ -2267,13 +2298,39 @@ void Synchronizer::interruptStart(MobiusContainer* container)
 }
 
 
+/**
+ * True if there are sync events to be processed by the tracks in
+ * this interrupt.  When there are, tracks must be processed serially
+ * since they share the event iterator.
+ */
+bool Synchronizer::hasInterruptEvents()
+{
+    return (mInterruptEvents->getEvents() != NULL);
+}
+
+/**
+ * Called by Mobius in the audio thread before and after
+ * TrackRenderer processes tracks in parallel.  The event iterator
+ * is shared so it is set once here rather than by each track
+ * in prepare.  There are no interrupt events when tracks are
+ * rendered in parallel so it will be empty.
+ */
+void Synchronizer::setParallel(bool b)
+{
+    if (b)
+      mNextAvailableEvent = mInterruptEvents->getEvents();
+    mParallel = b;
+}
+
 /**
  * Called as each Track is about to be processed.
- * Reset the sync event iterator.
+ * Reset the sync event iterator, unless tracks are being
+ * processed in parallel, see setParallel.
  */
 void Synchronizer::prepare(Track* t)
 {
-    mNextAvailableEvent = mInterruptEvents->getEvents();
+    if (!mParallel)
+      mNextAvailableEvent = mInterruptEvents->getEvents();
 
     // this will be set by trackSyncEvent if we see boundary
     // events during this interrupt
@@ -2744,9 +2801,9 @@ void Synchronizer::checkPulseWait(Loop* l, Event* e)
 
 		if (activate) {
 			Trace(l, 2, "Sync: Activating pending Wait %s event\n", type);
-			wait->pending = false;
-			wait->immediate = true;
-			wait->frame = l->getFrame();
+			wait->setPending(false);
+			wait->setImmediate(true);
+			wait->setFrame(l->getFrame());
 		}
 	}
 }
@@ -2883,8 +2940,8 @@ void Synchronizer::startRecording(Loop* l, Event* e)
         if (src == SYNC_MIDI && !e->fields.sync.syncTrackerEvent)
           startFrame += l->getInputLatency();
 
-        start->pending = false;
-        start->frame = startFrame;
+        start->setPending(false);
+        start->setFrame(startFrame);
 
         // have to pretend we're in play to start counting frames if
         // we're doing latency compensation at the beginning
@@ -3224,8 +3281,8 @@ void Synchronizer::activateRecordStop(Loop* l, Event* pulse,
     state->scheduleStop(pulses, finalFrames);
 
     // activate the event
-	stop->pending = false;
-	stop->frame = finalFrames;
+	stop->setPending(false);
+	stop->setFrame(finalFrames);
 
     // For SYNC_TRACK, recalculate the final cycle count based on our
     // size relative to the master track.  If we recorded an odd number
@@ -3436,9 +3493,9 @@ void Synchronizer::syncPulsePlaying(Loop* l, Event* e)
             }
 
             Trace(l, 2, "Sync: Activating pending SyncStartPoint at frame %ld\n", frame);
-            startPoint->pending = false;
-            startPoint->immediate = true;
-            startPoint->frame = frame;
+            startPoint->setPending(false);
+            startPoint->setImmediate(true);
+            startPoint->setFrame(frame);
         }
     }
 
@@ -3611,11 +3668,11 @@ void Synchronizer::doRealign(Loop* l, Event* pulse, Event* realign)
 	if (wait != NULL && 
         wait->pending && 
         wait->fields.script.waitType == WAIT_REALIGN) {
-		wait->pending = false;
+		wait->setPending(false);
 		// note that we use the special immediate option since
 		// the loop frame can be chagned by SyncStartPoint
-		wait->immediate = true;
-		wait->frame = l->getFrame();
+		wait->setImmediate(true);
+		wait->setFrame(l->getFrame());
 	}
 }
 
@@ -3894,9 +3951,9 @@ void Synchronizer::checkDrift(SyncTracker* tracker)
                     wait->fields.script.waitType == WAIT_DRIFT_CHECK) {
                     // activate it now
                     Loop* loop = t->getLoop();
-                    wait->pending = false;
-                    wait->immediate = true;
-                    wait->frame = loop->getFrame();
+                    wait->setPending(false);
+                    wait->setImmediate(true);
+                    wait->setFrame(loop->getFrame());
                 }
             }
         }
@@ -126,6 +126,8 @@ class Synchronizer {
 
     int getInBeatsPerBar();
 	float getInTempo();
+	float getInJitter();
+	float getInMaxJitter();
 	int getInRawBeat();
 	int getInBeat();
 	int getInBar();
@@ -169,6 +171,8 @@ class Synchronizer {
 	bool event(MidiEvent* e);
 
 	void interruptStart(class MobiusContainer* container);
+    bool hasInterruptEvents();
+    void setParallel(bool b);
     void prepare(class Track* t);
     void finish(class Track* t);
 	void interruptEnd();
@@ -317,6 +321,9 @@ class Synchronizer {
     Event* mReturnEvent;
     Event* mNextAvailableEvent;
 
+    // true while TrackRenderer is processing tracks
+    bool mParallel;
+
 	float mHostTempo;
 	int mHostBeat;
 	int mHostBeatsPerBar;
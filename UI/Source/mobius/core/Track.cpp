@@ -798,9 +798,9 @@ void Track::getState(MobiusTrackState* s)
  *                                                                          *
  ****************************************************************************/
 
-Audio* Track::getPlaybackAudio()
+LayerSnapshot* Track::getPlaybackSnapshot()
 {
-    return mLoop->getPlaybackAudio();
+    return mLoop->getPlaybackSnapshot();
 }
 
 /****************************************************************************
@@ -1149,14 +1149,17 @@ void Track::notifyBufferModified(float* buffer)
  *    mNoSetupChanges
  *
  * If both of these is on, then we can avoid refreshing the preset.
- * There will still be a lot of false positive though.  ANY change
- * to a preset will trigger a refresh even if it was for a preset
- * the track is not using.
+ * MobiusConfig::diff also marks the presets that changed so a track
+ * only refreshes when the preset it is using was edited.
+ *
+ * mNoGlobalChanges is set when none of the global parameters
+ * changed and we can skip updateGlobalParameters.
  */
 void Track::updateConfiguration(MobiusConfig* config)
 {
     // propagate some of the global parameters to the Loops
-    updateGlobalParameters(config);
+    if (!config->isNoGlobalChanges())
+      updateGlobalParameters(config);
 
     // Refresh the preset if it might have changed
     Preset* newPreset = NULL;
@@ -1178,18 +1181,24 @@ void Track::updateConfiguration(MobiusConfig* config)
         if (this == mMobius->getTrack()) {
             // current track follows the lingering selection
             // newPreset = config->getCurrentPreset();
-            newPreset = config->getDefaultPreset();
+            // unless it is already using it and it didn't change
+            Preset* dflt = config->getDefaultPreset();
+            if (dflt->isChanged() || mPreset->ordinal != dflt->ordinal)
+              newPreset = dflt;
         }
         else {
             // other tracks refresh the preset but retain their current
             // selection which may be different than the setup
             // newPreset = config->getPreset(mPreset->getNumber());
-            newPreset = config->getPreset(mPreset->ordinal);
-            if (newPreset == NULL) {
+            Preset* p = config->getPreset(mPreset->ordinal);
+            if (p == NULL) {
                 // can this happen?  maybe if we deleted the preset
                 // the track was using?
                 newPreset = config->getDefaultPreset();
             }
+            else if (p->isChanged()) {
+                newPreset = p;
+            }
         }
     }
     
@@ -1217,6 +1226,10 @@ void Track::updateConfiguration(MobiusConfig* config)
 void Track::updateGlobalParameters(MobiusConfig* config)
 {
 
+    // before latency since the better ones add some
+    mInput->setResampleQuality(config->getResampleQuality());
+    mOutput->setResampleQuality(config->getResampleQuality());
+
     // do NOT get latency from the config, Mobius calculates it
     mInput->setLatency(mMobius->getEffectiveInputLatency());
     mOutput->setLatency(mMobius->getEffectiveOutputLatency());
@@ -57,6 +57,7 @@ class Track : public TraceContext
 	friend class RecordFunction;
     friend class EventManager;
     friend class StreamState;
+    friend class TrackRenderer;
 
   public:
 
@@ -235,7 +236,7 @@ class Track : public TraceContext
     // Unit test interface
 	//
 
-    Audio* getPlaybackAudio();
+    class LayerSnapshot* getPlaybackSnapshot();
 	class Loop* getLoop();
     void setInterruptBreakpoint(bool b);
     void interruptBreakpoint();
@@ -0,0 +1,354 @@
+/**
+ * Optional parallel rendering of tracks during the audio interrupt.
+ * See TrackRenderer.h for the overview.
+ *
+ * The job list is shared with the workers using two atomic counters.
+ * The audio thread fills in the job arrays, then opens the list by
+ * storing zero in mNextJob.  Workers and the audio thread claim jobs
+ * by incrementing mNextJob and bump mFinished when each job is done.
+ * When every job has finished, mNextJob is closed again by setting it
+ * to a value no job index can reach so a worker that wakes up late
+ * can't claim a job from the next interrupt before it is ready.
+ *
+ * Getting an index from mNextJob isn't enough to render it, the
+ * job state also has to be moved out of JobWaiting.  If a worker
+ * claims an index and is descheduled before it starts, the audio
+ * thread stops spinning after TrackRendererSpins and renders
+ * any job that hasn't been started itself.
+ */
+
+#include <JuceHeader.h>
+
+#include "../../util/Trace.h"
+
+#include "../MobiusContainer.h"
+
+#include "AudioConstants.h"
+#include "Action.h"
+#include "Function.h"
+#include "Mode.h"
+#include "Track.h"
+#include "BlockProfiler.h"
+
+#include "../AudioPool.h"
+
+#include "TrackRenderer.h"
+
+#if JUCE_INTEL
+#include <emmintrin.h>
+#endif
+
+/**
+ * Value of mNextJob when there is nothing to claim.
+ * Workers may increment it a few times while closed so leave room.
+ */
+const int TrackRendererClosed = 1 << 30;
+
+/**
+ * Number of times the audio thread spins waiting for workers
+ * before it renders the jobs they haven't started.
+ */
+const int TrackRendererSpins = 4096;
+
+/**
+ * Job states.  Jobs are left JobFinished between interrupts.
+ */
+const int JobWaiting = 0;
+const int JobRunning = 1;
+const int JobFinished = 2;
+
+/**
+ * Tell the processor we're in a spin loop.
+ */
+static inline void SpinPause()
+{
+#if JUCE_INTEL
+    _mm_pause();
+#elif JUCE_ARM && !JUCE_MSVC
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Worker
+//
+//////////////////////////////////////////////////////////////////////
+
+TrackRenderer::Worker::Worker(TrackRenderer* r, int number) :
+    Thread(juce::String("MobiusTrackWorker") + juce::String(number))
+{
+    renderer = r;
+}
+
+TrackRenderer::Worker::~Worker()
+{
+}
+
+void TrackRenderer::Worker::run()
+{
+    // we only render tracks so we're always in the interrupt
+    AudioPool::setInterrupt(true);
+
+    while (!threadShouldExit()) {
+        // notify() from the audio thread breaks us out of this
+        wait(-1);
+        if (!threadShouldExit())
+          renderer->runJobs();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Renderer
+//
+//////////////////////////////////////////////////////////////////////
+
+TrackRenderer::TrackRenderer()
+{
+    mEnabled = false;
+    mProfiler = nullptr;
+    mBuffers = nullptr;
+    mMaxJobs = 0;
+    mStates = nullptr;
+    mContainer = nullptr;
+    mJobs = nullptr;
+    mInputs = nullptr;
+    mFrames = 0;
+    mPending = 0;
+    mJobCount = 0;
+    mNextJob = TrackRendererClosed;
+    mFinished = 0;
+}
+
+TrackRenderer::~TrackRenderer()
+{
+    stop();
+
+    for (int i = 0 ; i < mMaxJobs ; i++)
+      delete[] mBuffers[i];
+    delete[] mBuffers;
+    delete[] mStates;
+    delete[] mJobs;
+    delete[] mInputs;
+}
+
+/**
+ * Allocate a private buffer for every track, even though the priority
+ * track never gets here, it is easier than figuring out which one it
+ * will be.
+ */
+void TrackRenderer::start(int workers, int tracks)
+{
+    if (workers > 0 && tracks > 1 && mWorkers.size() == 0) {
+
+        mMaxJobs = tracks;
+        mBuffers = new float*[tracks];
+        for (int i = 0 ; i < tracks ; i++) {
+            mBuffers[i] = new float[AUDIO_MAX_SAMPLES_PER_BUFFER];
+            memset(mBuffers[i], 0, sizeof(float) * AUDIO_MAX_SAMPLES_PER_BUFFER);
+        }
+        mJobs = new Track*[tracks];
+        mInputs = new float*[tracks];
+        mStates = new std::atomic<int>[tracks];
+        for (int i = 0 ; i < tracks ; i++)
+          mStates[i] = JobFinished;
+
+        // no point in having more workers than there are tracks
+        // to share with the audio thread
+        if (workers > tracks - 1)
+          workers = tracks - 1;
+
+        // the options are immutable, the with methods return a copy
+        juce::Thread::RealtimeOptions options = juce::Thread::RealtimeOptions().withPriority(10);
+
+        for (int i = 0 ; i < workers ; i++) {
+            Worker* w = new Worker(this, i + 1);
+            if (w->startRealtimeThread(options)) {
+                mWorkers.add(w);
+            }
+            else {
+                Trace(1, "TrackRenderer: Unable to start worker thread\n");
+                delete w;
+            }
+        }
+
+        Trace(2, "TrackRenderer: Started %ld workers for %ld tracks\n",
+              (long)mWorkers.size(), (long)tracks);
+    }
+}
+
+void TrackRenderer::stop()
+{
+    for (auto w : mWorkers)
+      w->signalThreadShouldExit();
+
+    for (auto w : mWorkers) {
+        w->notify();
+        if (!w->stopThread(1000))
+          Trace(1, "TrackRenderer: Unable to stop worker thread\n");
+    }
+
+    mWorkers.clear();
+    mEnabled = false;
+}
+
+bool TrackRenderer::isEnabled()
+{
+    return (mEnabled && mWorkers.size() > 0);
+}
+
+void TrackRenderer::setEnabled(bool b)
+{
+    mEnabled = b;
+}
+
+void TrackRenderer::setProfiler(BlockProfiler* p)
+{
+    mProfiler = p;
+}
+
+void TrackRenderer::reset()
+{
+    mPending = 0;
+}
+
+bool TrackRenderer::add(Track* t)
+{
+    bool added = false;
+    if (mPending < mMaxJobs) {
+        mJobs[mPending] = t;
+        mPending++;
+        added = true;
+    }
+    return added;
+}
+
+int TrackRenderer::getCount()
+{
+    return mPending;
+}
+
+/**
+ * Render the quiet tracks.  The Mobius order rules have already been
+ * applied, the only thing we have to be careful about is the shared
+ * interrupt output buffer which is why each track gets its own.
+ *
+ * The private buffers are merged in track order so the result does
+ * not depend on which thread finished first.
+ */
+void TrackRenderer::render(MobiusContainer* cont)
+{
+    int count = mPending;
+    long frames = cont->getInterruptFrames();
+    int samples = (int)(frames * AUDIO_MAX_CHANNELS);
+    if (samples > AUDIO_MAX_SAMPLES_PER_BUFFER) {
+        // the serial path would have had the same problem,
+        // but don't write past our own buffers
+        Trace(1, "TrackRenderer: Block too large %ld\n", frames);
+        samples = AUDIO_MAX_SAMPLES_PER_BUFFER;
+        frames = samples / AUDIO_MAX_CHANNELS;
+    }
+
+    mContainer = cont;
+    mFrames = frames;
+    for (int i = 0 ; i < count ; i++) {
+        float* input = nullptr;
+        cont->getInterruptBuffers(mJobs[i]->getInputPort(), &input, 0, nullptr);
+        mInputs[i] = input;
+        juce::FloatVectorOperations::clear(mBuffers[i], samples);
+        mStates[i].store(JobWaiting);
+    }
+    mJobCount = count;
+    mFinished.store(0);
+
+    // open the job list, this publishes everything above
+    mNextJob.store(0, std::memory_order_release);
+
+    for (auto w : mWorkers)
+      w->notify();
+
+    // help out until there is nothing left to claim
+    runJobs();
+
+    // then wait for the ones the workers claimed, these are short
+    // so spin rather than giving up the core
+    int spins = 0;
+    while (mFinished.load(std::memory_order_acquire) < count) {
+        if (spins < TrackRendererSpins) {
+            SpinPause();
+            spins++;
+        }
+        else if (spins == TrackRendererSpins) {
+            // a worker claimed something and hasn't started it,
+            // don't let it hold up the interrupt
+            for (int i = 0 ; i < count ; i++) {
+                if (claimJob(i)) {
+                    renderJob(i);
+                    mFinished.fetch_add(1, std::memory_order_release);
+                }
+            }
+            spins++;
+        }
+        else {
+            // what's left is being rendered by a worker that
+            // got preempted, all we can do is let it run
+            juce::Thread::yield();
+        }
+    }
+
+    mNextJob.store(TrackRendererClosed);
+
+    for (int i = 0 ; i < count ; i++) {
+        Track* t = mJobs[i];
+        float* output = nullptr;
+        cont->getInterruptBuffers(0, nullptr, t->getOutputPort(), &output);
+        if (output != nullptr)
+          juce::FloatVectorOperations::add(output, mBuffers[i], samples);
+    }
+
+    mPending = 0;
+}
+
+/**
+ * Claim and render jobs until there are none left.
+ * Called by the workers and the audio thread.
+ */
+void TrackRenderer::runJobs()
+{
+    int index = mNextJob.fetch_add(1, std::memory_order_acquire);
+    while (index < mJobCount) {
+        if (claimJob(index)) {
+            renderJob(index);
+            mFinished.fetch_add(1, std::memory_order_release);
+        }
+        index = mNextJob.fetch_add(1, std::memory_order_acquire);
+    }
+}
+
+/**
+ * Take a job if nobody else has started it.
+ */
+bool TrackRenderer::claimJob(int index)
+{
+    int expected = JobWaiting;
+    return mStates[index].compare_exchange_strong(expected, JobRunning,
+                                                  std::memory_order_acquire);
+}
+
+void TrackRenderer::renderJob(int index)
+{
+    Track* t = mJobs[index];
+    juce::int64 start = BlockProfiler::now();
+
+    t->processBuffers(mContainer, mInputs[index], mBuffers[index], mFrames);
+    mStates[index].store(JobFinished, std::memory_order_release);
+
+    // a track is only in one job so there is only one writer
+    if (mProfiler != nullptr)
+      mProfiler->addTrack(t->getRawNumber(), BlockProfiler::now() - start);
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
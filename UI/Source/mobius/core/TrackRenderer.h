@@ -0,0 +1,128 @@
+/**
+ * Optional parallel rendering of tracks during the audio interrupt.
+ *
+ * Normally Mobius processes every Track one after another in the
+ * audio thread.  With a large number of tracks that can use up the
+ * entire block deadline on one core while the others are idle.
+ *
+ * TrackRenderer owns a small fixed pool of realtime worker threads.
+ * During the interrupt Mobius hands it the tracks that are "quiet" in
+ * this block, meaning they will do nothing but record and play with
+ * no events, no loop boundaries, and no sync activity.  Each of those
+ * renders into a private output buffer, and the audio thread waits
+ * for all of them to finish before the buffers are summed into the
+ * shared interrupt output buffers.
+ *
+ * The audio thread participates in the work, so if a worker is slow
+ * to wake up the interrupt still finishes, it just won't be any faster
+ * than it was before.  The audio thread only ever waits for a track
+ * that a worker has already started.
+ *
+ * Anything that might touch another track, the Synchronizer,
+ * or the script runtime is still done serially by Mobius, see
+ * Mobius::containerAudioAvailable for the rules.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <JuceHeader.h>
+
+class TrackRenderer
+{
+  public:
+
+    TrackRenderer();
+    ~TrackRenderer();
+
+    /**
+     * Called during Mobius initialization to create the threads
+     * and the private output buffers.  This allocates and must
+     * not be called in the audio thread.
+     */
+    void start(int workers, int tracks);
+
+    /**
+     * Called during Mobius shutdown to stop the threads.
+     */
+    void stop();
+
+    /**
+     * True if we have threads and the configuration wants them used.
+     */
+    bool isEnabled();
+    void setEnabled(bool b);
+
+    /**
+     * Each job is timed for the profiler owned by Mobius.
+     */
+    void setProfiler(class BlockProfiler* p);
+
+    /**
+     * Build the job list for the next interrupt.  Called in the
+     * audio thread, add returns false if the track can't be added.
+     */
+    void reset();
+    bool add(class Track* t);
+    int getCount();
+
+    /**
+     * Render the tracks that were added in parallel and merge the
+     * private output buffers into the container's buffers when finished.
+     * Called in the audio thread.
+     */
+    void render(class MobiusContainer* cont);
+
+  private:
+
+    /**
+     * The worker threads just wait to be told there is something
+     * to do, then join in on the job list.
+     */
+    class Worker : public juce::Thread
+    {
+      public:
+        Worker(TrackRenderer* r, int number);
+        ~Worker();
+        void run() override;
+      private:
+        TrackRenderer* renderer;
+    };
+
+    void runJobs();
+    bool claimJob(int index);
+    void renderJob(int index);
+
+    juce::OwnedArray<Worker> mWorkers;
+    bool mEnabled;
+    class BlockProfiler* mProfiler;
+
+    // one private output buffer for each possible job
+    float** mBuffers;
+    int mMaxJobs;
+
+    // JobState of each job, a job is only rendered by the
+    // thread that moves it out of JobWaiting
+    std::atomic<int>* mStates;
+
+    // the current job list, set up by the audio thread before
+    // mNextJob is opened
+    class MobiusContainer* mContainer;
+    class Track** mJobs;
+    float** mInputs;
+    long mFrames;
+    int mPending;
+    std::atomic<int> mJobCount;
+
+    // index of the next job to claim, held at a large value
+    // between interrupts so late workers find nothing to do
+    std::atomic<int> mNextJob;
+
+    // number of jobs that have been completed
+    std::atomic<int> mFinished;
+
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -2941,6 +2941,62 @@ void SyncInReceivingVariableType::getTrackValue(Track* t, ExValue* value)
 SyncInReceivingVariableType SyncInReceivingVariableObj;
 ScriptInternalVariable* SyncInReceivingVariable = &SyncInReceivingVariableObj;
 
+//////////////////////////////////////////////////////////////////////
+//
+// syncInJitter
+//
+// Average milliseconds between when MIDI clocks were received and
+// when the tempo estimator expected them.  Zero until it locks.
+//
+//////////////////////////////////////////////////////////////////////
+
+class SyncInJitterVariableType : public ScriptInternalVariable {
+  public:
+    SyncInJitterVariableType();
+	void getTrackValue(Track* t, ExValue* value);
+};
+
+SyncInJitterVariableType::SyncInJitterVariableType()
+{
+    setName("syncInJitter");
+}
+
+void SyncInJitterVariableType::getTrackValue(Track* t, ExValue* value)
+{
+	value->setFloat(t->getSynchronizer()->getInJitter());
+}
+
+SyncInJitterVariableType SyncInJitterVariableObj;
+ScriptInternalVariable* SyncInJitterVariable = &SyncInJitterVariableObj;
+
+//////////////////////////////////////////////////////////////////////
+//
+// syncInMaxJitter
+//
+// Largest number of milliseconds a MIDI clock arrived away from
+// where the tempo estimator expected it since it locked.
+//
+//////////////////////////////////////////////////////////////////////
+
+class SyncInMaxJitterVariableType : public ScriptInternalVariable {
+  public:
+    SyncInMaxJitterVariableType();
+	void getTrackValue(Track* t, ExValue* value);
+};
+
+SyncInMaxJitterVariableType::SyncInMaxJitterVariableType()
+{
+    setName("syncInMaxJitter");
+}
+
+void SyncInMaxJitterVariableType::getTrackValue(Track* t, ExValue* value)
+{
+	value->setFloat(t->getSynchronizer()->getInMaxJitter());
+}
+
+SyncInMaxJitterVariableType SyncInMaxJitterVariableObj;
+ScriptInternalVariable* SyncInMaxJitterVariable = &SyncInMaxJitterVariableObj;
+
 //////////////////////////////////////////////////////////////////////
 //
 // syncInStarted
@@ -3320,6 +3376,8 @@ ScriptInternalVariable* InternalVariables[] = {
 	SyncInBeatVariable,
 	SyncInBarVariable,
 	SyncInReceivingVariable,
+	SyncInJitterVariable,
+	SyncInMaxJitterVariable,
 	SyncInStartedVariable,
 
 	// Host sync
@@ -87,7 +87,7 @@ Event* BounceFunction::invoke(Action* action, Loop* loop)
 			// be dead space until the first loop is finished, maybe better
 			// to just ignore it here?
 			event = Function::scheduleEvent(action, loop);
-			event->frame = 0;
+			event->setFrame(0);
 		}
 		else if (mode == ResetMode) {
 			// what does this mean?  
@@ -112,7 +112,7 @@ Event* BounceFunction::invoke(Action* action, Loop* loop)
 				long desired = frame - loop->getInputLatency() - loop->getOutputLatency();
 				if (desired < 0)
 				  desired = 0;
-				event->frame = desired;
+				event->setFrame(desired);
 			}
 		}
 	}
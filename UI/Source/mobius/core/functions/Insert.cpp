@@ -264,7 +264,7 @@ Event* InsertFunction::scheduleEvent(Action* action, Loop* l)
 		if (action->down) {
 			event = em->getFunctionEvent(action, l, this);
 			// make it unquantized, could have this logic in getFunctionEvent?
-			event->frame = l->getFrame() + l->getInputLatency();
+			event->setFrame(l->getFrame() + l->getInputLatency());
 			em->addEvent(event);
 		}
 	}
@@ -865,8 +865,8 @@ Event* LoopTriggerFunction::scheduleSwitch(Action* action,
                 // calculated from the end of the mode, not the 
                 // current loop position.
                 
-                event->frame = modeEnd->frame;
-                event->pending = false;
+                event->setFrame(modeEnd->frame);
+                event->setPending(false);
 
                 // In theory we could set up a preplay, but
                 // I'm afraid this will confuse the play jump for the
@@ -920,7 +920,7 @@ Event* LoopTriggerFunction::addSwitchEvent(Action* action,
 
 	switche->savePreset(current->getPreset());
 
-	switche->pending = true;
+	switche->setPending(true);
 	switche->quantized = true;	// so it can be undone
 	switche->fields.loopSwitch.nextLoop = next;
     
@@ -1191,8 +1191,8 @@ void LoopTriggerFunction::confirmEvent(Action* action,
 		  l->validate(NULL);
 
 		// activate the switch event
-		switche->frame = switchFrame;
-		switche->pending = false;
+		switche->setFrame(switchFrame);
+		switche->setPending(false);
 		switche->quantized = quantized;
 
 		// setup a jump event for early playback
@@ -127,7 +127,7 @@ Event* MidiStartFunction::scheduleEvent(Action* action, Loop* l)
 	if (mode == ResetMode) {
 		// send MidiStart regardless of Sync mode
 		startEvent = Function::scheduleEvent(action, l);
-		startEvent->frame = l->getFrame();
+		startEvent->setFrame(l->getFrame());
 	}
 	else {
 		// since this isn't a mode, catch redundant invocations
@@ -162,7 +162,7 @@ Event* MidiStartFunction::scheduleEvent(Action* action, Loop* l)
 			if (startEvent != NULL && !startEvent->reschedule) {
 
 				// !! should this be the "end frame" or zero?
-				startEvent->frame = l->getFrames();
+				startEvent->setFrame(l->getFrames());
 				startEvent->quantized = true;
 
 				// could remember this for undo?  
@@ -277,7 +277,7 @@ Event* MidiStopFunction::scheduleEvent(Action* action, Loop* l)
 {
 	Event* e = Function::scheduleEvent(action, l);
 	if (l->getMode() == ResetMode)
-	  e->frame = l->getFrame();
+	  e->setFrame(l->getFrame());
 	return e;
 }
 
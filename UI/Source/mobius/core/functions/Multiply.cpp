@@ -373,7 +373,7 @@ void MultiplyFunction::doEvent(Loop* l, Event* e)
         // we're now at frame zero, to avoid event timing warnings 
         // in EventManager::processEvent, set the event frame back to zero too
         if (pruned)
-          e->frame = 0;
+          e->setFrame(0);
 
         // resume play/overdub
         l->resumePlay();
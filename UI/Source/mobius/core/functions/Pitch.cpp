@@ -213,6 +213,7 @@ class PitchFunction : public Function {
     void applyPitchChange(Loop* l, PitchChange* change, bool both);
     void applyPitchChange(PitchChange* change, Stream* s);
     void calculateNewPitch(PitchChange* change);
+    void adjustPlayFrame(Loop* l, int lastLatency);
 	PitchFunctionType mType;
     bool mCanRestart;
 };
@@ -554,9 +555,8 @@ Event* PitchFunction::scheduleEvent(Action* action, Loop* l)
                 annotateEvent(event, &change);
 
                 // !! not messing with a play jump event yet, just change
-                // both streams at the same time.  This is NOT right
-                // since turning pitch on and off results in HUGE
-                // latency changes
+                // both streams at the same time, doEvent moves the
+                // play frame when the shifter latency comes or goes
             }
         }
     }
@@ -717,6 +717,7 @@ void PitchFunction::doEvent(Loop* l, Event* e)
 
         Stream* istream = l->getInputStream();
         Stream* ostream = l->getOutputStream();
+        int lastLatency = ostream->latency;
 
         istream->setPitch(e->fields.pitchRestore.octave, 
                           e->fields.pitchRestore.step,
@@ -726,6 +727,8 @@ void PitchFunction::doEvent(Loop* l, Event* e)
                           e->fields.pitchRestore.step,
                           e->fields.pitchRestore.bend);
 
+        adjustPlayFrame(l, lastLatency);
+
         // here only after loop switch, will the SwitchEvent do validation?
         //l->validate(e);
     }
@@ -745,6 +748,7 @@ void PitchFunction::doEvent(Loop* l, Event* e)
 
         Trace(l, 2, "Pitch: Setting %s %ld\n", sunit, (long)value);
         
+        int lastLatency = l->getOutputStream()->latency;
         applyPitchChange(l, &change, true);
 
         if (mCanRestart && l->getPreset()->isPitchShiftRestart()) {
@@ -756,6 +760,9 @@ void PitchFunction::doEvent(Loop* l, Event* e)
             Synchronizer* sync = l->getSynchronizer();
             sync->loopRestart(l);
         }
+        else {
+            adjustPlayFrame(l, lastLatency);
+        }
 
         // normally we will stay in mute 
         l->checkMuteCancel(e);
@@ -763,6 +770,18 @@ void PitchFunction::doEvent(Loop* l, Event* e)
     }
 }
 
+/**
+ * Starting or ending a shift adds or removes the shifter latency.
+ * Since we don't schedule a play jump the play frame has to move to
+ * keep the output aligned with the record frame.  The shifter starts
+ * empty and the stream captures fade tails so the skip isn't heard.
+ */
+void PitchFunction::adjustPlayFrame(Loop* l, int lastLatency)
+{
+    if (l->getOutputStream()->latency != lastLatency && l->getFrames() > 0)
+      l->recalculatePlayFrame();
+}
+
 /**
  * Convert the contents of an Event into a PitchChange.
  */
@@ -200,7 +200,7 @@ Event* RealignFunction::scheduleEvent(Action* action, Loop* l)
 			// go through the usual scheduling, but make it pending
 			realignEvent = Function::scheduleEvent(action, l);
 			if (realignEvent != NULL && !realignEvent->reschedule) {
-				realignEvent->pending = true;
+				realignEvent->setPending(true);
 				realignEvent->quantized = true;
 
 				// could remember this for undo?  
@@ -464,12 +464,12 @@ void ReverseFunction::doEvent(Loop* l, Event* e)
             // in that case don't reverse the frame which will leave it
             // at the last frame and confuse pending event scheduling
             if (e->frame == origFrame)
-              e->frame = newFrame;
+              e->setFrame(newFrame);
             else {
                 // !! hey, what about the -1 adjustment we do for mFrame, 
                 // isn't that needed here too?
                 Trace(l, 1, "Loop: Possible event reflection error!\n");
-                e->frame = reverseFrame(l, e->frame);
+                e->setFrame(reverseFrame(l, e->frame));
             }
 
             // I don't think these are issues because we'd cancel
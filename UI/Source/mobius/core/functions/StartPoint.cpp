@@ -127,7 +127,7 @@ Event* StartPointFunction::scheduleEvent(Action* action, Loop* l)
 			if (mMidi) {
 				// we scheduled it normally, but make it pending so we can
 				// defer triggering it until the external start point happens
-				event->pending = true;
+				event->setPending(true);
 			}
 		}
 	}
@@ -144,7 +144,7 @@ void StartPointFunction::invokeLong(Action* action, Loop* l)
 		Event* event = em->findEvent(StartPointEvent);
 		if (event != NULL) {
 			// we haven't processed the simple StartPoint yet
-			event->pending = true;
+			event->setPending(true);
 			event->function = SyncStartPoint;
 		}
 		else {
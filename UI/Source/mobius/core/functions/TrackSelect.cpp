@@ -398,7 +398,7 @@ Event* TrackSelectFunction::invoke(Action* action, Loop* l)
                     else if (leaveAction == Preset::TRACK_LEAVE_CANCEL) {
                         // we supposed to cancel but not wait,  
                         // restore the original frame
-                        event->frame = selectFrame;
+                        event->setFrame(selectFrame);
                     }
 
                     // in all cases don't schedule another one
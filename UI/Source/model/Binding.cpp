@@ -266,6 +266,7 @@ BindingSet::~BindingSet()
 BindingSet::BindingSet(BindingSet* src)
 {
     mBindings = nullptr;
+    setName(src->getName());
 
     Binding* last = nullptr;
     Binding* srcBinding = src->getBindings();
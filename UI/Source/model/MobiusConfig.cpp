@@ -141,6 +141,7 @@ void MobiusConfig::init()
 
     mNoPresetChanges = false;
     mNoSetupChanges = false;
+    mNoGlobalChanges = false;
 
     // this causes confusion when not on since key bindings often don't work
 #ifdef _WIN32
@@ -159,6 +160,10 @@ void MobiusConfig::init()
     mLogStatus = false;
 
     mEdpisms = false;
+    mTrackWorkers = 0;
+    mMaxLoopMemory = 0;
+    mStreamSamples = false;
+    mResampleQuality = 0;
 }
 
 MobiusConfig::~MobiusConfig()
@@ -743,6 +748,14 @@ bool MobiusConfig::isNoSetupChanges() {
 	return mNoSetupChanges;
 }
 
+void MobiusConfig::setNoGlobalChanges(bool b) {
+	mNoGlobalChanges = b;
+}
+
+bool MobiusConfig::isNoGlobalChanges() {
+	return mNoGlobalChanges;
+}
+
 void MobiusConfig::setNoSyncBeatRounding(bool b) {
 	mNoSyncBeatRounding = b;
 }
@@ -767,6 +780,38 @@ bool MobiusConfig::isEdpisms() {
 	return mEdpisms;
 }
 
+void MobiusConfig::setTrackWorkers(int i) {
+	mTrackWorkers = i;
+}
+
+int MobiusConfig::getTrackWorkers() {
+	return mTrackWorkers;
+}
+
+void MobiusConfig::setMaxLoopMemory(int i) {
+	mMaxLoopMemory = i;
+}
+
+int MobiusConfig::getMaxLoopMemory() {
+	return mMaxLoopMemory;
+}
+
+void MobiusConfig::setStreamSamples(bool b) {
+	mStreamSamples = b;
+}
+
+bool MobiusConfig::isStreamSamples() {
+	return mStreamSamples;
+}
+
+void MobiusConfig::setResampleQuality(int i) {
+	mResampleQuality = i;
+}
+
+int MobiusConfig::getResampleQuality() {
+	return mResampleQuality;
+}
+
 /****************************************************************************
  *                                                                          *
  *                                    OSC                                   *
@@ -824,6 +869,194 @@ bool MobiusConfig::isOscEnable()
     return mOscEnable;
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                                   CLONE                                  *
+ *                                                                          *
+ ****************************************************************************/
+
+/**
+ * Make a full copy of the configuration.
+ * This used to be done by rendering XML and parsing it back, which
+ * for a large number of presets and bindings was most of the time
+ * spent in MobiusShell::configure.  The history list, the error
+ * and the transient change flags are not copied.
+ */
+MobiusConfig* MobiusConfig::clone()
+{
+    MobiusConfig* neu = new MobiusConfig(mDefault);
+
+	neu->mMidiInput = CopyString(mMidiInput);
+	neu->mMidiOutput = CopyString(mMidiOutput);
+	neu->mMidiThrough = CopyString(mMidiThrough);
+	neu->mPluginMidiInput = CopyString(mPluginMidiInput);
+	neu->mPluginMidiOutput = CopyString(mPluginMidiOutput);
+	neu->mPluginMidiThrough = CopyString(mPluginMidiThrough);
+	neu->mAudioInput = CopyString(mAudioInput);
+	neu->mAudioOutput = CopyString(mAudioOutput);
+	neu->mUIConfig = CopyString(mUIConfig);
+	neu->mQuickSave = CopyString(mQuickSave);
+    neu->mCustomMessageFile = CopyString(mCustomMessageFile);
+	neu->mUnitTests = CopyString(mUnitTests);
+
+	neu->mNoiseFloor = mNoiseFloor;
+	neu->mSuggestedLatency = mSuggestedLatency;
+	neu->mInputLatency = mInputLatency;
+	neu->mOutputLatency = mOutputLatency;
+	neu->mFadeFrames = mFadeFrames;
+	neu->mMaxSyncDrift = mMaxSyncDrift;
+	neu->mTracks = mTracks;
+    neu->mTrackGroups = mTrackGroups;
+    neu->mMaxLoops = mMaxLoops;
+    neu->mLongPress = mLongPress;
+
+    if (mFocusLockFunctions != nullptr)
+      neu->mFocusLockFunctions = new StringList(mFocusLockFunctions);
+    if (mMuteCancelFunctions != nullptr)
+      neu->mMuteCancelFunctions = new StringList(mMuteCancelFunctions);
+    if (mConfirmationFunctions != nullptr)
+      neu->mConfirmationFunctions = new StringList(mConfirmationFunctions);
+    if (mAltFeedbackDisables != nullptr)
+      neu->mAltFeedbackDisables = new StringList(mAltFeedbackDisables);
+
+    for (Preset* p = mPresets ; p != nullptr ; p = p->getNext())
+      neu->addPreset(new Preset(p));
+    neu->mDefaultPresetName = CopyString(mDefaultPresetName);
+
+    for (Setup* s = mSetups ; s != nullptr ; s = s->getNext())
+      neu->addSetup(new Setup(s));
+    neu->mStartingSetupName = CopyString(mStartingSetupName);
+
+    for (BindingSet* bs = mBindings ; bs != nullptr ; bs = bs->getNext())
+      neu->addBindingSet(new BindingSet(bs));
+    neu->mOverlayBindings = CopyString(mOverlayBindings);
+
+    if (mScriptConfig != nullptr)
+      neu->mScriptConfig = mScriptConfig->clone();
+    if (mSampleConfig != nullptr)
+      neu->mSampleConfig = new SampleConfig(mSampleConfig);
+    if (mOscConfig != nullptr)
+      neu->mOscConfig = new OscConfig(mOscConfig);
+
+    neu->mSampleRate = mSampleRate;
+	neu->mMonitorAudio = mMonitorAudio;
+    neu->mHostRewinds = mHostRewinds;
+	neu->mPluginPins = mPluginPins;
+    neu->mAutoFeedbackReduction = mAutoFeedbackReduction;
+    neu->mIsolateOverdubs = mIsolateOverdubs;
+    neu->mIntegerWaveFile = mIntegerWaveFile;
+	neu->mSpreadRange = mSpreadRange;
+	neu->mTracePrintLevel = mTracePrintLevel;
+	neu->mTraceDebugLevel = mTraceDebugLevel;
+	neu->mSaveLayers = mSaveLayers;
+	neu->mDriftCheckPoint = mDriftCheckPoint;
+	neu->mMidiRecordMode = mMidiRecordMode;
+    neu->mDualPluginWindow = mDualPluginWindow;
+    neu->mMidiExport = mMidiExport;
+    neu->mHostMidiExport = mHostMidiExport;
+    neu->mGroupFocusLock = mGroupFocusLock;
+
+    neu->mOscEnable = mOscEnable;
+    neu->mOscTrace = mOscTrace;
+    neu->mOscInputPort = mOscInputPort;
+    neu->mOscOutputPort = mOscOutputPort;
+    neu->mOscOutputHost = CopyString(mOscOutputHost);
+
+    neu->mNoSyncBeatRounding = mNoSyncBeatRounding;
+    neu->mLogStatus = mLogStatus;
+    neu->mEdpisms = mEdpisms;
+    neu->mTrackWorkers = mTrackWorkers;
+    neu->mMaxLoopMemory = mMaxLoopMemory;
+    neu->mStreamSamples = mStreamSamples;
+    neu->mResampleQuality = mResampleQuality;
+
+    return neu;
+}
+
+static bool StringListEqual(StringList* l1, StringList* l2)
+{
+    int size1 = (l1 != nullptr) ? l1->size() : 0;
+    int size2 = (l2 != nullptr) ? l2->size() : 0;
+    bool equal = (size1 == size2);
+    for (int i = 0 ; equal && i < size1 ; i++)
+      equal = StringEqual(l1->getString(i), l2->getString(i));
+    return equal;
+}
+
+/**
+ * Compare the global parameters the engine uses.
+ * Device names, UI settings and the things that have
+ * their own change detection are not included.
+ */
+bool MobiusConfig::isGlobalEqual(MobiusConfig* other)
+{
+    return (mNoiseFloor == other->mNoiseFloor &&
+            mSuggestedLatency == other->mSuggestedLatency &&
+            mInputLatency == other->mInputLatency &&
+            mOutputLatency == other->mOutputLatency &&
+            mFadeFrames == other->mFadeFrames &&
+            mMaxSyncDrift == other->mMaxSyncDrift &&
+            mTracks == other->mTracks &&
+            mTrackGroups == other->mTrackGroups &&
+            mMaxLoops == other->mMaxLoops &&
+            mLongPress == other->mLongPress &&
+            StringListEqual(mFocusLockFunctions, other->mFocusLockFunctions) &&
+            StringListEqual(mMuteCancelFunctions, other->mMuteCancelFunctions) &&
+            StringListEqual(mConfirmationFunctions, other->mConfirmationFunctions) &&
+            StringListEqual(mAltFeedbackDisables, other->mAltFeedbackDisables) &&
+            mSampleRate == other->mSampleRate &&
+            mMonitorAudio == other->mMonitorAudio &&
+            mHostRewinds == other->mHostRewinds &&
+            mPluginPins == other->mPluginPins &&
+            mAutoFeedbackReduction == other->mAutoFeedbackReduction &&
+            mIsolateOverdubs == other->mIsolateOverdubs &&
+            mIntegerWaveFile == other->mIntegerWaveFile &&
+            mSpreadRange == other->mSpreadRange &&
+            mSaveLayers == other->mSaveLayers &&
+            mDriftCheckPoint == other->mDriftCheckPoint &&
+            mMidiRecordMode == other->mMidiRecordMode &&
+            mGroupFocusLock == other->mGroupFocusLock &&
+            mNoSyncBeatRounding == other->mNoSyncBeatRounding &&
+            mEdpisms == other->mEdpisms &&
+            mTrackWorkers == other->mTrackWorkers &&
+            mMaxLoopMemory == other->mMaxLoopMemory &&
+            mResampleQuality == other->mResampleQuality);
+}
+
+/**
+ * Compare this configuration with the one it replaces and set
+ * the transient change flags so the kernel only propagates what
+ * changed.  Presets are compared by position since that is how
+ * tracks find their preset, and the ones that differ are marked
+ * changed.  Adding presets to the end doesn't count as a change,
+ * removing them or changing the default does.
+ */
+void MobiusConfig::diff(MobiusConfig* old)
+{
+    bool presetChanges = !StringEqual(mDefaultPresetName, old->mDefaultPresetName);
+    Preset* oldPreset = old->mPresets;
+    for (Preset* p = mPresets ; p != nullptr ; p = p->getNext()) {
+        bool changed = (oldPreset == nullptr ||
+                        !StringEqual(p->getName(), oldPreset->getName()) ||
+                        !p->isEqual(oldPreset));
+        p->setChanged(changed);
+        if (changed && oldPreset != nullptr)
+          presetChanges = true;
+        if (oldPreset != nullptr)
+          oldPreset = oldPreset->getNext();
+    }
+    if (oldPreset != nullptr)
+      presetChanges = true;
+    mNoPresetChanges = !presetChanges;
+
+    Setup* setup = getStartingSetup();
+    Setup* oldSetup = old->getStartingSetup();
+    mNoSetupChanges = (StringEqual(setup->getName(), oldSetup->getName()) &&
+                       setup->isEqual(oldSetup));
+
+    mNoGlobalChanges = isGlobalEqual(old);
+}
+
 /****************************************************************************
  *                                                                          *
  *                             PRESET MANAGEMENT                            *
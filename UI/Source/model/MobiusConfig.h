@@ -216,6 +216,7 @@ class MobiusConfig {
 	
     const char* getError();
     MobiusConfig* clone();
+    void diff(MobiusConfig* old);
 
     bool isDefault();
     void setHistory(MobiusConfig* config);
@@ -388,6 +389,18 @@ class MobiusConfig {
     void setEdpisms(bool b);
     bool isEdpisms();
 
+    void setTrackWorkers(int i);
+    int getTrackWorkers();
+
+    void setMaxLoopMemory(int i);
+    int getMaxLoopMemory();
+
+    void setStreamSamples(bool b);
+    bool isStreamSamples();
+
+    void setResampleQuality(int i);
+    int getResampleQuality();
+
     //
     // Transient fields for testing
     //
@@ -401,9 +414,13 @@ class MobiusConfig {
     void setNoPresetChanges(bool b);
     bool isNoPresetChanges();
 
+    void setNoGlobalChanges(bool b);
+    bool isNoGlobalChanges();
+
   private:
 
 	void init();
+    bool isGlobalEqual(MobiusConfig* other);
     //void generateNames(class Bindable* bindables, const char* prefix, 
     //const char* baseName);
     //void numberThings(class Bindable* things);
@@ -635,6 +652,7 @@ class MobiusConfig {
     // maintained by the tracks.   I don't really like this...
     bool mNoPresetChanges;
     bool mNoSetupChanges;
+    bool mNoGlobalChanges;
 
     /**
      * True to enable the OSC interface.
@@ -693,6 +711,42 @@ class MobiusConfig {
      */
     bool mEdpisms;
 
+    /**
+     * Number of worker threads used to render tracks in parallel
+     * during the audio interrupt.  Zero disables parallel rendering
+     * and all tracks are processed one after another in the audio thread.
+     * Threads are created during initialization, so changing this
+     * requires a restart.  It is intended for rigs with a large number
+     * of tracks and is not exposed as a Parameter.
+     */
+    int mTrackWorkers;
+
+    /**
+     * Maximum number of megabytes the AudioPool may allocate for
+     * loop audio.  Zero means to use the AudioPool default.
+     * The pool is filled to this size when it is initialized and
+     * the audio thread never allocates.  If it is exhausted the audio
+     * thread gets a shared silent block instead and the overflow is
+     * counted.
+     */
+    int mMaxLoopMemory;
+
+    /**
+     * When true, sample files are memory mapped and only the start
+     * of each one is read when samples are loaded.  The rest is read
+     * in the background the first time the sample is triggered.
+     * Unit tests always read samples completely.
+     */
+    bool mStreamSamples;
+
+    /**
+     * Interpolation used when tracks are speed shifted.
+     * 0 is linear, 1 cubic, 2 and 3 are 16 and 64 point sinc.
+     * The higher ones cost more and add a little latency but don't
+     * alias at large shifts.  See ResampleQuality in core/Resampler.h.
+     */
+    int mResampleQuality;
+
 };
 
 /****************************************************************************/
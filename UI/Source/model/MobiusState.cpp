@@ -2,6 +2,9 @@
  * Object capturing the runtime state of the Mobius engine.
  */
 
+#include <string.h>
+#include <stddef.h>
+
 #include "ModeDefinition.h"
 #include "MobiusState.h"
 
@@ -69,6 +72,7 @@ void MobiusLoopState::init()
 void  MobiusTrackState::init()
 {
 	number = 0;
+    version = 0;
 	preset = 0;
 	loopCount = 0;  // old initialized this to 1
 	inputMonitorLevel = 0;
@@ -115,10 +119,140 @@ void MobiusState::init()
     globalRecording = false;
     activeTrack = 0;
     trackCount = 0;
+    version = 0;
     for (int i = 0 ; i < MobiusStateMaxTracks ; i++)
       tracks[i].init();
+    profile.init();
 };
 
+void MobiusTimingState::init()
+{
+    p50 = 0;
+    p99 = 0;
+    max = 0;
+}
+
+void MobiusProfileState::init()
+{
+    window = 0;
+    deadline = 0;
+    utilization50 = 0;
+    utilization99 = 0;
+    utilizationMax = 0;
+    overruns = 0;
+    for (int i = 0 ; i < ProfilePhaseCount ; i++)
+      phases[i].init();
+    for (int i = 0 ; i < MobiusStateMaxTracks ; i++)
+      tracks[i].init();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// MobiusStateBuffer
+//
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * The states are zeroed before they are initialized so the bytes
+ * between fields compare equal in isSame.  Nothing after this
+ * assigns whole objects so they stay that way.
+ */
+MobiusStateBuffer::MobiusStateBuffer()
+{
+    states = new MobiusState[3];
+    for (int i = 0 ; i < 3 ; i++) {
+        memset((void*)&(states[i]), 0, sizeof(MobiusState));
+        states[i].init();
+    }
+}
+
+MobiusStateBuffer::~MobiusStateBuffer()
+{
+    delete[] states;
+}
+
+/**
+ * Return the state the writer is allowed to fill in.
+ */
+MobiusState* MobiusStateBuffer::getWriteState()
+{
+    return &(states[writeIndex]);
+}
+
+/**
+ * Make the write state visible to the reader and take the
+ * middle state to write next.
+ */
+void MobiusStateBuffer::publish()
+{
+    MobiusState* neu = &(states[writeIndex]);
+
+    // the last one we published is either still in the middle or
+    // is held by the reader, either way nobody is writing it
+    if (lastPublished >= 0)
+      updateVersions(neu, &(states[lastPublished]));
+    
+    lastPublished = writeIndex;
+    int old = middle.exchange(writeIndex | MobiusStateFresh, std::memory_order_acq_rel);
+    writeIndex = old & ~MobiusStateFresh;
+}
+
+/**
+ * Return the most recently published state.
+ * If nothing was published since the last call this is the same
+ * state returned last time.
+ */
+MobiusState* MobiusStateBuffer::getReadState()
+{
+    if (middle.load(std::memory_order_relaxed) & MobiusStateFresh) {
+        int old = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = old & ~MobiusStateFresh;
+    }
+    return &(states[readIndex]);
+}
+
+/**
+ * Carry the versions forward from the last published state and bump
+ * the ones for tracks that changed.
+ */
+void MobiusStateBuffer::updateVersions(MobiusState* neu, MobiusState* old)
+{
+    neu->version = old->version + 1;
+
+    int count = neu->trackCount;
+    if (count > MobiusStateMaxTracks)
+      count = MobiusStateMaxTracks;
+    
+    for (int i = 0 ; i < count ; i++) {
+        MobiusTrackState* ntrack = &(neu->tracks[i]);
+        MobiusTrackState* otrack = &(old->tracks[i]);
+        ntrack->version = otrack->version;
+        if (i >= old->trackCount || !isSame(ntrack, otrack))
+          ntrack->version++;
+    }
+}
+
+/**
+ * Compare the populated parts of two track states.
+ * Version must already be the same.
+ */
+bool MobiusStateBuffer::isSame(MobiusTrackState* neu, MobiusTrackState* old)
+{
+    bool same = false;
+    
+    size_t header = offsetof(MobiusTrackState, loops);
+    if (memcmp(neu, old, header) == 0) {
+        int loops = neu->loopCount;
+        if (loops > MobiusStateMaxLoops)
+          loops = MobiusStateMaxLoops;
+        if (loops > 0)
+          same = (memcmp(neu->loops, old->loops, sizeof(MobiusLoopState) * loops) == 0);
+        else
+          same = true;
+    }
+    return same;
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // Simulation
@@ -70,10 +70,19 @@
  * LoopSummary which had a smaller model for the loops that were not active.
  * Saves a little maintenance but I'm not sure it's necessary.  The engine can just
  * not set things for loops that aren't active.
+ *
+ * Update: the engine no longer refreshes this from the UI thread.  At the end of
+ * every audio interrupt the kernel fills in one of three MobiusStates managed
+ * by MobiusStateBuffer and publishes it.  The UI gets the most recently published
+ * one, which will not change until the next time it asks.  Only the tracks up
+ * to trackCount and the loops up to loopCount within each track are maintained,
+ * anything beyond that is stale.
  */
 
 #pragma once
 
+#include <atomic>
+
 #include "SystemConstant.h"
 
 // for SyncSource, SyncUnit
@@ -246,6 +255,10 @@ class MobiusTrackState
     // this is 1 based!
     int number;
 
+    // incremented by the engine each time something in this track
+    // changes, the UI can remember it and skip tracks that haven't changed
+    int version;
+
     // name?  old model had a char* that was a direct reference
     // to the character array maintained in the Track
     // not sure we need this, you can get it from the external Setup
@@ -299,6 +312,77 @@ class MobiusTrackState
     MobiusLoopState loops[MobiusStateMaxLoops];
 };
 
+/**
+ * Phases of the audio interrupt measured by the profiler.
+ * ProfileBlock is the entire interrupt, the others are parts of it.
+ */
+typedef enum {
+
+    ProfileBlock,
+    ProfileSamples,
+    ProfileSyncStart,
+    ProfileActions,
+    ProfileTracks,
+    ProfileSyncEnd,
+    ProfileCapture,
+    ProfilePhaseCount
+
+} ProfilePhase;
+
+/**
+ * Timing for one phase or track over the last profile window.
+ * Times are in microseconds.
+ */
+class MobiusTimingState
+{
+  public:
+
+    MobiusTimingState() {
+        init();
+    }
+
+    void init();
+
+    int p50;
+    int p99;
+    int max;
+};
+
+/**
+ * Where the audio deadline went.
+ * The engine refreshes this about once a second so it describes
+ * a window of recent blocks rather than the last one.
+ */
+class MobiusProfileState
+{
+  public:
+
+    MobiusProfileState() {
+        init();
+    }
+
+    void init();
+
+    // incremented each time the window is refreshed
+    int window;
+
+    // microseconds available to process one block
+    int deadline;
+
+    // percent of the deadline used by the block at p50, p99, and max
+    int utilization50;
+    int utilization99;
+    int utilizationMax;
+
+    // blocks that missed the deadline since the engine started
+    int overruns;
+
+    MobiusTimingState phases[ProfilePhaseCount];
+
+    // only up to MobiusState::trackCount are used
+    MobiusTimingState tracks[MobiusStateMaxTracks];
+};
+
 /**
  * Overall state of the engine.
  */
@@ -330,9 +414,15 @@ class MobiusState
     // index of the active track
     int activeTrack;
 
+    // incremented each time the engine publishes
+    int version;
+
     // state for each track
     MobiusTrackState tracks[MobiusStateMaxTracks];
 
+    // audio interrupt timing
+    MobiusProfileState profile;
+
     // testing
     void simulate(MobiusState* state);
     void simulate(MobiusTrackState* track);
@@ -340,6 +430,59 @@ class MobiusState
 
 };
 
+/**
+ * Triple buffer of MobiusState used to pass state from the engine
+ * to the UI without locking and without the UI seeing a partially
+ * updated state.
+ *
+ * One thread writes into the state returned by getWriteState and
+ * then calls publish.  One thread calls getReadState to get the
+ * most recent published state, which it owns until the next call
+ * to getReadState.  The third state sits between them.
+ *
+ * The states are large so the engine only fills in populated tracks
+ * and loops.  publish compares just those against the previously
+ * published state to maintain the track versions.
+ */
+class MobiusStateBuffer
+{
+  public:
+
+    MobiusStateBuffer();
+    ~MobiusStateBuffer();
+
+    // writer
+    MobiusState* getWriteState();
+    void publish();
+
+    // reader
+    MobiusState* getReadState();
+
+  private:
+
+    void updateVersions(MobiusState* neu, MobiusState* old);
+    bool isSame(MobiusTrackState* neu, MobiusTrackState* old);
+
+    MobiusState* states = nullptr;
+
+    // only touched by the writer
+    int writeIndex = 0;
+    int lastPublished = -1;
+
+    // index of the state between the writer and the reader
+    // with MobiusStateFresh set if it was published after the
+    // reader last looked
+    std::atomic<int> middle {1};
+
+    // only touched by the reader
+    int readIndex = 2;
+};
+
+/**
+ * Bit set in MobiusStateBuffer::middle when it has not been read.
+ */
+const int MobiusStateFresh = 4;
+
 /****************************************************************************/
 /****************************************************************************/
 /****************************************************************************/
@@ -27,6 +27,34 @@ OscConfig::OscConfig()
 	init();
 }
 
+OscConfig::OscConfig(OscConfig* src)
+{
+	init();
+	mInputPort = src->getInputPort();
+	mOutputHost = CopyString(src->getOutputHost());
+	mOutputPort = src->getOutputPort();
+
+	OscBindingSet* lastSet = nullptr;
+	for (OscBindingSet* set = src->getBindings() ; set != nullptr ; set = set->getNext()) {
+		OscBindingSet* copy = new OscBindingSet(set);
+		if (lastSet == nullptr)
+		  mBindings = copy;
+		else
+		  lastSet->setNext(copy);
+		lastSet = copy;
+	}
+
+	OscWatcher* lastWatcher = nullptr;
+	for (OscWatcher* w = src->getWatchers() ; w != nullptr ; w = w->getNext()) {
+		OscWatcher* copy = new OscWatcher(w);
+		if (lastWatcher == nullptr)
+		  mWatchers = copy;
+		else
+		  lastWatcher->setNext(copy);
+		lastWatcher = copy;
+	}
+}
+
 void OscConfig::init()
 {
 	mInputPort = 0;
@@ -114,6 +142,27 @@ OscBindingSet::OscBindingSet()
 	init();
 }
 
+OscBindingSet::OscBindingSet(OscBindingSet* src)
+{
+	init();
+	mName = CopyString(src->getName());
+	mComments = CopyString(src->getComments());
+	mActive = src->isActive();
+	mInputPort = src->getInputPort();
+	mOutputHost = CopyString(src->getOutputHost());
+	mOutputPort = src->getOutputPort();
+
+	Binding* last = nullptr;
+	for (Binding* b = src->getBindings() ; b != nullptr ; b = b->getNext()) {
+		Binding* copy = new Binding(b);
+		if (last == nullptr)
+		  mBindings = copy;
+		else
+		  last->setNext(copy);
+		last = copy;
+	}
+}
+
 void OscBindingSet::init()
 {
 	mNext = nullptr;
@@ -238,6 +287,14 @@ OscWatcher::OscWatcher()
     init();
 }
 
+OscWatcher::OscWatcher(OscWatcher* src)
+{
+    init();
+    mPath = CopyString(src->getPath());
+    mName = CopyString(src->getName());
+    mTrack = src->getTrack();
+}
+
 void OscWatcher::init()
 {
     mNext = nullptr;
@@ -28,6 +28,7 @@ class OscConfig {
   public:
 
 	OscConfig();
+	OscConfig(OscConfig* src);
 	~OscConfig();
 
     // what's this for, parsing?
@@ -105,6 +106,7 @@ class OscBindingSet {
   public:
 
 	OscBindingSet();
+	OscBindingSet(OscBindingSet* src);
 	~OscBindingSet();
 
 	void setNext(OscBindingSet* s);
@@ -200,6 +202,7 @@ class OscWatcher {
   public:
 
     OscWatcher();
+    OscWatcher(OscWatcher* src);
     ~OscWatcher();
 
     OscWatcher* getNext();
@@ -23,6 +23,7 @@
 Preset::Preset()
 {
 	reset();
+    mChanged = true;
 }
 
 Preset::~Preset()
@@ -38,6 +39,7 @@ Preset::Preset(Preset* src)
 {
     setName(src->getName());
     copyNoAlloc(src);
+    mChanged = true;
 }
 
 /**
@@ -214,6 +216,78 @@ void Preset::copyNoAlloc(Preset* src)
     mWindowEdgeAmount = src->mWindowEdgeAmount;
 }
 
+/**
+ * Compare the parameters of two presets.
+ * Used when a new configuration is installed to find the presets
+ * that need to be sent to the tracks.  This must follow copyNoAlloc.
+ * The step sequences are compiled from their source so that is
+ * all we need to compare.
+ */
+bool Preset::isEqual(Preset* src)
+{
+    return (mLoops == src->mLoops &&
+            mSubcycles == src->mSubcycles &&
+            mMaxUndo == src->mMaxUndo &&
+            mMaxRedo == src->mMaxRedo &&
+            mNoFeedbackUndo == src->mNoFeedbackUndo &&
+            mNoLayerFlattening == src->mNoLayerFlattening &&
+            mAltFeedbackEnable == src->mAltFeedbackEnable &&
+            StringEqual(mSustainFunctions, src->mSustainFunctions) &&
+            mOverdubQuantized == src->mOverdubQuantized &&
+            mQuantize == src->mQuantize &&
+            mBounceQuantize == src->mBounceQuantize &&
+            mSwitchQuantize == src->mSwitchQuantize &&
+            mRecordThreshold == src->mRecordThreshold &&
+            mRecordResetsFeedback == src->mRecordResetsFeedback &&
+            mSpeedRecord == src->mSpeedRecord &&
+            mMultiplyMode == src->mMultiplyMode &&
+            mRoundingOverdub == src->mRoundingOverdub &&
+            mMuteMode == src->mMuteMode &&
+            mMuteCancel == src->mMuteCancel &&
+            mSlipTime == src->mSlipTime &&
+            mSlipMode == src->mSlipMode &&
+            mShuffleMode == src->mShuffleMode &&
+            mSpeedShiftRestart == src->mSpeedShiftRestart &&
+            mPitchShiftRestart == src->mPitchShiftRestart &&
+            StringEqual(mSpeedSequence.getSource(), src->mSpeedSequence.getSource()) &&
+            StringEqual(mPitchSequence.getSource(), src->mPitchSequence.getSource()) &&
+            mSpeedStepRange == src->mSpeedStepRange &&
+            mSpeedBendRange == src->mSpeedBendRange &&
+            mPitchStepRange == src->mPitchStepRange &&
+            mPitchBendRange == src->mPitchBendRange &&
+            mTimeStretchRange == src->mTimeStretchRange &&
+            mEmptyLoopAction == src->mEmptyLoopAction &&
+            mSwitchVelocity == src->mSwitchVelocity &&
+            mSwitchLocation == src->mSwitchLocation &&
+            mReturnLocation == src->mReturnLocation &&
+            mSwitchDuration == src->mSwitchDuration &&
+            mTimeCopyMode == src->mTimeCopyMode &&
+            mSoundCopyMode == src->mSoundCopyMode &&
+            mRecordTransfer == src->mRecordTransfer &&
+            mOverdubTransfer == src->mOverdubTransfer &&
+            mReverseTransfer == src->mReverseTransfer &&
+            mSpeedTransfer == src->mSpeedTransfer &&
+            mPitchTransfer == src->mPitchTransfer &&
+            mAutoRecordTempo == src->mAutoRecordTempo &&
+            mAutoRecordBars == src->mAutoRecordBars &&
+            mEmptyTrackAction == src->mEmptyTrackAction &&
+            mTrackLeaveAction == src->mTrackLeaveAction &&
+            mWindowSlideUnit == src->mWindowSlideUnit &&
+            mWindowSlideAmount == src->mWindowSlideAmount &&
+            mWindowEdgeUnit == src->mWindowEdgeUnit &&
+            mWindowEdgeAmount == src->mWindowEdgeAmount);
+}
+
+void Preset::setChanged(bool b)
+{
+    mChanged = b;
+}
+
+bool Preset::isChanged()
+{
+    return mChanged;
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 // Preset Parameters
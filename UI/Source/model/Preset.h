@@ -136,6 +136,13 @@ class Preset : public Structure {
     
     void reset();
     void copyNoAlloc(Preset* src);
+
+    // true if the parameters are the same, the name is not compared
+    bool isEqual(Preset* other);
+
+    // transient, set by MobiusConfig::diff when this was edited
+    void setChanged(bool b);
+    bool isChanged();
     
     // 
     // Limits
@@ -861,6 +868,9 @@ class Preset : public Structure {
      */
     int mWindowEdgeAmount;
 
+    // transient, not copied
+    bool mChanged;
+
 };
 
 /****************************************************************************/
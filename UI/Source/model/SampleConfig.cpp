@@ -18,6 +18,16 @@ SampleConfig::SampleConfig()
 	mSamples = nullptr;
 }
 
+/**
+ * Copy the sample definitions, loaded data is not copied.
+ */
+SampleConfig::SampleConfig(SampleConfig* src)
+{
+	mSamples = nullptr;
+	for (Sample* s = src->getSamples() ; s != nullptr ; s = s->getNext())
+	  add(new Sample(s));
+}
+
 SampleConfig::~SampleConfig()
 {
 	delete mSamples;
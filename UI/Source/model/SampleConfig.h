@@ -56,6 +56,7 @@ class SampleConfig
   public:
 
 	SampleConfig();
+	SampleConfig(SampleConfig* src);
 	~SampleConfig();
 
 	void clear();
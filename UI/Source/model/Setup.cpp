@@ -169,6 +169,43 @@ Setup::Setup(Setup* src)
     }
 }
 
+/**
+ * Compare two setups, used to decide whether a new configuration
+ * needs to be sent to the tracks.  This must follow the copy
+ * constructor.  Variables aren't copied so they aren't compared.
+ */
+bool Setup::isEqual(Setup* src)
+{
+    bool equal = (StringEqual(mResetRetains, src->getResetRetains()) &&
+                  mActiveTrack == src->getActiveTrack() &&
+                  StringEqual(mBindings, src->getBindings()) &&
+                  mSyncSource == src->getSyncSource() &&
+                  mSyncUnit == src->getSyncUnit() &&
+                  mSyncTrackUnit == src->getSyncTrackUnit() &&
+                  mManualStart == src->isManualStart() &&
+                  mMinTempo == src->getMinTempo() &&
+                  mMaxTempo == src->getMaxTempo() &&
+                  mBeatsPerBar == src->getBeatsPerBar() &&
+                  mMuteSyncMode == src->getMuteSyncMode() &&
+                  mResizeSyncAdjust == src->getResizeSyncAdjust() &&
+                  mSpeedSyncAdjust == src->getSpeedSyncAdjust() &&
+                  mRealignTime == src->getRealignTime() &&
+                  mOutRealignMode == src->getOutRealignMode());
+
+    SetupTrack* track = mTracks;
+    SetupTrack* srcTrack = src->getTracks();
+    while (equal && (track != nullptr || srcTrack != nullptr)) {
+        if (track == nullptr || srcTrack == nullptr)
+          equal = false;
+        else {
+            equal = track->isEqual(srcTrack);
+            track = track->getNext();
+            srcTrack = srcTrack->getNext();
+        }
+    }
+    return equal;
+}
+
 /**
  * Put the setup into the standard state for unit tests.
  */
@@ -482,6 +519,26 @@ SetupTrack::SetupTrack(SetupTrack* src)
 	// !! TODO: copy mVariables
 }
 
+bool SetupTrack::isEqual(SetupTrack* src)
+{
+    return (StringEqual(mName, src->getName()) &&
+            StringEqual(mStartingPresetName, src->getStartingPresetName()) &&
+            mFocusLock == src->isFocusLock() &&
+            mGroup == src->getGroup() &&
+            mInputLevel == src->getInputLevel() &&
+            mOutputLevel == src->getOutputLevel() &&
+            mFeedback == src->getFeedback() &&
+            mAltFeedback == src->getAltFeedback() &&
+            mPan == src->getPan() &&
+            mMono == src->isMono() &&
+            mAudioInputPort == src->getAudioInputPort() &&
+            mAudioOutputPort == src->getAudioOutputPort() &&
+            mPluginInputPort == src->getPluginInputPort() &&
+            mPluginOutputPort == src->getPluginOutputPort() &&
+            mSyncSource == src->getSyncSource() &&
+            mSyncTrackUnit == src->getSyncTrackUnit());
+}
+
 /**
  * Called by the UI to return the track to an initial state.
  * Since we've already been initialized have to be careful
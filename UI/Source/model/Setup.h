@@ -150,6 +150,9 @@ class Setup : public Structure {
     ~Setup();
 
     Structure* clone();
+
+    // true if everything but the name is the same
+    bool isEqual(Setup* other);
     
     // put it it the standard state for the unit tests
     void reset(class Preset* p);
@@ -337,6 +340,8 @@ class SetupTrack {
 	// SetupTrack* clone();
 	void reset();
 
+    bool isEqual(SetupTrack* other);
+
     // will need to sort this out
 	//void capture(class MobiusState* state);
 
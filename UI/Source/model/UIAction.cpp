@@ -45,6 +45,16 @@ UIAction::~UIAction()
  * handle this.
  */
 UIAction::UIAction(UIAction* src)
+{
+    scriptArgs = nullptr;
+    copy(src);
+}
+
+/**
+ * Copy everything but the chain pointer and the script arguments.
+ * Used to reuse an action that was allocated in advance.
+ */
+void UIAction::copy(UIAction* src)
 {
     // this never conveys
     next = nullptr;
@@ -79,6 +89,7 @@ UIAction::UIAction(UIAction* src)
     escapeQuantization = src->escapeQuantization;
     noLatency = src->noLatency;
     noSynchronization = src->noSynchronization;
+    timestamp = src->timestamp;
     
     // Arguments
     strcpy(bindingArgs, src->bindingArgs);
@@ -88,6 +99,7 @@ UIAction::UIAction(UIAction* src)
     // todo: I don't think this is used in the UI
     // if so hide it under functions
     // it's an ExValueList and I don't want to mess with copying it yet
+    delete scriptArgs;
     scriptArgs = nullptr;
 }
 
@@ -125,6 +137,7 @@ void UIAction::init()
     escapeQuantization = false;
     noLatency = false;
     noSynchronization = false;
+    timestamp = 0.0;
     
     // Arguments
     strcpy(bindingArgs, "");
@@ -110,6 +110,7 @@ class UIAction {
 	~UIAction();
 
     void init(class Binding* b);
+    void copy(UIAction* src);
     void reset();
     void resolve();
 
@@ -305,6 +306,13 @@ class UIAction {
      */
     bool noSynchronization;
 
+    /**
+     * High resolution millisecond time the trigger was received,
+     * zero if it doesn't matter.  Set for MIDI triggers so the engine
+     * can place them within the block.
+     */
+    double timestamp;
+
     //////////////////////////////////////////////////////////////////////
     //
     // Arguments
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <atomic>
 
 #include "../util/Util.h"
 
@@ -93,6 +94,17 @@ UserVariable* UserVariable::getNext()
 UserVariables::UserVariables()
 {
 	mVariables = nullptr;
+    newGeneration();
+}
+
+/**
+ * Generations are unique across all collections so a slot can't
+ * match a new collection allocated where a deleted one was.
+ */
+void UserVariables::newGeneration()
+{
+    static std::atomic<int> Generations {0};
+    mGeneration = ++Generations;
 }
 
 UserVariables::~UserVariables()
@@ -109,6 +121,7 @@ void UserVariables::setVariables(UserVariable* list)
 {
     delete mVariables;
     mVariables = list;
+    newGeneration();
 }
 
 UserVariable* UserVariables::getVariable(const char* name)
@@ -152,6 +165,47 @@ void UserVariables::set(const char* name, ExValue* value)
 	}
 }
 
+/**
+ * Variables are only deleted all at once, and new ones are added
+ * to the front, so a variable found once stays valid until the
+ * generation changes.  Misses are not remembered since the
+ * variable may be set later.
+ */
+UserVariable* UserVariables::getVariable(const char* name, UserVariableSlot* slot)
+{
+    UserVariable* v = nullptr;
+    if (slot->container == this && slot->generation == mGeneration &&
+        slot->variable != nullptr) {
+        v = slot->variable;
+    }
+    else {
+        v = getVariable(name);
+        if (v != nullptr) {
+            slot->container = this;
+            slot->generation = mGeneration;
+            slot->variable = v;
+        }
+    }
+    return v;
+}
+
+void UserVariables::get(const char* name, ExValue* value, UserVariableSlot* slot)
+{
+    value->setNull();
+	UserVariable* v = getVariable(name, slot);
+	if (v != nullptr)
+	  v->getValue(value);
+}
+
+void UserVariables::set(const char* name, ExValue* value, UserVariableSlot* slot)
+{
+	UserVariable* v = getVariable(name, slot);
+	if (v != nullptr)
+	  v->setValue(value);
+	else
+	  set(name, value);
+}
+
 /**
  * For now we're going to go with the presence of a UserVariable to 
  * mean that it was bound.  We'll need to change this if we allow the
@@ -179,6 +233,7 @@ void UserVariables::reset()
 {
 	delete mVariables;
     mVariables = nullptr;
+    newGeneration();
 }
 
 /****************************************************************************/
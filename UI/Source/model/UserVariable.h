@@ -53,6 +53,20 @@ class UserVariable {
 
 };
 
+/**
+ * A remembered reference to a variable in one UserVariables.
+ * Scripts keep one of these for each variable reference so repeated
+ * access doesn't search the list by name.  The generation changes
+ * whenever variables in the collection may have been deleted, which
+ * invalidates the slot.
+ */
+class UserVariableSlot {
+  public:
+    class UserVariables* container = nullptr;
+    int generation = 0;
+    UserVariable* variable = nullptr;
+};
+
 /**
  * Represents a collection of bound variables.
  * One of these represents a "scope" of variables, currently
@@ -75,9 +89,17 @@ class UserVariables {
 	bool isBound(const char* name);
     void reset();
 
+    // versions that remember where the variable was found
+    void get(const char* name, class ExValue* value, UserVariableSlot* slot);
+	void set(const char* name, class ExValue* value, UserVariableSlot* slot);
+
   private:
 
+    UserVariable* getVariable(const char* name, UserVariableSlot* slot);
+    void newGeneration();
+
 	UserVariable* mVariables;
+    int mGeneration;
 
 };
 
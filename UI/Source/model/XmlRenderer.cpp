@@ -463,6 +463,10 @@ void XmlRenderer::parseStructure(XmlElement* e, Structure* structure)
 
 #define ATT_LOG_STATUS "logStatus"
 #define ATT_EDPISMS "edpisms"
+#define ATT_TRACK_WORKERS "trackWorkers"
+#define ATT_MAX_LOOP_MEMORY "maxLoopMemory"
+#define ATT_STREAM_SAMPLES "streamSamples"
+#define ATT_RESAMPLE_QUALITY "resampleQuality"
 
 void XmlRenderer::render(XmlBuffer* b, MobiusConfig* c)
 {
@@ -537,6 +541,22 @@ void XmlRenderer::render(XmlBuffer* b, MobiusConfig* c)
     if (c->isEdpisms())
       b->addAttribute(ATT_EDPISMS, "true");
 
+    // not an official parameter, only for large track counts
+    if (c->getTrackWorkers() > 0)
+      b->addAttribute(ATT_TRACK_WORKERS, c->getTrackWorkers());
+
+    // not an official parameter, zero means the AudioPool default
+    if (c->getMaxLoopMemory() > 0)
+      b->addAttribute(ATT_MAX_LOOP_MEMORY, c->getMaxLoopMemory());
+
+    // not an official parameter, for large sample libraries
+    if (c->isStreamSamples())
+      b->addAttribute(ATT_STREAM_SAMPLES, "true");
+
+    // not an official parameter, zero is the original linear interpolation
+    if (c->getResampleQuality() > 0)
+      b->addAttribute(ATT_RESAMPLE_QUALITY, c->getResampleQuality());
+
 	b->add(">\n");
 	b->incIndent();
 
@@ -637,6 +657,10 @@ void XmlRenderer::parse(XmlElement* e, MobiusConfig* c)
 
     // not an official parameter yet
     c->setEdpisms(e->getBoolAttribute(ATT_EDPISMS));
+    c->setTrackWorkers(e->getIntAttribute(ATT_TRACK_WORKERS));
+    c->setMaxLoopMemory(e->getIntAttribute(ATT_MAX_LOOP_MEMORY));
+    c->setStreamSamples(e->getBoolAttribute(ATT_STREAM_SAMPLES));
+    c->setResampleQuality(e->getIntAttribute(ATT_RESAMPLE_QUALITY));
 
 	//c->setSampleRate((AudioSampleRate)parse(e, UIParameterSampleRate));
 
@@ -234,6 +234,15 @@ void LayerElement::paint(juce::Graphics& g)
 // Test Actions
 //////////////////////////////////////////////////////////////////////
 
+/**
+ * Only Undo, Redo and Debug need to be seen from MIDI bindings and
+ * only while testing.  Coverage comes from an ActionButton.
+ */
+bool LayerElement::isInterceptingTriggers()
+{
+    return doTest;
+}
+
 /**
  * Intercept an ActionButton function action.
  * We're in the UI message loop and not part of the update() thread
@@ -259,6 +268,7 @@ bool LayerElement::doAction(UIAction* action)
             testLoop.redoCount = 0;
             testLoop.lostRedo = 0;
         }
+        Supervisor::Instance->updateTriggerInterception();
         handled = true;
     }
 
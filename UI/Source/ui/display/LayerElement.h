@@ -32,6 +32,7 @@ class LayerElement : public StatusElement, public Supervisor::ActionListener
 
     // intercept some of the ActionButtons to simulate layer state
     bool doAction(class UIAction* a);
+    bool isInterceptingTriggers() override;
     
   private:
 
@@ -0,0 +1,139 @@
+/**
+ * Displays the audio interrupt profile.
+ *
+ * The top line has the block deadline and how much of it was used,
+ * followed by one line for each phase and track with p50, p99,
+ * and max in microseconds and a bar showing p99 against the deadline.
+ * Bars turn red when the block p99 passes 80% of the deadline
+ * since that is usually where dropouts start.
+ */
+
+#include <JuceHeader.h>
+
+#include "../../model/UIConfig.h"
+#include "../../model/MobiusState.h"
+
+#include "Colors.h"
+#include "StatusArea.h"
+#include "ProfileElement.h"
+
+const int ProfileLineHeight = 14;
+const int ProfileLabelWidth = 60;
+const int ProfileNumberWidth = 45;
+const int ProfileBarWidth = 100;
+const int ProfileWarning = 80;
+
+static const char* ProfilePhaseNames[] = {
+    "Block",
+    "Samples",
+    "Sync",
+    "Actions",
+    "Tracks",
+    "SyncEnd",
+    "Capture"
+};
+
+ProfileElement::ProfileElement(StatusArea* area) :
+    StatusElement(area, "ProfileElement")
+{
+}
+
+ProfileElement::~ProfileElement()
+{
+}
+
+void ProfileElement::configure(UIConfig* config)
+{
+}
+
+/**
+ * Leave room for the maximum number of tracks rather than
+ * changing size when the track count changes.
+ */
+int ProfileElement::getPreferredHeight()
+{
+    return ProfileLineHeight * (1 + ProfilePhaseCount + 8);
+}
+
+int ProfileElement::getPreferredWidth()
+{
+    return ProfileLabelWidth + (ProfileNumberWidth * 3) + ProfileBarWidth + 8;
+}
+
+void ProfileElement::resized()
+{
+}
+
+/**
+ * The profile only changes when the engine closes a window.
+ */
+void ProfileElement::update(MobiusState* state)
+{
+    if (profile.window != state->profile.window ||
+        trackCount != state->trackCount) {
+
+        profile = state->profile;
+        trackCount = state->trackCount;
+        repaint();
+    }
+}
+
+void ProfileElement::paint(juce::Graphics& g)
+{
+    // borders, labels, etc.
+    StatusElement::paint(g);
+
+    juce::Rectangle<int> area = getLocalBounds().reduced(2);
+    g.setColour(juce::Colours::black);
+    g.fillRect(area);
+    g.setFont(juce::Font((float)(ProfileLineHeight - 2)));
+
+    juce::String summary = "Deadline " + juce::String(profile.deadline) +
+        "us used " + juce::String(profile.utilization50) +
+        "/" + juce::String(profile.utilization99) +
+        "/" + juce::String(profile.utilizationMax) + "%" +
+        " overruns " + juce::String(profile.overruns);
+
+    g.setColour((profile.overruns > 0) ? juce::Colour(MobiusRed) : juce::Colour(MobiusBlue));
+    g.drawText(summary, area.removeFromTop(ProfileLineHeight), juce::Justification::centredLeft);
+
+    for (int i = 0 ; i < ProfilePhaseCount ; i++)
+      paintTiming(g, area.removeFromTop(ProfileLineHeight), ProfilePhaseNames[i],
+                  &(profile.phases[i]));
+
+    for (int i = 0 ; i < trackCount && i < MobiusStateMaxTracks ; i++) {
+        if (area.getHeight() < ProfileLineHeight)
+          break;
+        juce::String label = "Track " + juce::String(i + 1);
+        paintTiming(g, area.removeFromTop(ProfileLineHeight), label.toUTF8(),
+                    &(profile.tracks[i]));
+    }
+}
+
+void ProfileElement::paintTiming(juce::Graphics& g, juce::Rectangle<int> area,
+                                 const char* label, MobiusTimingState* timing)
+{
+    g.setColour(juce::Colour(MobiusBlue));
+    g.drawText(label, area.removeFromLeft(ProfileLabelWidth), juce::Justification::centredLeft);
+    g.drawText(juce::String(timing->p50), area.removeFromLeft(ProfileNumberWidth),
+               juce::Justification::centredRight);
+    g.drawText(juce::String(timing->p99), area.removeFromLeft(ProfileNumberWidth),
+               juce::Justification::centredRight);
+    g.drawText(juce::String(timing->max), area.removeFromLeft(ProfileNumberWidth),
+               juce::Justification::centredRight);
+
+    if (profile.deadline > 0) {
+        juce::Rectangle<int> bar = area.removeFromLeft(ProfileBarWidth).reduced(4, 3);
+        int percent = (timing->p99 * 100) / profile.deadline;
+        int width = (bar.getWidth() * juce::jmin(percent, 100)) / 100;
+        
+        g.setColour(juce::Colours::darkgrey);
+        g.drawRect(bar);
+        g.setColour((percent >= ProfileWarning) ? juce::Colour(MobiusRed) : juce::Colour(MobiusGreen));
+        g.fillRect(bar.withWidth(width));
+    }
+}
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
@@ -0,0 +1,41 @@
+/**
+ * Status element to display where the audio interrupt time went.
+ * Diagnostic, shows the MobiusProfileState from the engine.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "../../model/MobiusState.h"
+#include "StatusElement.h"
+
+class ProfileElement : public StatusElement
+{
+  public:
+    
+    ProfileElement(class StatusArea* area);
+    ~ProfileElement();
+
+    void configure(class UIConfig* config) override;
+    void update(class MobiusState* state) override;
+    int getPreferredWidth() override;
+    int getPreferredHeight() override;
+
+    void resized() override;
+    void paint(juce::Graphics& g) override;
+
+  private:
+
+    // copy of what we're displaying, only changes once a second
+    MobiusProfileState profile;
+    int trackCount = 0;
+
+    void paintTiming(juce::Graphics& g, juce::Rectangle<int> area,
+                     const char* label, MobiusTimingState* timing);
+    
+};
+
+/****************************************************************************/
+/****************************************************************************/
+/****************************************************************************/
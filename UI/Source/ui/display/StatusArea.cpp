@@ -42,6 +42,7 @@ StatusArea::StatusArea(MobiusDisplay* parent)
     addElement(&audioMeter);
     addElement(&layers);
     addElement(&alerts);
+    addElement(&profile);
 }
 
 void StatusArea::addElement(StatusElement* el)
@@ -18,6 +18,7 @@
 #include "AudioMeterElement.h"
 #include "LayerElement.h"
 #include "AlertElement.h"
+#include "ProfileElement.h"
 
 class StatusArea : public juce::Component
 {
@@ -55,6 +56,7 @@ class StatusArea : public juce::Component
     AudioMeterElement audioMeter {this};
     LayerElement layers {this};
     AlertElement alerts {this};
+    ProfileElement profile {this};
     
     void addElement(StatusElement* el);
     void addMissing(StatusElement* el);
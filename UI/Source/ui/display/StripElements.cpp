@@ -334,7 +334,13 @@ void StripLoopStack::update(MobiusState* state)
     int tracknum = strip->getTrackNumber();
 
     // paint needs the entire track so save it locally
-    track = &(state->tracks[tracknum]);
+    MobiusTrackState* tstate = &(state->tracks[tracknum]);
+    if (track == nullptr || tstate->version != lastVersion ||
+        tstate->number != trackState.number) {
+        trackState = *tstate;
+        lastVersion = tstate->version;
+        track = &trackState;
+    }
     MobiusLoopState* activeLoop = &(track->loops[track->activeLoop]);
 
     if (lastActive != track->activeLoop ||
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "../../model/MobiusState.h"
+
 #include "StripElement.h"
 #include "StripRotary.h"
 
@@ -98,6 +100,10 @@ class StripLoopStack : public StripElement
   private:
 
     int maxLoops = 0;
+    // paint needs the whole track and the state may be reused
+    // by the engine after update, so keep a copy
+    MobiusTrackState trackState;
+    int lastVersion = -1;
     class MobiusTrackState* track = nullptr;
     int lastActive = -1;
     long lastFrame = 0;
@@ -111,11 +111,22 @@ void TrackStrip::resized()
     // could center the elements here or do it in layout
 }
 
+/**
+ * The engine bumps the track version whenever anything in the
+ * track changes so we can skip the elements if it didn't.
+ */
 void TrackStrip::update(MobiusState* state)
 {
-    for (int i = 0 ; i < elements.size() ; i++) {
-        StripElement* el = elements[i];
-        el->update(state);
+    int tnum = getTrackNumber();
+    MobiusTrackState* track = &(state->tracks[tnum]);
+    
+    if (tnum != lastTrack || track->version != lastVersion) {
+        for (int i = 0 ; i < elements.size() ; i++) {
+            StripElement* el = elements[i];
+            el->update(state);
+        }
+        lastTrack = tnum;
+        lastVersion = track->version;
     }
 
     if (activeTrack != state->activeTrack) {
@@ -57,6 +57,10 @@ class TrackStrip : public juce::Component
     // if we're a docked strip, this controls the border highlighting
     int activeTrack = 0;
 
+    // the track and version we last gave to the elements
+    int lastTrack = -1;
+    int lastVersion = -1;
+
 };
 
 
@@ -2,7 +2,7 @@
 // This is very old code that could use a refresh, but it is used EVERYWHERE
 // and I needed it early
 //
-// Replaced CriticalSection with Juce CriticalSection/ScopedLock
+// Replaced CriticalSection with a lock free ring
 // Lingering issues about where to get io.h and windows.h for DebugOutputStream
 // Forced it on for now, but when we get to the Mac port this will need
 // to be addressed.  Need something in Juce we can test for selective includes.
@@ -33,25 +33,24 @@
  * anything dangerous like allocating dynamic memory.
  *
  * For both of these reasons trace records are normally simply accumulated
- * in a global array which is then sent to the appropriate display method
+ * in a global ring which is then sent to the appropriate display method
  * by another thread outside the interrupt.
  *
- * Adding trace records should be synchronized since records can be added
- * by concurrent threads.  In practice there will only be one thread pulling
- * records out of the queue.
+ * Records can be added by concurrent threads without locking, see
+ * ClaimTrace.  There must only be one thread pulling records out of
+ * the ring at a time.
  *
- * The records are acumulated as a ring buffer with a head
- * pointer advanced as trace messages are added, and a tail pointer advanced
- * as messages are displayed.  This can be bypassed for testing purposes
- * by setting the TracetoStdout flag.
+ * Only the raw arguments are saved when a record is added, the sprintf
+ * happens when the ring is flushed.  This can be bypassed for testing
+ * purposes by setting the TracetoStdout flag.
  *
  */
 
-// CriticalSection/ScopedLocked
 #include <JuceHeader.h>
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <atomic>
 
 // where can we get this now?
 #define _WIN32 1
@@ -159,34 +158,46 @@ int TraceDebugLevel = 1;
 TraceListener* GlobalTraceListener = nullptr;
 
 /**
- * Trace records are accumulated in a global array.
- * In theory there could be thread synchronization problems, 
- * but in practice that would be rare as almost all trace messages
- * come from the interrupt thread.  I don't want to mess with
- * csects here, the only potential problem is loss of a message.
+ * Trace records are accumulated in a ring that is shared by every
+ * thread that traces, most of them coming from the audio thread.
+ * Adding a record does not lock or allocate, writers claim a slot
+ * by advancing TraceTail with compare-and-swap, fill it in, then
+ * publish it by advancing the record's sequence number.
+ *
+ * There must only be one reader at a time.  FlushTrace may be called
+ * from several threads when there is no GlobalTraceListener, so
+ * the reader side is guarded with a flag, if someone else is already
+ * flushing we just leave our records for them.
+ *
+ * The ring starts with a static array and may be replaced during
+ * startup with SetTraceCapacity.
  */
-TraceRecord TraceRecords[MAX_TRACE_RECORDS];
+TraceRecord TraceDefaultRecords[MAX_TRACE_RECORDS];
+TraceRecord* TraceRecords = TraceDefaultRecords;
+unsigned int TraceCapacity = MAX_TRACE_RECORDS;
 
 /**
- * Csect needed for the head pointer since we can be adding
- * trace from several threads.
- * You must only flush trace from one thread.
+ * Position of the next record to be rendered.  Only the reader
+ * touches this.
  */
+unsigned int TraceHead = 0;
 
-// converted to Juce, and also it no longer leaks
-//CriticalSection* TraceCsect = new CriticalSection("Trace");
-juce::CriticalSection TraceCriticalSection;
+/**
+ * Position of the next record to be claimed by a writer.
+ */
+std::atomic<unsigned int> TraceTail {0};
 
 /**
- * Index into TraceRecords of the first active record.
- * If this is equal to TraceTail, then the message queue is empty.
+ * Set by the thread that is rendering records.
  */
-int TraceHead = 0;
+std::atomic_flag TraceFlushing = ATOMIC_FLAG_INIT;
 
 /**
- * The index into TraceRecords of the next available record.
+ * The number of records that could not be added because the
+ * ring was full, and the number we have already complained about.
  */
-int TraceTail = 0;
+std::atomic<int> TraceOverflows {0};
+int TraceOverflowsReported = 0;
 
 /**
  * A default object that may be registered to provide context and time
@@ -194,20 +205,97 @@ int TraceTail = 0;
  */
 TraceContext* DefaultTraceContext = nullptr;
 
-bool TraceInitialized = false;
+/**
+ * Set when the first record is added, after which the ring
+ * can't be replaced.
+ */
+std::atomic<bool> TraceInitialized {false};
 
 void TraceBreakpoint()
 {
 	int x = 0;
 }
 
+/**
+ * Give every record the sequence number of its first lap.
+ */
+void InitTraceRecords(TraceRecord* records, unsigned int capacity)
+{
+    for (unsigned int i = 0 ; i < capacity ; i++) {
+        records[i].msg[0] = 0;
+        records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Replace the trace ring with one of a different size.
+ * The size is rounded up to a power of two.
+ *
+ * Writers don't lock, so this can't be done safely once anything
+ * has been traced.  Supervisor calls this before the engine or
+ * the audio device are started.
+ */
+void SetTraceCapacity(int records)
+{
+    unsigned int capacity = 16;
+    while (capacity < (unsigned int)records)
+      capacity <<= 1;
+
+    if (TraceInitialized) {
+        trace("Trace: Unable to change capacity after tracing has started\n");
+    }
+    else if (capacity != TraceCapacity) {
+        TraceRecord* neu = new TraceRecord[capacity];
+        InitTraceRecords(neu, capacity);
+        TraceRecord* old = TraceRecords;
+        TraceRecords = neu;
+        TraceCapacity = capacity;
+        if (old != TraceDefaultRecords)
+          delete[] old;
+    }
+}
+
+int GetTraceOverflows()
+{
+    return TraceOverflows;
+}
+
+/**
+ * Make sure the sequence numbers are set before the first record.
+ */
+void StartTrace()
+{
+    if (!TraceInitialized) {
+        // normally happens in the UI thread during startup but
+        // in the off chance two threads get here, the second one
+        // waits until the records are ready
+        static std::atomic_flag starting = ATOMIC_FLAG_INIT;
+        if (!starting.test_and_set()) {
+            InitTraceRecords(TraceRecords, TraceCapacity);
+            TraceInitialized = true;
+        }
+        else {
+            while (!TraceInitialized) {
+            }
+        }
+    }
+}
+
 void ResetTrace()
 {
-    //TraceCsect->enter();
-    const juce::ScopedLock lock (TraceCriticalSection);
-    TraceHead = 0;
-    TraceTail = 0;
-    //TraceCsect->leave();
+    // just skip anything that hasn't been rendered
+    if (!TraceFlushing.test_and_set(std::memory_order_acquire)) {
+        unsigned int tail = TraceTail.load(std::memory_order_acquire);
+        while (TraceHead != tail) {
+            TraceRecord* r = &TraceRecords[TraceHead & (TraceCapacity - 1)];
+            if (r->sequence.load(std::memory_order_acquire) != TraceHead + 1)
+              break;
+            r->msg[0] = 0;
+            r->sequence.store(TraceHead + TraceCapacity, std::memory_order_release);
+            TraceHead++;
+        }
+        TraceFlushing.clear(std::memory_order_release);
+    }
 }
 
 /**
@@ -247,12 +335,57 @@ void SaveMessage(const char* src, char* dest)
     }
 }
 
+/**
+ * Claim the next record in the ring.
+ * Returns nullptr if the ring is full, in which case the new record
+ * is lost and counted.  We used to lose old records but that can
+ * overwrite the one being flushed.  The overflow is reported the next
+ * time the ring is flushed rather than here since we're usually in
+ * the audio thread.
+ */
+TraceRecord* ClaimTrace(unsigned int* position)
+{
+    TraceRecord* claimed = nullptr;
+
+    StartTrace();
+    
+    unsigned int pos = TraceTail.load(std::memory_order_relaxed);
+    while (claimed == nullptr) {
+        TraceRecord* r = &TraceRecords[pos & (TraceCapacity - 1)];
+        unsigned int seq = r->sequence.load(std::memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            // available, try to take it
+            if (TraceTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+              claimed = r;
+        }
+        else if (diff < 0) {
+            // the reader hasn't gotten to this one yet
+            TraceOverflows++;
+            break;
+        }
+        else {
+            // another writer got it first
+            pos = TraceTail.load(std::memory_order_relaxed);
+        }
+    }
+
+    *position = pos;
+    return claimed;
+}
+
+/**
+ * Make a claimed record visible to the reader.
+ */
+void PublishTrace(TraceRecord* r, unsigned int position)
+{
+    r->sequence.store(position + 1, std::memory_order_release);
+}
+
 /**
  * Add a trace record to the trace array.
- * If we're queueing and we fill the record array, we can either lose
- * old records or new ones.  New ones are more important, but we're not
- * supposed to increment TraceHead if TraceQueued is on.
- * 
+ * Only the raw arguments are saved, formatting happens when the
+ * ring is flushed.
  */
 void AddTrace(TraceContext* context, int level, 
               const char* msg, 
@@ -261,14 +394,6 @@ void AddTrace(TraceContext* context, int level,
               const char* string3,
               long l1, long l2, long l3, long l4, long l5)
 {
-	// kludge: trying to track down a problem, make sure the 
-	// records are initialized
-	if (!TraceInitialized) {
-		for (int i = 0 ; i < MAX_TRACE_RECORDS ; i++)
-          TraceRecords[i].msg[0] = 0;
-		TraceInitialized =  true;
-	}
-
     // trying to detect something weird
     if (msg == nullptr || strlen(msg) == 0) {
         msg = "!!!!!!!!!!! SHOULDN'T BE HERE !!!!!!!!!!!!!!";
@@ -277,37 +402,9 @@ void AddTrace(TraceContext* context, int level,
 	// only queue if it falls within the interesting levels
 	if (level <= TracePrintLevel || level <= TraceDebugLevel) {
 
-        // must csect this, the TraceTail can't advance
-        // until we've fully initialized the record or else
-        // the flush thread can try to render a partially
-        // initialized record
-        //TraceCsect->enter();
-        // note: the new Juce csect will have a longer scope
-        // than the old one, we released it early if we had a buffer overflow,
-        // shouldn't matter
-        const juce::ScopedLock lock (TraceCriticalSection);
-
-		TraceRecord* r = &TraceRecords[TraceTail];
-
-		int nextTail = TraceTail + 1;
-		if (nextTail >= MAX_TRACE_RECORDS)
-		  nextTail = 0;
-
-		if (nextTail == TraceHead) {
-            // overflow
-            // originally we bumped the head but that causes
-            // problems if the flush thread is active at the moment,
-            // we can overwtite the record being flushed causing
-            // a sprintf format/argument mismatch.  This can
-            // only happen when the refresh thread is bogged down 
-            // or excessive trace is being generated
-
-            // used to leave the csect early, but it's easier just to let
-            // it extend to the original scope
-            // TraceCsect->leave();
-            TraceEmit("WARNING: Trace record buffer overflow!!\n");
-		}
-        else {
+        unsigned int position = 0;
+		TraceRecord* r = ClaimTrace(&position);
+		if (r != nullptr) {
             // use the default context if none explictily passedn
             if (context == nullptr)
               context = DefaultTraceContext;
@@ -339,9 +436,8 @@ void AddTrace(TraceContext* context, int level,
                 printf("Trace: Unable to copy string arguments!\n");
             }
 
-            // only change the tail after the record is fully initialized
-            TraceTail = nextTail;
-            //TraceCsect->leave();
+            // only publish after the record is fully initialized
+            PublishTrace(r, position);
         }
 
 		// spot to hang a breakpoint
@@ -357,26 +453,9 @@ void AddTrace(TraceContext* context, int level,
  */
 void AddTrace(const char* msg) 
 {
-	// kludge: trying to track down a problem, make sure the 
-	// records are initialized
-	if (!TraceInitialized) {
-		for (int i = 0 ; i < MAX_TRACE_RECORDS ; i++)
-          TraceRecords[i].msg[0] = 0;
-		TraceInitialized =  true;
-	}
-    
-    const juce::ScopedLock lock (TraceCriticalSection);
-    
-    TraceRecord* r = &TraceRecords[TraceTail];
-
-    int nextTail = TraceTail + 1;
-    if (nextTail >= MAX_TRACE_RECORDS)
-      nextTail = 0;
-
-    if (nextTail == TraceHead) {
-        TraceRaw("WARNING: Trace record buffer overflow!!\n");
-    }
-    else {
+    unsigned int position = 0;
+    TraceRecord* r = ClaimTrace(&position);
+    if (r != nullptr) {
         r->level = 0;
         r->context = 0;
         r->time = 0;
@@ -396,8 +475,7 @@ void AddTrace(const char* msg)
             printf("Trace: Unable to copy string arguments!\n");
         }
         
-        // only change the tail after the record is fully initialized
-        TraceTail = nextTail;
+        PublishTrace(r, position);
     }
 }
 
@@ -470,38 +548,88 @@ void RenderTrace(TraceRecord* r, char* buffer)
  *                                                                          *
  ****************************************************************************/
 
-void WriteTrace(FILE* fp)
+/**
+ * Render every published record to a file or the emitters.
+ * Returns false if another thread is already flushing.
+ */
+bool RenderTraceRecords(FILE* fp)
 {
 	char buffer[1024 * 8];
 
-	// guard against mods during the flush, really that safe?
-    int tail = TraceHead;
-    {
-        const juce::ScopedLock lock (TraceCriticalSection);
-        tail = TraceTail;
+    if (TraceFlushing.test_and_set(std::memory_order_acquire))
+      return false;
+
+    int overflows = TraceOverflows;
+    if (overflows != TraceOverflowsReported) {
+        sprintf(buffer, "WARNING: Trace record buffer overflow!! %d records lost\n",
+                overflows - TraceOverflowsReported);
+        TraceOverflowsReported = overflows;
+        if (fp != nullptr)
+          fprintf(fp, "%s", buffer);
+        else
+          TraceEmit(buffer);
     }
 
-    fprintf(fp, "=========================================================\n");
-	while (TraceHead != tail) {
-        TraceRecord* r = &TraceRecords[TraceHead];
-		RenderTrace(r, buffer);
-		fprintf(fp, "%s", buffer);
-		TraceHead++;
-		if (TraceHead >= MAX_TRACE_RECORDS)
-		  TraceHead = 0;
+    // stop at the first record that hasn't been published yet,
+    // even if others after it have
+    bool more = TraceInitialized;
+    while (more) {
+        TraceRecord* r = &TraceRecords[TraceHead & (TraceCapacity - 1)];
+        if (r->sequence.load(std::memory_order_acquire) != TraceHead + 1) {
+            more = false;
+        }
+        else {
+            RenderTrace(r, buffer);
+
+            if (fp != nullptr) {
+                fprintf(fp, "%s", buffer);
+            }
+            else {
+                // not used any more what what the heck
+                // note that the way AddTrace works, if you
+                // set TracePrintLevel high it will now
+                // make TraceEmit unconditional, but you
+                // shoudlnt' be using PrintLevel anyway
+                if (r->level <= TracePrintLevel) {
+                    printf("%s", buffer);
+                    fflush(stdout);
+                }
+
+                TraceEmit(buffer);
+            }
+
+            // give it back to the writers for the next lap
+            r->sequence.store(TraceHead + TraceCapacity, std::memory_order_release);
+            TraceHead++;
+        }
     }
+
+    TraceFlushing.clear(std::memory_order_release);
+    return true;
 }
 
-void WriteTrace(const char* file)
+/**
+ * True if there is at least one record ready to render.
+ */
+bool HasTrace()
 {
-	// guard against mods during the flush, really that safe?
-    int tail = TraceHead;
-    {
-        const juce::ScopedLock lock (TraceCriticalSection);
-        tail = TraceTail;
+    bool ready = false;
+    if (TraceInitialized) {
+        TraceRecord* r = &TraceRecords[TraceHead & (TraceCapacity - 1)];
+        ready = (r->sequence.load(std::memory_order_acquire) == TraceHead + 1);
     }
+    return ready;
+}
 
-	if (TraceHead != tail) {
+void WriteTrace(FILE* fp)
+{
+    fprintf(fp, "=========================================================\n");
+    RenderTraceRecords(fp);
+}
+
+void WriteTrace(const char* file)
+{
+	if (HasTrace()) {
 		FILE* fp = fopen(file, "w");
 		if (fp != nullptr) {
 			WriteTrace(fp);
@@ -514,14 +642,7 @@ void WriteTrace(const char* file)
 
 void AppendTrace(const char* file)
 {
-	// guard against mods during the flush, really that safe?
-    int tail = TraceHead;
-    {
-        const juce::ScopedLock lock (TraceCriticalSection);
-        tail = TraceTail;
-    }
-    
-	if (TraceHead != tail) {
+	if (HasTrace()) {
 		FILE* fp = fopen(file, "a");
 		if (fp != nullptr) {
 			WriteTrace(fp);
@@ -537,37 +658,13 @@ void PrintTrace()
     WriteTrace(stdout);
 }
 
+/**
+ * Format and emit everything in the ring.
+ * This is where the sprintf happens, normally in MainThread.
+ */
 void FlushTrace()
 {
-	char buffer[1024 * 8];
-	
-	// guard against mods during the flush, really that safe?
-    int tail = TraceHead;
-    {
-        const juce::ScopedLock lock (TraceCriticalSection);
-        tail = TraceTail;
-    }
-
-	while (TraceHead != tail) {
-        TraceRecord* r = &TraceRecords[TraceHead];
-		RenderTrace(r, buffer);
-
-        // not used any more what what the heck
-        // note that the way AddTrace works, if you
-        // set TracePrintLevel high it will now
-        // make TraceEmit unconditional, but you
-        // shoudlnt' be using PrintLevel anyway
-		if (r->level <= TracePrintLevel) {
-			printf("%s", buffer);
-			fflush(stdout);
-		}
-
-        TraceEmit(buffer);
-
-		TraceHead++;
-		if (TraceHead >= MAX_TRACE_RECORDS)
-		  TraceHead = 0;
-    }
+    RenderTraceRecords(nullptr);
 }
 
 /**
@@ -18,6 +18,7 @@
 #define TRACE_H
 
 #include <stdarg.h>
+#include <atomic>
 // for juce::String
 #include <JuceHeader.h>
 
@@ -63,7 +64,11 @@ extern class TraceListener* GlobalTraceListener;
  *                                                                          *
  ****************************************************************************/
 
-#define MAX_TRACE_RECORDS 1000
+/**
+ * The default number of records in the trace ring.
+ * This can be changed with SetTraceCapacity and must be a power of two.
+ */
+#define MAX_TRACE_RECORDS 1024
 
 #define MAX_ARG 64
 #define MAX_MSG 256
@@ -81,6 +86,14 @@ class TraceRecord {
 
   public:
 
+    /**
+     * Ring position this record is waiting for.  Writers claim the
+     * record when it matches their position and publish it by
+     * advancing it by one, the reader advances it by a full lap
+     * after rendering.
+     */
+    std::atomic<unsigned int> sequence;
+
 	/* Message level */
 	int level;
 
@@ -191,6 +204,12 @@ void AppendTrace(const char* file);
 void PrintTrace();
 void FlushTrace();
 
+// change the size of the trace ring, only during startup
+void SetTraceCapacity(int records);
+
+// the number of records lost because the ring was full
+int GetTraceOverflows();
+
 /****************************************************************************
  *                                                                          *
  *   						   TRACE FUNCTIONS                              *